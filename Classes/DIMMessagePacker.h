@@ -36,11 +36,44 @@
 //
 
 #import <DIMSDK/DIMTwinsHelper.h>
+#import <DIMSDK/DIMMessageCodec.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @interface DIMMessagePacker : DIMTwinsHelper <DIMPacker>
 
+/**
+ *  Wire format for serializing messages (JsON as default),
+ *  switch to a compact format after the remote peer shows that it supports;
+ *  the format of received package will be detected automatically.
+ */
+@property (nonatomic) DIMMessageFormat messageFormat;
+
+/**
+ *  Max number of workers for encrypting message key to group members,
+ *  default is 1 (one by one in current thread)
+ */
+@property (nonatomic) NSUInteger maxConcurrency;
+
+/**
+ *  Encrypt message, and report group members whose visa key not found
+ *
+ * @param iMsg    - plain message
+ * @param missing - output members without visa key (optional)
+ * @return SecureMessage object, null on visa not found
+ */
+- (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
+                                        missing:(nullable NSMutableArray<id<MKMID>> *)missing;
+
+/**
+ *  Verify a batch of received messages (e.g. draining a backlog),
+ *  signatures by the same sender are checked together
+ *
+ * @param messages - received messages
+ * @return bitmap, bit (i % 8) of byte (i / 8) is set when message i is verified
+ */
+- (NSData *)verifyMessages:(NSArray<id<DKDReliableMessage>> *)messages;
+
 @end
 
 @class DIMInstantMessagePacker;
@@ -62,6 +95,15 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)checkAttachments:(id<DKDReliableMessage>)rMsg;
 
+/**
+ *  Called when group members' visa keys not found while encrypting,
+ *  check their meta & documents for querying by default
+ *
+ * @param iMsg    - plain message
+ * @param members - members without visa key
+ */
+- (void)message:(id<DKDInstantMessage>)iMsg missingVisaForMembers:(NSArray<id<MKMID>> *)members;
+
 @end
 
 NS_ASSUME_NONNULL_END
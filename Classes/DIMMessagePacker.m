@@ -57,13 +57,34 @@
                        messenger:(DIMTransceiver *)transceiver {
     if (self = [super initWithFacebook:barrack messenger:transceiver]) {
         self.instantPacker = [[DIMInstantMessagePacker alloc] initWithDelegate:transceiver];
+        self.instantPacker.dataSource = barrack;
         self.securePacker = [[DIMSecureMessagePacker alloc] initWithDelegate:transceiver];
         self.reliablePacker = [[DIMReliableMessagePacker alloc] initWithDelegate:transceiver];
+        _messageFormat = DIMMessageFormat_JSON;
     }
     return self;
 }
 
+- (NSUInteger)maxConcurrency {
+    return _instantPacker.maxConcurrency;
+}
+
+- (void)setMaxConcurrency:(NSUInteger)maxConcurrency {
+    _instantPacker.maxConcurrency = maxConcurrency;
+}
+
 - (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg {
+    NSMutableArray<id<MKMID>> *missing = [[NSMutableArray alloc] init];
+    id<DKDSecureMessage> sMsg = [self encryptMessage:iMsg missing:missing];
+    if ([missing count] > 0) {
+        // some members' visa keys not found
+        [self message:iMsg missingVisaForMembers:missing];
+    }
+    return sMsg;
+}
+
+- (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
+                                        missing:(nullable NSMutableArray<id<MKMID>> *)missing {
     // TODO: check receiver before calling this, make sure the visa.key exists;
     //       otherwise, suspend this message for waiting receiver's visa/meta;
     //       if receiver is a group, query all members' visa too!
@@ -100,7 +121,11 @@
         // a station will never send group message, so here must be a client;
         // the client messenger should check the group's meta & members before encrypting,
         // so we can trust that the group members MUST exist here.
-        sMsg = [_instantPacker encryptMessage:iMsg withKey:password forMembers:members];
+        // the members without visa key will be reported to the caller.
+        sMsg = [_instantPacker encryptMessage:iMsg
+                                      withKey:password
+                                   forMembers:members
+                                      missing:missing];
     } else {
         // personal message (or split group message)
         sMsg = [_instantPacker encryptMessage:iMsg withKey:password];
@@ -127,26 +152,13 @@
 }
 
 - (nullable NSData *)serializeMessage:(id<DKDReliableMessage>)rMsg {
-    return MKMUTF8Encode(MKMJSONEncode(rMsg.dictionary));
+    return DIMMessageEncode(rMsg, _messageFormat);
 }
 
 - (nullable id<DKDReliableMessage>)deserializeMessage:(NSData *)data {
     NSAssert([data length] > 0, @"message data should not be empty");
-    id dict = MKMJSONDecode(MKMUTF8Decode(data));
-    // TODO: translate short keys
-    //       'S' -> 'sender'
-    //       'R' -> 'receiver'
-    //       'W' -> 'time'
-    //       'T' -> 'type'
-    //       'G' -> 'group'
-    //       ------------------
-    //       'D' -> 'data'
-    //       'V' -> 'signature'
-    //       'K' -> 'key', 'keys'
-    //       ------------------
-    //       'M' -> 'meta'
-    //       'P' -> 'visa'
-    return DKDReliableMessageParse(dict);
+    // JsON, JsON with short keys, or binary
+    return DIMReliableMessageDecode(data);
 }
 
 - (id<DKDSecureMessage>)verifyMessage:(id<DKDReliableMessage>)rMsg {
@@ -160,6 +172,48 @@
     return [_reliablePacker verifyMessage:rMsg];
 }
 
+- (NSData *)verifyMessages:(NSArray<id<DKDReliableMessage>> *)messages {
+    DIMFacebook *facebook = [self facebook];
+    NSUInteger count = [messages count];
+    NSMutableArray<id<DKDReliableMessage>> *checked = [[NSMutableArray alloc] initWithCapacity:count];
+    NSMutableArray *keys = [[NSMutableArray alloc] initWithCapacity:count];
+    NSMutableArray<NSNumber *> *positions = [[NSMutableArray alloc] initWithCapacity:count];
+    NSUInteger index;
+    for (index = 0; index < count; ++index) {
+        id<DKDReliableMessage> rMsg = [messages objectAtIndex:index];
+        // make sure sender's meta exists before verifying message
+        if (![self checkAttachments:rMsg]) {
+            continue;
+        }
+        // take the first key of sender which can verify in batch,
+        // others will be verified one by one
+        id key = [NSNull null];
+        for (id<MKMVerifyKey> pKey in [facebook publicKeysForVerification:rMsg.sender]) {
+            if ([[pKey class] respondsToSelector:@selector(verifyBatch:signatures:keys:)]) {
+                key = pKey;
+                break;
+            }
+        }
+        [checked addObject:rMsg];
+        [keys addObject:key];
+        [positions addObject:@(index)];
+    }
+    NSData *verified = [_reliablePacker verifyMessages:checked withKeys:keys];
+    if ([checked count] == count) {
+        return verified;
+    }
+    NSMutableData *results = [[NSMutableData alloc] initWithLength:(count + 7) / 8];
+    uint8_t *bitmap = [results mutableBytes];
+    const uint8_t *bits = [verified bytes];
+    for (index = 0; index < [checked count]; ++index) {
+        if (bits[index / 8] & (1 << (index % 8))) {
+            NSUInteger pos = [[positions objectAtIndex:index] unsignedIntegerValue];
+            bitmap[pos / 8] |= 1 << (pos % 8);
+        }
+    }
+    return results;
+}
+
 - (id<DKDInstantMessage>)decryptMessage:(id<DKDSecureMessage>)sMsg {
     // TODO: check receiver before calling this, make sure you are the receiver,
     //       or you are a member of the group when this is a group message,
@@ -204,4 +258,13 @@
     return YES;
 }
 
+- (void)message:(id<DKDInstantMessage>)iMsg missingVisaForMembers:(NSArray<id<MKMID>> *)members {
+    DIMFacebook *facebook = [self facebook];
+    for (id<MKMID> member in members) {
+        // check meta & documents for querying
+        [facebook metaForID:member];
+        [facebook documentsForID:member];
+    }
+}
+
 @end
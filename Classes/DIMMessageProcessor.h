@@ -66,4 +66,33 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+/*
+ *  Batch processing for packages received from one socket read
+ *
+ *    +----------+     +----------+     +----------+                 +----------+
+ *    |  data 1  |     |  rMsg 1  |     |  conv A  |                 |  pack 1  |
+ *    |  data 2  |  -> |  rMsg 2  |  => |  conv B  |  (concurrent)   |  pack 2  |
+ *    |  ...     |     |  ...     |     |  ...     |  -> decrypt ->  |  ...     |
+ *    +----------+     +----------+     +----------+                 +----------+
+ *     deserialize      verify in batch  group by sender/group        responses
+ */
+@interface DIMMessageProcessor (Batch)
+
+/**
+ *  Process received packages, responses in arrival order
+ *
+ *  All packages are deserialized and verified in batch first, then the
+ *  conversations (by sender, or by group) are processed concurrently,
+ *  messages in one conversation are processed in order; the steps touching
+ *  the facebook & key cache run in a serial queue, only the decrypting runs
+ *  concurrently. Messages failed in the batch go through
+ *  'processReliableMessage:' as for one package.
+ *
+ * @param packages - received data packages
+ * @return responses for all packages, in the order of packages
+ */
+- (NSArray<NSData *> *)processPackages:(NSArray<NSData *> *)packages;
+
+@end
+
 NS_ASSUME_NONNULL_END
@@ -38,6 +38,9 @@
 #import "DIMContentProcessorCreator.h"
 #import "DIMFacebook.h"
 #import "DIMMessenger.h"
+#import "DIMMessagePacker.h"
+#import "DIMSecureMessagePacker.h"
+#import "DIMReliableMessagePacker.h"
 
 #import "DIMMessageProcessor.h"
 
@@ -229,3 +232,222 @@
 }
 
 @end
+
+static inline dispatch_queue_t process_queue(void) {
+    return dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+}
+
+// messages from the same sender, or to the same group, are processed in order
+static inline NSString *conversation_of(id<DKDReliableMessage> rMsg) {
+    id<MKMID> dest = [DIMCipherKeyDelegate destinationOfMessage:rMsg];
+    if ([dest isGroup]) {
+        return [dest string];
+    }
+    return [rMsg.sender string];
+}
+
+@implementation DIMMessageProcessor (Batch)
+
+- (NSArray<NSData *> *)processPackages:(NSArray<NSData *> *)packages {
+    DIMMessenger *transceiver = self.messenger;
+    //
+    //  1. deserialize messages (in order)
+    //
+    NSMutableArray<id<DKDReliableMessage>> *messages;
+    messages = [[NSMutableArray alloc] initWithCapacity:packages.count];
+    id<DKDReliableMessage> rMsg;
+    for (NSData *data in packages) {
+        rMsg = [transceiver deserializeMessage:data];
+        if (!rMsg) {
+            // no message received
+            continue;
+        }
+        [messages addObject:rMsg];
+    }
+    NSUInteger count = [messages count];
+    if (count == 0) {
+        // nothing to process
+        return nil;
+    }
+    DIMMessagePacker *packer = [transceiver packer];
+    if (![packer isKindOfClass:[DIMMessagePacker class]]) {
+        // cannot verify in batch, process one by one
+        NSMutableArray<NSData *> *responses = [[NSMutableArray alloc] init];
+        for (id<DKDReliableMessage> msg in messages) {
+            [self serializeMessages:[transceiver processReliableMessage:msg]
+                          toPackages:responses];
+        }
+        return responses;
+    }
+    //
+    //  2. verify messages in batch
+    //
+    NSData *verified = [packer verifyMessages:messages];
+    const uint8_t *bitmap = [verified bytes];
+    //
+    //  3. group messages by conversation (in order)
+    //
+    NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *groups;
+    groups = [[NSMutableDictionary alloc] init];
+    NSMutableArray<NSMutableArray<NSNumber *> *> *conversations = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *indexes;
+    NSString *name;
+    NSUInteger index;
+    for (index = 0; index < count; ++index) {
+        name = conversation_of([messages objectAtIndex:index]);
+        indexes = [groups objectForKey:name];
+        if (!indexes) {
+            indexes = [[NSMutableArray alloc] init];
+            [groups setObject:indexes forKey:name];
+            [conversations addObject:indexes];
+        }
+        [indexes addObject:@(index)];
+    }
+    //
+    //  4. process conversations concurrently, messages in one conversation
+    //     are processed in order; the facebook & key cache are not
+    //     thread-safe, so all steps touching them run in a serial queue,
+    //     only the decrypting runs in the workers.
+    //
+    dispatch_queue_t queue = dispatch_queue_create("chat.dim.processor.batch", DISPATCH_QUEUE_SERIAL);
+    __strong id *results = (__strong id *)calloc(count, sizeof(id));
+    dispatch_apply([conversations count], process_queue(), ^(size_t i) {
+        for (NSNumber *position in [conversations objectAtIndex:i]) {
+            NSUInteger pos = [position unsignedIntegerValue];
+            id<DKDReliableMessage> msg = [messages objectAtIndex:pos];
+            if (bitmap[pos / 8] & (1 << (pos % 8))) {
+                results[pos] = [self processVerifiedMessage:msg queue:queue];
+            } else {
+                // failed in batch, try the normal way
+                __block NSArray *res;
+                dispatch_sync(queue, ^{
+                    res = [transceiver processReliableMessage:msg];
+                });
+                results[pos] = res;
+            }
+        }
+    });
+    //
+    //  5. serialize responses (in order)
+    //
+    NSMutableArray<NSData *> *responses = [[NSMutableArray alloc] init];
+    for (index = 0; index < count; ++index) {
+        [self serializeMessages:results[index] toPackages:responses];
+        results[index] = nil;
+    }
+    free(results);
+    return responses;
+}
+
+- (void)serializeMessages:(NSArray<id<DKDReliableMessage>> *)messages
+               toPackages:(NSMutableArray<NSData *> *)packages {
+    DIMMessenger *transceiver = self.messenger;
+    NSData *pack;
+    for (id<DKDReliableMessage> res in messages) {
+        pack = [transceiver serializeMessage:res];
+        if ([pack length] == 0) {
+            // should not happen
+            continue;
+        }
+        [packages addObject:pack];
+    }
+}
+
+// called in worker thread, facebook & key cache are accessed in the queue
+- (NSArray<id<DKDReliableMessage>> *)processVerifiedMessage:(id<DKDReliableMessage>)rMsg
+                                                      queue:(dispatch_queue_t)queue {
+    DIMFacebook *facebook = self.facebook;
+    DIMMessenger *transceiver = self.messenger;
+    DIMMessagePacker *packer = [transceiver packer];
+    id<DKDSecureMessage> sMsg = [packer.reliablePacker secureMessageFromVerifiedMessage:rMsg];
+    NSData *encryptedKey = [sMsg encryptedKey];
+    __block id<MKMUser> user;
+    __block NSArray<id<MKMDecryptKey>> *decryptKeys;
+    __block id<MKMSymmetricKey> password = nil;
+    //
+    //  1. get local user & private keys (or the reused key) in the queue
+    //
+    dispatch_sync(queue, ^{
+        user = [facebook selectLocalUserWithID:sMsg.receiver];
+        if (!user) {
+            // not for you?
+        } else if (encryptedKey) {
+            decryptKeys = [facebook privateKeysForDecryption:user.ID];
+        } else {
+            password = [transceiver message:sMsg deserializeKey:nil];
+        }
+    });
+    //
+    //  2. decrypt key & data in current thread
+    //
+    NSData *keyData = nil;
+    for (id<MKMDecryptKey> key in decryptKeys) {
+        keyData = [key decrypt:encryptedKey params:nil];
+        if (keyData) {
+            break;
+        }
+    }
+    if (keyData) {
+        password = [transceiver message:sMsg deserializeKey:keyData];
+    }
+    NSData *body = nil;
+    if (password) {
+        body = [transceiver message:sMsg decryptContent:sMsg.data withKey:password];
+    }
+    //
+    //  3. process content & pack responses in the queue
+    //
+    __block NSArray<id<DKDReliableMessage>> *messages = nil;
+    dispatch_sync(queue, ^{
+        if (!user) {
+            // not for you
+            return;
+        }
+        NSArray<id<DKDSecureMessage>> *responses;
+        id<DKDContent> content = nil;
+        if (body) {
+            // cache the key when success
+            content = [transceiver message:sMsg deserializeContent:body withKey:password];
+        }
+        id<DKDInstantMessage> iMsg = nil;
+        if (content) {
+            iMsg = [packer.securePacker instantMessageFromSecureMessage:sMsg content:content];
+        }
+        if (!iMsg) {
+            // cannot decrypt in parts, try the normal way
+            responses = [transceiver processSecureMessage:sMsg withReliableMessageMessage:rMsg];
+        } else {
+            responses = [self encryptMessages:[transceiver processInstantMessage:iMsg
+                                                      withReliableMessageMessage:rMsg]];
+        }
+        NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:responses.count];
+        id<DKDReliableMessage> msg;
+        for (id<DKDSecureMessage> res in responses) {
+            msg = [transceiver signMessage:res];
+            if (!msg) {
+                // should not happen
+                continue;
+            }
+            [array addObject:msg];
+        }
+        messages = array;
+    });
+    return messages;
+}
+
+- (NSArray<id<DKDSecureMessage>> *)encryptMessages:(NSArray<id<DKDInstantMessage>> *)responses {
+    DIMMessenger *transceiver = self.messenger;
+    NSMutableArray<id<DKDSecureMessage>> *messages = [[NSMutableArray alloc] initWithCapacity:[responses count]];
+    id<DKDSecureMessage> msg;
+    for (id<DKDInstantMessage> res in responses) {
+        msg = [transceiver encryptMessage:res];
+        if (!msg) {
+            // should not happen
+            continue;
+        }
+        [messages addObject:msg];
+    }
+    return messages;
+}
+
+@end
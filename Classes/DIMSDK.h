@@ -65,6 +65,8 @@ FOUNDATION_EXPORT const unsigned char DIMSDKVersionString[];
 
 // DaoKeDao
 #import <DIMSDK/DIMMessageFactory.h>
+#import <DIMSDK/DIMMessageCodec.h>
+#import <DIMSDK/DIMRawMessage.h>
 #import <DIMSDK/DIMInstantMessagePacker.h>
 #import <DIMSDK/DIMSecureMessagePacker.h>
 #import <DIMSDK/DIMReliableMessagePacker.h>
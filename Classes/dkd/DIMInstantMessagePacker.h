@@ -43,6 +43,20 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (readonly, weak, nonatomic) id<DKDInstantMessageDelegate> delegate;
 
+/**
+ *  Source of members' visa keys for encrypting group message key concurrently;
+ *  the keys are taken in current thread, only the encrypting is dispatched.
+ */
+@property (weak, nonatomic, nullable) id<MKMUserDataSource> dataSource;
+
+/**
+ *  Max number of workers for encrypting message key to group members,
+ *  default is 1 (one by one in current thread, by the delegate method
+ *  'message:encryptKey:forReceiver:'); when it's greater than 1 and the
+ *  data source is set, the members' keys will encrypt concurrently.
+ */
+@property (nonatomic) NSUInteger maxConcurrency;
+
 - (instancetype)initWithDelegate:(id<DKDInstantMessageDelegate>)delegate
 NS_DESIGNATED_INITIALIZER;
 
@@ -84,6 +98,20 @@ NS_DESIGNATED_INITIALIZER;
                                         withKey:(id<MKMSymmetricKey>)password
                                      forMembers:(NSArray<id<MKMID>> *)members;
 
+/**
+ *  3. Encrypt group message, and report members whose visa key not found
+ *
+ * @param iMsg     - plain message
+ * @param password - symmetric key
+ * @param members  - group members for group message
+ * @param missing  - output members without visa key (optional)
+ * @return SecureMessage object, null on all visa keys not found
+ */
+- (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
+                                        withKey:(id<MKMSymmetricKey>)password
+                                     forMembers:(NSArray<id<MKMID>> *)members
+                                        missing:(nullable NSMutableArray<id<MKMID>> *)missing;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -35,6 +35,8 @@
 //  Copyright © 2018 DIM Group. All rights reserved.
 //
 
+#import "DIMRawMessage.h"
+
 #import "DIMInstantMessagePacker.h"
 
 @interface DIMInstantMessagePacker ()
@@ -55,12 +57,20 @@
 - (instancetype)initWithDelegate:(id<DKDInstantMessageDelegate>)delegate {
     if (self = [super init]) {
         self.delegate = delegate;
+        self.maxConcurrency = 1;
     }
     return self;
 }
 
 @end
 
+// too few members are not worth to dispatch
+#define DIM_CONCURRENT_KEYS_MIN 16
+
+static inline dispatch_queue_t encrypt_queue(void) {
+    return dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+}
+
 @implementation DIMInstantMessagePacker (Encryption)
 
 - (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
@@ -72,6 +82,14 @@
 - (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
                                         withKey:(id<MKMSymmetricKey>)password
                                      forMembers:(NSArray<id<MKMID>> *)members {
+    NSMutableArray *missing = nil;
+    return [self encryptMessage:iMsg withKey:password forMembers:members missing:missing];
+}
+
+- (nullable id<DKDSecureMessage>)encryptMessage:(id<DKDInstantMessage>)iMsg
+                                        withKey:(id<MKMSymmetricKey>)password
+                                     forMembers:(NSArray<id<MKMID>> *)members
+                                        missing:(nullable NSMutableArray<id<MKMID>> *)missing {
     // TODO: check attachment for File/Image/Audio/Video message content
     //      (do it by application)
     id<DKDInstantMessageDelegate> delegate = [self delegate];
@@ -92,44 +110,32 @@
                                    withKey:password];
     NSAssert([ciphertext length] > 0, @"failed to encrypt content with key: %@", password);
 
-    //
-    //  3. Encode 'message.data' to String (Base64)
-    //
-    NSObject *encodedData;
-    if ([DIMMessage isBroadcast:iMsg]) {
-        // broadcast message content will not be encrypted (just encoded to JsON),
-        // so no need to encode to Base64 here
-        encodedData = MKMUTF8Decode(ciphertext);
-    } else {
-        // message content had been encrypted by a symmetric key,
-        // so the data should be encoded here (with algorithm 'base64' as default).
-        encodedData = MKMTransportableDataEncode(ciphertext);
-    }
-    NSAssert(encodedData, @"failed to encode content data: %@", ciphertext);
-    
     // replace 'content' with encrypted 'data'
+    // (the raw message encodes 'data' only when it's serialized to JsON)
     NSMutableDictionary *info = [iMsg dictionary:NO];
     [info removeObjectForKey:@"content"];
-    [info setObject:encodedData forKey:@"data"];
     
     //
-    //  4. Serialize message key to data (JsON / ProtoBuf / ...)
+    //  3. Serialize message key to data (JsON / ProtoBuf / ...)
     //
     NSData *pwd = [delegate message:iMsg serializeKey:password];
     if (!pwd) {
         // A) broadcast message has no key
         // B) reused key
-        return DKDSecureMessageParse(info);
+        return [[DIMRawSecureMessage alloc] initWithDictionary:info
+                                                          data:ciphertext
+                                                           key:nil
+                                                          keys:nil];
     }
     
-    NSData *encryptedKey;
-    NSObject *encodedKey;
+    NSData *encryptedKey = nil;
+    NSMutableDictionary<NSString *, NSData *> *keys = nil;
     if (!members)  // personal message
     {
         id<MKMID> receiver = [iMsg receiver];
         NSAssert([receiver isUser], @"message.receiver error: %@", receiver);
         //
-        //  5. Encrypt key data to 'message.key/keys' with receiver's public key
+        //  4. Encrypt key data to 'message.key' with receiver's public key
         //
         encryptedKey = [delegate message:iMsg encryptKey:pwd forReceiver:receiver];
         if (!encryptedKey) {
@@ -137,46 +143,92 @@
             // TODO: suspend this message for waiting receiver's visa
             return nil;
         }
-        //
-        //  6. Encode message key to String (Base64)
-        //
-        encodedKey = MKMTransportableDataEncode(encryptedKey);
-        NSAssert(encodedKey, @"failed to encode key data: %@", encryptedKey);
-        // insert as 'key'
-        [info setObject:encodedKey forKey:@"key"];
     }
     else  // group message
     {
-        NSMutableDictionary *keys = [[NSMutableDictionary alloc] initWithCapacity:members.count];
+        //
+        //  4. Encrypt key data to 'message.keys' with members' public keys
+        //
+        NSArray *results = [self encryptKey:pwd forMembers:members message:iMsg];
+        // merge in the order of members
+        keys = [[NSMutableDictionary alloc] initWithCapacity:members.count];
+        NSUInteger index = 0;
+        id result;
         for (id<MKMID> receiver in members) {
-            //
-            //  5. Encrypt key data to 'message.key/keys' with receiver's public key
-            //
-            encryptedKey = [delegate message:iMsg encryptKey:pwd forReceiver:receiver];
-            if (!encryptedKey) {
+            result = [results objectAtIndex:index++];
+            if ([result isKindOfClass:[NSNull class]]) {
                 // public key for member not found
                 // TODO: suspend this message for waiting member's visa
+                [missing addObject:receiver];
                 continue;
             }
-            //
-            //  6. Encode message key to String (Base64)
-            //
-            encodedKey = MKMTransportableDataEncode(encryptedKey);
-            NSAssert(encodedKey, @"failed to encode key data: %@", encryptedKey);
             // insert to 'message.keys' with member ID
-            [keys setObject:encodedKey forKey:receiver.string];
+            [keys setObject:result forKey:receiver.string];
         }
         if ([keys count] == 0) {
             // public key for member(s) not found
             // TODO: suspend this message for waiting member's visa
             return nil;
         }
-        // insert as 'keys'
-        [info setObject:keys forKey:@"keys"];
     }
 
-    // OK, pack message
-    return DKDSecureMessageParse(info);
+    //
+    //  5. OK, pack message with raw data & key(s),
+    //     they will be encoded to String (Base64) only when serializing
+    //     to JsON, so the signer will not decode them again
+    //
+    return [[DIMRawSecureMessage alloc] initWithDictionary:info
+                                                      data:ciphertext
+                                                       key:encryptedKey
+                                                      keys:keys];
+}
+
+// encrypt key data for each member,
+// results are in the same order of members (NSNull for visa key not found)
+- (NSArray *)encryptKey:(NSData *)pwd
+             forMembers:(NSArray<id<MKMID>> *)members
+                message:(id<DKDInstantMessage>)iMsg {
+    id<DKDInstantMessageDelegate> delegate = [self delegate];
+    id<MKMUserDataSource> dataSource = [self dataSource];
+    NSUInteger count = [members count];
+    NSUInteger workers = MIN(self.maxConcurrency, count);
+    NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:count];
+    NSData *encryptedKey;
+    if (!dataSource || workers < 2 || count < DIM_CONCURRENT_KEYS_MIN) {
+        // one by one in current thread
+        for (id<MKMID> receiver in members) {
+            encryptedKey = [delegate message:iMsg encryptKey:pwd forReceiver:receiver];
+            [array addObject:(encryptedKey ? encryptedKey : [NSNull null])];
+        }
+        return array;
+    }
+    
+    // 1. get visa keys in current thread, the data source is not thread-safe
+    NSMutableArray *visaKeys = [[NSMutableArray alloc] initWithCapacity:count];
+    id<MKMEncryptKey> visaKey;
+    for (id<MKMID> receiver in members) {
+        visaKey = [dataSource publicKeyForEncryption:receiver];
+        [visaKeys addObject:(visaKey ? visaKey : [NSNull null])];
+    }
+    
+    // 2. encrypt with the keys concurrently
+    __strong id *results = (__strong id *)calloc(count, sizeof(id));
+    dispatch_apply(workers, encrypt_queue(), ^(size_t worker) {
+        // each worker takes the members with stride, writes its own slots
+        id key;
+        for (NSUInteger i = worker; i < count; i += workers) {
+            key = [visaKeys objectAtIndex:i];
+            if ([key conformsToProtocol:@protocol(MKMEncryptKey)]) {
+                results[i] = [key encrypt:pwd params:nil];
+            }
+        }
+    });
+    for (NSUInteger i = 0; i < count; ++i) {
+        [array addObject:(results[i] ? results[i] : [NSNull null])];
+        results[i] = nil;
+    }
+    free(results);
+    return array;
 }
 
 @end
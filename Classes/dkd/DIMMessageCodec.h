@@ -0,0 +1,119 @@
+// license: https://mit-license.org
+//
+//  DIM-SDK : Decentralized Instant Messaging Software Development Kit
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMMessageCodec.h
+//  DIMSDK
+//
+//  Created by Albert Moky on 2024/3/18.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <DIMCore/DIMCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ *  Wire Formats for Reliable Message
+ *
+ *  1. JsON: the default format, all peers support it;
+ *
+ *  2. JsON with short keys:
+ *          'S' -> 'sender'
+ *          'R' -> 'receiver'
+ *          'W' -> 'time'
+ *          'T' -> 'type'
+ *          'G' -> 'group'
+ *          ------------------
+ *          'D' -> 'data'
+ *          'V' -> 'signature'
+ *          'K' -> 'key', 'keys'
+ *          ------------------
+ *          'M' -> 'meta'
+ *          'P' -> 'visa'
+ *
+ *  3. Binary: magic + version + fields, each field is
+ *          tag (1 byte) + length (varint) + value (length bytes);
+ *     'data', 'key', 'keys' and 'signature' are carried as raw bytes,
+ *     'meta', 'visa' and other unknown fields are carried as JsON.
+ *
+ *  The receiver detects the format automatically, so a peer can switch to
+ *  a compact format once it knows the other side supports it.
+ */
+typedef NS_ENUM(UInt8, DIMMessageFormat) {
+    DIMMessageFormat_JSON         = 0,
+    DIMMessageFormat_ShortKeyJSON = 1,
+    DIMMessageFormat_Binary       = 2,
+};
+
+#define DIMMessageBinaryMagic   0xD1
+#define DIMMessageBinaryVersion 0x01
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Serialize message in the given format
+ *
+ * @param rMsg   - network message
+ * @param format - wire format
+ * @return data package, nil on error
+ */
+NSData * _Nullable DIMMessageEncode(id<DKDReliableMessage> rMsg, DIMMessageFormat format);
+
+/**
+ *  Deserialize message info from data package (format detected automatically)
+ *
+ * @param data - data package
+ * @return message info with full keys, nil on error
+ */
+NSDictionary * _Nullable DIMMessageDecode(NSData *data);
+
+/**
+ *  Deserialize message from data package (format detected automatically),
+ *  raw bytes in binary package will be carried with the message,
+ *  and encoded to Base64 only when the message is serialized to JsON
+ *
+ * @param data - data package
+ * @return network message, nil on error
+ */
+id<DKDReliableMessage> _Nullable DIMReliableMessageDecode(NSData *data);
+
+/**
+ *  Translate keys between full names and short names
+ */
+NSDictionary *DIMMessageShortenKeys(NSDictionary *msg);
+NSDictionary *DIMMessageExpandKeys(NSDictionary *msg);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,530 @@
+// license: https://mit-license.org
+//
+//  DIM-SDK : Decentralized Instant Messaging Software Development Kit
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMMessageCodec.m
+//  DIMSDK
+//
+//  Created by Albert Moky on 2024/3/18.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import "DIMRawMessage.h"
+
+#import "DIMMessageCodec.h"
+
+#pragma mark Short Keys
+
+static NSDictionary<NSString *, NSString *> *full_to_short(void) {
+    static NSDictionary *s_table = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        s_table = @{
+            @"sender"   : @"S",
+            @"receiver" : @"R",
+            @"time"     : @"W",
+            @"type"     : @"T",
+            @"group"    : @"G",
+
+            @"data"     : @"D",
+            @"signature": @"V",
+            @"key"      : @"K",
+            @"keys"     : @"K",
+
+            @"meta"     : @"M",
+            @"visa"     : @"P",
+        };
+    });
+    return s_table;
+}
+
+static NSDictionary<NSString *, NSString *> *short_to_full(void) {
+    static NSDictionary *s_table = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        s_table = @{
+            @"S": @"sender",
+            @"R": @"receiver",
+            @"W": @"time",
+            @"T": @"type",
+            @"G": @"group",
+
+            @"D": @"data",
+            @"V": @"signature",
+            // 'K' -> 'key' or 'keys', depends on the value
+
+            @"M": @"meta",
+            @"P": @"visa",
+        };
+    });
+    return s_table;
+}
+
+NSDictionary *DIMMessageShortenKeys(NSDictionary *msg) {
+    NSDictionary *table = full_to_short();
+    // 'key' & 'keys' cannot share the same short key
+    BOOL both = [msg objectForKey:@"key"] && [msg objectForKey:@"keys"];
+    NSMutableDictionary *info = [[NSMutableDictionary alloc] initWithCapacity:msg.count];
+    [msg enumerateKeysAndObjectsUsingBlock:^(NSString *key, id obj, BOOL *stop) {
+        NSString *name = [table objectForKey:key];
+        if (!name || (both && [key isEqualToString:@"keys"])) {
+            name = key;
+        }
+        [info setObject:obj forKey:name];
+    }];
+    return info;
+}
+
+NSDictionary *DIMMessageExpandKeys(NSDictionary *msg) {
+    if ([msg objectForKey:@"sender"]) {
+        // full keys
+        return msg;
+    }
+    NSDictionary *table = short_to_full();
+    NSMutableDictionary *info = [[NSMutableDictionary alloc] initWithCapacity:msg.count];
+    [msg enumerateKeysAndObjectsUsingBlock:^(NSString *key, id obj, BOOL *stop) {
+        NSString *name;
+        if ([key isEqualToString:@"K"]) {
+            name = [obj isKindOfClass:[NSDictionary class]] ? @"keys" : @"key";
+        } else {
+            name = [table objectForKey:key];
+        }
+        [info setObject:obj forKey:(name ? name : key)];
+    }];
+    return info;
+}
+
+#pragma mark Binary Writer
+
+static inline void write_varint(NSMutableData *buffer, uint64_t value) {
+    uint8_t bytes[10];
+    int len = 0;
+    do {
+        bytes[len] = value & 0x7F;
+        value >>= 7;
+        if (value) {
+            bytes[len] |= 0x80;
+        }
+        ++len;
+    } while (value);
+    [buffer appendBytes:bytes length:len];
+}
+
+static inline void write_field(NSMutableData *buffer, char tag,
+                               const void *bytes, NSUInteger len) {
+    [buffer appendBytes:&tag length:1];
+    write_varint(buffer, len);
+    [buffer appendBytes:bytes length:len];
+}
+
+static inline void write_data(NSMutableData *buffer, char tag, NSData *data) {
+    write_field(buffer, tag, data.bytes, data.length);
+}
+
+static inline void write_json(NSMutableData *buffer, char tag, id object) {
+    write_data(buffer, tag, MKMUTF8Encode(MKMJSONEncode(object)));
+}
+
+static inline NSData *decode_ted(id value) {
+    return [MKMTransportableDataParse(value) data];
+}
+
+// each entry: varint(len) + member ID + varint(len) + encrypted key
+static inline void write_key(NSMutableData *entries, NSString *member, NSData *key) {
+    NSData *name = MKMUTF8Encode(member);
+    write_varint(entries, name.length);
+    [entries appendData:name];
+    write_varint(entries, key.length);
+    [entries appendData:key];
+}
+
+static NSData *binary_encode(id<DKDReliableMessage> rMsg) {
+    // the fields without carried bytes, no need to encode them to Base64
+    NSDictionary *info = DIMMessageGetFields(rMsg);
+    NSData *signature = [rMsg signature];
+    NSData *ciphertext = [rMsg data];
+    NSMutableData *buffer;
+    buffer = [[NSMutableData alloc] initWithCapacity:(ciphertext.length + 512)];
+    uint8_t head[2] = {DIMMessageBinaryMagic, DIMMessageBinaryVersion};
+    [buffer appendBytes:head length:2];
+    // names of the fields written
+    NSMutableSet<NSString *> *written = [[NSMutableSet alloc] initWithCapacity:12];
+    id value;
+
+    //
+    //  1. envelope
+    //
+    NSDictionary<NSString *, NSString *> *table = full_to_short();
+    for (NSString *name in @[@"sender", @"receiver", @"group"]) {
+        value = [info objectForKey:name];
+        if ([value isKindOfClass:[NSString class]]) {
+            write_data(buffer, [table[name] characterAtIndex:0], MKMUTF8Encode(value));
+            [written addObject:name];
+        }
+    }
+    value = [info objectForKey:@"time"];
+    if ([value isKindOfClass:[NSNumber class]]) {
+        double seconds = [value doubleValue];
+        uint64_t bits;
+        memcpy(&bits, &seconds, sizeof(bits));
+        bits = CFSwapInt64HostToBig(bits);
+        write_field(buffer, 'W', &bits, sizeof(bits));
+        [written addObject:@"time"];
+    }
+    value = [info objectForKey:@"type"];
+    if ([value isKindOfClass:[NSNumber class]]) {
+        NSMutableData *varint = [[NSMutableData alloc] initWithCapacity:10];
+        write_varint(varint, [value unsignedLongLongValue]);
+        write_data(buffer, 'T', varint);
+        [written addObject:@"type"];
+    }
+
+    //
+    //  2. body (raw bytes, taken from raw message directly)
+    //
+    if ([ciphertext length] == 0) {
+        return nil;
+    } else if ([DIMMessage isBroadcast:rMsg]) {
+        // broadcast message content was not encrypted, it's a JsON string
+        write_data(buffer, 'd', ciphertext);
+    } else {
+        write_data(buffer, 'D', ciphertext);
+    }
+    [written addObject:@"data"];
+    NSData *key = DIMMessageGetRawKey(rMsg);
+    value = [info objectForKey:@"key"];
+    if (!key && value) {
+        key = decode_ted(value);
+        if (!key) {
+            return nil;
+        }
+    }
+    if (key) {
+        write_data(buffer, 'K', key);
+        [written addObject:@"key"];
+    }
+    NSDictionary *keys = DIMMessageGetRawKeys(rMsg);
+    NSMutableData *entries = nil;
+    if (keys) {
+        entries = [[NSMutableData alloc] initWithCapacity:([keys count] * 160)];
+        [keys enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSData *obj, BOOL *stop) {
+            write_key(entries, name, obj);
+        }];
+    } else if ([(value = [info objectForKey:@"keys"]) isKindOfClass:[NSDictionary class]]) {
+        entries = [[NSMutableData alloc] initWithCapacity:([value count] * 160)];
+        __block BOOL ok = YES;
+        [value enumerateKeysAndObjectsUsingBlock:^(NSString *name, id obj, BOOL *stop) {
+            NSData *data = decode_ted(obj);
+            if (![name isKindOfClass:[NSString class]] || !data) {
+                ok = NO;
+                *stop = YES;
+                return;
+            }
+            write_key(entries, name, data);
+        }];
+        if (!ok) {
+            return nil;
+        }
+    }
+    if (entries) {
+        write_data(buffer, 'k', entries);
+        [written addObject:@"keys"];
+    }
+    if ([signature length] > 0) {
+        write_data(buffer, 'V', signature);
+        [written addObject:@"signature"];
+    }
+
+    //
+    //  3. attachments & others (JsON)
+    //
+    value = [info objectForKey:@"meta"];
+    if ([value isKindOfClass:[NSDictionary class]]) {
+        write_json(buffer, 'M', value);
+        [written addObject:@"meta"];
+    }
+    value = [info objectForKey:@"visa"];
+    if ([value isKindOfClass:[NSDictionary class]]) {
+        write_json(buffer, 'P', value);
+        [written addObject:@"visa"];
+    }
+    NSMutableDictionary *others = nil;
+    for (NSString *name in info) {
+        if ([written containsObject:name]) {
+            continue;
+        }
+        if (!others) {
+            others = [[NSMutableDictionary alloc] init];
+        }
+        [others setObject:[info objectForKey:name] forKey:name];
+    }
+    if (others) {
+        write_json(buffer, '*', others);
+    }
+    return buffer;
+}
+
+#pragma mark Binary Reader
+
+typedef struct {
+    const uint8_t *ptr;
+    const uint8_t *end;
+} DIMByteReader;
+
+static inline BOOL read_varint(DIMByteReader *reader, uint64_t *value) {
+    uint64_t result = 0;
+    uint8_t byte;
+    for (int shift = 0; shift < 64 && reader->ptr < reader->end; shift += 7) {
+        byte = *reader->ptr++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static inline BOOL read_bytes(DIMByteReader *reader, const uint8_t **bytes, NSUInteger *len) {
+    uint64_t size;
+    if (!read_varint(reader, &size) || size > (uint64_t)(reader->end - reader->ptr)) {
+        return NO;
+    }
+    *bytes = reader->ptr;
+    *len = (NSUInteger)size;
+    reader->ptr += size;
+    return YES;
+}
+
+static inline NSString *utf8_string(const uint8_t *bytes, NSUInteger len) {
+    return [[NSString alloc] initWithBytes:bytes length:len encoding:NSUTF8StringEncoding];
+}
+
+static inline NSData *sub_data(NSData *data, const uint8_t *bytes, NSUInteger len) {
+    const uint8_t *base = (const uint8_t *)[data bytes];
+    return [data subdataWithRange:NSMakeRange(bytes - base, len)];
+}
+
+static inline id json_object(const uint8_t *bytes, NSUInteger len) {
+    return MKMJSONDecode(utf8_string(bytes, len));
+}
+
+// member ID => raw key bytes (sub-ranges of the package)
+static NSDictionary *decode_keys(NSData *data, const uint8_t *bytes, NSUInteger len) {
+    DIMByteReader reader = {bytes, bytes + len};
+    NSMutableDictionary *keys = [[NSMutableDictionary alloc] init];
+    const uint8_t *member, *key;
+    NSUInteger memberLen, keyLen;
+    NSString *name;
+    while (reader.ptr < reader.end) {
+        if (!read_bytes(&reader, &member, &memberLen) ||
+            !read_bytes(&reader, &key, &keyLen)) {
+            return nil;
+        }
+        name = utf8_string(member, memberLen);
+        if (!name) {
+            return nil;
+        }
+        [keys setObject:sub_data(data, key, keyLen) forKey:name];
+    }
+    return keys;
+}
+
+// 'raw' collects the raw bytes of 'data', 'key', 'keys' & 'signature',
+// they are not put into the fields (no Base64 here)
+static NSMutableDictionary *binary_decode(NSData *data, NSMutableDictionary *raw) {
+    const uint8_t *bytes = (const uint8_t *)[data bytes];
+    DIMByteReader reader = {bytes + 2, bytes + [data length]};
+    NSMutableDictionary *info = [[NSMutableDictionary alloc] initWithCapacity:8];
+    NSDictionary *table = short_to_full();
+    const uint8_t *value;
+    NSUInteger size;
+    uint8_t tag;
+    id object;
+    while (reader.ptr < reader.end) {
+        tag = *reader.ptr++;
+        if (!read_bytes(&reader, &value, &size)) {
+            return nil;
+        }
+        switch (tag) {
+            case 'S':
+            case 'R':
+            case 'G':
+                object = utf8_string(value, size);
+                break;
+            case 'W': {
+                if (size != 8) {
+                    return nil;
+                }
+                uint64_t bits;
+                memcpy(&bits, value, sizeof(bits));
+                bits = CFSwapInt64BigToHost(bits);
+                double seconds;
+                memcpy(&seconds, &bits, sizeof(seconds));
+                object = @(seconds);
+            }
+                break;
+            case 'T': {
+                DIMByteReader sub = {value, value + size};
+                uint64_t type;
+                object = read_varint(&sub, &type) ? @(type) : nil;
+            }
+                break;
+            case 'D':
+                [raw setObject:sub_data(data, value, size) forKey:@"data"];
+                continue;
+            case 'K':
+                [raw setObject:sub_data(data, value, size) forKey:@"key"];
+                continue;
+            case 'V':
+                [raw setObject:sub_data(data, value, size) forKey:@"signature"];
+                continue;
+            case 'k':
+                object = decode_keys(data, value, size);
+                if (!object) {
+                    return nil;
+                }
+                [raw setObject:object forKey:@"keys"];
+                continue;
+            case 'd':
+                // broadcast message content, a JsON string
+                object = utf8_string(value, size);
+                [raw setObject:sub_data(data, value, size) forKey:@"data"];
+                break;
+            case 'M':
+            case 'P':
+                object = json_object(value, size);
+                break;
+            case '*':
+                object = json_object(value, size);
+                if (![object isKindOfClass:[NSDictionary class]]) {
+                    return nil;
+                }
+                [info addEntriesFromDictionary:object];
+                continue;
+            default:
+                // unknown field, skip it
+                continue;
+        }
+        if (!object) {
+            return nil;
+        }
+        if (tag == 'd') {
+            [info setObject:object forKey:@"data"];
+        } else {
+            [info setObject:object forKey:[table objectForKey:[NSString stringWithFormat:@"%c", tag]]];
+        }
+    }
+    return info;
+}
+
+// fields & raw bytes from binary package
+static DIMRawReliableMessage *binary_message(NSData *data) {
+    NSMutableDictionary *raw = [[NSMutableDictionary alloc] initWithCapacity:4];
+    NSMutableDictionary *info = binary_decode(data, raw);
+    if (!info) {
+        return nil;
+    }
+    return [[DIMRawReliableMessage alloc] initWithDictionary:info
+                                                        data:[raw objectForKey:@"data"]
+                                                         key:[raw objectForKey:@"key"]
+                                                        keys:[raw objectForKey:@"keys"]
+                                                   signature:[raw objectForKey:@"signature"]];
+}
+
+#pragma mark -
+
+NSData *DIMMessageEncode(id<DKDReliableMessage> rMsg, DIMMessageFormat format) {
+    if (format == DIMMessageFormat_Binary) {
+        NSData *pack = binary_encode(rMsg);
+        if (pack) {
+            return pack;
+        }
+        // fields not supported by binary format, send in JsON
+    } else if (format == DIMMessageFormat_ShortKeyJSON) {
+        return MKMUTF8Encode(MKMJSONEncode(DIMMessageShortenKeys(rMsg.dictionary)));
+    }
+    return MKMUTF8Encode(MKMJSONEncode(rMsg.dictionary));
+}
+
+static inline BOOL is_binary(NSData *data) {
+    const uint8_t *bytes = (const uint8_t *)[data bytes];
+    NSUInteger len = [data length];
+    return len > 2 && bytes[0] == DIMMessageBinaryMagic;
+}
+
+// the version byte comes from the network, reject unknown versions quietly
+static inline BOOL is_supported_version(NSData *data) {
+    const uint8_t *bytes = (const uint8_t *)[data bytes];
+    if (bytes[1] != DIMMessageBinaryVersion) {
+        NSLog(@"binary message version not support: %d", bytes[1]);
+        return NO;
+    }
+    return YES;
+}
+
+static inline NSDictionary *json_decode(NSData *data) {
+    id dict = MKMJSONDecode(MKMUTF8Decode(data));
+    if (![dict isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    return DIMMessageExpandKeys(dict);
+}
+
+NSDictionary *DIMMessageDecode(NSData *data) {
+    if (is_binary(data)) {
+        if (!is_supported_version(data)) {
+            return nil;
+        }
+        // encode the raw bytes, as the caller asks for the dictionary
+        return [binary_message(data) dictionary];
+    }
+    return json_decode(data);
+}
+
+id<DKDReliableMessage> DIMReliableMessageDecode(NSData *data) {
+    if (!is_binary(data)) {
+        return DKDReliableMessageParse(json_decode(data));
+    }
+    if (!is_supported_version(data)) {
+        return nil;
+    }
+    // carry the raw bytes with the message, they will not be encoded to
+    // Base64 unless the message is serialized to JsON
+    DIMRawReliableMessage *rMsg = binary_message(data);
+    if (!rMsg) {
+        return nil;
+    } else if (!DIMMessageGetFields(rMsg)[@"sender"] ||
+               [rMsg.data length] == 0 ||
+               [rMsg.signature length] == 0) {
+        // not a reliable message
+        return nil;
+    }
+    return rMsg;
+}
@@ -0,0 +1,101 @@
+// license: https://mit-license.org
+//
+//  DIM-SDK : Decentralized Instant Messaging Software Development Kit
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMRawMessage.h
+//  DIMSDK
+//
+//  Created by Albert Moky on 2024/3/20.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <DIMCore/DIMCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ *  Messages carrying raw bytes
+ *  ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *  The packers know the raw bytes of 'data', 'key', 'keys' & 'signature'
+ *  when they build the next message, so they hand them over with the new
+ *  message; the next step gets them directly, instead of decoding the
+ *  encoded strings (Base64) from the dictionary again.
+ *
+ *  The raw bytes are not encoded into the dictionary until someone asks for
+ *  the whole dictionary (e.g. serializing to JsON), so the binary format and
+ *  the next packer never pay for Base64. Fields in the dictionary (envelope,
+ *  meta, visa, ...) are shared with the message built from it, not copied.
+ */
+@interface DIMRawSecureMessage : DIMSecureMessage
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict
+                              data:(nullable NSData *)ciphertext
+                               key:(nullable NSData *)encryptedKey
+                              keys:(nullable NSDictionary<NSString *, NSData *> *)encryptedKeys;
+
+@end
+
+@interface DIMRawReliableMessage : DIMReliableMessage
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict
+                              data:(nullable NSData *)ciphertext
+                               key:(nullable NSData *)encryptedKey
+                              keys:(nullable NSDictionary<NSString *, NSData *> *)encryptedKeys
+                         signature:(nullable NSData *)signature;
+
+@end
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Get the message fields without encoding the raw bytes into them,
+ *  so 'data', 'key', 'keys' & 'signature' may be absent for raw messages
+ *
+ * @return the message's own dictionary (not a copy)
+ */
+NSMutableDictionary *DIMMessageGetFields(id<DKDMessage> msg);
+
+/**
+ *  Get raw bytes of 'message.key' if carried, don't decode from dictionary
+ */
+NSData * _Nullable DIMMessageGetRawKey(id<DKDSecureMessage> msg);
+
+/**
+ *  Get raw bytes of 'message.keys' (member ID => key) if carried,
+ *  don't decode from dictionary
+ */
+NSDictionary<NSString *, NSData *> * _Nullable DIMMessageGetRawKeys(id<DKDSecureMessage> msg);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+NS_ASSUME_NONNULL_END
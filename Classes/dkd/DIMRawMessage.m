@@ -0,0 +1,369 @@
+// license: https://mit-license.org
+//
+//  DIM-SDK : Decentralized Instant Messaging Software Development Kit
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMRawMessage.m
+//  DIMSDK
+//
+//  Created by Albert Moky on 2024/3/20.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import "DIMRawMessage.h"
+
+// fields carried as raw bytes, encoded into the dictionary on demand
+@interface DIMRawFields : NSObject
+
+@property (strong, nonatomic, nullable) NSData *data;
+@property (strong, nonatomic, nullable) NSData *key;
+@property (strong, nonatomic, nullable) NSDictionary<NSString *, NSData *> *keys;
+@property (strong, nonatomic, nullable) NSData *signature;
+
+@end
+
+@implementation DIMRawFields
+
+@end
+
+static inline BOOL is_raw_field(NSString *name) {
+    return [name isEqualToString:@"data"] ||
+           [name isEqualToString:@"key"] ||
+           [name isEqualToString:@"keys"] ||
+           [name isEqualToString:@"signature"];
+}
+
+static inline void forget_field(DIMRawFields *raw, NSString *name) {
+    // the dictionary value is changed, decode it again when needed
+    if ([name isEqualToString:@"data"]) {
+        raw.data = nil;
+    } else if ([name isEqualToString:@"key"]) {
+        raw.key = nil;
+    } else if ([name isEqualToString:@"keys"]) {
+        raw.keys = nil;
+    } else if ([name isEqualToString:@"signature"]) {
+        raw.signature = nil;
+    }
+}
+
+// encode the carried bytes which are not in the dictionary yet
+static void encode_fields(DIMRawFields *raw, NSMutableDictionary *info, id<DKDMessage> msg) {
+    NSData *data = raw.data;
+    if (data && ![info objectForKey:@"data"]) {
+        if ([DIMMessage isBroadcast:msg]) {
+            // broadcast message content was not encrypted, it's a JsON string
+            [info setObject:MKMUTF8Decode(data) forKey:@"data"];
+        } else {
+            [info setObject:MKMTransportableDataEncode(data) forKey:@"data"];
+        }
+    }
+    NSData *key = raw.key;
+    if (key && ![info objectForKey:@"key"]) {
+        [info setObject:MKMTransportableDataEncode(key) forKey:@"key"];
+    }
+    NSDictionary<NSString *, NSData *> *keys = raw.keys;
+    if (keys && ![info objectForKey:@"keys"]) {
+        NSMutableDictionary *encoded = [[NSMutableDictionary alloc] initWithCapacity:keys.count];
+        [keys enumerateKeysAndObjectsUsingBlock:^(NSString *member, NSData *obj, BOOL *stop) {
+            [encoded setObject:MKMTransportableDataEncode(obj) forKey:member];
+        }];
+        [info setObject:encoded forKey:@"keys"];
+    }
+    NSData *signature = raw.signature;
+    if (signature && ![info objectForKey:@"signature"]) {
+        [info setObject:MKMTransportableDataEncode(signature) forKey:@"signature"];
+    }
+}
+
+@interface DIMRawSecureMessage () {
+
+    DIMRawFields *_raw;
+    id<DKDEnvelope> _head;
+}
+
+// fields without the carried bytes
+- (NSMutableDictionary *)fields;
+
+// carried bytes
+- (DIMRawFields *)raw;
+
+@end
+
+@implementation DIMRawSecureMessage
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict {
+    return [self initWithDictionary:dict data:nil key:nil keys:nil];
+}
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)dict
+                              data:(nullable NSData *)ciphertext
+                               key:(nullable NSData *)encryptedKey
+                              keys:(nullable NSDictionary<NSString *, NSData *> *)encryptedKeys {
+    if (self = [super initWithDictionary:dict]) {
+        _raw = [[DIMRawFields alloc] init];
+        _raw.data = ciphertext;
+        _raw.key = encryptedKey;
+        _raw.keys = encryptedKeys;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    // the copy decodes from the dictionary lazily
+    encode_fields(_raw, [super dictionary], self);
+    return [super copyWithZone:zone];
+}
+
+- (NSMutableDictionary *)fields {
+    return [super dictionary];
+}
+
+- (DIMRawFields *)raw {
+    return _raw;
+}
+
+- (NSMutableDictionary *)dictionary {
+    NSMutableDictionary *info = [super dictionary];
+    encode_fields(_raw, info, self);
+    return info;
+}
+
+- (NSMutableDictionary *)dictionary:(BOOL)deepCopy {
+    encode_fields(_raw, [super dictionary], self);
+    return [super dictionary:deepCopy];
+}
+
+- (NSUInteger)count {
+    return [[self dictionary] count];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [[self dictionary] keyEnumerator];
+}
+
+- (nullable id)objectForKey:(NSString *)aKey {
+    if (is_raw_field(aKey)) {
+        encode_fields(_raw, [super dictionary], self);
+    }
+    return [super objectForKey:aKey];
+}
+
+- (void)setObject:(id)anObject forKey:(NSString *)aKey {
+    forget_field(_raw, aKey);
+    [super setObject:anObject forKey:aKey];
+}
+
+- (void)removeObjectForKey:(NSString *)aKey {
+    forget_field(_raw, aKey);
+    [super removeObjectForKey:aKey];
+}
+
+- (id<DKDEnvelope>)envelope {
+    id<DKDEnvelope> head = _head;
+    if (!head) {
+        // share the fields, no need to encode the raw bytes
+        _head = head = DKDEnvelopeParse([super dictionary]);
+    }
+    return head;
+}
+
+- (NSData *)data {
+    NSData *ciphertext = _raw.data;
+    if (!ciphertext) {
+        _raw.data = ciphertext = [super data];
+    }
+    return ciphertext;
+}
+
+- (nullable NSData *)encryptedKey {
+    NSData *key = _raw.key;
+    if (key) {
+        return key;
+    }
+    NSDictionary<NSString *, NSData *> *keys = _raw.keys;
+    if (keys) {
+        return [keys objectForKey:[self.receiver string]];
+    }
+    return [super encryptedKey];
+}
+
+@end
+
+@interface DIMRawReliableMessage () {
+
+    DIMRawFields *_raw;
+    id<DKDEnvelope> _head;
+}
+
+// fields without the carried bytes
+- (NSMutableDictionary *)fields;
+
+// carried bytes
+- (DIMRawFields *)raw;
+
+@end
+
+@implementation DIMRawReliableMessage
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict {
+    return [self initWithDictionary:dict data:nil key:nil keys:nil signature:nil];
+}
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)dict
+                              data:(nullable NSData *)ciphertext
+                               key:(nullable NSData *)encryptedKey
+                              keys:(nullable NSDictionary<NSString *, NSData *> *)encryptedKeys
+                         signature:(nullable NSData *)signature {
+    if (self = [super initWithDictionary:dict]) {
+        _raw = [[DIMRawFields alloc] init];
+        _raw.data = ciphertext;
+        _raw.key = encryptedKey;
+        _raw.keys = encryptedKeys;
+        _raw.signature = signature;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    // the copy decodes from the dictionary lazily
+    encode_fields(_raw, [super dictionary], self);
+    return [super copyWithZone:zone];
+}
+
+- (NSMutableDictionary *)fields {
+    return [super dictionary];
+}
+
+- (DIMRawFields *)raw {
+    return _raw;
+}
+
+- (NSMutableDictionary *)dictionary {
+    NSMutableDictionary *info = [super dictionary];
+    encode_fields(_raw, info, self);
+    return info;
+}
+
+- (NSMutableDictionary *)dictionary:(BOOL)deepCopy {
+    encode_fields(_raw, [super dictionary], self);
+    return [super dictionary:deepCopy];
+}
+
+- (NSUInteger)count {
+    return [[self dictionary] count];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [[self dictionary] keyEnumerator];
+}
+
+- (nullable id)objectForKey:(NSString *)aKey {
+    if (is_raw_field(aKey)) {
+        encode_fields(_raw, [super dictionary], self);
+    }
+    return [super objectForKey:aKey];
+}
+
+- (void)setObject:(id)anObject forKey:(NSString *)aKey {
+    forget_field(_raw, aKey);
+    [super setObject:anObject forKey:aKey];
+}
+
+- (void)removeObjectForKey:(NSString *)aKey {
+    forget_field(_raw, aKey);
+    [super removeObjectForKey:aKey];
+}
+
+- (id<DKDEnvelope>)envelope {
+    id<DKDEnvelope> head = _head;
+    if (!head) {
+        // share the fields, no need to encode the raw bytes
+        _head = head = DKDEnvelopeParse([super dictionary]);
+    }
+    return head;
+}
+
+- (NSData *)data {
+    NSData *ciphertext = _raw.data;
+    if (!ciphertext) {
+        _raw.data = ciphertext = [super data];
+    }
+    return ciphertext;
+}
+
+- (nullable NSData *)encryptedKey {
+    NSData *key = _raw.key;
+    if (key) {
+        return key;
+    }
+    NSDictionary<NSString *, NSData *> *keys = _raw.keys;
+    if (keys) {
+        return [keys objectForKey:[self.receiver string]];
+    }
+    return [super encryptedKey];
+}
+
+- (NSData *)signature {
+    NSData *signature = _raw.signature;
+    if (!signature) {
+        _raw.signature = signature = [super signature];
+    }
+    return signature;
+}
+
+@end
+
+static inline DIMRawFields *raw_fields(id<DKDMessage> msg) {
+    if ([msg isKindOfClass:[DIMRawReliableMessage class]]) {
+        return [(DIMRawReliableMessage *)msg raw];
+    } else if ([msg isKindOfClass:[DIMRawSecureMessage class]]) {
+        return [(DIMRawSecureMessage *)msg raw];
+    }
+    return nil;
+}
+
+NSMutableDictionary *DIMMessageGetFields(id<DKDMessage> msg) {
+    if ([msg isKindOfClass:[DIMRawReliableMessage class]]) {
+        return [(DIMRawReliableMessage *)msg fields];
+    } else if ([msg isKindOfClass:[DIMRawSecureMessage class]]) {
+        return [(DIMRawSecureMessage *)msg fields];
+    }
+    return [msg dictionary];
+}
+
+NSData *DIMMessageGetRawKey(id<DKDSecureMessage> msg) {
+    // don't decode it here
+    return [raw_fields(msg) key];
+}
+
+NSDictionary<NSString *, NSData *> *DIMMessageGetRawKeys(id<DKDSecureMessage> msg) {
+    // don't decode them here
+    return [raw_fields(msg) keys];
+}
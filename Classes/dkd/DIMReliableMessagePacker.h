@@ -71,6 +71,45 @@ NS_DESIGNATED_INITIALIZER;
  */
 - (nullable id<DKDSecureMessage>)verifyMessage:(id<DKDReliableMessage>)rMsg;
 
+/**
+ *  Verify a batch of messages, signatures by the same key are checked together;
+ *  messages failed in the batch will be verified again by the delegate
+ *
+ * @param messages - received messages
+ * @param keys     - sender's public key for each message (NSNull when unknown)
+ * @return bitmap, bit (i % 8) of byte (i / 8) is set when message i is verified
+ */
+- (NSData *)verifyMessages:(NSArray<id<DKDReliableMessage>> *)messages
+                  withKeys:(NSArray *)keys;
+
+/**
+ *  Pack a verified message to Secure Message (signature removed)
+ *
+ * @param rMsg - verified message
+ * @return SecureMessage object
+ */
+- (id<DKDSecureMessage>)secureMessageFromVerifiedMessage:(id<DKDReliableMessage>)rMsg;
+
+@end
+
+/**
+ *  Public key class which can verify a batch of signatures at once
+ *  (e.g. MKMECCPublicKey)
+ */
+@protocol DIMBatchVerifyKey <NSObject>
+
+/**
+ *  Verify a batch of signatures
+ *
+ * @param data       - signed data
+ * @param signatures - signatures
+ * @param keys       - signer's public key for each signature
+ * @return bitmap, bit (i % 8) of byte (i / 8) is set when signature i matches
+ */
++ (NSData *)verifyBatch:(NSArray<NSData *> *)data
+             signatures:(NSArray<NSData *> *)signatures
+                   keys:(NSArray<id<MKMVerifyKey>> *)keys;
+
 @end
 
 #ifdef __cplusplus
@@ -35,6 +35,8 @@
 //  Copyright © 2018 DIM Group. All rights reserved.
 //
 
+#import "DIMRawMessage.h"
+
 #import "DIMReliableMessagePacker.h"
 
 @interface DIMReliableMessagePacker ()
@@ -95,10 +97,99 @@
         return nil;
     }
     
-    // OK, pack message
-    NSMutableDictionary *info = [rMsg dictionary:NO];
-    [info removeObjectForKey:@"signature"];
-    return DKDSecureMessageParse(info);
+    return [self secureMessageFromVerifiedMessage:rMsg];
+}
+
+- (NSData *)verifyMessages:(NSArray<id<DKDReliableMessage>> *)messages
+                  withKeys:(NSArray *)keys {
+    id<DKDReliableMessageDelegate> delegate = [self delegate];
+    NSUInteger count = [messages count];
+    NSAssert([keys count] == count, @"keys not match: %lu, %lu", count, [keys count]);
+    NSMutableData *results = [[NSMutableData alloc] initWithLength:(count + 7) / 8];
+    uint8_t *bitmap = [results mutableBytes];
+    
+    //
+    //  1. Group messages by the key class which supports batch verifying
+    //
+    NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *groups;
+    groups = [[NSMutableDictionary alloc] init];
+    NSMutableArray<NSNumber *> *indexes;
+    id<DKDReliableMessage> rMsg;
+    id key;
+    NSUInteger index;
+    for (index = 0; index < count; ++index) {
+        key = [keys objectAtIndex:index];
+        if (![[key class] respondsToSelector:@selector(verifyBatch:signatures:keys:)]) {
+            continue;
+        }
+        rMsg = [messages objectAtIndex:index];
+        if ([rMsg.data length] == 0 || [rMsg.signature length] == 0) {
+            continue;
+        }
+        NSString *name = NSStringFromClass([key class]);
+        indexes = [groups objectForKey:name];
+        if (!indexes) {
+            indexes = [[NSMutableArray alloc] init];
+            [groups setObject:indexes forKey:name];
+        }
+        [indexes addObject:@(index)];
+    }
+    
+    //
+    //  2. Verify each group at once
+    //
+    [groups enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSMutableArray<NSNumber *> *group, BOOL *stop) {
+        NSMutableArray<NSData *> *data = [[NSMutableArray alloc] initWithCapacity:group.count];
+        NSMutableArray<NSData *> *signatures = [[NSMutableArray alloc] initWithCapacity:group.count];
+        NSMutableArray<id<MKMVerifyKey>> *verifyKeys = [[NSMutableArray alloc] initWithCapacity:group.count];
+        for (NSNumber *pos in group) {
+            id<DKDReliableMessage> msg = [messages objectAtIndex:[pos unsignedIntegerValue]];
+            [data addObject:msg.data];
+            [signatures addObject:msg.signature];
+            [verifyKeys addObject:[keys objectAtIndex:[pos unsignedIntegerValue]]];
+        }
+        Class<DIMBatchVerifyKey> clazz = NSClassFromString(name);
+        NSData *verified = [clazz verifyBatch:data signatures:signatures keys:verifyKeys];
+        const uint8_t *bits = [verified bytes];
+        NSUInteger i, pos;
+        for (i = 0; i < group.count; ++i) {
+            if (bits[i / 8] & (1 << (i % 8))) {
+                pos = [[group objectAtIndex:i] unsignedIntegerValue];
+                bitmap[pos / 8] |= 1 << (pos % 8);
+            }
+        }
+    }];
+    
+    //
+    //  3. Fall back to verify the others one by one
+    //     (sender may have signed with another key)
+    //
+    for (index = 0; index < count; ++index) {
+        if (bitmap[index / 8] & (1 << (index % 8))) {
+            continue;
+        }
+        rMsg = [messages objectAtIndex:index];
+        NSData *ciphertext = [rMsg data];
+        NSData *signature = [rMsg signature];
+        if ([ciphertext length] == 0 || [signature length] == 0) {
+            continue;
+        }
+        if ([delegate message:rMsg verifyData:ciphertext withSignature:signature]) {
+            bitmap[index / 8] |= 1 << (index % 8);
+        }
+    }
+    return results;
+}
+
+- (id<DKDSecureMessage>)secureMessageFromVerifiedMessage:(id<DKDReliableMessage>)rMsg {
+    // OK, pack message with the decoded data, sharing the fields with rMsg,
+    // so the decrypter will not decode it from the dictionary again
+    // (the 'signature' may stay in the fields, as the secure message factory
+    // accepts; it is dropped when decrypting to instant message)
+    return [[DIMRawSecureMessage alloc] initWithDictionary:DIMMessageGetFields(rMsg)
+                                                      data:[rMsg data]
+                                                       key:DIMMessageGetRawKey(rMsg)
+                                                      keys:DIMMessageGetRawKeys(rMsg)];
 }
 
 @end
@@ -72,6 +72,16 @@ NS_DESIGNATED_INITIALIZER;
 - (nullable id<DKDInstantMessage>)decryptMessage:(id<DKDSecureMessage>)sMsg
                                      forReceiver:(id<MKMID>)receiver;
 
+/**
+ *  Pack a decrypted content to Instant Message (key, data & signature removed)
+ *
+ * @param sMsg    - encrypted message
+ * @param content - decrypted content
+ * @return InstantMessage object
+ */
+- (nullable id<DKDInstantMessage>)instantMessageFromSecureMessage:(id<DKDSecureMessage>)sMsg
+                                                          content:(id<DKDContent>)content;
+
 @end
 
 /*
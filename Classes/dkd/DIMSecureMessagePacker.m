@@ -35,6 +35,8 @@
 //  Copyright © 2018 DIM Group. All rights reserved.
 //
 
+#import "DIMRawMessage.h"
+
 #import "DIMSecureMessagePacker.h"
 
 @interface DIMSecureMessagePacker ()
@@ -150,10 +152,17 @@
     //      (do it by application)
 
     // OK, pack message
-    NSMutableDictionary *info = [sMsg dictionary:NO];
+    return [self instantMessageFromSecureMessage:sMsg content:content];
+}
+
+- (nullable id<DKDInstantMessage>)instantMessageFromSecureMessage:(id<DKDSecureMessage>)sMsg
+                                                          content:(id<DKDContent>)content {
+    // copy the fields only, the carried bytes need not be encoded
+    NSMutableDictionary *info = [DIMMessageGetFields(sMsg) mutableCopy];
     [info removeObjectForKey:@"key"];
     [info removeObjectForKey:@"keys"];
     [info removeObjectForKey:@"data"];
+    [info removeObjectForKey:@"signature"];
     [info setObject:content.dictionary forKey:@"content"];
     return DKDInstantMessageParse(info);
 }
@@ -167,6 +176,7 @@
     
     //
     //  0. decode message data
+    //     (raw message carries it from the encrypting step, no need to decode)
     //
     NSData *ciphertext = [sMsg data];
     NSAssert([ciphertext length] > 0, @"failed to to decode message data: %@ => %@, %@", sMsg.sender, sMsg.receiver, sMsg.group);
@@ -177,16 +187,20 @@
     NSData *signature = [delegate message:sMsg signData:ciphertext];
     NSAssert([signature length] > 0, @"failed to sign message: %@ => %@, %@", sMsg.sender, sMsg.receiver, sMsg.group);
     
-    //
-    //  2. Encode 'message.signature' to String (Base64)
-    //
-    NSObject *base64 = MKMTransportableDataEncode(signature);
-    //NSAssert([(NSString *)base64 length] > 0, @"failed to encode signature: %lu byte(s), %@ => %@, %@", signature.length, sMsg.sender, sMsg.receiver, sMsg.group);
-    
-    // OK, pack message
-    NSMutableDictionary *info = [sMsg dictionary:NO];
-    [info setObject:base64 forKey:@"signature"];
-    return DKDReliableMessageParse(info);
+    // OK, pack message with raw bytes, sharing the fields with sMsg;
+    // the signature will be encoded to String (Base64) only when
+    // serializing to JsON
+    NSMutableDictionary *info = DIMMessageGetFields(sMsg);
+    if ([info objectForKey:@"signature"]) {
+        // signing again, keep the old message untouched
+        info = [info mutableCopy];
+        [info removeObjectForKey:@"signature"];
+    }
+    return [[DIMRawReliableMessage alloc] initWithDictionary:info
+                                                        data:ciphertext
+                                                         key:DIMMessageGetRawKey(sMsg)
+                                                        keys:DIMMessageGetRawKeys(sMsg)
+                                                   signature:signature];
 }
 
 @end
@@ -37,6 +37,9 @@
 
 #import <DIMCore/DIMCore.h>
 
+#import "uECC.h"
+#import "drbg.h"
+
 #import "DIMDataDigesters.h"
 #import "DIMDataCoders.h"
 #import "DIMDataParsers.h"
@@ -44,10 +47,13 @@
 #import "DIMBaseFileFactory.h"
 
 #import "MKMAESKey.h"
+#import "MKMChaCha20Key.h"
 #import "MKMRSAPublicKey.h"
 #import "MKMRSAPrivateKey.h"
 #import "MKMECCPublicKey.h"
 #import "MKMECCPrivateKey.h"
+#import "MKMEd25519PublicKey.h"
+#import "MKMEd25519PrivateKey.h"
 
 #import "MKMPlugins.h"
 
@@ -60,7 +66,7 @@
  *          data     : ""       // empty data
  *      }
  */
-@interface PlainKey : DIMSymmetricKey
+@interface PlainKey : DIMSymmetricKey <MKMStreamCipher>
 
 + (instancetype)sharedInstance;
 
@@ -102,6 +108,16 @@ static PlainKey *s_sharedPlainKey = nil;
     return ciphertext;
 }
 
+- (MKMCipherContext *)streamEncryptor {
+    // copy through
+    return [[MKMCipherContext alloc] init];
+}
+
+- (MKMCipherContext *)streamDecryptor {
+    // copy through
+    return [[MKMCipherContext alloc] init];
+}
+
 @end
 
 @interface KeyFactory : NSObject
@@ -144,6 +160,10 @@ static PlainKey *s_sharedPlainKey = nil;
     if ([algorithm isEqualToString:MKMAlgorithm_AES]) {
         return [[MKMAESKey alloc] initWithDictionary:key];
     }
+    // ChaCha20-Poly1305 key
+    if ([algorithm isEqualToString:MKMAlgorithm_ChaCha20Poly1305]) {
+        return [[MKMChaCha20Key alloc] initWithDictionary:key];
+    }
     // Plain Key
     if ([algorithm isEqualToString:MKMAlgorithm_Plain]) {
         return [PlainKey sharedInstance];
@@ -169,6 +189,10 @@ static PlainKey *s_sharedPlainKey = nil;
     if ([self.algorithm isEqualToString:MKMAlgorithm_ECC]) {
         return [[MKMECCPublicKey alloc] initWithDictionary:key];
     }
+    // Ed25519 Key
+    if ([self.algorithm isEqualToString:MKMAlgorithm_Ed25519]) {
+        return [[MKMEd25519PublicKey alloc] initWithDictionary:key];
+    }
     NSAssert(false, @"public key algorithm (%@) not support yet", self.algorithm);
     return nil;
 }
@@ -196,18 +220,32 @@ static PlainKey *s_sharedPlainKey = nil;
     if ([self.algorithm isEqualToString:MKMAlgorithm_ECC]) {
         return [[MKMECCPrivateKey alloc] initWithDictionary:key];
     }
+    // Ed25519 Key
+    if ([self.algorithm isEqualToString:MKMAlgorithm_Ed25519]) {
+        return [[MKMEd25519PrivateKey alloc] initWithDictionary:key];
+    }
     NSAssert(false, @"private key algorithm (%@) not support yet", self.algorithm);
     return nil;
 }
 
 @end
 
+// buffered per-thread DRBG instead of reading /dev/urandom for each nonce
+static int ecc_rng(uint8_t *dest, unsigned size) {
+    return drbg_random_bytes(dest, size);
+}
+
 @implementation MKMPlugins (Crypto)
 
 + (void)registerKeyFactories {
+    // Random for ECC keys & signatures
+    uECC_set_rng(ecc_rng);
+    
     // Symmetric key
     MKMSymmetricKeySetFactory(MKMAlgorithm_AES,
                               [[SymmetricKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_AES]);
+    MKMSymmetricKeySetFactory(MKMAlgorithm_ChaCha20Poly1305,
+                              [[SymmetricKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_ChaCha20Poly1305]);
     MKMSymmetricKeySetFactory(MKMAlgorithm_Plain,
                               [[SymmetricKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_Plain]);
 
@@ -216,12 +254,16 @@ static PlainKey *s_sharedPlainKey = nil;
                            [[PublicKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_RSA]);
     MKMPublicKeySetFactory(MKMAlgorithm_ECC,
                            [[PublicKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_ECC]);
+    MKMPublicKeySetFactory(MKMAlgorithm_Ed25519,
+                           [[PublicKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_Ed25519]);
 
     // private key
     MKMPrivateKeySetFactory(MKMAlgorithm_RSA,
                             [[PrivateKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_RSA]);
     MKMPrivateKeySetFactory(MKMAlgorithm_ECC,
                             [[PrivateKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_ECC]);
+    MKMPrivateKeySetFactory(MKMAlgorithm_Ed25519,
+                            [[PrivateKeyFactory alloc] initWithAlgorithm:MKMAlgorithm_Ed25519]);
 }
 
 @end
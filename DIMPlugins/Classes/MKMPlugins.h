@@ -40,6 +40,8 @@
 NS_ASSUME_NONNULL_BEGIN
 
 #define MKMAlgorithm_Plain @"PLAIN"
+#define MKMAlgorithm_ChaCha20Poly1305 @"ChaCha20-Poly1305"
+#define MKMAlgorithm_Ed25519 @"Ed25519"
 
 @interface MKMPlugins : NSObject
 
@@ -8,6 +8,8 @@
 //#include <uint256.h>
 
 #include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
 #include <string.h>
 
 /** All alphanumeric characters except for "0", "I", "O", and "l" */
@@ -31,92 +33,188 @@ static const int8_t mapBase58[256] = {
     -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
 };
 
-bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
+// Big numbers are held in 32-bit limbs (little-endian limb order):
+//   base 58^5 while encoding, base 2^32 while decoding,
+// so each step handles 4 bytes (or 5 chars) instead of 1 byte (or 1 char).
+static const uint32_t kBase58Pow5 = 58 * 58 * 58 * 58 * 58;  // 656356768 < 2^30
+static const uint32_t kBase58Pows[6] = {1, 58, 58 * 58, 58 * 58 * 58, 58 * 58 * 58 * 58, kBase58Pow5};
+
+// Inputs up to this size (e.g. 25-byte addresses) use stack buffers only.
+static const size_t kStackLimbs = 32;
+
+template <typename Func>
+static inline bool WithLimbs(size_t count, Func func)
+{
+    if (count <= kStackLimbs) {
+        uint32_t limbs[kStackLimbs];
+        return func(limbs);
+    }
+    std::vector<uint32_t> limbs(count);
+    return func(limbs.data());
+}
+
+size_t EncodeBase58(const unsigned char* pbegin, const unsigned char* pend, char* out, size_t outsize)
+{
+    // Skip & count leading zeroes.
+    size_t zeroes = 0;
+    while (pbegin != pend && *pbegin == 0) {
+        pbegin++;
+        zeroes++;
+    }
+    size_t len = pend - pbegin;
+    // log(256) / log(58), rounded up; then 5 digits per limb.
+    size_t digits = len * 138 / 100 + 1;
+    size_t count = digits / 5 + 1;
+    if (zeroes + digits > outsize) {
+        return 0;
+    }
+    size_t total = 0;
+    WithLimbs(count, [&](uint32_t* limbs) {
+        size_t used = 0;
+        // Apply "b58 = b58 * 2^(8*k) + word" for each word of k (<= 4) bytes.
+        size_t head = len % 4;
+        for (size_t pos = 0; pos < len; ) {
+            size_t k = (pos == 0 && head) ? head : 4;
+            uint64_t carry = 0;
+            for (size_t j = 0; j < k; ++j) {
+                carry = (carry << 8) | pbegin[pos + j];
+            }
+            pos += k;
+            size_t i = 0;
+            for (; i < used; ++i) {
+                uint64_t t = ((uint64_t)limbs[i] << (8 * k)) + carry;
+                limbs[i] = (uint32_t)(t % kBase58Pow5);
+                carry = t / kBase58Pow5;
+            }
+            while (carry != 0) {
+                assert(i < count);
+                limbs[i++] = (uint32_t)(carry % kBase58Pow5);
+                carry /= kBase58Pow5;
+            }
+            used = i;
+        }
+        // Translate limbs into digits, most significant first, skipping leading zeroes.
+        char* p = out;
+        for (size_t j = 0; j < zeroes; ++j) {
+            *p++ = '1';
+        }
+        bool started = false;
+        for (size_t i = used; i-- > 0; ) {
+            uint32_t limb = limbs[i];
+            char group[5];
+            for (int j = 4; j >= 0; --j) {
+                group[j] = pszBase58[limb % 58];
+                limb /= 58;
+            }
+            int j = 0;
+            if (!started) {
+                while (j < 5 && group[j] == '1') {
+                    j++;
+                }
+                started = j < 5;
+            }
+            for (; j < 5; ++j) {
+                *p++ = group[j];
+            }
+        }
+        total = p - out;
+        return true;
+    });
+    return total;
+}
+
+bool DecodeBase58(const char* psz, size_t len, unsigned char* out, size_t outsize, size_t* outlen)
 {
-    // Skip leading spaces.
-    while (*psz && isspace(*psz))
+    const char* pend = psz + len;
+    // Skip leading and trailing spaces.
+    while (psz != pend && isspace(*psz))
         psz++;
+    while (pend != psz && isspace(*(pend - 1)))
+        pend--;
     // Skip and count leading '1's.
-    int zeroes = 0;
-    int length = 0;
-    while (*psz == '1') {
+    size_t zeroes = 0;
+    while (psz != pend && *psz == '1') {
         zeroes++;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    unsigned long size = strlen(psz) * 733 /1000 + 1; // log(58) / log(256), rounded up.
-    std::vector<unsigned char> b256(size);
-    // Process the characters.
+    len = pend - psz;
+    // log(58) / log(256), rounded up; then 4 bytes per limb.
+    size_t bytes = len * 733 / 1000 + 1;
+    size_t count = bytes / 4 + 1;
     static_assert(sizeof(mapBase58)/sizeof(mapBase58[0]) == 256, "mapBase58.size() should be 256"); // guarantee not out of range
-    while (*psz && !isspace(*psz)) {
-        // Decode base58 character
-        int carry = mapBase58[(uint8_t)*psz];
-        if (carry == -1)  // Invalid b58 character
+    return WithLimbs(count, [&](uint32_t* limbs) {
+        size_t used = 0;
+        // Apply "b256 = b256 * 58^k + value" for each group of k (<= 5) chars.
+        for (size_t pos = 0; pos < len; ) {
+            size_t k = len - pos < 5 ? len - pos : 5;
+            uint64_t carry = 0;
+            for (size_t j = 0; j < k; ++j) {
+                int digit = mapBase58[(uint8_t)psz[pos + j]];
+                if (digit == -1)  // Invalid b58 character
+                    return false;
+                carry = carry * 58 + digit;
+            }
+            pos += k;
+            uint64_t mul = kBase58Pows[k];
+            size_t i = 0;
+            for (; i < used; ++i) {
+                uint64_t t = limbs[i] * mul + carry;
+                limbs[i] = (uint32_t)t;
+                carry = t >> 32;
+            }
+            while (carry != 0) {
+                assert(i < count);
+                limbs[i++] = (uint32_t)carry;
+                carry >>= 32;
+            }
+            used = i;
+        }
+        // Count significant bytes in the top limb.
+        size_t top = 0;
+        if (used > 0) {
+            uint32_t limb = limbs[used - 1];
+            while (limb) {
+                top++;
+                limb >>= 8;
+            }
+        }
+        size_t size = zeroes + (used > 0 ? (used - 1) * 4 + top : 0);
+        if (size > outsize)
             return false;
-        int i = 0;
-        for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); (carry != 0 || i < length) && (it != b256.rend()); ++it, ++i) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+        // Copy result into output buffer (big-endian).
+        unsigned char* p = out;
+        for (size_t j = 0; j < zeroes; ++j) {
+            *p++ = 0x00;
         }
-        assert(carry == 0);
-        length = i;
-        psz++;
-    }
-    // Skip trailing spaces.
-    while (isspace(*psz))
-        psz++;
-    if (*psz != 0)
+        for (size_t i = used; i-- > 0; ) {
+            uint32_t limb = limbs[i];
+            int n = (i == used - 1) ? (int)top : 4;
+            for (int j = n - 1; j >= 0; --j) {
+                *p++ = (unsigned char)(limb >> (8 * j));
+            }
+        }
+        *outlen = size;
+        return true;
+    });
+}
+
+bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
+{
+    size_t len = strlen(psz);
+    vch.resize(BASE58_DECODE_SIZE(len));
+    size_t size = 0;
+    if (!DecodeBase58(psz, len, vch.data(), vch.size(), &size)) {
+        vch.clear();
         return false;
-    // Skip leading zeroes in b256.
-    std::vector<unsigned char>::iterator it = b256.begin() + (size - length);
-    while (it != b256.end() && *it == 0)
-        it++;
-    // Copy result into output vector.
-    vch.reserve(zeroes + (b256.end() - it));
-    vch.assign(zeroes, 0x00);
-    while (it != b256.end())
-        vch.push_back(*(it++));
+    }
+    vch.resize(size);
     return true;
 }
 
 std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
 {
-    // Skip & count leading zeroes.
-    int zeroes = 0;
-    int length = 0;
-    while (pbegin != pend && *pbegin == 0) {
-        pbegin++;
-        zeroes++;
-    }
-    // Allocate enough space in big-endian base58 representation.
-    unsigned long size = (pend - pbegin) * 138 / 100 + 1; // log(256) / log(58), rounded up.
-    std::vector<unsigned char> b58(size);
-    // Process the bytes.
-    while (pbegin != pend) {
-        int carry = *pbegin;
-        int i = 0;
-        // Apply "b58 = b58 * 256 + ch".
-        for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); (carry != 0 || i < length) && (it != b58.rend()); it++, i++) {
-            carry += 256 * (*it);
-            *it = carry % 58;
-            carry /= 58;
-        }
-
-        assert(carry == 0);
-        length = i;
-        pbegin++;
-    }
-    // Skip leading zeroes in base58 result.
-    std::vector<unsigned char>::iterator it = b58.begin() + (size - length);
-    while (it != b58.end() && *it == 0)
-        it++;
-    // Translate the result into a string.
-    std::string str;
-    str.reserve(zeroes + (b58.end() - it));
-    str.assign(zeroes, '1');
-    while (it != b58.end())
-        str += pszBase58[*(it++)];
+    std::string str(BASE58_ENCODE_SIZE(pend - pbegin), '\0');
+    str.resize(EncodeBase58(pbegin, pend, &str[0], str.size()));
     return str;
 }
 
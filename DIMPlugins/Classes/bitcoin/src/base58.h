@@ -14,9 +14,31 @@
 #ifndef BITCOIN_BASE58_H
 #define BITCOIN_BASE58_H
 
+#include <stddef.h>
 #include <string>
 #include <vector>
 
+/**
+ * Max output sizes for the buffer versions below
+ * (each leading zero byte <=> one leading '1').
+ */
+#define BASE58_ENCODE_SIZE(len) ((len) * 138 / 100 + 2)
+#define BASE58_DECODE_SIZE(len) ((len) + 1)
+
+/**
+ * Encode a byte sequence as base58 into a buffer (no heap allocation for short inputs).
+ * pbegin and pend cannot be nullptr, unless both are.
+ * return length of output chars (not NUL-terminated), or 0 if the buffer is too small.
+ */
+size_t EncodeBase58(const unsigned char* pbegin, const unsigned char* pend, char* out, size_t outsize);
+
+/**
+ * Decode base58 chars into a buffer (no heap allocation for short inputs).
+ * Leading and trailing spaces are skipped.
+ * return true if decoding is successful, and set outlen to the length of output bytes.
+ */
+bool DecodeBase58(const char* psz, size_t len, unsigned char* out, size_t outsize, size_t* outlen);
+
 /**
  * Encode a byte sequence as a base58-encoded string.
  * pbegin and pend cannot be nullptr, unless both are.
@@ -0,0 +1,106 @@
+//
+//  lanes.h
+//  DIMPlugins
+//
+//  Multi-buffer hashing: N independent messages are hashed at once, word j
+//  of message i sits in element i of vector j (GCC/Clang vector extensions,
+//  compiled to SSE2/AVX2 on x86 and NEON on arm64). The compression
+//  functions are templates on the word type, so the scalar and the vector
+//  versions share the same round code.
+//
+//  Created by Albert Moky on 2024/3/28.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef BITCOIN_CRYPTO_LANES_H
+#define BITCOIN_CRYPTO_LANES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+#if defined(__GNUC__) && (defined(DIM_CPU_X86) || defined(DIM_CPU_ARM))
+#define ENABLE_MULTI_LANES 1
+
+typedef uint32_t u32x4 __attribute__((vector_size(16)));  // SSE2 / NEON
+typedef uint32_t u32x8 __attribute__((vector_size(32)));  // AVX2
+
+/** Number of 64-byte blocks of a message after MD-padding. */
+static inline size_t LaneBlocks(size_t len)
+{
+    return (len + 8) / 64 + 1;
+}
+
+/** Whether the 'n' messages take the same number of blocks. */
+static inline bool SameLaneBlocks(const size_t* len, size_t n)
+{
+    const size_t blocks = LaneBlocks(len[0]);
+    for (size_t i = 1; i < n; ++i) {
+        if (LaneBlocks(len[i]) != blocks) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Hash N messages (with the same number of blocks) in the lanes of V.
+ *
+ * Algo provides:
+ *     OUTPUT_SIZE, STATE_WORDS, IV[STATE_WORDS],
+ *     Compress<T>(T* s, const T* w),
+ *     ReadWord(), WriteWord(), WriteLength() - byte order of the algorithm
+ */
+template <typename Algo, typename V, int N>
+ALWAYS_INLINE void HashLanes(unsigned char* out, const unsigned char* const* in, const size_t* len)
+{
+    const size_t blocks = LaneBlocks(len[0]);
+    unsigned char tail[N][128];
+    size_t full[N];
+    for (int i = 0; i < N; ++i) {
+        // the last 1 or 2 blocks: remaining bytes + 0x80 + zeros + bit length
+        full[i] = len[i] / 64;
+        size_t rem = len[i] - full[i] * 64;
+        size_t end = 64 * (blocks - full[i]);
+        memset(tail[i], 0, end);
+        if (rem > 0) {
+            memcpy(tail[i], in[i] + full[i] * 64, rem);
+        }
+        tail[i][rem] = 0x80;
+        Algo::WriteLength(tail[i] + end - 8, (uint64_t)len[i] << 3);
+    }
+    V s[Algo::STATE_WORDS];
+    for (int j = 0; j < Algo::STATE_WORDS; ++j) {
+        s[j] = V{} + Algo::IV[j];
+    }
+    V w[16];
+    const unsigned char* p[N];
+    for (size_t b = 0; b < blocks; ++b) {
+        for (int i = 0; i < N; ++i) {
+            p[i] = b < full[i] ? in[i] + b * 64 : tail[i] + (b - full[i]) * 64;
+        }
+        for (int j = 0; j < 16; ++j) {
+            for (int i = 0; i < N; ++i) {
+                w[j][i] = Algo::ReadWord(p[i] + 4 * j);
+            }
+        }
+        Algo::Compress(s, w);
+    }
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < (int)(Algo::OUTPUT_SIZE / 4); ++j) {
+            Algo::WriteWord(out + Algo::OUTPUT_SIZE * i + 4 * j, s[j][i]);
+        }
+    }
+}
+
+#endif // ENABLE_MULTI_LANES
+
+#endif // BITCOIN_CRYPTO_LANES_H
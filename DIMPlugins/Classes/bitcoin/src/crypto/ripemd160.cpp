@@ -5,6 +5,7 @@
 #include "ripemd160.h"
 
 #include "common.h"
+#include "lanes.h"
 
 #include <string.h>
 
@@ -14,51 +15,51 @@ namespace
 /// Internal RIPEMD-160 implementation.
 namespace ripemd160
 {
-uint32_t inline f1(uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; }
-uint32_t inline f2(uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (~x & z); }
-uint32_t inline f3(uint32_t x, uint32_t y, uint32_t z) { return (x | ~y) ^ z; }
-uint32_t inline f4(uint32_t x, uint32_t y, uint32_t z) { return (x & z) | (y & ~z); }
-uint32_t inline f5(uint32_t x, uint32_t y, uint32_t z) { return x ^ (y | ~z); }
+template <typename T> ALWAYS_INLINE T f1(T x, T y, T z) { return x ^ y ^ z; }
+template <typename T> ALWAYS_INLINE T f2(T x, T y, T z) { return (x & y) | (~x & z); }
+template <typename T> ALWAYS_INLINE T f3(T x, T y, T z) { return (x | ~y) ^ z; }
+template <typename T> ALWAYS_INLINE T f4(T x, T y, T z) { return (x & z) | (y & ~z); }
+template <typename T> ALWAYS_INLINE T f5(T x, T y, T z) { return x ^ (y | ~z); }
+
+static const uint32_t IV[5] = {
+    0x67452301ul, 0xEFCDAB89ul, 0x98BADCFEul, 0x10325476ul, 0xC3D2E1F0ul,
+};
 
 /** Initialize RIPEMD-160 state. */
 void inline Initialize(uint32_t* s)
 {
-    s[0] = 0x67452301ul;
-    s[1] = 0xEFCDAB89ul;
-    s[2] = 0x98BADCFEul;
-    s[3] = 0x10325476ul;
-    s[4] = 0xC3D2E1F0ul;
+    memcpy(s, IV, sizeof(IV));
 }
 
-uint32_t inline rol(uint32_t x, int i) { return (x << i) | (x >> (32 - i)); }
+template <typename T> ALWAYS_INLINE T rol(T x, int i) { return (x << i) | (x >> (32 - i)); }
 
-void inline Round(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t f, uint32_t x, uint32_t k, int r)
+template <typename T>
+ALWAYS_INLINE void Round(T& a, T b, T& c, T d, T e, T f, T x, uint32_t k, int r)
 {
     a = rol(a + f + x + k, r) + e;
     c = rol(c, 10);
 }
 
-void inline R11(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f1(b, c, d), x, 0, r); }
-void inline R21(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f2(b, c, d), x, 0x5A827999ul, r); }
-void inline R31(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f3(b, c, d), x, 0x6ED9EBA1ul, r); }
-void inline R41(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f4(b, c, d), x, 0x8F1BBCDCul, r); }
-void inline R51(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f5(b, c, d), x, 0xA953FD4Eul, r); }
+template <typename T> ALWAYS_INLINE void R11(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f1(b, c, d), x, 0, r); }
+template <typename T> ALWAYS_INLINE void R21(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f2(b, c, d), x, 0x5A827999ul, r); }
+template <typename T> ALWAYS_INLINE void R31(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f3(b, c, d), x, 0x6ED9EBA1ul, r); }
+template <typename T> ALWAYS_INLINE void R41(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f4(b, c, d), x, 0x8F1BBCDCul, r); }
+template <typename T> ALWAYS_INLINE void R51(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f5(b, c, d), x, 0xA953FD4Eul, r); }
 
-void inline R12(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f5(b, c, d), x, 0x50A28BE6ul, r); }
-void inline R22(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f4(b, c, d), x, 0x5C4DD124ul, r); }
-void inline R32(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f3(b, c, d), x, 0x6D703EF3ul, r); }
-void inline R42(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f2(b, c, d), x, 0x7A6D76E9ul, r); }
-void inline R52(uint32_t& a, uint32_t b, uint32_t& c, uint32_t d, uint32_t e, uint32_t x, int r) { Round(a, b, c, d, e, f1(b, c, d), x, 0, r); }
+template <typename T> ALWAYS_INLINE void R12(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f5(b, c, d), x, 0x50A28BE6ul, r); }
+template <typename T> ALWAYS_INLINE void R22(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f4(b, c, d), x, 0x5C4DD124ul, r); }
+template <typename T> ALWAYS_INLINE void R32(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f3(b, c, d), x, 0x6D703EF3ul, r); }
+template <typename T> ALWAYS_INLINE void R42(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f2(b, c, d), x, 0x7A6D76E9ul, r); }
+template <typename T> ALWAYS_INLINE void R52(T& a, T b, T& c, T d, T e, T x, int r) { Round(a, b, c, d, e, f1(b, c, d), x, 0, r); }
 
-/** Perform a RIPEMD-160 transformation, processing a 64-byte chunk. */
-void Transform(uint32_t* s, const unsigned char* chunk)
+/** Compress one 64-byte block, already read as 16 words. */
+template <typename T>
+ALWAYS_INLINE void Compress(T* s, const T* w)
 {
-    uint32_t a1 = s[0], b1 = s[1], c1 = s[2], d1 = s[3], e1 = s[4];
-    uint32_t a2 = a1, b2 = b1, c2 = c1, d2 = d1, e2 = e1;
-    uint32_t w0 = ReadLE32(chunk + 0), w1 = ReadLE32(chunk + 4), w2 = ReadLE32(chunk + 8), w3 = ReadLE32(chunk + 12);
-    uint32_t w4 = ReadLE32(chunk + 16), w5 = ReadLE32(chunk + 20), w6 = ReadLE32(chunk + 24), w7 = ReadLE32(chunk + 28);
-    uint32_t w8 = ReadLE32(chunk + 32), w9 = ReadLE32(chunk + 36), w10 = ReadLE32(chunk + 40), w11 = ReadLE32(chunk + 44);
-    uint32_t w12 = ReadLE32(chunk + 48), w13 = ReadLE32(chunk + 52), w14 = ReadLE32(chunk + 56), w15 = ReadLE32(chunk + 60);
+    T a1 = s[0], b1 = s[1], c1 = s[2], d1 = s[3], e1 = s[4];
+    T a2 = a1, b2 = b1, c2 = c1, d2 = d1, e2 = e1;
+    T w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3], w4 = w[4], w5 = w[5], w6 = w[6], w7 = w[7];
+    T w8 = w[8], w9 = w[9], w10 = w[10], w11 = w[11], w12 = w[12], w13 = w[13], w14 = w[14], w15 = w[15];
 
     R11(a1, b1, c1, d1, e1, w0, 11);
     R12(a2, b2, c2, d2, e2, w5, 8);
@@ -225,7 +226,7 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     R51(b1, c1, d1, e1, a1, w13, 6);
     R52(b2, c2, d2, e2, a2, w11, 11);
 
-    uint32_t t = s[0];
+    T t = s[0];
     s[0] = s[1] + c1 + d2;
     s[1] = s[2] + d1 + e2;
     s[2] = s[3] + e1 + a2;
@@ -233,6 +234,48 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[4] = t + b1 + c2;
 }
 
+/** Perform a RIPEMD-160 transformation, processing a 64-byte chunk. */
+void Transform(uint32_t* s, const unsigned char* chunk)
+{
+    uint32_t w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = ReadLE32(chunk + 4 * i);
+    }
+    Compress(s, w);
+}
+
+#ifdef ENABLE_MULTI_LANES
+
+/** RIPEMD-160 for HashLanes(): little-endian words and length. */
+struct Lanes {
+    static const size_t OUTPUT_SIZE = 20;
+    static const int STATE_WORDS = 5;
+    static constexpr const uint32_t* IV = ripemd160::IV;
+
+    template <typename T>
+    static ALWAYS_INLINE void Compress(T* s, const T* w) { ripemd160::Compress(s, w); }
+    static ALWAYS_INLINE uint32_t ReadWord(const unsigned char* p) { return ReadLE32(p); }
+    static ALWAYS_INLINE void WriteWord(unsigned char* p, uint32_t x) { WriteLE32(p, x); }
+    static ALWAYS_INLINE void WriteLength(unsigned char* p, uint64_t bits) { WriteLE64(p, bits); }
+};
+
+/** 4 messages at once, SSE2 on x86_64, NEON on arm64. */
+void Transform_4way(unsigned char* out, const unsigned char* const* in, const size_t* len)
+{
+    HashLanes<Lanes, u32x4, 4>(out, in, len);
+}
+
+#ifdef DIM_CPU_X86
+/** 8 messages at once. */
+__attribute__((target("avx2")))
+void Transform_8way(unsigned char* out, const unsigned char* const* in, const size_t* len)
+{
+    HashLanes<Lanes, u32x8, 8>(out, in, len);
+}
+#endif
+
+#endif // ENABLE_MULTI_LANES
+
 } // namespace ripemd160
 
 } // namespace
@@ -290,3 +333,32 @@ CRIPEMD160& CRIPEMD160::Reset()
     ripemd160::Initialize(s);
     return *this;
 }
+
+void RIPEMD160Many(unsigned char* out, const unsigned char* const* in, const size_t* len, size_t count)
+{
+    size_t i = 0;
+#ifdef ENABLE_MULTI_LANES
+#ifdef DIM_CPU_X86
+    static const bool avx2 = dim_cpu_has_avx2();
+#endif
+    while (i + 4 <= count) {
+#ifdef DIM_CPU_X86
+        if (avx2 && i + 8 <= count && SameLaneBlocks(len + i, 8)) {
+            ripemd160::Transform_8way(out + 20 * i, in + i, len + i);
+            i += 8;
+            continue;
+        }
+#endif
+        if (SameLaneBlocks(len + i, 4)) {
+            ripemd160::Transform_4way(out + 20 * i, in + i, len + i);
+            i += 4;
+        } else {
+            CRIPEMD160().Write(in[i], len[i]).Finalize(out + 20 * i);
+            i += 1;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        CRIPEMD160().Write(in[i], len[i]).Finalize(out + 20 * i);
+    }
+}
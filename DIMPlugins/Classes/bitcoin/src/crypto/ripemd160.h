@@ -25,4 +25,11 @@ public:
     CRIPEMD160& Reset();
 };
 
+/**
+ * Compute RIPEMD-160 of 'count' messages into 'out' (20 bytes each).
+ * Runs of messages taking the same number of blocks are hashed 8 (AVX2)
+ * or 4 (SSE2/NEON) at a time.
+ */
+void RIPEMD160Many(unsigned char* out, const unsigned char* const* in, const size_t* len, size_t count);
+
 #endif // BITCOIN_CRYPTO_RIPEMD160_H
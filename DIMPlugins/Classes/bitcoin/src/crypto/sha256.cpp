@@ -0,0 +1,413 @@
+// Copyright (c) 2014-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sha256.h"
+
+#include "common.h"
+#include "lanes.h"
+
+#include <string.h>
+
+#if defined(DIM_CPU_X86) && defined(__GNUC__)
+#define ENABLE_X86_SHANI 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define ENABLE_ARM_SHANI 1
+#include <arm_neon.h>
+#endif
+
+// Internal implementation code.
+namespace
+{
+/// Internal SHA-256 implementation.
+namespace sha256
+{
+// Word type T is uint32_t, or a vector of uint32_t (one message per lane).
+template <typename T> ALWAYS_INLINE T Ch(T x, T y, T z) { return z ^ (x & (y ^ z)); }
+template <typename T> ALWAYS_INLINE T Maj(T x, T y, T z) { return (x & y) | (z & (x | y)); }
+template <typename T> ALWAYS_INLINE T Sigma0(T x) { return (x >> 2 | x << 30) ^ (x >> 13 | x << 19) ^ (x >> 22 | x << 10); }
+template <typename T> ALWAYS_INLINE T Sigma1(T x) { return (x >> 6 | x << 26) ^ (x >> 11 | x << 21) ^ (x >> 25 | x << 7); }
+template <typename T> ALWAYS_INLINE T sigma0(T x) { return (x >> 7 | x << 25) ^ (x >> 18 | x << 14) ^ (x >> 3); }
+template <typename T> ALWAYS_INLINE T sigma1(T x) { return (x >> 17 | x << 15) ^ (x >> 19 | x << 13) ^ (x >> 10); }
+
+/** One round of SHA-256. */
+template <typename T>
+ALWAYS_INLINE void Round(T a, T b, T c, T& d, T e, T f, T g, T& h, uint32_t k, T w)
+{
+    T t1 = h + Sigma1(e) + Ch(e, f, g) + k + w;
+    T t2 = Sigma0(a) + Maj(a, b, c);
+    d += t1;
+    h = t1 + t2;
+}
+
+static const uint32_t IV[8] = {
+    0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul,
+    0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul,
+};
+
+/** Initialize SHA-256 state. */
+void inline Initialize(uint32_t* s)
+{
+    memcpy(s, IV, sizeof(IV));
+}
+
+/** Compress one 64-byte block, already read as 16 words. */
+template <typename T>
+ALWAYS_INLINE void Compress(T* s, const T* w)
+{
+    T a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    T w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
+
+    Round(a, b, c, d, e, f, g, h, 0x428a2f98ul, (w0 = w[0]));
+    Round(h, a, b, c, d, e, f, g, 0x71374491ul, (w1 = w[1]));
+    Round(g, h, a, b, c, d, e, f, 0xb5c0fbcful, (w2 = w[2]));
+    Round(f, g, h, a, b, c, d, e, 0xe9b5dba5ul, (w3 = w[3]));
+    Round(e, f, g, h, a, b, c, d, 0x3956c25bul, (w4 = w[4]));
+    Round(d, e, f, g, h, a, b, c, 0x59f111f1ul, (w5 = w[5]));
+    Round(c, d, e, f, g, h, a, b, 0x923f82a4ul, (w6 = w[6]));
+    Round(b, c, d, e, f, g, h, a, 0xab1c5ed5ul, (w7 = w[7]));
+    Round(a, b, c, d, e, f, g, h, 0xd807aa98ul, (w8 = w[8]));
+    Round(h, a, b, c, d, e, f, g, 0x12835b01ul, (w9 = w[9]));
+    Round(g, h, a, b, c, d, e, f, 0x243185beul, (w10 = w[10]));
+    Round(f, g, h, a, b, c, d, e, 0x550c7dc3ul, (w11 = w[11]));
+    Round(e, f, g, h, a, b, c, d, 0x72be5d74ul, (w12 = w[12]));
+    Round(d, e, f, g, h, a, b, c, 0x80deb1feul, (w13 = w[13]));
+    Round(c, d, e, f, g, h, a, b, 0x9bdc06a7ul, (w14 = w[14]));
+    Round(b, c, d, e, f, g, h, a, 0xc19bf174ul, (w15 = w[15]));
+
+    Round(a, b, c, d, e, f, g, h, 0xe49b69c1ul, (w0 += sigma1(w14) + w9 + sigma0(w1)));
+    Round(h, a, b, c, d, e, f, g, 0xefbe4786ul, (w1 += sigma1(w15) + w10 + sigma0(w2)));
+    Round(g, h, a, b, c, d, e, f, 0x0fc19dc6ul, (w2 += sigma1(w0) + w11 + sigma0(w3)));
+    Round(f, g, h, a, b, c, d, e, 0x240ca1ccul, (w3 += sigma1(w1) + w12 + sigma0(w4)));
+    Round(e, f, g, h, a, b, c, d, 0x2de92c6ful, (w4 += sigma1(w2) + w13 + sigma0(w5)));
+    Round(d, e, f, g, h, a, b, c, 0x4a7484aaul, (w5 += sigma1(w3) + w14 + sigma0(w6)));
+    Round(c, d, e, f, g, h, a, b, 0x5cb0a9dcul, (w6 += sigma1(w4) + w15 + sigma0(w7)));
+    Round(b, c, d, e, f, g, h, a, 0x76f988daul, (w7 += sigma1(w5) + w0 + sigma0(w8)));
+    Round(a, b, c, d, e, f, g, h, 0x983e5152ul, (w8 += sigma1(w6) + w1 + sigma0(w9)));
+    Round(h, a, b, c, d, e, f, g, 0xa831c66dul, (w9 += sigma1(w7) + w2 + sigma0(w10)));
+    Round(g, h, a, b, c, d, e, f, 0xb00327c8ul, (w10 += sigma1(w8) + w3 + sigma0(w11)));
+    Round(f, g, h, a, b, c, d, e, 0xbf597fc7ul, (w11 += sigma1(w9) + w4 + sigma0(w12)));
+    Round(e, f, g, h, a, b, c, d, 0xc6e00bf3ul, (w12 += sigma1(w10) + w5 + sigma0(w13)));
+    Round(d, e, f, g, h, a, b, c, 0xd5a79147ul, (w13 += sigma1(w11) + w6 + sigma0(w14)));
+    Round(c, d, e, f, g, h, a, b, 0x06ca6351ul, (w14 += sigma1(w12) + w7 + sigma0(w15)));
+    Round(b, c, d, e, f, g, h, a, 0x14292967ul, (w15 += sigma1(w13) + w8 + sigma0(w0)));
+
+    Round(a, b, c, d, e, f, g, h, 0x27b70a85ul, (w0 += sigma1(w14) + w9 + sigma0(w1)));
+    Round(h, a, b, c, d, e, f, g, 0x2e1b2138ul, (w1 += sigma1(w15) + w10 + sigma0(w2)));
+    Round(g, h, a, b, c, d, e, f, 0x4d2c6dfcul, (w2 += sigma1(w0) + w11 + sigma0(w3)));
+    Round(f, g, h, a, b, c, d, e, 0x53380d13ul, (w3 += sigma1(w1) + w12 + sigma0(w4)));
+    Round(e, f, g, h, a, b, c, d, 0x650a7354ul, (w4 += sigma1(w2) + w13 + sigma0(w5)));
+    Round(d, e, f, g, h, a, b, c, 0x766a0abbul, (w5 += sigma1(w3) + w14 + sigma0(w6)));
+    Round(c, d, e, f, g, h, a, b, 0x81c2c92eul, (w6 += sigma1(w4) + w15 + sigma0(w7)));
+    Round(b, c, d, e, f, g, h, a, 0x92722c85ul, (w7 += sigma1(w5) + w0 + sigma0(w8)));
+    Round(a, b, c, d, e, f, g, h, 0xa2bfe8a1ul, (w8 += sigma1(w6) + w1 + sigma0(w9)));
+    Round(h, a, b, c, d, e, f, g, 0xa81a664bul, (w9 += sigma1(w7) + w2 + sigma0(w10)));
+    Round(g, h, a, b, c, d, e, f, 0xc24b8b70ul, (w10 += sigma1(w8) + w3 + sigma0(w11)));
+    Round(f, g, h, a, b, c, d, e, 0xc76c51a3ul, (w11 += sigma1(w9) + w4 + sigma0(w12)));
+    Round(e, f, g, h, a, b, c, d, 0xd192e819ul, (w12 += sigma1(w10) + w5 + sigma0(w13)));
+    Round(d, e, f, g, h, a, b, c, 0xd6990624ul, (w13 += sigma1(w11) + w6 + sigma0(w14)));
+    Round(c, d, e, f, g, h, a, b, 0xf40e3585ul, (w14 += sigma1(w12) + w7 + sigma0(w15)));
+    Round(b, c, d, e, f, g, h, a, 0x106aa070ul, (w15 += sigma1(w13) + w8 + sigma0(w0)));
+
+    Round(a, b, c, d, e, f, g, h, 0x19a4c116ul, (w0 += sigma1(w14) + w9 + sigma0(w1)));
+    Round(h, a, b, c, d, e, f, g, 0x1e376c08ul, (w1 += sigma1(w15) + w10 + sigma0(w2)));
+    Round(g, h, a, b, c, d, e, f, 0x2748774cul, (w2 += sigma1(w0) + w11 + sigma0(w3)));
+    Round(f, g, h, a, b, c, d, e, 0x34b0bcb5ul, (w3 += sigma1(w1) + w12 + sigma0(w4)));
+    Round(e, f, g, h, a, b, c, d, 0x391c0cb3ul, (w4 += sigma1(w2) + w13 + sigma0(w5)));
+    Round(d, e, f, g, h, a, b, c, 0x4ed8aa4aul, (w5 += sigma1(w3) + w14 + sigma0(w6)));
+    Round(c, d, e, f, g, h, a, b, 0x5b9cca4ful, (w6 += sigma1(w4) + w15 + sigma0(w7)));
+    Round(b, c, d, e, f, g, h, a, 0x682e6ff3ul, (w7 += sigma1(w5) + w0 + sigma0(w8)));
+    Round(a, b, c, d, e, f, g, h, 0x748f82eeul, (w8 += sigma1(w6) + w1 + sigma0(w9)));
+    Round(h, a, b, c, d, e, f, g, 0x78a5636ful, (w9 += sigma1(w7) + w2 + sigma0(w10)));
+    Round(g, h, a, b, c, d, e, f, 0x84c87814ul, (w10 += sigma1(w8) + w3 + sigma0(w11)));
+    Round(f, g, h, a, b, c, d, e, 0x8cc70208ul, (w11 += sigma1(w9) + w4 + sigma0(w12)));
+    Round(e, f, g, h, a, b, c, d, 0x90befffaul, (w12 += sigma1(w10) + w5 + sigma0(w13)));
+    Round(d, e, f, g, h, a, b, c, 0xa4506cebul, (w13 += sigma1(w11) + w6 + sigma0(w14)));
+    Round(c, d, e, f, g, h, a, b, 0xbef9a3f7ul, (w14 += sigma1(w12) + w7 + sigma0(w15)));
+    Round(b, c, d, e, f, g, h, a, 0xc67178f2ul, (w15 += sigma1(w13) + w8 + sigma0(w0)));
+
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+    s[5] += f;
+    s[6] += g;
+    s[7] += h;
+}
+
+/** Perform a number of SHA-256 transformations, processing 64-byte chunks. */
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    uint32_t w[16];
+    while (blocks--) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = ReadBE32(chunk + 4 * i);
+        }
+        Compress(s, w);
+        chunk += 64;
+    }
+}
+
+#ifdef ENABLE_MULTI_LANES
+
+/** SHA-256 for HashLanes(): big-endian words and length. */
+struct Lanes {
+    static const size_t OUTPUT_SIZE = 32;
+    static const int STATE_WORDS = 8;
+    static constexpr const uint32_t* IV = sha256::IV;
+
+    template <typename T>
+    static ALWAYS_INLINE void Compress(T* s, const T* w) { sha256::Compress(s, w); }
+    static ALWAYS_INLINE uint32_t ReadWord(const unsigned char* p) { return ReadBE32(p); }
+    static ALWAYS_INLINE void WriteWord(unsigned char* p, uint32_t x) { WriteBE32(p, x); }
+    static ALWAYS_INLINE void WriteLength(unsigned char* p, uint64_t bits) { WriteBE64(p, bits); }
+};
+
+/** 4 messages at once, SSE2 on x86_64, NEON on arm64. */
+void Transform_4way(unsigned char* out, const unsigned char* const* in, const size_t* len)
+{
+    HashLanes<Lanes, u32x4, 4>(out, in, len);
+}
+
+#ifdef DIM_CPU_X86
+/** 8 messages at once. */
+__attribute__((target("avx2")))
+void Transform_8way(unsigned char* out, const unsigned char* const* in, const size_t* len)
+{
+    HashLanes<Lanes, u32x8, 8>(out, in, len);
+}
+#endif
+
+#endif // ENABLE_MULTI_LANES
+
+#if defined(ENABLE_X86_SHANI) || defined(ENABLE_ARM_SHANI)
+
+alignas(16) static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Each group of 4 rounds takes 4 message words: m0..m3 hold W[i-4]..W[i-1]
+// (rotating), the schedule replaces m0 with W[i].
+#define SHA256_GROUPS(ROUNDS, SCHEDULE)   \
+    ROUNDS(m0, 0);                        \
+    ROUNDS(m1, 4);                        \
+    ROUNDS(m2, 8);                        \
+    ROUNDS(m3, 12);                       \
+    for (int k = 16; k < 64; k += 16) {   \
+        SCHEDULE(m0, m1, m2, m3);         \
+        ROUNDS(m0, k);                    \
+        SCHEDULE(m1, m2, m3, m0);         \
+        ROUNDS(m1, k + 4);                \
+        SCHEDULE(m2, m3, m0, m1);         \
+        ROUNDS(m2, k + 8);                \
+        SCHEDULE(m3, m0, m1, m2);         \
+        ROUNDS(m3, k + 12);               \
+    }
+
+#endif
+
+#ifdef ENABLE_X86_SHANI
+
+#define SHANI_ROUNDS(m, k)                                                  \
+    tmp = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + (k))));    \
+    st1 = _mm_sha256rnds2_epu32(st1, st0, tmp);                             \
+    st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(tmp, 0x0E))
+
+#define SHANI_SCHEDULE(m0, m1, m2, m3)                                      \
+    m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1),   \
+                                            _mm_alignr_epi8(m3, m2, 4)), m3)
+
+/** SHA-256 with the Intel SHA extensions. */
+__attribute__((target("sha,sse4.1")))
+void Transform_shani(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i st0, st1, tmp, m0, m1, m2, m3, abef, cdgh;
+
+    // state as ABEF / CDGH for the rounds instruction
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);        // CDAB
+    st1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);  // EFGH
+    st0 = _mm_alignr_epi8(tmp, st1, 8);                                        // ABEF
+    st1 = _mm_blend_epi16(st1, tmp, 0xF0);                                     // CDGH
+
+    while (blocks--) {
+        abef = st0;
+        cdgh = st1;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 0)), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 32)), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 48)), mask);
+        SHA256_GROUPS(SHANI_ROUNDS, SHANI_SCHEDULE)
+        st0 = _mm_add_epi32(st0, abef);
+        st1 = _mm_add_epi32(st1, cdgh);
+        chunk += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(st0, 0x1B);                                        // FEBA
+    st1 = _mm_shuffle_epi32(st1, 0xB1);                                        // DCHG
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(tmp, st1, 0xF0));            // DCBA
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(st1, tmp, 8));         // HGFE
+}
+
+#endif // ENABLE_X86_SHANI
+
+#ifdef ENABLE_ARM_SHANI
+
+#define ARM_ROUNDS(m, k)                                                    \
+    tmp = vaddq_u32(m, vld1q_u32(K + (k)));                                 \
+    abcd = st0;                                                             \
+    st0 = vsha256hq_u32(st0, st1, tmp);                                     \
+    st1 = vsha256h2q_u32(st1, abcd, tmp)
+
+#define ARM_SCHEDULE(m0, m1, m2, m3)                                        \
+    m0 = vsha256su1q_u32(vsha256su0q_u32(m0, m1), m2, m3)
+
+/** SHA-256 with the ARMv8 crypto extensions. */
+void Transform_armv8(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    uint32x4_t st0 = vld1q_u32(s);      // ABCD
+    uint32x4_t st1 = vld1q_u32(s + 4);  // EFGH
+    uint32x4_t tmp, abcd, m0, m1, m2, m3, abcd_save, efgh_save;
+
+    while (blocks--) {
+        abcd_save = st0;
+        efgh_save = st1;
+        m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk + 0)));
+        m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk + 16)));
+        m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk + 32)));
+        m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(chunk + 48)));
+        SHA256_GROUPS(ARM_ROUNDS, ARM_SCHEDULE)
+        st0 = vaddq_u32(st0, abcd_save);
+        st1 = vaddq_u32(st1, efgh_save);
+        chunk += 64;
+    }
+
+    vst1q_u32(s, st0);
+    vst1q_u32(s + 4, st1);
+}
+
+#endif // ENABLE_ARM_SHANI
+
+typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
+
+/** The transform in use, see SHA256AutoDetect(). */
+TransformType transform = sha256::Transform;
+
+} // namespace sha256
+
+} // namespace
+
+std::string SHA256AutoDetect()
+{
+#if defined(ENABLE_X86_SHANI)
+    if (dim_cpu_has_sha() && dim_cpu_has_sse41()) {
+        sha256::transform = sha256::Transform_shani;
+        return "shani";
+    }
+#elif defined(ENABLE_ARM_SHANI)
+    sha256::transform = sha256::Transform_armv8;
+    return "arm_shani";
+#endif
+    sha256::transform = sha256::Transform;
+    return "standard";
+}
+
+////// SHA-256
+
+CSHA256::CSHA256() : bytes(0)
+{
+    sha256::Initialize(s);
+}
+
+CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
+{
+    const unsigned char* end = data + len;
+    size_t bufsize = bytes % 64;
+    if (bufsize && bufsize + len >= 64) {
+        // Fill the buffer, and process it.
+        memcpy(buf + bufsize, data, 64 - bufsize);
+        bytes += 64 - bufsize;
+        data += 64 - bufsize;
+        sha256::transform(s, buf, 1);
+        bufsize = 0;
+    }
+    if (end - data >= 64) {
+        // Process full chunks directly from the source.
+        size_t blocks = (end - data) / 64;
+        sha256::transform(s, data, blocks);
+        data += 64 * blocks;
+        bytes += 64 * blocks;
+    }
+    if (end > data) {
+        // Fill the buffer with what remains.
+        memcpy(buf + bufsize, data, end - data);
+        bytes += end - data;
+    }
+    return *this;
+}
+
+void CSHA256::Finalize(unsigned char hash[OUTPUT_SIZE])
+{
+    static const unsigned char pad[64] = {0x80};
+    unsigned char sizedesc[8];
+    WriteBE64(sizedesc, bytes << 3);
+    Write(pad, 1 + ((119 - (bytes % 64)) % 64));
+    Write(sizedesc, 8);
+    WriteBE32(hash, s[0]);
+    WriteBE32(hash + 4, s[1]);
+    WriteBE32(hash + 8, s[2]);
+    WriteBE32(hash + 12, s[3]);
+    WriteBE32(hash + 16, s[4]);
+    WriteBE32(hash + 20, s[5]);
+    WriteBE32(hash + 24, s[6]);
+    WriteBE32(hash + 28, s[7]);
+}
+
+CSHA256& CSHA256::Reset()
+{
+    bytes = 0;
+    sha256::Initialize(s);
+    return *this;
+}
+
+void SHA256Many(unsigned char* out, const unsigned char* const* in, const size_t* len, size_t count)
+{
+    size_t i = 0;
+#ifdef ENABLE_MULTI_LANES
+#ifdef DIM_CPU_X86
+    static const bool avx2 = dim_cpu_has_avx2();
+#endif
+    // SHA instructions on one message beat the lanes
+    const bool hardware = sha256::transform != sha256::Transform;
+    while (!hardware && i + 4 <= count) {
+#ifdef DIM_CPU_X86
+        if (avx2 && i + 8 <= count && SameLaneBlocks(len + i, 8)) {
+            sha256::Transform_8way(out + 32 * i, in + i, len + i);
+            i += 8;
+            continue;
+        }
+#endif
+        if (SameLaneBlocks(len + i, 4)) {
+            sha256::Transform_4way(out + 32 * i, in + i, len + i);
+            i += 4;
+        } else {
+            CSHA256().Write(in[i], len[i]).Finalize(out + 32 * i);
+            i += 1;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        CSHA256().Write(in[i], len[i]).Finalize(out + 32 * i);
+    }
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2014-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_SHA256_H
+#define BITCOIN_CRYPTO_SHA256_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** A hasher class for SHA-256. */
+class CSHA256
+{
+private:
+    uint32_t s[8];
+    unsigned char buf[64];
+    uint64_t bytes;
+
+public:
+    static const size_t OUTPUT_SIZE = 32;
+
+    CSHA256();
+    CSHA256& Write(const unsigned char* data, size_t len);
+    void Finalize(unsigned char hash[OUTPUT_SIZE]);
+    CSHA256& Reset();
+};
+
+/**
+ * Autodetect the best available SHA-256 implementation (SHA-NI on x86,
+ * ARMv8 SHA2 on arm64, otherwise the standard one) for CSHA256.
+ * Returns the name of the implementation.
+ */
+std::string SHA256AutoDetect();
+
+/**
+ * Compute SHA-256 of 'count' messages into 'out' (32 bytes each).
+ * Runs of messages taking the same number of blocks are hashed 8 (AVX2)
+ * or 4 (SSE2/NEON) at a time.
+ */
+void SHA256Many(unsigned char* out, const unsigned char* const* in, const size_t* len, size_t count);
+
+#endif // BITCOIN_CRYPTO_SHA256_H
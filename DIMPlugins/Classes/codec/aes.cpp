@@ -0,0 +1,1015 @@
+//
+//  aes.cpp
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/2.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "aes.h"
+#include "cpu.h"
+
+#include <string.h>
+
+#if defined(DIM_CPU_X86) && defined(__GNUC__)
+#define ENABLE_X86_AES 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define ENABLE_ARM_AES 1
+#include <arm_neon.h>
+#endif
+
+// blocks per GCM pass, the ciphertext stays in L1 between CTR and GHASH
+#define GCM_CHUNK_BLOCKS 256
+
+static inline uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32_le(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint64_t load64_be(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline void store64_be(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; --i) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static inline uint32_t rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+// increment the last 32 bits (big-endian), as GCM does
+static inline void inc32(uint8_t ctr[16]) {
+    for (int i = 15; i >= 12; --i) {
+        if (++ctr[i] != 0) {
+            break;
+        }
+    }
+}
+
+static inline void xor_block(uint8_t *out, const uint8_t *a, const uint8_t *b) {
+    for (int i = 0; i < 16; ++i) {
+        out[i] = a[i] ^ b[i];
+    }
+}
+
+static void aes_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+#pragma mark Tables
+
+static inline uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1B));
+}
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    uint8_t r = 0;
+    while (b) {
+        if (b & 1) {
+            r ^= a;
+        }
+        a = xtime(a);
+        b >>= 1;
+    }
+    return r;
+}
+
+struct AesTables {
+    uint8_t sbox[256];
+    uint8_t inv_sbox[256];
+    uint32_t te[256];  // SubBytes + MixColumns for row 0 (column as little-endian word)
+    uint32_t td[256];  // InvSubBytes + InvMixColumns for row 0
+
+    AesTables() {
+        // walk the multiplicative group with generator 3
+        uint8_t p = 1, q = 1;
+        do {
+            p = p ^ xtime(p);
+            q ^= q << 1;
+            q ^= q << 2;
+            q ^= q << 4;
+            if (q & 0x80) {
+                q ^= 0x09;
+            }
+            uint8_t x = q ^ (uint8_t)((q << 1) | (q >> 7)) ^ (uint8_t)((q << 2) | (q >> 6))
+                          ^ (uint8_t)((q << 3) | (q >> 5)) ^ (uint8_t)((q << 4) | (q >> 4));
+            sbox[p] = x ^ 0x63;
+        } while (p != 1);
+        sbox[0] = 0x63;
+        for (int i = 0; i < 256; ++i) {
+            inv_sbox[sbox[i]] = (uint8_t)i;
+        }
+        for (int i = 0; i < 256; ++i) {
+            uint8_t s = sbox[i];
+            te[i] = (uint32_t)gf_mul(s, 2) | ((uint32_t)s << 8) | ((uint32_t)s << 16) | ((uint32_t)gf_mul(s, 3) << 24);
+            s = inv_sbox[i];
+            td[i] = (uint32_t)gf_mul(s, 14) | ((uint32_t)gf_mul(s, 9) << 8)
+                  | ((uint32_t)gf_mul(s, 13) << 16) | ((uint32_t)gf_mul(s, 11) << 24);
+        }
+    }
+};
+
+static inline const AesTables &tables() {
+    static const AesTables t;
+    return t;
+}
+
+#pragma mark Key Schedule
+
+static void expand_key(aes256_key *key, const uint8_t *password) {
+    const AesTables &t = tables();
+    uint8_t *w = &key->rk[0][0];  // 60 words
+    uint8_t rcon = 1;
+    memcpy(w, password, 32);
+    for (int i = 8; i < 60; ++i) {
+        uint8_t tmp[4];
+        memcpy(tmp, w + 4 * (i - 1), 4);
+        if (i % 8 == 0) {
+            // RotWord + SubWord + Rcon
+            uint8_t b0 = tmp[0];
+            tmp[0] = t.sbox[tmp[1]] ^ rcon;
+            tmp[1] = t.sbox[tmp[2]];
+            tmp[2] = t.sbox[tmp[3]];
+            tmp[3] = t.sbox[b0];
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            for (int j = 0; j < 4; ++j) {
+                tmp[j] = t.sbox[tmp[j]];
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            w[4 * i + j] = w[4 * (i - 8) + j] ^ tmp[j];
+        }
+    }
+    // equivalent inverse cipher: reversed order, InvMixColumns on the inner keys
+    memcpy(key->dk[0], key->rk[14], 16);
+    memcpy(key->dk[14], key->rk[0], 16);
+    for (int r = 1; r < 14; ++r) {
+        const uint8_t *src = key->rk[14 - r];
+        uint8_t *dst = key->dk[r];
+        for (int c = 0; c < 16; c += 4) {
+            uint8_t a0 = src[c], a1 = src[c + 1], a2 = src[c + 2], a3 = src[c + 3];
+            dst[c]     = gf_mul(a0, 14) ^ gf_mul(a1, 11) ^ gf_mul(a2, 13) ^ gf_mul(a3, 9);
+            dst[c + 1] = gf_mul(a0, 9) ^ gf_mul(a1, 14) ^ gf_mul(a2, 11) ^ gf_mul(a3, 13);
+            dst[c + 2] = gf_mul(a0, 13) ^ gf_mul(a1, 9) ^ gf_mul(a2, 14) ^ gf_mul(a3, 11);
+            dst[c + 3] = gf_mul(a0, 11) ^ gf_mul(a1, 13) ^ gf_mul(a2, 9) ^ gf_mul(a3, 14);
+        }
+    }
+}
+
+#pragma mark Portable
+
+static void encrypt_block(const aes256_key *key, const uint8_t *in, uint8_t *out) {
+    const AesTables &t = tables();
+    const uint32_t *te = t.te;
+    uint32_t s0 = load32_le(in) ^ load32_le(key->rk[0]);
+    uint32_t s1 = load32_le(in + 4) ^ load32_le(key->rk[0] + 4);
+    uint32_t s2 = load32_le(in + 8) ^ load32_le(key->rk[0] + 8);
+    uint32_t s3 = load32_le(in + 12) ^ load32_le(key->rk[0] + 12);
+    uint32_t t0, t1, t2, t3;
+    for (int r = 1; r < 14; ++r) {
+        const uint8_t *rk = key->rk[r];
+        t0 = te[s0 & 0xFF] ^ rotl32(te[(s1 >> 8) & 0xFF], 8) ^ rotl32(te[(s2 >> 16) & 0xFF], 16) ^ rotl32(te[s3 >> 24], 24);
+        t1 = te[s1 & 0xFF] ^ rotl32(te[(s2 >> 8) & 0xFF], 8) ^ rotl32(te[(s3 >> 16) & 0xFF], 16) ^ rotl32(te[s0 >> 24], 24);
+        t2 = te[s2 & 0xFF] ^ rotl32(te[(s3 >> 8) & 0xFF], 8) ^ rotl32(te[(s0 >> 16) & 0xFF], 16) ^ rotl32(te[s1 >> 24], 24);
+        t3 = te[s3 & 0xFF] ^ rotl32(te[(s0 >> 8) & 0xFF], 8) ^ rotl32(te[(s1 >> 16) & 0xFF], 16) ^ rotl32(te[s2 >> 24], 24);
+        s0 = t0 ^ load32_le(rk);
+        s1 = t1 ^ load32_le(rk + 4);
+        s2 = t2 ^ load32_le(rk + 8);
+        s3 = t3 ^ load32_le(rk + 12);
+    }
+    const uint8_t *sb = t.sbox;
+    const uint8_t *rk = key->rk[14];
+#define AES_LAST(a, b, c, d) ((uint32_t)sb[(a) & 0xFF] | ((uint32_t)sb[((b) >> 8) & 0xFF] << 8) \
+                             | ((uint32_t)sb[((c) >> 16) & 0xFF] << 16) | ((uint32_t)sb[(d) >> 24] << 24))
+    store32_le(out, AES_LAST(s0, s1, s2, s3) ^ load32_le(rk));
+    store32_le(out + 4, AES_LAST(s1, s2, s3, s0) ^ load32_le(rk + 4));
+    store32_le(out + 8, AES_LAST(s2, s3, s0, s1) ^ load32_le(rk + 8));
+    store32_le(out + 12, AES_LAST(s3, s0, s1, s2) ^ load32_le(rk + 12));
+#undef AES_LAST
+}
+
+static void decrypt_block(const aes256_key *key, const uint8_t *in, uint8_t *out) {
+    const AesTables &t = tables();
+    const uint32_t *td = t.td;
+    uint32_t s0 = load32_le(in) ^ load32_le(key->dk[0]);
+    uint32_t s1 = load32_le(in + 4) ^ load32_le(key->dk[0] + 4);
+    uint32_t s2 = load32_le(in + 8) ^ load32_le(key->dk[0] + 8);
+    uint32_t s3 = load32_le(in + 12) ^ load32_le(key->dk[0] + 12);
+    uint32_t t0, t1, t2, t3;
+    for (int r = 1; r < 14; ++r) {
+        const uint8_t *dk = key->dk[r];
+        t0 = td[s0 & 0xFF] ^ rotl32(td[(s3 >> 8) & 0xFF], 8) ^ rotl32(td[(s2 >> 16) & 0xFF], 16) ^ rotl32(td[s1 >> 24], 24);
+        t1 = td[s1 & 0xFF] ^ rotl32(td[(s0 >> 8) & 0xFF], 8) ^ rotl32(td[(s3 >> 16) & 0xFF], 16) ^ rotl32(td[s2 >> 24], 24);
+        t2 = td[s2 & 0xFF] ^ rotl32(td[(s1 >> 8) & 0xFF], 8) ^ rotl32(td[(s0 >> 16) & 0xFF], 16) ^ rotl32(td[s3 >> 24], 24);
+        t3 = td[s3 & 0xFF] ^ rotl32(td[(s2 >> 8) & 0xFF], 8) ^ rotl32(td[(s1 >> 16) & 0xFF], 16) ^ rotl32(td[s0 >> 24], 24);
+        s0 = t0 ^ load32_le(dk);
+        s1 = t1 ^ load32_le(dk + 4);
+        s2 = t2 ^ load32_le(dk + 8);
+        s3 = t3 ^ load32_le(dk + 12);
+    }
+    const uint8_t *sb = t.inv_sbox;
+    const uint8_t *dk = key->dk[14];
+#define AES_LAST(a, b, c, d) ((uint32_t)sb[(a) & 0xFF] | ((uint32_t)sb[((b) >> 8) & 0xFF] << 8) \
+                             | ((uint32_t)sb[((c) >> 16) & 0xFF] << 16) | ((uint32_t)sb[(d) >> 24] << 24))
+    store32_le(out, AES_LAST(s0, s3, s2, s1) ^ load32_le(dk));
+    store32_le(out + 4, AES_LAST(s1, s0, s3, s2) ^ load32_le(dk + 4));
+    store32_le(out + 8, AES_LAST(s2, s1, s0, s3) ^ load32_le(dk + 8));
+    store32_le(out + 12, AES_LAST(s3, s2, s1, s0) ^ load32_le(dk + 12));
+#undef AES_LAST
+}
+
+static void cbc_encrypt_portable(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        xor_block(iv, iv, in);
+        encrypt_block(key, iv, out);
+        memcpy(iv, out, 16);
+    }
+}
+
+static void cbc_decrypt_portable(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8_t c[16];
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        memcpy(c, in, 16);  // 'in' may be 'out'
+        decrypt_block(key, c, out);
+        xor_block(out, out, iv);
+        memcpy(iv, c, 16);
+    }
+}
+
+static void ctr32_portable(const aes256_key *key, uint8_t ctr[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8_t ks[16];
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        encrypt_block(key, ctr, ks);
+        xor_block(out, in, ks);
+        inc32(ctr);
+    }
+    aes_wipe(ks, sizeof(ks));
+}
+
+// GHASH with 4-bit tables (Shoup): hk[0..15] = low halves, hk[16..31] = high halves
+static const uint64_t ghash_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+static void prepare_portable(aes256_key *key) {
+    uint8_t h[16] = {0};
+    encrypt_block(key, h, h);
+    uint64_t *hl = key->hk, *hh = key->hk + 16;
+    uint64_t vh = load64_be(h), vl = load64_be(h + 8);
+    hl[8] = vl;
+    hh[8] = vh;
+    hl[0] = hh[0] = 0;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t t = (vl & 1) * 0xe100000000000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ t;
+        hl[i] = vl;
+        hh[i] = vh;
+    }
+    for (int i = 2; i <= 8; i *= 2) {
+        for (int j = 1; j < i; ++j) {
+            hh[i + j] = hh[i] ^ hh[j];
+            hl[i + j] = hl[i] ^ hl[j];
+        }
+    }
+    aes_wipe(h, sizeof(h));
+}
+
+static void ghash_portable(const aes256_key *key, uint8_t x[16], const uint8_t *in, size_t blocks) {
+    const uint64_t *hl = key->hk, *hh = key->hk + 16;
+    uint8_t b[16];
+    for (; blocks > 0; --blocks, in += 16) {
+        xor_block(b, x, in);
+        uint8_t lo = b[15] & 0x0F, hi, rem;
+        uint64_t zh = hh[lo], zl = hl[lo];
+        for (int i = 15; i >= 0; --i) {
+            lo = b[i] & 0x0F;
+            hi = b[i] >> 4;
+            if (i != 15) {
+                rem = (uint8_t)zl & 0x0F;
+                zl = (zh << 60) | (zl >> 4);
+                zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+                zh ^= hh[lo];
+                zl ^= hl[lo];
+            }
+            rem = (uint8_t)zl & 0x0F;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+            zh ^= hh[hi];
+            zl ^= hl[hi];
+        }
+        store64_be(x, zh);
+        store64_be(x + 8, zl);
+    }
+}
+
+#ifdef ENABLE_X86_AES
+
+#pragma mark AES-NI
+
+#define X86_AES __attribute__((target("aes,pclmul,ssse3,sse4.1")))
+
+X86_AES static inline __m128i x86_bswap(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+// counter block with the last word in native order, and back
+X86_AES static inline __m128i x86_ctr_swap(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_set_epi8(12, 13, 14, 15, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+X86_AES static inline void x86_load_keys(__m128i rk[15], const uint8_t keys[15][16]) {
+    for (int r = 0; r < 15; ++r) {
+        rk[r] = _mm_loadu_si128((const __m128i *)keys[r]);
+    }
+}
+
+X86_AES static inline __m128i x86_encrypt(const __m128i rk[15], __m128i b) {
+    b = _mm_xor_si128(b, rk[0]);
+    for (int r = 1; r < 14; ++r) {
+        b = _mm_aesenc_si128(b, rk[r]);
+    }
+    return _mm_aesenclast_si128(b, rk[14]);
+}
+
+X86_AES static inline __m128i x86_decrypt(const __m128i dk[15], __m128i b) {
+    b = _mm_xor_si128(b, dk[0]);
+    for (int r = 1; r < 14; ++r) {
+        b = _mm_aesdec_si128(b, dk[r]);
+    }
+    return _mm_aesdeclast_si128(b, dk[14]);
+}
+
+X86_AES static void cbc_encrypt_aesni(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    __m128i rk[15];
+    x86_load_keys(rk, key->rk);
+    __m128i c = _mm_loadu_si128((const __m128i *)iv);
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        c = x86_encrypt(rk, _mm_xor_si128(c, _mm_loadu_si128((const __m128i *)in)));
+        _mm_storeu_si128((__m128i *)out, c);
+    }
+    _mm_storeu_si128((__m128i *)iv, c);
+}
+
+X86_AES static void cbc_decrypt_aesni(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    __m128i dk[15];
+    x86_load_keys(dk, key->dk);
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+    for (; blocks >= 8; blocks -= 8, in += 128, out += 128) {
+        __m128i c[8], b[8];
+        for (int i = 0; i < 8; ++i) {
+            c[i] = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+            b[i] = _mm_xor_si128(c[i], dk[0]);
+        }
+        for (int r = 1; r < 14; ++r) {
+            for (int i = 0; i < 8; ++i) {
+                b[i] = _mm_aesdec_si128(b[i], dk[r]);
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            b[i] = _mm_aesdeclast_si128(b[i], dk[14]);
+        }
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(b[0], prev));
+        for (int i = 1; i < 8; ++i) {
+            _mm_storeu_si128((__m128i *)(out + 16 * i), _mm_xor_si128(b[i], c[i - 1]));
+        }
+        prev = c[7];
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)in);
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(x86_decrypt(dk, c), prev));
+        prev = c;
+    }
+    _mm_storeu_si128((__m128i *)iv, prev);
+}
+
+X86_AES static void ctr32_aesni(const aes256_key *key, uint8_t ctr[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    __m128i rk[15];
+    x86_load_keys(rk, key->rk);
+    const __m128i one = _mm_set_epi32(1, 0, 0, 0);
+    __m128i c = x86_ctr_swap(_mm_loadu_si128((const __m128i *)ctr));
+    for (; blocks >= 8; blocks -= 8, in += 128, out += 128) {
+        __m128i b[8];
+        for (int i = 0; i < 8; ++i) {
+            b[i] = _mm_xor_si128(x86_ctr_swap(c), rk[0]);
+            c = _mm_add_epi32(c, one);
+        }
+        for (int r = 1; r < 14; ++r) {
+            for (int i = 0; i < 8; ++i) {
+                b[i] = _mm_aesenc_si128(b[i], rk[r]);
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            b[i] = _mm_aesenclast_si128(b[i], rk[14]);
+            b[i] = _mm_xor_si128(b[i], _mm_loadu_si128((const __m128i *)(in + 16 * i)));
+            _mm_storeu_si128((__m128i *)(out + 16 * i), b[i]);
+        }
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        __m128i b = x86_encrypt(rk, x86_ctr_swap(c));
+        c = _mm_add_epi32(c, one);
+        _mm_storeu_si128((__m128i *)out, _mm_xor_si128(b, _mm_loadu_si128((const __m128i *)in)));
+    }
+    _mm_storeu_si128((__m128i *)ctr, x86_ctr_swap(c));
+}
+
+// GHASH on byte-reflected blocks (Gueron & Kounavis, Intel white paper):
+// the 256-bit carry-less product is collected in (lo, mid, hi) and
+// reduced once, so several products can share one reduction.
+
+X86_AES static inline void x86_clmul(__m128i a, __m128i b, __m128i &lo, __m128i &mid, __m128i &hi) {
+    lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00));
+    hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11));
+    mid = _mm_xor_si128(mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x01),
+                                           _mm_clmulepi64_si128(a, b, 0x10)));
+}
+
+X86_AES static inline __m128i x86_reduce(__m128i lo, __m128i mid, __m128i hi) {
+    __m128i t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    __m128i t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+    // shift the product left by one bit
+    __m128i t7 = _mm_srli_epi32(t3, 31);
+    __m128i t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    __m128i t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(_mm_or_si128(t6, t8), t9);
+    // reduce modulo x^128 + x^7 + x^2 + x + 1
+    t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(t3, 31), _mm_slli_epi32(t3, 30)), _mm_slli_epi32(t3, 25));
+    t8 = _mm_srli_si128(t7, 4);
+    t3 = _mm_xor_si128(t3, _mm_slli_si128(t7, 12));
+    __m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(t3, 1), _mm_srli_epi32(t3, 2)), _mm_srli_epi32(t3, 7));
+    t3 = _mm_xor_si128(t3, _mm_xor_si128(t2, t8));
+    return _mm_xor_si128(t6, t3);
+}
+
+X86_AES static inline __m128i x86_gfmul(__m128i a, __m128i b) {
+    __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+    x86_clmul(a, b, lo, mid, hi);
+    return x86_reduce(lo, mid, hi);
+}
+
+// hk[0..15]: H^8 .. H^1, byte-reflected
+X86_AES static void prepare_x86(aes256_key *key) {
+    __m128i rk[15];
+    x86_load_keys(rk, key->rk);
+    __m128i h = x86_bswap(x86_encrypt(rk, _mm_setzero_si128()));
+    __m128i p = h;
+    __m128i *powers = (__m128i *)key->hk;
+    for (int i = 7; i >= 0; --i) {
+        _mm_storeu_si128(powers + i, p);
+        p = x86_gfmul(p, h);
+    }
+}
+
+X86_AES static void ghash_pclmul(const aes256_key *key, uint8_t x[16], const uint8_t *in, size_t blocks) {
+    const __m128i *powers = (const __m128i *)key->hk;
+    __m128i h[8];
+    for (int i = 0; i < 8; ++i) {
+        h[i] = _mm_loadu_si128(powers + i);
+    }
+    __m128i y = x86_bswap(_mm_loadu_si128((const __m128i *)x));
+    for (; blocks >= 8; blocks -= 8, in += 128) {
+        __m128i lo = _mm_setzero_si128(), mid = lo, hi = lo;
+        x86_clmul(_mm_xor_si128(y, x86_bswap(_mm_loadu_si128((const __m128i *)in))), h[0], lo, mid, hi);
+        for (int i = 1; i < 8; ++i) {
+            x86_clmul(x86_bswap(_mm_loadu_si128((const __m128i *)(in + 16 * i))), h[i], lo, mid, hi);
+        }
+        y = x86_reduce(lo, mid, hi);
+    }
+    for (; blocks > 0; --blocks, in += 16) {
+        y = x86_gfmul(_mm_xor_si128(y, x86_bswap(_mm_loadu_si128((const __m128i *)in))), h[7]);
+    }
+    _mm_storeu_si128((__m128i *)x, x86_bswap(y));
+}
+
+#pragma mark VAES
+
+#define X86_VAES __attribute__((target("vaes,vpclmulqdq,avx2,aes,pclmul,ssse3,sse4.1")))
+
+X86_VAES static inline void x86_load_keys256(__m256i rk[15], const uint8_t keys[15][16]) {
+    for (int r = 0; r < 15; ++r) {
+        rk[r] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)keys[r]));
+    }
+}
+
+X86_VAES static void ctr32_vaes(const aes256_key *key, uint8_t ctr[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    if (blocks >= 16) {
+        __m256i rk[15];
+        x86_load_keys256(rk, key->rk);
+        const __m256i swap = _mm256_broadcastsi128_si256(_mm_set_epi8(12, 13, 14, 15, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+        const __m256i two = _mm256_set_epi32(2, 0, 0, 0, 2, 0, 0, 0);
+        __m128i c0 = x86_ctr_swap(_mm_loadu_si128((const __m128i *)ctr));
+        __m256i c = _mm256_add_epi32(_mm256_broadcastsi128_si256(c0), _mm256_set_epi32(1, 0, 0, 0, 0, 0, 0, 0));
+        for (; blocks >= 16; blocks -= 16, in += 256, out += 256) {
+            __m256i b[8];
+            for (int i = 0; i < 8; ++i) {
+                b[i] = _mm256_xor_si256(_mm256_shuffle_epi8(c, swap), rk[0]);
+                c = _mm256_add_epi32(c, two);
+            }
+            for (int r = 1; r < 14; ++r) {
+                for (int i = 0; i < 8; ++i) {
+                    b[i] = _mm256_aesenc_epi128(b[i], rk[r]);
+                }
+            }
+            for (int i = 0; i < 8; ++i) {
+                b[i] = _mm256_aesenclast_epi128(b[i], rk[14]);
+                b[i] = _mm256_xor_si256(b[i], _mm256_loadu_si256((const __m256i *)(in + 32 * i)));
+                _mm256_storeu_si256((__m256i *)(out + 32 * i), b[i]);
+            }
+        }
+        _mm_storeu_si128((__m128i *)ctr, x86_ctr_swap(_mm256_castsi256_si128(c)));
+    }
+    if (blocks > 0) {
+        ctr32_aesni(key, ctr, in, out, blocks);
+    }
+}
+
+X86_VAES static void cbc_decrypt_vaes(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    if (blocks >= 16) {
+        __m256i dk[15];
+        x86_load_keys256(dk, key->dk);
+        __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+        for (; blocks >= 16; blocks -= 16, in += 256, out += 256) {
+            __m256i c[8], p[8], b[8];
+            for (int i = 0; i < 8; ++i) {
+                c[i] = _mm256_loadu_si256((const __m256i *)(in + 32 * i));
+                b[i] = _mm256_xor_si256(c[i], dk[0]);
+            }
+            // previous ciphertext blocks, one block behind
+            p[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(prev), _mm_loadu_si128((const __m128i *)in), 1);
+            for (int i = 1; i < 8; ++i) {
+                p[i] = _mm256_loadu_si256((const __m256i *)(in + 32 * i - 16));
+            }
+            prev = _mm256_extracti128_si256(c[7], 1);
+            for (int r = 1; r < 14; ++r) {
+                for (int i = 0; i < 8; ++i) {
+                    b[i] = _mm256_aesdec_epi128(b[i], dk[r]);
+                }
+            }
+            for (int i = 0; i < 8; ++i) {
+                b[i] = _mm256_aesdeclast_epi128(b[i], dk[14]);
+                _mm256_storeu_si256((__m256i *)(out + 32 * i), _mm256_xor_si256(b[i], p[i]));
+            }
+        }
+        _mm_storeu_si128((__m128i *)iv, prev);
+    }
+    if (blocks > 0) {
+        cbc_decrypt_aesni(key, iv, in, out, blocks);
+    }
+}
+
+X86_VAES static inline void x86_clmul256(__m256i a, __m256i b, __m256i &lo, __m256i &mid, __m256i &hi) {
+    lo = _mm256_xor_si256(lo, _mm256_clmulepi64_epi128(a, b, 0x00));
+    hi = _mm256_xor_si256(hi, _mm256_clmulepi64_epi128(a, b, 0x11));
+    mid = _mm256_xor_si256(mid, _mm256_xor_si256(_mm256_clmulepi64_epi128(a, b, 0x01),
+                                                 _mm256_clmulepi64_epi128(a, b, 0x10)));
+}
+
+X86_VAES static inline __m128i x86_fold256(__m256i v) {
+    return _mm_xor_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+X86_VAES static void ghash_vpclmul(const aes256_key *key, uint8_t x[16], const uint8_t *in, size_t blocks) {
+    if (blocks >= 8) {
+        const __m256i mask = _mm256_broadcastsi128_si256(_mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        __m256i h[4];  // (H^8, H^7), (H^6, H^5), (H^4, H^3), (H^2, H^1)
+        for (int i = 0; i < 4; ++i) {
+            h[i] = _mm256_loadu_si256((const __m256i *)(key->hk + 4 * i));
+        }
+        __m128i y = x86_bswap(_mm_loadu_si128((const __m128i *)x));
+        for (; blocks >= 8; blocks -= 8, in += 128) {
+            __m256i lo = _mm256_setzero_si256(), mid = lo, hi = lo;
+            __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)in), mask);
+            x86_clmul256(_mm256_xor_si256(b, _mm256_castsi128_si256(y)), h[0], lo, mid, hi);
+            for (int i = 1; i < 4; ++i) {
+                b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + 32 * i)), mask);
+                x86_clmul256(b, h[i], lo, mid, hi);
+            }
+            y = x86_reduce(x86_fold256(lo), x86_fold256(mid), x86_fold256(hi));
+        }
+        _mm_storeu_si128((__m128i *)x, x86_bswap(y));
+    }
+    if (blocks > 0) {
+        ghash_pclmul(key, x, in, blocks);
+    }
+}
+
+#endif /* ENABLE_X86_AES */
+
+#ifdef ENABLE_ARM_AES
+
+#pragma mark ARMv8
+
+static inline void arm_load_keys(uint8x16_t rk[15], const uint8_t keys[15][16]) {
+    for (int r = 0; r < 15; ++r) {
+        rk[r] = vld1q_u8(keys[r]);
+    }
+}
+
+static inline uint8x16_t arm_encrypt(const uint8x16_t rk[15], uint8x16_t b) {
+    for (int r = 0; r < 13; ++r) {
+        b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+    }
+    return veorq_u8(vaeseq_u8(b, rk[13]), rk[14]);
+}
+
+static inline uint8x16_t arm_decrypt(const uint8x16_t dk[15], uint8x16_t b) {
+    for (int r = 0; r < 13; ++r) {
+        b = vaesimcq_u8(vaesdq_u8(b, dk[r]));
+    }
+    return veorq_u8(vaesdq_u8(b, dk[13]), dk[14]);
+}
+
+// counter block 'base' with the last word (big-endian) set to 'n'
+static inline uint8x16_t arm_ctr_block(uint8x16_t base, uint32_t n) {
+    return vreinterpretq_u8_u32(vsetq_lane_u32(__builtin_bswap32(n), vreinterpretq_u32_u8(base), 3));
+}
+
+static void cbc_encrypt_arm(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8x16_t rk[15];
+    arm_load_keys(rk, key->rk);
+    uint8x16_t c = vld1q_u8(iv);
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        c = arm_encrypt(rk, veorq_u8(c, vld1q_u8(in)));
+        vst1q_u8(out, c);
+    }
+    vst1q_u8(iv, c);
+}
+
+static void cbc_decrypt_arm(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8x16_t dk[15];
+    arm_load_keys(dk, key->dk);
+    uint8x16_t prev = vld1q_u8(iv);
+    for (; blocks >= 8; blocks -= 8, in += 128, out += 128) {
+        uint8x16_t c[8], b[8];
+        for (int i = 0; i < 8; ++i) {
+            b[i] = c[i] = vld1q_u8(in + 16 * i);
+        }
+        for (int r = 0; r < 13; ++r) {
+            for (int i = 0; i < 8; ++i) {
+                b[i] = vaesimcq_u8(vaesdq_u8(b[i], dk[r]));
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            b[i] = veorq_u8(vaesdq_u8(b[i], dk[13]), dk[14]);
+        }
+        vst1q_u8(out, veorq_u8(b[0], prev));
+        for (int i = 1; i < 8; ++i) {
+            vst1q_u8(out + 16 * i, veorq_u8(b[i], c[i - 1]));
+        }
+        prev = c[7];
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        uint8x16_t c = vld1q_u8(in);
+        vst1q_u8(out, veorq_u8(arm_decrypt(dk, c), prev));
+        prev = c;
+    }
+    vst1q_u8(iv, prev);
+}
+
+static void ctr32_arm(const aes256_key *key, uint8_t ctr[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8x16_t rk[15];
+    arm_load_keys(rk, key->rk);
+    uint8x16_t base = vld1q_u8(ctr);
+    uint32_t n = ((uint32_t)ctr[12] << 24) | ((uint32_t)ctr[13] << 16) | ((uint32_t)ctr[14] << 8) | ctr[15];
+    for (; blocks >= 8; blocks -= 8, in += 128, out += 128) {
+        uint8x16_t b[8];
+        for (int i = 0; i < 8; ++i) {
+            b[i] = arm_ctr_block(base, n++);
+        }
+        for (int r = 0; r < 13; ++r) {
+            for (int i = 0; i < 8; ++i) {
+                b[i] = vaesmcq_u8(vaeseq_u8(b[i], rk[r]));
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            b[i] = veorq_u8(vaeseq_u8(b[i], rk[13]), rk[14]);
+            vst1q_u8(out + 16 * i, veorq_u8(b[i], vld1q_u8(in + 16 * i)));
+        }
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        uint8x16_t b = arm_encrypt(rk, arm_ctr_block(base, n++));
+        vst1q_u8(out, veorq_u8(b, vld1q_u8(in)));
+    }
+    vst1q_u8(ctr, arm_ctr_block(base, n));
+}
+
+// the same GHASH as the x86 path, on NEON + PMULL
+
+static inline uint8x16_t arm_bswap(uint8x16_t x) {
+    x = vrev64q_u8(x);
+    return vextq_u8(x, x, 8);
+}
+
+static inline uint8x16_t arm_pmull_lo(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_p128(vmull_p64((poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 0),
+                                           (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 0)));
+}
+
+static inline uint8x16_t arm_pmull_hi(uint8x16_t a, uint8x16_t b) {
+    return vreinterpretq_u8_p128(vmull_high_p64(vreinterpretq_p64_u8(a), vreinterpretq_p64_u8(b)));
+}
+
+static inline void arm_clmul(uint8x16_t a, uint8x16_t b, uint8x16_t &lo, uint8x16_t &mid, uint8x16_t &hi) {
+    lo = veorq_u8(lo, arm_pmull_lo(a, b));
+    hi = veorq_u8(hi, arm_pmull_hi(a, b));
+    // (a.hi * b.lo) ^ (a.lo * b.hi)
+    mid = veorq_u8(mid, veorq_u8(arm_pmull_lo(vextq_u8(a, a, 8), b), arm_pmull_lo(a, vextq_u8(b, b, 8))));
+}
+
+#define ARM_SHL32(x, n) vreinterpretq_u8_u32(vshlq_n_u32(vreinterpretq_u32_u8(x), n))
+#define ARM_SHR32(x, n) vreinterpretq_u8_u32(vshrq_n_u32(vreinterpretq_u32_u8(x), n))
+#define ARM_SHL128(x, n) vextq_u8(vdupq_n_u8(0), x, 16 - (n))
+#define ARM_SHR128(x, n) vextq_u8(x, vdupq_n_u8(0), n)
+
+static inline uint8x16_t arm_reduce(uint8x16_t lo, uint8x16_t mid, uint8x16_t hi) {
+    uint8x16_t t3 = veorq_u8(lo, ARM_SHL128(mid, 8));
+    uint8x16_t t6 = veorq_u8(hi, ARM_SHR128(mid, 8));
+    // shift the product left by one bit
+    uint8x16_t t7 = ARM_SHR32(t3, 31);
+    uint8x16_t t8 = ARM_SHR32(t6, 31);
+    t3 = ARM_SHL32(t3, 1);
+    t6 = ARM_SHL32(t6, 1);
+    uint8x16_t t9 = ARM_SHR128(t7, 12);
+    t8 = ARM_SHL128(t8, 4);
+    t7 = ARM_SHL128(t7, 4);
+    t3 = vorrq_u8(t3, t7);
+    t6 = vorrq_u8(vorrq_u8(t6, t8), t9);
+    // reduce modulo x^128 + x^7 + x^2 + x + 1
+    t7 = veorq_u8(veorq_u8(ARM_SHL32(t3, 31), ARM_SHL32(t3, 30)), ARM_SHL32(t3, 25));
+    t8 = ARM_SHR128(t7, 4);
+    t3 = veorq_u8(t3, ARM_SHL128(t7, 12));
+    uint8x16_t t2 = veorq_u8(veorq_u8(ARM_SHR32(t3, 1), ARM_SHR32(t3, 2)), ARM_SHR32(t3, 7));
+    t3 = veorq_u8(t3, veorq_u8(t2, t8));
+    return veorq_u8(t6, t3);
+}
+
+static inline uint8x16_t arm_gfmul(uint8x16_t a, uint8x16_t b) {
+    uint8x16_t lo = vdupq_n_u8(0), mid = lo, hi = lo;
+    arm_clmul(a, b, lo, mid, hi);
+    return arm_reduce(lo, mid, hi);
+}
+
+// hk[0..15]: H^8 .. H^1, byte-reflected
+static void prepare_arm(aes256_key *key) {
+    uint8x16_t rk[15];
+    arm_load_keys(rk, key->rk);
+    uint8x16_t h = arm_bswap(arm_encrypt(rk, vdupq_n_u8(0)));
+    uint8x16_t p = h;
+    uint8_t *powers = (uint8_t *)key->hk;
+    for (int i = 7; i >= 0; --i) {
+        vst1q_u8(powers + 16 * i, p);
+        p = arm_gfmul(p, h);
+    }
+}
+
+static void ghash_pmull(const aes256_key *key, uint8_t x[16], const uint8_t *in, size_t blocks) {
+    const uint8_t *powers = (const uint8_t *)key->hk;
+    uint8x16_t h[8];
+    for (int i = 0; i < 8; ++i) {
+        h[i] = vld1q_u8(powers + 16 * i);
+    }
+    uint8x16_t y = arm_bswap(vld1q_u8(x));
+    for (; blocks >= 8; blocks -= 8, in += 128) {
+        uint8x16_t lo = vdupq_n_u8(0), mid = lo, hi = lo;
+        arm_clmul(veorq_u8(y, arm_bswap(vld1q_u8(in))), h[0], lo, mid, hi);
+        for (int i = 1; i < 8; ++i) {
+            arm_clmul(arm_bswap(vld1q_u8(in + 16 * i)), h[i], lo, mid, hi);
+        }
+        y = arm_reduce(lo, mid, hi);
+    }
+    for (; blocks > 0; --blocks, in += 16) {
+        y = arm_gfmul(veorq_u8(y, arm_bswap(vld1q_u8(in))), h[7]);
+    }
+    vst1q_u8(x, arm_bswap(y));
+}
+
+#endif /* ENABLE_ARM_AES */
+
+#pragma mark Dispatch
+
+typedef void (*aes_prepare_fn)(aes256_key *key);
+typedef void (*aes_mode_fn)(const aes256_key *key, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t blocks);
+typedef void (*aes_ghash_fn)(const aes256_key *key, uint8_t x[16], const uint8_t *in, size_t blocks);
+
+struct AesKernels {
+    const char *name;
+    aes_prepare_fn prepare;      // GHASH key from the round keys
+    aes_mode_fn cbc_encrypt;     // iv is updated
+    aes_mode_fn cbc_decrypt;
+    aes_mode_fn ctr32;           // counter is updated (last 32 bits)
+    aes_ghash_fn ghash;
+
+    AesKernels() : name("portable"), prepare(prepare_portable),
+                   cbc_encrypt(cbc_encrypt_portable), cbc_decrypt(cbc_decrypt_portable),
+                   ctr32(ctr32_portable), ghash(ghash_portable) {
+#if defined(ENABLE_X86_AES)
+        if (dim_cpu_has_aes_clmul() && dim_cpu_has_ssse3() && dim_cpu_has_sse41()) {
+            name = "aesni";
+            prepare = prepare_x86;
+            cbc_encrypt = cbc_encrypt_aesni;
+            cbc_decrypt = cbc_decrypt_aesni;
+            ctr32 = ctr32_aesni;
+            ghash = ghash_pclmul;
+            if (dim_cpu_has_vaes_clmul()) {
+                name = "vaes";
+                cbc_decrypt = cbc_decrypt_vaes;
+                ctr32 = ctr32_vaes;
+                ghash = ghash_vpclmul;
+            }
+        }
+#elif defined(ENABLE_ARM_AES)
+        name = "armv8";
+        prepare = prepare_arm;
+        cbc_encrypt = cbc_encrypt_arm;
+        cbc_decrypt = cbc_decrypt_arm;
+        ctr32 = ctr32_arm;
+        ghash = ghash_pmull;
+#endif
+    }
+};
+
+static inline const AesKernels &kernels() {
+    static const AesKernels k;
+    return k;
+}
+
+#pragma mark API
+
+const char *aes_implementation(void) {
+    return kernels().name;
+}
+
+void aes256_init(aes256_key *key, const uint8_t *password) {
+    expand_key(key, password);
+    kernels().prepare(key);
+}
+
+void aes256_wipe(aes256_key *key) {
+    aes_wipe(key, sizeof(aes256_key));
+}
+
+size_t aes256_cbc_encrypt(const aes256_key *key, const uint8_t *iv,
+                          const uint8_t *in, size_t len, uint8_t *out) {
+    const AesKernels &k = kernels();
+    uint8_t chain[16], last[16];
+    size_t full = len / 16, rest = len % 16;
+    if (iv) {
+        memcpy(chain, iv, 16);
+    } else {
+        memset(chain, 0, 16);
+    }
+    k.cbc_encrypt(key, chain, in, out, full);
+    // PKCS#7
+    memcpy(last, in + full * 16, rest);
+    memset(last + rest, (int)(16 - rest), 16 - rest);
+    k.cbc_encrypt(key, chain, last, out + full * 16, 1);
+    aes_wipe(last, sizeof(last));
+    return (full + 1) * 16;
+}
+
+size_t aes256_cbc_decrypt(const aes256_key *key, const uint8_t *iv,
+                          const uint8_t *in, size_t len, uint8_t *out) {
+    if (len == 0 || len % 16 != 0) {
+        return AES_DECRYPT_ERROR;
+    }
+    uint8_t chain[16];
+    if (iv) {
+        memcpy(chain, iv, 16);
+    } else {
+        memset(chain, 0, 16);
+    }
+    kernels().cbc_decrypt(key, chain, in, out, len / 16);
+    // PKCS#7
+    uint8_t pad = out[len - 1];
+    uint8_t bad = (uint8_t)(pad == 0) | (uint8_t)(pad > 16);
+    for (size_t i = 1; i <= 16; ++i) {
+        // check the padding bytes, all 16 tail bytes are read
+        uint8_t in_pad = (uint8_t)(i <= pad);
+        bad |= in_pad & (uint8_t)(out[len - i] != pad);
+    }
+    if (bad) {
+        return AES_DECRYPT_ERROR;
+    }
+    return len - pad;
+}
+
+// GHASH over data, the last partial block padded with zeros
+static void gcm_ghash(const AesKernels &k, const aes256_key *key, uint8_t x[16], const uint8_t *data, size_t len) {
+    if (len >= 16) {
+        k.ghash(key, x, data, len / 16);
+    }
+    if (len % 16) {
+        uint8_t block[16] = {0};
+        memcpy(block, data + len / 16 * 16, len % 16);
+        k.ghash(key, x, block, 1);
+    }
+}
+
+// returns the tag of the ciphertext (the input when decrypting)
+static void gcm_crypt(const aes256_key *key, const uint8_t *iv,
+                      const uint8_t *aad, size_t aad_len,
+                      const uint8_t *in, size_t len, uint8_t *out,
+                      uint8_t tag[16], bool decrypt) {
+    const AesKernels &k = kernels();
+    uint8_t j0[16], ctr[16], x[16] = {0}, block[16];
+    memcpy(j0, iv, 12);
+    j0[12] = 0;
+    j0[13] = 0;
+    j0[14] = 0;
+    j0[15] = 1;
+    memcpy(ctr, j0, 16);
+    inc32(ctr);
+
+    if (aad_len > 0) {
+        gcm_ghash(k, key, x, aad, aad_len);
+    }
+
+    size_t total = len;
+    while (len >= 16) {
+        size_t blocks = len / 16;
+        if (blocks > GCM_CHUNK_BLOCKS) {
+            blocks = GCM_CHUNK_BLOCKS;
+        }
+        if (decrypt) {
+            k.ghash(key, x, in, blocks);
+            k.ctr32(key, ctr, in, out, blocks);
+        } else {
+            k.ctr32(key, ctr, in, out, blocks);
+            k.ghash(key, x, out, blocks);
+        }
+        in += blocks * 16;
+        out += blocks * 16;
+        len -= blocks * 16;
+    }
+    if (len > 0) {
+        memset(block, 0, 16);
+        memcpy(block, in, len);
+        if (decrypt) {
+            k.ghash(key, x, block, 1);
+            k.ctr32(key, ctr, block, block, 1);
+            memcpy(out, block, len);
+        } else {
+            k.ctr32(key, ctr, block, block, 1);
+            memcpy(out, block, len);
+            memset(block + len, 0, 16 - len);
+            k.ghash(key, x, block, 1);
+        }
+    }
+
+    // len(A) || len(C) in bits
+    store64_be(block, (uint64_t)aad_len * 8);
+    store64_be(block + 8, (uint64_t)total * 8);
+    k.ghash(key, x, block, 1);
+    // T = E(J0) ^ S
+    k.ctr32(key, j0, x, tag, 1);
+    aes_wipe(block, sizeof(block));
+}
+
+void aes256_gcm_encrypt(const aes256_key *key, const uint8_t *iv,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag) {
+    gcm_crypt(key, iv, aad, aad_len, in, len, out, tag, false);
+}
+
+int aes256_gcm_decrypt(const aes256_key *key, const uint8_t *iv,
+                       const uint8_t *aad, size_t aad_len,
+                       const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out) {
+    uint8_t expected[16];
+    gcm_crypt(key, iv, aad, aad_len, in, len, out, expected, true);
+    uint8_t diff = 0;
+    for (int i = 0; i < 16; ++i) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if (diff != 0) {
+        aes_wipe(out, len);
+        return 0;
+    }
+    return 1;
+}
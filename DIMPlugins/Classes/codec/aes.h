@@ -0,0 +1,96 @@
+//
+//  aes.h
+//  DIMPlugins
+//
+//  AES-256 kernels: CBC (PKCS#7) and GCM, with AES-NI + PCLMULQDQ,
+//  VAES + VPCLMULQDQ (AVX2) and ARMv8 AES + PMULL paths selected at runtime.
+//
+//  The portable fallback uses lookup tables and is not constant-time,
+//  every Apple device takes one of the hardware paths.
+//
+//  Created by Albert Moky on 2024/4/2.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_AES_H
+#define DIM_AES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AES256_KEY_SIZE  32
+#define AES_BLOCK_SIZE   16
+#define AES_GCM_IV_SIZE  12
+#define AES_GCM_TAG_SIZE 16
+
+#define AES_DECRYPT_ERROR ((size_t)-1)
+
+// output buffer size for CBC encryption (PKCS#7 always adds 1..16 bytes)
+#define AES_CBC_ENCRYPT_SIZE(len) (((len) / AES_BLOCK_SIZE + 1) * AES_BLOCK_SIZE)
+
+/**
+ *  Expanded key: round keys for both directions and the GHASH key,
+ *  build it once and reuse it for every message
+ */
+typedef struct aes256_key {
+    uint8_t rk[15][16];  // encryption round keys
+    uint8_t dk[15][16];  // decryption round keys (equivalent inverse cipher)
+    uint64_t hk[32];     // GHASH key, the layout depends on the kernel
+} aes256_key;
+
+/**
+ *  Expand key
+ *
+ * @param key      - key schedule to build
+ * @param password - 32 bytes
+ */
+void aes256_init(aes256_key *key, const uint8_t *password);
+
+/**
+ *  Erase key schedule
+ */
+void aes256_wipe(aes256_key *key);
+
+/**
+ *  CBC mode with PKCS#7 padding
+ *
+ * @param iv  - 16 bytes, NULL for zeros
+ * @param out - AES_CBC_ENCRYPT_SIZE(len) bytes for encryption,
+ *              len bytes for decryption (may be the same as input)
+ * @return output length; AES_DECRYPT_ERROR on wrong length or padding
+ */
+size_t aes256_cbc_encrypt(const aes256_key *key, const uint8_t *iv,
+                          const uint8_t *in, size_t len, uint8_t *out);
+size_t aes256_cbc_decrypt(const aes256_key *key, const uint8_t *iv,
+                          const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ *  GCM mode (NIST SP 800-38D) with 96-bit IV and 128-bit tag
+ *
+ * @param iv  - 12 bytes, must never repeat for the same key
+ * @param aad - additional authenticated data (optional)
+ * @param out - len bytes (may be the same as input)
+ * @param tag - 16 bytes
+ * @return 1 on success; 0 when the tag mismatched, the output is erased
+ */
+void aes256_gcm_encrypt(const aes256_key *key, const uint8_t *iv,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag);
+int aes256_gcm_decrypt(const aes256_key *key, const uint8_t *iv,
+                       const uint8_t *aad, size_t aad_len,
+                       const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out);
+
+/**
+ *  Name of the kernel in use ("vaes", "aesni", "armv8" or "portable")
+ */
+const char *aes_implementation(void);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_AES_H */
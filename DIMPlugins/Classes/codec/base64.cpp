@@ -0,0 +1,419 @@
+//
+//  base64.cpp
+//  DIMPlugins
+//
+//  SIMD algorithms by Wojciech Muła & Daniel Lemire:
+//      "Faster Base64 Encoding and Decoding Using AVX2 Instructions"
+//
+//  Created by Albert Moky on 2024/3/26.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "base64.h"
+#include "cpu.h"
+
+#if defined(DIM_CPU_X86)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+#define B64_SPACE   0x40  // whitespace
+#define B64_PAD     0x41  // '='
+#define B64_INVALID 0xFF
+
+// char => 6 bits value
+struct Base64Table {
+    uint8_t values[256];
+    // ASCII chars only, for NEON lookups
+    uint8_t ascii[128];
+    
+    Base64Table() {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = B64_INVALID;
+        }
+        for (int i = 0; i < 64; ++i) {
+            values[(uint8_t)kAlphabet[i]] = (uint8_t)i;
+        }
+        for (int i = 0; i < 128; ++i) {
+            ascii[i] = values[i];
+        }
+        values[' '] = values['\t'] = values['\r'] = values['\n'] = B64_SPACE;
+        values['='] = B64_PAD;
+    }
+};
+
+static const Base64Table kTable;
+
+#pragma mark Scalar
+
+static inline size_t encode_scalar(const uint8_t *src, size_t len, char *dst) {
+    char *out = dst;
+    size_t i = 0;
+    uint32_t v;
+    for (; i + 3 <= len; i += 3) {
+        v = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) | src[i + 2];
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+        *out++ = kAlphabet[(v >> 6) & 0x3F];
+        *out++ = kAlphabet[v & 0x3F];
+    }
+    if (i + 1 == len) {
+        v = (uint32_t)src[i] << 16;
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+        *out++ = '=';
+        *out++ = '=';
+    } else if (i + 2 == len) {
+        v = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8);
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+        *out++ = kAlphabet[(v >> 6) & 0x3F];
+        *out++ = '=';
+    }
+    return out - dst;
+}
+
+// decoding state between blocks
+struct DecodeState {
+    uint32_t acc;   // pending bits
+    int count;      // pending 6-bit values (0..3)
+    int padding;    // number of '=' seen
+    int flags;
+};
+
+// decode chars one by one, returns bytes written
+static inline size_t decode_scalar(const char *src, size_t len, uint8_t *dst, DecodeState *st) {
+    uint8_t *out = dst;
+    uint8_t v;
+    for (size_t i = 0; i < len; ++i) {
+        v = kTable.values[(uint8_t)src[i]];
+        if (v < 64) {
+            if (st->padding > 0) {
+                // data after padding
+                if (st->flags == BASE64_STRICT) {
+                    return BASE64_DECODE_ERROR;
+                }
+                continue;
+            }
+            st->acc = (st->acc << 6) | v;
+            if (++st->count == 4) {
+                *out++ = (uint8_t)(st->acc >> 16);
+                *out++ = (uint8_t)(st->acc >> 8);
+                *out++ = (uint8_t)st->acc;
+                st->acc = 0;
+                st->count = 0;
+            }
+        } else if (v == B64_PAD) {
+            ++st->padding;
+        } else if (v == B64_INVALID && st->flags == BASE64_STRICT) {
+            return BASE64_DECODE_ERROR;
+        }
+        // skip whitespaces (and unknown chars when lenient)
+    }
+    return out - dst;
+}
+
+// flush the pending bits at the end
+static inline size_t decode_final(uint8_t *dst, DecodeState *st) {
+    if (st->flags == BASE64_STRICT) {
+        if (st->count == 0 ? st->padding != 0 : st->count + st->padding != 4) {
+            return BASE64_DECODE_ERROR;
+        }
+    }
+    switch (st->count) {
+        case 0:
+            return 0;
+        case 2:
+            dst[0] = (uint8_t)(st->acc >> 4);
+            return 1;
+        case 3:
+            dst[0] = (uint8_t)(st->acc >> 10);
+            dst[1] = (uint8_t)(st->acc >> 2);
+            return 2;
+        default:
+            // a single char cannot make a byte
+            return BASE64_DECODE_ERROR;
+    }
+}
+
+#pragma mark SSSE3 / SSE4.1
+
+#if defined(DIM_CPU_X86)
+
+// 16 6-bit indexes => 16 chars
+__attribute__((target("ssse3")))
+static inline __m128i sse_lookup(__m128i indices) {
+    const __m128i shift_LUT = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                            '/' - 63, 'A', 0, 0);
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    result = _mm_shuffle_epi8(shift_LUT, result);
+    return _mm_add_epi8(result, indices);
+}
+
+// 12 bytes (in 16) => 16 6-bit indexes
+__attribute__((target("ssse3")))
+static inline __m128i sse_unpack(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3,sse4.1")))
+static size_t encode_sse(const uint8_t *src, size_t len, char *dst) {
+    size_t i = 0, out = 0;
+    // reads 16 bytes, uses 12
+    for (; i + 16 <= len; i += 12, out += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + out), sse_lookup(sse_unpack(in)));
+    }
+    return i;
+}
+
+// 16 chars => 12 bytes (in 16); returns false on any char not in alphabet
+__attribute__((target("ssse3,sse4.1")))
+static inline bool sse_pack(__m128i in, __m128i *out) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2F = _mm_set1_epi8(0x2F);
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask_2F);
+    const __m128i lo_nibbles = _mm_and_si128(in, mask_2F);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm_testz_si128(lo, hi)) {
+        return false;
+    }
+    const __m128i eq_2F = _mm_cmpeq_epi8(in, mask_2F);
+    const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi_nibbles));
+    const __m128i values = _mm_add_epi8(in, roll);
+    // 4 x 6 bits => 3 bytes
+    const __m128i ab_bc = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i abc = _mm_madd_epi16(ab_bc, _mm_set1_epi32(0x00011000));
+    *out = _mm_shuffle_epi8(abc, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return true;
+}
+
+__attribute__((target("ssse3,sse4.1")))
+static size_t decode_sse(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    size_t i = 0, out = 0;
+    __m128i block;
+    for (; i + 16 <= len; i += 16, out += 12) {
+        if (!sse_pack(_mm_loadu_si128((const __m128i *)(src + i)), &block)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(dst + out), block);
+    }
+    *consumed = i;
+    return out;
+}
+
+#pragma mark AVX2
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(const uint8_t *src, size_t len, char *dst) {
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i shift_LUT = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                               '/' - 63, 'A', 0, 0,
+                                               'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                               '/' - 63, 'A', 0, 0);
+    size_t i = 0, out = 0;
+    // reads 2 x 16 bytes, uses 2 x 12
+    for (; i + 28 <= len; i += 24, out += 32) {
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(src + i))),
+                                             _mm_loadu_si128((const __m128i *)(src + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shift_LUT, result), indices);
+        _mm256_storeu_si256((__m256i *)(dst + out), result);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71,
+                                              0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask_2F = _mm256_set1_epi8(0x2F);
+    size_t i = 0, out = 0;
+    for (; i + 32 <= len; i += 32, out += 24) {
+        const __m256i in = _mm256_loadu_si256((const __m256i *)(src + i));
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2F);
+        const __m256i lo_nibbles = _mm256_and_si256(in, mask_2F);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        const __m256i eq_2F = _mm256_cmpeq_epi8(in, mask_2F);
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2F, hi_nibbles));
+        const __m256i values = _mm256_add_epi8(in, roll);
+        const __m256i ab_bc = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i abc = _mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000));
+        abc = _mm256_shuffle_epi8(abc, pack);
+        // 12 bytes in each lane => 24 bytes
+        abc = _mm256_permutevar8x32_epi32(abc, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)(dst + out), abc);
+    }
+    *consumed = i;
+    return out;
+}
+
+#endif /* DIM_CPU_X86 */
+
+#pragma mark NEON
+
+#if defined(__aarch64__)
+
+static size_t encode_neon(const uint8_t *src, size_t len, char *dst) {
+    const uint8x16x4_t table = vld1q_u8_x4((const uint8_t *)kAlphabet);
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+    size_t i = 0, out = 0;
+    for (; i + 48 <= len; i += 48, out += 64) {
+        // de-interleave 16 x 3 bytes
+        uint8x16x3_t in = vld3q_u8(src + i);
+        uint8x16x4_t idx;
+        idx.val[0] = vshrq_n_u8(in.val[0], 2);
+        idx.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[0], 4)), mask);
+        idx.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(in.val[2], 6), vshlq_n_u8(in.val[1], 2)), mask);
+        idx.val[3] = vandq_u8(in.val[2], mask);
+        uint8x16x4_t chars;
+        chars.val[0] = vqtbl4q_u8(table, idx.val[0]);
+        chars.val[1] = vqtbl4q_u8(table, idx.val[1]);
+        chars.val[2] = vqtbl4q_u8(table, idx.val[2]);
+        chars.val[3] = vqtbl4q_u8(table, idx.val[3]);
+        vst4q_u8((uint8_t *)dst + out, chars);
+    }
+    return i;
+}
+
+static size_t decode_neon(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    // values of chars 0..127, 0xFF for invalid
+    const uint8x16x4_t lo = vld1q_u8_x4(kTable.ascii);
+    const uint8x16x4_t hi = vld1q_u8_x4(kTable.ascii + 64);
+    const uint8x16_t offset = vdupq_n_u8(64);
+    size_t i = 0, out = 0;
+    for (; i + 64 <= len; i += 64, out += 48) {
+        uint8x16x4_t in = vld4q_u8((const uint8_t *)src + i);
+        uint8x16_t bad = vdupq_n_u8(0);
+        for (int k = 0; k < 4; ++k) {
+            uint8x16_t c = in.val[k];
+            uint8x16_t v = vqtbx4q_u8(vqtbl4q_u8(lo, c), hi, vsubq_u8(c, offset));
+            // chars >= 128 are out of both tables
+            bad = vorrq_u8(bad, vorrq_u8(v, vcgeq_u8(c, vdupq_n_u8(128))));
+            in.val[k] = v;
+        }
+        if (vmaxvq_u8(bad) > 63) {
+            break;
+        }
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+        vst3q_u8(dst + out, bytes);
+    }
+    *consumed = i;
+    return out;
+}
+
+#endif /* __aarch64__ */
+
+#pragma mark Dispatch
+
+typedef size_t (*base64_encode_fn)(const uint8_t *src, size_t len, char *dst);
+typedef size_t (*base64_decode_fn)(const char *src, size_t len, uint8_t *dst, size_t *consumed);
+
+struct Base64Kernels {
+    base64_encode_fn encode;
+    base64_decode_fn decode;
+    
+    Base64Kernels() : encode(nullptr), decode(nullptr) {
+#if defined(DIM_CPU_X86)
+        if (dim_cpu_has_avx2()) {
+            encode = encode_avx2;
+            decode = decode_avx2;
+        } else if (dim_cpu_has_ssse3() && dim_cpu_has_sse41()) {
+            encode = encode_sse;
+            decode = decode_sse;
+        }
+#elif defined(__aarch64__)
+        encode = encode_neon;
+        decode = decode_neon;
+#endif
+    }
+};
+
+static inline const Base64Kernels &kernels() {
+    static const Base64Kernels k;
+    return k;
+}
+
+size_t base64_encode(const uint8_t *src, size_t len, char *dst) {
+    size_t done = 0;
+    const Base64Kernels &k = kernels();
+    if (k.encode) {
+        done = k.encode(src, len, dst);
+    }
+    // each SIMD step takes a multiple of 3 bytes
+    return done / 3 * 4 + encode_scalar(src + done, len - done, dst + done / 3 * 4);
+}
+
+size_t base64_decode(const char *src, size_t len, uint8_t *dst, int flags) {
+    const Base64Kernels &k = kernels();
+    DecodeState st = {0, 0, 0, flags};
+    size_t pos = 0, out = 0, consumed, res;
+    while (pos < len) {
+        if (k.decode && st.count == 0 && st.padding == 0) {
+            // fast path: blocks of alphabet chars only
+            out += k.decode(src + pos, len - pos, dst + out, &consumed);
+            pos += consumed;
+        }
+        // slow path: one block (or the tail) with whitespaces / padding
+        size_t step = len - pos < 64 ? len - pos : 64;
+        res = decode_scalar(src + pos, step, dst + out, &st);
+        if (res == BASE64_DECODE_ERROR) {
+            return BASE64_DECODE_ERROR;
+        }
+        out += res;
+        pos += step;
+    }
+    res = decode_final(dst + out, &st);
+    if (res == BASE64_DECODE_ERROR) {
+        return BASE64_DECODE_ERROR;
+    }
+    return out + res;
+}
@@ -0,0 +1,62 @@
+//
+//  base64.h
+//  DIMPlugins
+//
+//  Base64 codec kernels: lookup tables + SSSE3/SSE4.1/AVX2/NEON.
+//
+//  Created by Albert Moky on 2024/3/26.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_BASE64_H
+#define DIM_BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BASE64_DECODE_ERROR ((size_t)-1)
+
+// output buffer sizes (decoding needs some slack for the SIMD stores)
+#define BASE64_ENCODE_SIZE(len)  (((len) + 2) / 3 * 4)
+#define BASE64_DECODE_BOUND(len) ((len) / 4 * 3 + 16)
+
+/**
+ *  Decoding options
+ *
+ *      lenient - skip all unknown chars, padding is optional
+ *      strict  - only whitespaces (' ', '\t', '\r', '\n') can be skipped,
+ *                padding is required (RFC 4648)
+ */
+#define BASE64_LENIENT 0
+#define BASE64_STRICT  1
+
+/**
+ *  Encode bytes to base64 string (with padding, no line breaks)
+ *
+ * @param src - input bytes
+ * @param len - input length
+ * @param dst - output buffer, at least BASE64_ENCODE_SIZE(len) bytes
+ * @return output length
+ */
+size_t base64_encode(const uint8_t *src, size_t len, char *dst);
+
+/**
+ *  Decode base64 string, skipping whitespaces in the same pass
+ *
+ * @param src   - input chars
+ * @param len   - input length
+ * @param dst   - output buffer, at least BASE64_DECODE_BOUND(len) bytes
+ * @param flags - BASE64_LENIENT or BASE64_STRICT
+ * @return output length; BASE64_DECODE_ERROR on error
+ */
+size_t base64_decode(const char *src, size_t len, uint8_t *dst, int flags);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_BASE64_H */
@@ -0,0 +1,772 @@
+//
+//  chacha.cpp
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/8.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "chacha.h"
+#include "cpu.h"
+
+#include <string.h>
+
+#ifndef __SIZEOF_INT128__
+#error "Poly1305 needs a 64-bit target (unsigned __int128)"
+#endif
+
+#if defined(DIM_CPU_X86) && defined(__GNUC__)
+#define ENABLE_X86_CHACHA 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define ENABLE_ARM_CHACHA 1
+#include <arm_neon.h>
+#endif
+
+// bytes per pass in the AEAD, the ciphertext stays in L1 for Poly1305
+#define CHACHA_CHUNK_SIZE 4096
+
+// the 4-way Poly1305 needs r^2..r^4 first, not worth it for short input
+#define POLY1305_SIMD_MIN_BLOCKS 16
+
+typedef unsigned __int128 uint128_t;
+
+static inline uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store32_le(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint64_t load64_le(const uint8_t *p) {
+    return (uint64_t)load32_le(p) | ((uint64_t)load32_le(p + 4) << 32);
+}
+
+static inline void store64_le(uint8_t *p, uint64_t v) {
+    store32_le(p, (uint32_t)v);
+    store32_le(p + 4, (uint32_t)(v >> 32));
+}
+
+static void chacha_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+#pragma mark ChaCha20
+
+static void chacha_setup(uint32_t s[16], const uint8_t *key, const uint8_t *nonce, uint32_t counter) {
+    s[0] = 0x61707865;
+    s[1] = 0x3320646e;
+    s[2] = 0x79622d32;
+    s[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        s[4 + i] = load32_le(key + 4 * i);
+    }
+    s[12] = counter;
+    s[13] = load32_le(nonce);
+    s[14] = load32_le(nonce + 4);
+    s[15] = load32_le(nonce + 8);
+}
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)                \
+    a += b; d ^= a; d = ROTL32(d, 16);          \
+    c += d; b ^= c; b = ROTL32(b, 12);          \
+    a += b; d ^= a; d = ROTL32(d, 8);           \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+static void chacha_block(const uint32_t s[16], uint8_t out[64]) {
+    uint32_t x[16];
+    memcpy(x, s, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        QUARTERROUND(x[0], x[4], x[8],  x[12]);
+        QUARTERROUND(x[1], x[5], x[9],  x[13]);
+        QUARTERROUND(x[2], x[6], x[10], x[14]);
+        QUARTERROUND(x[3], x[7], x[11], x[15]);
+        QUARTERROUND(x[0], x[5], x[10], x[15]);
+        QUARTERROUND(x[1], x[6], x[11], x[12]);
+        QUARTERROUND(x[2], x[7], x[8],  x[13]);
+        QUARTERROUND(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        store32_le(out + 4 * i, x[i] + s[i]);
+    }
+    chacha_wipe(x, sizeof(x));
+}
+
+// out = in ^ keystream, the block counter (s[12]) is updated
+static void chacha_blocks_portable(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    uint8_t ks[64];
+    for (; blocks > 0; --blocks, in += 64, out += 64) {
+        chacha_block(s, ks);
+        for (int i = 0; i < 64; ++i) {
+            out[i] = in[i] ^ ks[i];
+        }
+        ++s[12];
+    }
+    chacha_wipe(ks, sizeof(ks));
+}
+
+#ifdef ENABLE_X86_CHACHA
+
+#define X86_SSE2   __attribute__((target("sse2")))
+#define X86_AVX2   __attribute__((target("avx2")))
+#define X86_AVX512 __attribute__((target("avx512f,avx2")))
+
+// 4 blocks, one per lane (vertical)
+
+#define SSE2_ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define SSE2_ROTL16(x)  _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1)
+
+#define SSE2_QR(a, b, c, d)                                                 \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE2_ROTL16(d);   \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE2_ROTL(b, 12); \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = SSE2_ROTL(d, 8);  \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = SSE2_ROTL(b, 7)
+
+X86_SSE2 static void chacha_blocks_sse2(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    for (; blocks >= 4; blocks -= 4, in += 256, out += 256) {
+        __m128i x[16], o[16];
+        for (int i = 0; i < 16; ++i) {
+            o[i] = _mm_set1_epi32((int)s[i]);
+        }
+        o[12] = _mm_add_epi32(o[12], _mm_set_epi32(3, 2, 1, 0));
+        memcpy(x, o, sizeof(x));
+        for (int r = 0; r < 10; ++r) {
+            SSE2_QR(x[0], x[4], x[8],  x[12]);
+            SSE2_QR(x[1], x[5], x[9],  x[13]);
+            SSE2_QR(x[2], x[6], x[10], x[14]);
+            SSE2_QR(x[3], x[7], x[11], x[15]);
+            SSE2_QR(x[0], x[5], x[10], x[15]);
+            SSE2_QR(x[1], x[6], x[11], x[12]);
+            SSE2_QR(x[2], x[7], x[8],  x[13]);
+            SSE2_QR(x[3], x[4], x[9],  x[14]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            x[i] = _mm_add_epi32(x[i], o[i]);
+        }
+        // transpose 4 words x 4 blocks
+        for (int g = 0; g < 4; ++g) {
+            __m128i t0 = _mm_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i r[4] = {
+                _mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3),
+            };
+            for (int b = 0; b < 4; ++b) {
+                const __m128i *src = (const __m128i *)(in + 64 * b + 16 * g);
+                _mm_storeu_si128((__m128i *)(out + 64 * b + 16 * g), _mm_xor_si128(r[b], _mm_loadu_si128(src)));
+            }
+        }
+        s[12] += 4;
+    }
+    if (blocks > 0) {
+        chacha_blocks_portable(s, in, out, blocks);
+    }
+}
+
+// 8 blocks, one per lane (vertical)
+
+#define AVX2_ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+
+#define AVX2_QR(a, b, c, d)                                                                  \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16); \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX2_ROTL(b, 12);             \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8);  \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = AVX2_ROTL(b, 7)
+
+X86_AVX2 static void chacha_blocks_avx2(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                          13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                         14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+    for (; blocks >= 8; blocks -= 8, in += 512, out += 512) {
+        __m256i x[16], o[16];
+        for (int i = 0; i < 16; ++i) {
+            o[i] = _mm256_set1_epi32((int)s[i]);
+        }
+        o[12] = _mm256_add_epi32(o[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        memcpy(x, o, sizeof(x));
+        for (int r = 0; r < 10; ++r) {
+            AVX2_QR(x[0], x[4], x[8],  x[12]);
+            AVX2_QR(x[1], x[5], x[9],  x[13]);
+            AVX2_QR(x[2], x[6], x[10], x[14]);
+            AVX2_QR(x[3], x[7], x[11], x[15]);
+            AVX2_QR(x[0], x[5], x[10], x[15]);
+            AVX2_QR(x[1], x[6], x[11], x[12]);
+            AVX2_QR(x[2], x[7], x[8],  x[13]);
+            AVX2_QR(x[3], x[4], x[9],  x[14]);
+        }
+        // transpose in 128-bit lanes: t[g][b] = words 4g..4g+3 of blocks (b, b + 4)
+        __m256i t[4][4];
+        for (int g = 0; g < 4; ++g) {
+            __m256i a = _mm256_add_epi32(x[4 * g], o[4 * g]);
+            __m256i b = _mm256_add_epi32(x[4 * g + 1], o[4 * g + 1]);
+            __m256i c = _mm256_add_epi32(x[4 * g + 2], o[4 * g + 2]);
+            __m256i d = _mm256_add_epi32(x[4 * g + 3], o[4 * g + 3]);
+            __m256i t0 = _mm256_unpacklo_epi32(a, b);
+            __m256i t1 = _mm256_unpacklo_epi32(c, d);
+            __m256i t2 = _mm256_unpackhi_epi32(a, b);
+            __m256i t3 = _mm256_unpackhi_epi32(c, d);
+            t[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            t[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            t[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            t[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+        for (int b = 0; b < 4; ++b) {
+            const uint8_t *src = in + 64 * b;
+            uint8_t *dst = out + 64 * b;
+            __m256i k0 = _mm256_permute2x128_si256(t[0][b], t[1][b], 0x20);
+            __m256i k1 = _mm256_permute2x128_si256(t[2][b], t[3][b], 0x20);
+            __m256i k2 = _mm256_permute2x128_si256(t[0][b], t[1][b], 0x31);
+            __m256i k3 = _mm256_permute2x128_si256(t[2][b], t[3][b], 0x31);
+            _mm256_storeu_si256((__m256i *)dst, _mm256_xor_si256(k0, _mm256_loadu_si256((const __m256i *)src)));
+            _mm256_storeu_si256((__m256i *)(dst + 32), _mm256_xor_si256(k1, _mm256_loadu_si256((const __m256i *)(src + 32))));
+            _mm256_storeu_si256((__m256i *)(dst + 256), _mm256_xor_si256(k2, _mm256_loadu_si256((const __m256i *)(src + 256))));
+            _mm256_storeu_si256((__m256i *)(dst + 288), _mm256_xor_si256(k3, _mm256_loadu_si256((const __m256i *)(src + 288))));
+        }
+        s[12] += 8;
+    }
+    if (blocks > 0) {
+        chacha_blocks_sse2(s, in, out, blocks);
+    }
+}
+
+// 16 blocks: 4 sets of rows, one block per 128-bit lane (horizontal)
+
+#define AVX512_QR(a, b, c, d)                                                                 \
+    a = _mm512_add_epi32(a, b); d = _mm512_xor_si512(d, a); d = _mm512_rol_epi32(d, 16);     \
+    c = _mm512_add_epi32(c, d); b = _mm512_xor_si512(b, c); b = _mm512_rol_epi32(b, 12);     \
+    a = _mm512_add_epi32(a, b); d = _mm512_xor_si512(d, a); d = _mm512_rol_epi32(d, 8);      \
+    c = _mm512_add_epi32(c, d); b = _mm512_xor_si512(b, c); b = _mm512_rol_epi32(b, 7)
+
+#define AVX512_DIAG(b, c, d, pb, pd)                    \
+    b = _mm512_shuffle_epi32(b, (_MM_PERM_ENUM)(pb));   \
+    c = _mm512_shuffle_epi32(c, (_MM_PERM_ENUM)0x4E);   \
+    d = _mm512_shuffle_epi32(d, (_MM_PERM_ENUM)(pd))
+
+X86_AVX512 static void chacha_blocks_avx512(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    if (blocks >= 16) {
+        const __m512i ra = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)s));
+        const __m512i rb = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(s + 4)));
+        const __m512i rc = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(s + 8)));
+        const __m512i step = _mm512_set_epi32(0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 4);
+        __m512i rd = _mm512_add_epi32(_mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(s + 12))),
+                                      _mm512_set_epi32(0, 0, 0, 3, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0));
+        for (; blocks >= 16; blocks -= 16, in += 1024, out += 1024) {
+            __m512i a[4], b[4], c[4], d[4], od[4];
+            for (int k = 0; k < 4; ++k) {
+                a[k] = ra;
+                b[k] = rb;
+                c[k] = rc;
+                d[k] = od[k] = rd;
+                rd = _mm512_add_epi32(rd, step);
+            }
+            for (int r = 0; r < 10; ++r) {
+                for (int k = 0; k < 4; ++k) {
+                    AVX512_QR(a[k], b[k], c[k], d[k]);
+                    AVX512_DIAG(b[k], c[k], d[k], 0x39, 0x93);
+                }
+                for (int k = 0; k < 4; ++k) {
+                    AVX512_QR(a[k], b[k], c[k], d[k]);
+                    AVX512_DIAG(b[k], c[k], d[k], 0x93, 0x39);
+                }
+            }
+            for (int k = 0; k < 4; ++k) {
+                __m512i xa = _mm512_add_epi32(a[k], ra);
+                __m512i xb = _mm512_add_epi32(b[k], rb);
+                __m512i xc = _mm512_add_epi32(c[k], rc);
+                __m512i xd = _mm512_add_epi32(d[k], od[k]);
+                // gather lane i of the 4 rows into block i
+                __m512i ab01 = _mm512_shuffle_i32x4(xa, xb, 0x44);
+                __m512i cd01 = _mm512_shuffle_i32x4(xc, xd, 0x44);
+                __m512i ab23 = _mm512_shuffle_i32x4(xa, xb, 0xEE);
+                __m512i cd23 = _mm512_shuffle_i32x4(xc, xd, 0xEE);
+                __m512i ks[4] = {
+                    _mm512_shuffle_i32x4(ab01, cd01, 0x88), _mm512_shuffle_i32x4(ab01, cd01, 0xDD),
+                    _mm512_shuffle_i32x4(ab23, cd23, 0x88), _mm512_shuffle_i32x4(ab23, cd23, 0xDD),
+                };
+                for (int i = 0; i < 4; ++i) {
+                    const uint8_t *src = in + 256 * k + 64 * i;
+                    _mm512_storeu_si512(out + 256 * k + 64 * i, _mm512_xor_si512(ks[i], _mm512_loadu_si512(src)));
+                }
+            }
+            s[12] += 16;
+        }
+    }
+    if (blocks > 0) {
+        chacha_blocks_avx2(s, in, out, blocks);
+    }
+}
+
+#endif /* ENABLE_X86_CHACHA */
+
+#ifdef ENABLE_ARM_CHACHA
+
+// 4 blocks, one per lane (vertical)
+
+#define NEON_ROTL(x, n) vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - (n))
+#define NEON_ROTL16(x)  vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(x)))
+
+#define NEON_QR(a, b, c, d)                                        \
+    a = vaddq_u32(a, b); d = veorq_u32(d, a); d = NEON_ROTL16(d);  \
+    c = vaddq_u32(c, d); b = veorq_u32(b, c); b = NEON_ROTL(b, 12); \
+    a = vaddq_u32(a, b); d = veorq_u32(d, a); d = NEON_ROTL(d, 8);  \
+    c = vaddq_u32(c, d); b = veorq_u32(b, c); b = NEON_ROTL(b, 7)
+
+static void chacha_blocks_neon(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks) {
+    static const uint32_t lanes[4] = {0, 1, 2, 3};
+    for (; blocks >= 4; blocks -= 4, in += 256, out += 256) {
+        uint32x4_t x[16], o[16];
+        for (int i = 0; i < 16; ++i) {
+            o[i] = vdupq_n_u32(s[i]);
+        }
+        o[12] = vaddq_u32(o[12], vld1q_u32(lanes));
+        for (int i = 0; i < 16; ++i) {
+            x[i] = o[i];
+        }
+        for (int r = 0; r < 10; ++r) {
+            NEON_QR(x[0], x[4], x[8],  x[12]);
+            NEON_QR(x[1], x[5], x[9],  x[13]);
+            NEON_QR(x[2], x[6], x[10], x[14]);
+            NEON_QR(x[3], x[7], x[11], x[15]);
+            NEON_QR(x[0], x[5], x[10], x[15]);
+            NEON_QR(x[1], x[6], x[11], x[12]);
+            NEON_QR(x[2], x[7], x[8],  x[13]);
+            NEON_QR(x[3], x[4], x[9],  x[14]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            x[i] = vaddq_u32(x[i], o[i]);
+        }
+        // transpose 4 words x 4 blocks
+        for (int g = 0; g < 4; ++g) {
+            uint32x4x2_t ab = vtrnq_u32(x[4 * g], x[4 * g + 1]);
+            uint32x4x2_t cd = vtrnq_u32(x[4 * g + 2], x[4 * g + 3]);
+            uint32x4_t r[4] = {
+                vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0])),
+                vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1])),
+                vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0])),
+                vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1])),
+            };
+            for (int b = 0; b < 4; ++b) {
+                const uint8_t *src = in + 64 * b + 16 * g;
+                vst1q_u8(out + 64 * b + 16 * g, veorq_u8(vreinterpretq_u8_u32(r[b]), vld1q_u8(src)));
+            }
+        }
+        s[12] += 4;
+    }
+    if (blocks > 0) {
+        chacha_blocks_portable(s, in, out, blocks);
+    }
+}
+
+#endif /* ENABLE_ARM_CHACHA */
+
+#pragma mark Poly1305
+
+// h, r in 44/44/42-bit limbs (poly1305-donna-64)
+struct poly1305_state {
+    uint64_t r[3];
+    uint64_t h[3];
+    uint64_t pad[2];
+    uint32_t powers[4][5];  // r^1..r^4 in 26-bit limbs, for the 4-way kernel
+    int has_powers;
+};
+
+#define M44 0xFFFFFFFFFFFULL
+#define M42 0x3FFFFFFFFFFULL
+#define M26 0x3FFFFFFU
+
+static void poly1305_init(poly1305_state *st, const uint8_t key[32]) {
+    uint64_t t0 = load64_le(key);
+    uint64_t t1 = load64_le(key + 8);
+    // clamp
+    st->r[0] = t0 & 0xFFC0FFFFFFFULL;
+    st->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xFFFFFC0FFFFULL;
+    st->r[2] = (t1 >> 24) & 0x00FFFFFFC0FULL;
+    st->h[0] = st->h[1] = st->h[2] = 0;
+    st->pad[0] = load64_le(key + 16);
+    st->pad[1] = load64_le(key + 24);
+    st->has_powers = 0;
+}
+
+// h = h * r (mod 2^130 - 5), partially reduced
+static inline void poly1305_mul(uint64_t h[3], const uint64_t r[3]) {
+    uint64_t s1 = r[1] * (5 << 2), s2 = r[2] * (5 << 2);
+    uint128_t d0 = (uint128_t)h[0] * r[0] + (uint128_t)h[1] * s2 + (uint128_t)h[2] * s1;
+    uint128_t d1 = (uint128_t)h[0] * r[1] + (uint128_t)h[1] * r[0] + (uint128_t)h[2] * s2;
+    uint128_t d2 = (uint128_t)h[0] * r[2] + (uint128_t)h[1] * r[1] + (uint128_t)h[2] * r[0];
+    uint64_t c = (uint64_t)(d0 >> 44);
+    h[0] = (uint64_t)d0 & M44;
+    d1 += c;
+    c = (uint64_t)(d1 >> 44);
+    h[1] = (uint64_t)d1 & M44;
+    d2 += c;
+    c = (uint64_t)(d2 >> 42);
+    h[2] = (uint64_t)d2 & M42;
+    h[0] += c * 5;
+    c = h[0] >> 44;
+    h[0] &= M44;
+    h[1] += c;
+}
+
+static void poly1305_blocks_scalar(poly1305_state *st, const uint8_t *in, size_t blocks, uint64_t hibit) {
+    for (; blocks > 0; --blocks, in += 16) {
+        uint64_t t0 = load64_le(in);
+        uint64_t t1 = load64_le(in + 8);
+        st->h[0] += t0 & M44;
+        st->h[1] += ((t0 >> 44) | (t1 << 20)) & M44;
+        st->h[2] += ((t1 >> 24) & M42) | (hibit << 40);
+        poly1305_mul(st->h, st->r);
+    }
+}
+
+// 44/44/42-bit limbs (value < 2^130 after a carry) to 26-bit limbs
+static inline void poly1305_to26(const uint64_t h[3], uint64_t v[5]) {
+    uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
+    uint64_t c = h1 >> 44;
+    h1 &= M44;
+    h2 += c;
+    v[0] = h0 & M26;
+    v[1] = ((h0 >> 26) | (h1 << 18)) & M26;
+    v[2] = (h1 >> 8) & M26;
+    v[3] = ((h1 >> 34) | (h2 << 10)) & M26;
+    v[4] = h2 >> 16;
+}
+
+static void poly1305_powers(poly1305_state *st) {
+    uint64_t p[3] = {st->r[0], st->r[1], st->r[2]};
+    for (int k = 0; k < 4; ++k) {
+        if (k > 0) {
+            poly1305_mul(p, st->r);
+        }
+        uint64_t v[5];
+        poly1305_to26(p, v);
+        for (int i = 0; i < 5; ++i) {
+            st->powers[k][i] = (uint32_t)v[i];
+        }
+    }
+    st->has_powers = 1;
+}
+
+#ifdef ENABLE_X86_CHACHA
+
+// 4 accumulators, one per 64-bit lane, 26-bit limbs:
+//     H_j = H_j * r^4 + m_(4i+j), then h = sum(H_j * r^(4-j))
+
+X86_AVX2 static inline void poly_avx2_mul(__m256i h[5], const __m256i r[5], const __m256i s[5]) {
+    __m256i d0, d1, d2, d3, d4;
+#define MUL(a, b) _mm256_mul_epu32(a, b)
+#define ADD(a, b) _mm256_add_epi64(a, b)
+    d0 = ADD(ADD(ADD(ADD(MUL(h[0], r[0]), MUL(h[1], s[4])), MUL(h[2], s[3])), MUL(h[3], s[2])), MUL(h[4], s[1]));
+    d1 = ADD(ADD(ADD(ADD(MUL(h[0], r[1]), MUL(h[1], r[0])), MUL(h[2], s[4])), MUL(h[3], s[3])), MUL(h[4], s[2]));
+    d2 = ADD(ADD(ADD(ADD(MUL(h[0], r[2]), MUL(h[1], r[1])), MUL(h[2], r[0])), MUL(h[3], s[4])), MUL(h[4], s[3]));
+    d3 = ADD(ADD(ADD(ADD(MUL(h[0], r[3]), MUL(h[1], r[2])), MUL(h[2], r[1])), MUL(h[3], r[0])), MUL(h[4], s[4]));
+    d4 = ADD(ADD(ADD(ADD(MUL(h[0], r[4]), MUL(h[1], r[3])), MUL(h[2], r[2])), MUL(h[3], r[1])), MUL(h[4], r[0]));
+    // carry
+    const __m256i mask = _mm256_set1_epi64x(M26);
+    __m256i c;
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+    c = _mm256_srli_epi64(d1, 26); d1 = _mm256_and_si256(d1, mask); d2 = ADD(d2, c);
+    c = _mm256_srli_epi64(d2, 26); d2 = _mm256_and_si256(d2, mask); d3 = ADD(d3, c);
+    c = _mm256_srli_epi64(d3, 26); d3 = _mm256_and_si256(d3, mask); d4 = ADD(d4, c);
+    c = _mm256_srli_epi64(d4, 26); d4 = _mm256_and_si256(d4, mask);
+    d0 = ADD(d0, ADD(c, _mm256_slli_epi64(c, 2)));
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+#undef MUL
+#undef ADD
+    h[0] = d0;
+    h[1] = d1;
+    h[2] = d2;
+    h[3] = d3;
+    h[4] = d4;
+}
+
+// 4 blocks as 26-bit limbs, lane j = block j
+X86_AVX2 static inline void poly_avx2_load(const uint8_t *in, __m256i m[5]) {
+    const __m256i mask = _mm256_set1_epi64x(M26);
+    __m256i a = _mm256_loadu_si256((const __m256i *)in);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(in + 32));
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+    m[0] = _mm256_and_si256(lo, mask);
+    m[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask);
+    m[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask);
+    m[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask);
+    m[4] = _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24));
+}
+
+// full blocks (hibit = 1), a multiple of 4
+X86_AVX2 static void poly1305_blocks_avx2(poly1305_state *st, const uint8_t *in, size_t blocks) {
+    if (!st->has_powers) {
+        poly1305_powers(st);
+    }
+    __m256i r4[5], s4[5], rf[5], sf[5], h[5], m[5];
+    const uint32_t (*p)[5] = st->powers;
+    for (int i = 0; i < 5; ++i) {
+        r4[i] = _mm256_set1_epi64x(p[3][i]);
+        s4[i] = _mm256_set1_epi64x((uint64_t)p[3][i] * 5);
+        rf[i] = _mm256_set_epi64x(p[0][i], p[1][i], p[2][i], p[3][i]);
+        sf[i] = _mm256_set_epi64x((uint64_t)p[0][i] * 5, (uint64_t)p[1][i] * 5,
+                                  (uint64_t)p[2][i] * 5, (uint64_t)p[3][i] * 5);
+    }
+    // the current h goes into the first block of lane 0
+    uint64_t v[5];
+    poly1305_to26(st->h, v);
+    poly_avx2_load(in, h);
+    for (int i = 0; i < 5; ++i) {
+        h[i] = _mm256_add_epi64(h[i], _mm256_set_epi64x(0, 0, 0, (long long)v[i]));
+    }
+    for (in += 64, blocks -= 4; blocks >= 4; in += 64, blocks -= 4) {
+        poly_avx2_mul(h, r4, s4);
+        poly_avx2_load(in, m);
+        for (int i = 0; i < 5; ++i) {
+            h[i] = _mm256_add_epi64(h[i], m[i]);
+        }
+    }
+    poly_avx2_mul(h, rf, sf);
+    // sum the lanes
+    uint64_t l[5];
+    for (int i = 0; i < 5; ++i) {
+        __m128i x = _mm_add_epi64(_mm256_castsi256_si128(h[i]), _mm256_extracti128_si256(h[i], 1));
+        l[i] = (uint64_t)_mm_cvtsi128_si64(x) + (uint64_t)_mm_extract_epi64(x, 1);
+    }
+    // back to 44/44/42-bit limbs
+    uint64_t h0 = l[0] + (l[1] << 26);
+    uint64_t c = h0 >> 44;
+    h0 &= M44;
+    uint64_t h1 = c + (l[2] << 8) + (l[3] << 34);
+    c = h1 >> 44;
+    h1 &= M44;
+    uint64_t h2 = c + (l[4] << 16);
+    c = h2 >> 42;
+    h2 &= M42;
+    h0 += c * 5;
+    c = h0 >> 44;
+    h0 &= M44;
+    h1 += c;
+    st->h[0] = h0;
+    st->h[1] = h1;
+    st->h[2] = h2;
+}
+
+#endif /* ENABLE_X86_CHACHA */
+
+static void poly1305_finish(poly1305_state *st, uint8_t tag[16]) {
+    uint64_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], c;
+    // fully carry h
+    c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c; c = h1 >> 44; h1 &= M44;
+    h2 += c; c = h2 >> 42; h2 &= M42;
+    h0 += c * 5; c = h0 >> 44; h0 &= M44;
+    h1 += c;
+    // g = h + -p
+    uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= M44;
+    uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= M44;
+    uint64_t g2 = h2 + c - (1ULL << 42);
+    // select h if h < p, or h + -p if h >= p
+    c = (g2 >> 63) - 1;
+    g0 &= c;
+    g1 &= c;
+    g2 &= c;
+    c = ~c;
+    h0 = (h0 & c) | g0;
+    h1 = (h1 & c) | g1;
+    h2 = (h2 & c) | g2;
+    // h = h + pad
+    uint64_t t0 = st->pad[0], t1 = st->pad[1];
+    h0 += t0 & M44; c = h0 >> 44; h0 &= M44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & M44) + c; c = h1 >> 44; h1 &= M44;
+    h2 += ((t1 >> 24) & M42) + c; h2 &= M42;
+    store64_le(tag, h0 | (h1 << 44));
+    store64_le(tag + 8, (h1 >> 20) | (h2 << 24));
+}
+
+#pragma mark Dispatch
+
+typedef void (*chacha_blocks_fn)(uint32_t s[16], const uint8_t *in, uint8_t *out, size_t blocks);
+typedef void (*poly_blocks_fn)(poly1305_state *st, const uint8_t *in, size_t blocks);
+
+struct ChaChaKernels {
+    const char *name;
+    chacha_blocks_fn blocks;
+    poly_blocks_fn poly4;  // 4-way Poly1305 (full blocks), NULL for none
+
+    ChaChaKernels() : name("portable+scalar"), blocks(chacha_blocks_portable), poly4(NULL) {
+#if defined(ENABLE_X86_CHACHA)
+#if defined(__x86_64__) || defined(__SSE2__)
+        name = "sse2+scalar";
+        blocks = chacha_blocks_sse2;
+#endif
+        if (dim_cpu_has_avx2()) {
+            name = "avx2+avx2";
+            blocks = chacha_blocks_avx2;
+            poly4 = poly1305_blocks_avx2;
+            if (dim_cpu_has_avx512()) {
+                name = "avx512+avx2";
+                blocks = chacha_blocks_avx512;
+            }
+        }
+#elif defined(ENABLE_ARM_CHACHA)
+        name = "neon+scalar";
+        blocks = chacha_blocks_neon;
+#endif
+    }
+};
+
+static inline const ChaChaKernels &kernels() {
+    static const ChaChaKernels k;
+    return k;
+}
+
+static void poly1305_update(const ChaChaKernels &k, poly1305_state *st, const uint8_t *in, size_t blocks) {
+    if (k.poly4 && blocks >= POLY1305_SIMD_MIN_BLOCKS) {
+        size_t n = blocks & ~(size_t)3;
+        k.poly4(st, in, n);
+        in += n * 16;
+        blocks -= n;
+    }
+    if (blocks > 0) {
+        poly1305_blocks_scalar(st, in, blocks, 1);
+    }
+}
+
+// data padded with zeros to 16 bytes (RFC 8439, section 2.8)
+static void poly1305_update_padded(const ChaChaKernels &k, poly1305_state *st, const uint8_t *in, size_t len) {
+    poly1305_update(k, st, in, len / 16);
+    if (len % 16) {
+        uint8_t block[16] = {0};
+        memcpy(block, in + len / 16 * 16, len % 16);
+        poly1305_blocks_scalar(st, block, 1, 1);
+        chacha_wipe(block, sizeof(block));
+    }
+}
+
+static void chacha20_stream(const ChaChaKernels &k, uint32_t s[16], const uint8_t *in, size_t len, uint8_t *out) {
+    if (len >= 64) {
+        k.blocks(s, in, out, len / 64);
+    }
+    if (len % 64) {
+        uint8_t block[64] = {0};
+        size_t done = len / 64 * 64;
+        memcpy(block, in + done, len % 64);
+        k.blocks(s, block, block, 1);
+        memcpy(out + done, block, len % 64);
+        chacha_wipe(block, sizeof(block));
+    }
+}
+
+#pragma mark API
+
+const char *chacha_implementation(void) {
+    return kernels().name;
+}
+
+void chacha20_xor(const uint8_t *key, const uint8_t *nonce, uint32_t counter,
+                  const uint8_t *in, size_t len, uint8_t *out) {
+    uint32_t s[16];
+    chacha_setup(s, key, nonce, counter);
+    chacha20_stream(kernels(), s, in, len, out);
+    chacha_wipe(s, sizeof(s));
+}
+
+void poly1305_mac(const uint8_t *key, const uint8_t *in, size_t len, uint8_t *tag) {
+    poly1305_state st;
+    poly1305_init(&st, key);
+    poly1305_update(kernels(), &st, in, len / 16);
+    if (len % 16) {
+        // the last block with a 1 byte appended, no high bit
+        uint8_t block[16] = {0};
+        memcpy(block, in + len / 16 * 16, len % 16);
+        block[len % 16] = 1;
+        poly1305_blocks_scalar(&st, block, 1, 0);
+    }
+    poly1305_finish(&st, tag);
+    chacha_wipe(&st, sizeof(st));
+}
+
+// returns the tag of the ciphertext (the input when decrypting)
+static void chacha20poly1305_crypt(const uint8_t *key, const uint8_t *nonce,
+                                   const uint8_t *aad, size_t aad_len,
+                                   const uint8_t *in, size_t len, uint8_t *out,
+                                   uint8_t tag[16], bool decrypt) {
+    const ChaChaKernels &k = kernels();
+    uint32_t s[16];
+    uint8_t block[64];
+    poly1305_state st;
+    // one-time Poly1305 key from block 0
+    chacha_setup(s, key, nonce, 0);
+    chacha_block(s, block);
+    poly1305_init(&st, block);
+    s[12] = 1;
+
+    if (aad_len > 0) {
+        poly1305_update_padded(k, &st, aad, aad_len);
+    }
+    size_t total = len;
+    while (len >= CHACHA_CHUNK_SIZE) {
+        if (decrypt) {
+            poly1305_update(k, &st, in, CHACHA_CHUNK_SIZE / 16);
+            k.blocks(s, in, out, CHACHA_CHUNK_SIZE / 64);
+        } else {
+            k.blocks(s, in, out, CHACHA_CHUNK_SIZE / 64);
+            poly1305_update(k, &st, out, CHACHA_CHUNK_SIZE / 16);
+        }
+        in += CHACHA_CHUNK_SIZE;
+        out += CHACHA_CHUNK_SIZE;
+        len -= CHACHA_CHUNK_SIZE;
+    }
+    if (len > 0) {
+        if (decrypt) {
+            poly1305_update_padded(k, &st, in, len);
+            chacha20_stream(k, s, in, len, out);
+        } else {
+            chacha20_stream(k, s, in, len, out);
+            poly1305_update_padded(k, &st, out, len);
+        }
+    }
+    // len(AAD) || len(ciphertext), 64-bit little-endian
+    store64_le(block, (uint64_t)aad_len);
+    store64_le(block + 8, (uint64_t)total);
+    poly1305_blocks_scalar(&st, block, 1, 1);
+    poly1305_finish(&st, tag);
+
+    chacha_wipe(s, sizeof(s));
+    chacha_wipe(block, sizeof(block));
+    chacha_wipe(&st, sizeof(st));
+}
+
+void chacha20poly1305_encrypt(const uint8_t *key, const uint8_t *nonce,
+                              const uint8_t *aad, size_t aad_len,
+                              const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag) {
+    chacha20poly1305_crypt(key, nonce, aad, aad_len, in, len, out, tag, false);
+}
+
+int chacha20poly1305_decrypt(const uint8_t *key, const uint8_t *nonce,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out) {
+    uint8_t expected[16];
+    chacha20poly1305_crypt(key, nonce, aad, aad_len, in, len, out, expected, true);
+    uint8_t diff = 0;
+    for (int i = 0; i < 16; ++i) {
+        diff |= expected[i] ^ tag[i];
+    }
+    if (diff != 0) {
+        chacha_wipe(out, len);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,71 @@
+//
+//  chacha.h
+//  DIMPlugins
+//
+//  ChaCha20-Poly1305 AEAD (RFC 8439): SSE2, AVX2, AVX-512 and NEON ChaCha20
+//  kernels selected at runtime, Poly1305 in 64-bit limbs with a 4-way AVX2
+//  path for long messages. Everything is constant-time.
+//
+//  Created by Albert Moky on 2024/4/8.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_CHACHA_H
+#define DIM_CHACHA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHACHA20_KEY_SIZE   32
+#define CHACHA20_NONCE_SIZE 12
+#define POLY1305_TAG_SIZE   16
+
+/**
+ *  ChaCha20 stream (RFC 8439, 32-bit block counter)
+ *
+ * @param key     - 32 bytes
+ * @param nonce   - 12 bytes
+ * @param counter - first block counter
+ * @param out     - len bytes (may be the same as input)
+ */
+void chacha20_xor(const uint8_t *key, const uint8_t *nonce, uint32_t counter,
+                  const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ *  Poly1305 one-time authenticator
+ *
+ * @param key - 32 bytes, never reuse it
+ * @param tag - 16 bytes
+ */
+void poly1305_mac(const uint8_t *key, const uint8_t *in, size_t len, uint8_t *tag);
+
+/**
+ *  ChaCha20-Poly1305 AEAD
+ *
+ * @param nonce - 12 bytes, must never repeat for the same key
+ * @param aad   - additional authenticated data (optional)
+ * @param out   - len bytes (may be the same as input)
+ * @param tag   - 16 bytes
+ * @return 1 on success; 0 when the tag mismatched, the output is erased
+ */
+void chacha20poly1305_encrypt(const uint8_t *key, const uint8_t *nonce,
+                              const uint8_t *aad, size_t aad_len,
+                              const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag);
+int chacha20poly1305_decrypt(const uint8_t *key, const uint8_t *nonce,
+                             const uint8_t *aad, size_t aad_len,
+                             const uint8_t *in, size_t len, const uint8_t *tag, uint8_t *out);
+
+/**
+ *  Name of the kernels in use, e.g. "avx2+avx2", "neon+scalar"
+ */
+const char *chacha_implementation(void);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_CHACHA_H */
@@ -0,0 +1,127 @@
+//
+//  cpu.h
+//  DIMPlugins
+//
+//  Runtime CPU feature detection for the SIMD kernels.
+//
+//  Baseline features (SSE2 on x86_64, NEON on arm64) are checked at compile
+//  time with the compiler macros; only the optional extensions need the
+//  runtime check here. Results are cached by the callers (function pointers
+//  resolved once).
+//
+//  Created by Albert Moky on 2024/3/25.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_CPU_H
+#define DIM_CPU_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DIM_CPU_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define DIM_CPU_ARM 1
+#endif
+
+#ifdef DIM_CPU_X86
+
+#include <cpuid.h>
+#include <stdint.h>
+
+// OS saves the AVX (YMM) / AVX-512 (ZMM, opmask) registers
+static inline uint64_t dim_cpu_xgetbv(void) {
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static inline int dim_cpu_has_osxsave(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return 0;
+    }
+    return (c & bit_OSXSAVE) != 0;
+}
+
+static inline int dim_cpu_has_avx2(void) {
+    unsigned int a, b, c, d;
+    if (!dim_cpu_has_osxsave() || (dim_cpu_xgetbv() & 0x06) != 0x06) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return 0;
+    }
+    return (b & bit_AVX2) != 0;
+}
+
+static inline int dim_cpu_has_avx512(void) {
+    // AVX-512 F + BW + VL
+    unsigned int a, b, c, d;
+    if (!dim_cpu_has_osxsave() || (dim_cpu_xgetbv() & 0xE6) != 0xE6) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return 0;
+    }
+    const unsigned int mask = (1u << 16) | (1u << 30) | (1u << 31);
+    return (b & mask) == mask;
+}
+
+static inline int dim_cpu_has_ssse3(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return 0;
+    }
+    return (c & bit_SSSE3) != 0;
+}
+
+static inline int dim_cpu_has_sse41(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return 0;
+    }
+    return (c & bit_SSE4_1) != 0;
+}
+
+static inline int dim_cpu_has_sha(void) {
+    unsigned int a, b, c, d;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return 0;
+    }
+    return (b & (1u << 29)) != 0;
+}
+
+static inline int dim_cpu_has_bmi2_adx(void) {
+    // MULX (BMI2) + ADCX/ADOX (ADX)
+    unsigned int a, b, c, d;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return 0;
+    }
+    const unsigned int mask = (1u << 8) | (1u << 19);
+    return (b & mask) == mask;
+}
+
+static inline int dim_cpu_has_aes_clmul(void) {
+    // AES-NI + PCLMULQDQ
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return 0;
+    }
+    const unsigned int mask = bit_AES | bit_PCLMUL;
+    return (c & mask) == mask;
+}
+
+static inline int dim_cpu_has_vaes_clmul(void) {
+    // VAES + VPCLMULQDQ on 256-bit registers
+    unsigned int a, b, c, d;
+    if (!dim_cpu_has_avx2() || !__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return 0;
+    }
+    const unsigned int mask = (1u << 9) | (1u << 10);
+    return (c & mask) == mask;
+}
+
+#endif /* DIM_CPU_X86 */
+
+#endif /* DIM_CPU_H */
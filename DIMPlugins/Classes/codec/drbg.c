@@ -0,0 +1,141 @@
+//
+//  drbg.c
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/3/30.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "drbg.h"
+#include "chacha.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__APPLE__) || defined(__linux__)
+#include <sys/random.h>
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+#define DRBG_BLOCKS      16                      // ChaCha20 blocks per refill
+#define DRBG_STREAM_SIZE (DRBG_BLOCKS * 64)
+#define DRBG_BUFFER_SIZE (DRBG_STREAM_SIZE - 32) // the first 32 bytes rekey
+
+struct drbg_state {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    uint8_t buffer[DRBG_STREAM_SIZE];
+    size_t available;          // unread bytes at the end of buffer
+    size_t output;             // bytes since seeding
+    unsigned long generation;  // fork generation when seeded
+    int seeded;
+};
+
+static __thread struct drbg_state tls_state;
+
+static volatile unsigned long g_fork_generation = 0;
+static pthread_once_t g_atfork_once = PTHREAD_ONCE_INIT;
+
+static void drbg_after_fork(void) {
+    // only the forking thread survives in the child, its state is a copy
+    // of the parent's, so make it reseed before the next output
+    ++g_fork_generation;
+}
+
+static void drbg_register_atfork(void) {
+    pthread_atfork(NULL, NULL, drbg_after_fork);
+}
+
+static void drbg_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+#pragma mark DRBG
+
+static int drbg_entropy(uint8_t *buf, size_t len) {
+#if defined(__APPLE__) || defined(__linux__)
+    // getrandom() on Linux, no file descriptor needed
+    if (getentropy(buf, len) == 0) {
+        return 1;
+    }
+#endif
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0) {
+            close(fd);
+            return 0;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    close(fd);
+    return 1;
+}
+
+static int drbg_seed(struct drbg_state *st) {
+    uint8_t seed[CHACHA20_KEY_SIZE];
+    int i;
+    if (!drbg_entropy(seed, sizeof(seed))) {
+        return 0;
+    }
+    // mix into the current key, never weaker than before
+    for (i = 0; i < CHACHA20_KEY_SIZE; ++i) {
+        st->key[i] ^= seed[i];
+    }
+    drbg_wipe(seed, sizeof(seed));
+    // drop the buffered output (may be shared with the parent process)
+    drbg_wipe(st->buffer, sizeof(st->buffer));
+    st->available = 0;
+    st->output = 0;
+    st->generation = g_fork_generation;
+    st->seeded = 1;
+    return 1;
+}
+
+static void drbg_refill(struct drbg_state *st) {
+    static const uint8_t nonce[CHACHA20_NONCE_SIZE] = {0};
+    // keystream of the current key (every refill uses a new key, so the
+    // nonce stays zero); fast key erasure: the first 32 bytes replace the
+    // key, so the output before it cannot be recovered from the state
+    memset(st->buffer, 0, sizeof(st->buffer));
+    chacha20_xor(st->key, nonce, 0, st->buffer, sizeof(st->buffer), st->buffer);
+    memcpy(st->key, st->buffer, CHACHA20_KEY_SIZE);
+    drbg_wipe(st->buffer, CHACHA20_KEY_SIZE);
+    st->available = DRBG_BUFFER_SIZE;
+}
+
+int drbg_random_bytes(uint8_t *buf, size_t len) {
+    struct drbg_state *st = &tls_state;
+    uint8_t *src;
+    size_t n;
+    pthread_once(&g_atfork_once, drbg_register_atfork);
+    if (!st->seeded || st->generation != g_fork_generation || st->output >= DRBG_RESEED_BYTES) {
+        if (!drbg_seed(st)) {
+            return 0;
+        }
+    }
+    while (len > 0) {
+        if (st->available == 0) {
+            drbg_refill(st);
+        }
+        n = len < st->available ? len : st->available;
+        src = st->buffer + (DRBG_STREAM_SIZE - st->available);
+        memcpy(buf, src, n);
+        drbg_wipe(src, n);
+        st->available -= n;
+        st->output += n;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
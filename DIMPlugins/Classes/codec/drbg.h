@@ -0,0 +1,38 @@
+//
+//  drbg.h
+//  DIMPlugins
+//
+//  Per-thread ChaCha20 DRBG: seeded from the system entropy source,
+//  fast key erasure on every refill, reseeded after fork() and after
+//  every DRBG_RESEED_BYTES of output.
+//
+//  Created by Albert Moky on 2024/3/30.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_DRBG_H
+#define DIM_DRBG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DRBG_RESEED_BYTES (1 << 20)
+
+/**
+ *  Fill buffer with random bytes
+ *
+ * @param buf - output buffer
+ * @param len - number of bytes
+ * @return 1 on success, 0 when the system entropy source failed
+ */
+int drbg_random_bytes(uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_DRBG_H */
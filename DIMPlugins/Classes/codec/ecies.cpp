@@ -0,0 +1,97 @@
+//
+//  ecies.cpp
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/12.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "ecies.h"
+#include "chacha.h"
+#include "sha256.h"
+
+#include <string.h>
+
+static inline void ecies_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    for (size_t i = 0; i < len; ++i) {
+        p[i] = 0;
+    }
+}
+
+#pragma mark - Key Derivation
+
+// ANSI X9.63 KDF, one block: SHA-256(Z || counter || shared info)
+static void ecies_kdf(ecies_key *ctx, const uint8_t *z, const uint8_t *rpk) {
+    static const uint8_t counter[4] = {0, 0, 0, 1};
+    CSHA256 sha;
+    sha.Write(z, 32);
+    sha.Write(counter, sizeof(counter));
+    sha.Write(ctx->epk, ECIES_POINT_SIZE);
+    sha.Write(rpk, ECIES_POINT_SIZE);
+    sha.Finalize(ctx->key);
+    ecies_wipe(&sha, sizeof(sha));
+}
+
+int ecies_sender_init(ecies_key *ctx, const uint8_t *peer, uECC_Curve curve) {
+    if (uECC_curve_private_key_size(curve) != 32 || !uECC_valid_public_key(peer, curve)) {
+        return 0;
+    }
+    uint8_t secret[32], pub[64], z[32], rpk[ECIES_POINT_SIZE];
+    int ok = uECC_make_key(pub, secret, curve) &&
+             uECC_shared_secret(peer, secret, z, curve);
+    if (ok) {
+        uECC_compress(pub, ctx->epk, curve);
+        uECC_compress(peer, rpk, curve);
+        ecies_kdf(ctx, z, rpk);
+    }
+    ecies_wipe(secret, sizeof(secret));
+    ecies_wipe(z, sizeof(z));
+    return ok;
+}
+
+int ecies_receiver_init(ecies_key *ctx, const uint8_t *secret, const uint8_t *pub,
+                        const uint8_t *epk, uECC_Curve curve) {
+    if (uECC_curve_private_key_size(curve) != 32 || (epk[0] != 0x02 && epk[0] != 0x03)) {
+        return 0;
+    }
+    // decompress does not check the point, an x without y gives a point off the curve
+    uint8_t point[64], z[32], rpk[ECIES_POINT_SIZE];
+    uECC_decompress(epk, point, curve);
+    if (!uECC_valid_public_key(point, curve)) {
+        return 0;
+    }
+    memcpy(ctx->epk, epk, ECIES_POINT_SIZE);
+    int ok = uECC_shared_secret(point, secret, z, curve);
+    if (ok) {
+        uECC_compress(pub, rpk, curve);
+        ecies_kdf(ctx, z, rpk);
+    }
+    ecies_wipe(z, sizeof(z));
+    return ok;
+}
+
+void ecies_key_wipe(ecies_key *ctx) {
+    ecies_wipe(ctx, sizeof(ecies_key));
+}
+
+#pragma mark - Seal / Open
+
+void ecies_seal(const ecies_key *ctx, const uint8_t *nonce,
+                const uint8_t *in, size_t len, uint8_t *out) {
+    memcpy(out, ctx->epk, ECIES_POINT_SIZE);
+    out += ECIES_POINT_SIZE;
+    memcpy(out, nonce, ECIES_NONCE_SIZE);
+    out += ECIES_NONCE_SIZE;
+    chacha20poly1305_encrypt(ctx->key, nonce, NULL, 0, in, len, out, out + len);
+}
+
+int ecies_open(const ecies_key *ctx, const uint8_t *in, size_t len, uint8_t *out) {
+    if (len < ECIES_OVERHEAD || memcmp(in, ctx->epk, ECIES_POINT_SIZE) != 0) {
+        return 0;
+    }
+    const uint8_t *nonce = in + ECIES_POINT_SIZE;
+    const uint8_t *body = nonce + ECIES_NONCE_SIZE;
+    len -= ECIES_OVERHEAD;
+    return chacha20poly1305_decrypt(ctx->key, nonce, NULL, 0, body, len, body + len, out);
+}
@@ -0,0 +1,91 @@
+//
+//  ecies.h
+//  DIMPlugins
+//
+//  ECIES over the uECC curves: ECDH shared secret, ANSI X9.63 KDF with
+//  SHA-256 and ChaCha20-Poly1305. The derived key is kept in a context,
+//  so a sender (or receiver) can seal (or open) many messages with one
+//  ephemeral key pair without computing the shared secret again.
+//
+//  Created by Albert Moky on 2024/4/12.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_ECIES_H
+#define DIM_ECIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "uECC.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// compressed point, for 256-bit curves
+#define ECIES_POINT_SIZE 33
+#define ECIES_NONCE_SIZE 12
+#define ECIES_TAG_SIZE   16
+
+// ephemeral public key (33 bytes) + nonce (12 bytes) + ciphertext + tag (16 bytes)
+#define ECIES_OVERHEAD (ECIES_POINT_SIZE + ECIES_NONCE_SIZE + ECIES_TAG_SIZE)
+
+/**
+ *  Derived key between one ephemeral key pair and one receiver key
+ *
+ *      Z   = ECDH(ephemeral, receiver).x
+ *      key = SHA-256(Z || 00000001 || epk || rpk)
+ */
+typedef struct ecies_key {
+    uint8_t epk[ECIES_POINT_SIZE];  // compressed ephemeral public key
+    uint8_t key[32];                // ChaCha20-Poly1305 key
+} ecies_key;
+
+/**
+ *  Sender: generate an ephemeral key pair (with the uECC RNG) for the peer
+ *
+ * @param peer - receiver's public key, uncompressed without prefix (64 bytes)
+ * @return 0 on invalid peer key or RNG failure
+ */
+int ecies_sender_init(ecies_key *ctx, const uint8_t *peer, uECC_Curve curve);
+
+/**
+ *  Receiver: derive the key for an ephemeral public key
+ *
+ * @param secret - receiver's private key (32 bytes)
+ * @param pub    - receiver's public key, uncompressed without prefix (64 bytes)
+ * @param epk    - compressed ephemeral public key from the message (33 bytes)
+ * @return 0 on invalid ephemeral key
+ */
+int ecies_receiver_init(ecies_key *ctx, const uint8_t *secret, const uint8_t *pub,
+                        const uint8_t *epk, uECC_Curve curve);
+
+/**
+ *  Erase context
+ */
+void ecies_key_wipe(ecies_key *ctx);
+
+/**
+ *  Encrypt: out = epk || nonce || ChaCha20-Poly1305(key, nonce, in)
+ *
+ * @param nonce - 12 random bytes, must never repeat for the same context
+ * @param out   - len + ECIES_OVERHEAD bytes
+ */
+void ecies_seal(const ecies_key *ctx, const uint8_t *nonce,
+                const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ *  Decrypt message sealed with the same ephemeral key (ctx->epk)
+ *
+ * @param len - sealed length (at least ECIES_OVERHEAD)
+ * @param out - len - ECIES_OVERHEAD bytes
+ * @return 1 on success; 0 on wrong key or modified data
+ */
+int ecies_open(const ecies_key *ctx, const uint8_t *in, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_ECIES_H */
@@ -0,0 +1,1216 @@
+//
+//  ed25519.cpp
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "ed25519.h"
+#include "chacha.h"
+#include "drbg.h"
+
+#include <string.h>
+
+#include <vector>
+
+#ifndef __SIZEOF_INT128__
+#error "radix 2^51 arithmetic needs a 64-bit target (unsigned __int128)"
+#endif
+
+// signatures per random linear combination
+#define ED25519_BATCH_SIZE 64
+
+typedef unsigned __int128 uint128_t;
+
+static inline uint64_t load64_le(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline void store64_le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void ed25519_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+#pragma mark SHA-512
+
+struct sha512_ctx {
+    uint64_t h[8];
+    uint8_t buf[128];
+    size_t fill;
+    uint64_t total;
+};
+
+static const uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+#define ROTR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+static void sha512_compress(uint64_t h[8], const uint8_t *block) {
+    uint64_t w[80];
+    for (int t = 0; t < 16; ++t) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) {
+            v = (v << 8) | block[8 * t + i];
+        }
+        w[t] = v;
+    }
+    for (int t = 16; t < 80; ++t) {
+        uint64_t s0 = ROTR64(w[t - 15], 1) ^ ROTR64(w[t - 15], 8) ^ (w[t - 15] >> 7);
+        uint64_t s1 = ROTR64(w[t - 2], 19) ^ ROTR64(w[t - 2], 61) ^ (w[t - 2] >> 6);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    uint64_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int t = 0; t < 80; ++t) {
+        uint64_t S1 = ROTR64(e, 14) ^ ROTR64(e, 18) ^ ROTR64(e, 41);
+        uint64_t ch = (e & f) ^ (~e & g);
+        uint64_t t1 = k + S1 + ch + SHA512_K[t] + w[t];
+        uint64_t S0 = ROTR64(a, 28) ^ ROTR64(a, 34) ^ ROTR64(a, 39);
+        uint64_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint64_t t2 = S0 + maj;
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+static void sha512_init(sha512_ctx *ctx) {
+    static const uint64_t iv[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+    };
+    memcpy(ctx->h, iv, sizeof(iv));
+    ctx->fill = 0;
+    ctx->total = 0;
+}
+
+static void sha512_update(sha512_ctx *ctx, const uint8_t *data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    ctx->total += len;
+    if (ctx->fill > 0) {
+        size_t n = 128 - ctx->fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->buf + ctx->fill, data, n);
+        ctx->fill += n;
+        data += n;
+        len -= n;
+        if (ctx->fill < 128) {
+            return;
+        }
+        sha512_compress(ctx->h, ctx->buf);
+        ctx->fill = 0;
+    }
+    for (; len >= 128; data += 128, len -= 128) {
+        sha512_compress(ctx->h, data);
+    }
+    memcpy(ctx->buf, data, len);
+    ctx->fill = len;
+}
+
+static void sha512_final(sha512_ctx *ctx, uint8_t out[64]) {
+    uint64_t bits = ctx->total * 8;
+    ctx->buf[ctx->fill++] = 0x80;
+    if (ctx->fill > 112) {
+        memset(ctx->buf + ctx->fill, 0, 128 - ctx->fill);
+        sha512_compress(ctx->h, ctx->buf);
+        ctx->fill = 0;
+    }
+    memset(ctx->buf + ctx->fill, 0, 120 - ctx->fill);
+    for (int i = 0; i < 8; ++i) {
+        ctx->buf[120 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha512_compress(ctx->h, ctx->buf);
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            out[8 * i + j] = (uint8_t)(ctx->h[i] >> (56 - 8 * j));
+        }
+    }
+    ed25519_wipe(ctx, sizeof(sha512_ctx));
+}
+
+#pragma mark Field (2^255 - 19)
+
+// 5 limbs of 51 bits; mul/sq/carry outputs are below 2^52,
+// add outputs (two of those) stay below 2^53 and may feed mul/sub
+typedef uint64_t fe[5];
+
+#define MASK51 0x7FFFFFFFFFFFFULL
+
+static const fe FE_D = {
+    0x34dca135978a3ULL, 0x1a8283b156ebdULL, 0x5e7a26001c029ULL, 0x739c663a03cbbULL, 0x52036cee2b6ffULL,
+};
+static const fe FE_D2 = {
+    0x69b9426b2f159ULL, 0x35050762add7aULL, 0x3cf44c0038052ULL, 0x6738cc7407977ULL, 0x2406d9dc56dffULL,
+};
+static const fe FE_SQRTM1 = {
+    0x61b274a0ea0b0ULL, 0x0d5a5fc8f189dULL, 0x7ef5e9cbd0c60ULL, 0x78595a6804c9eULL, 0x2b8324804fc1dULL,
+};
+
+static inline void fe_0(fe h) {
+    h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static inline void fe_1(fe h) {
+    h[0] = 1;
+    h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static inline void fe_copy(fe h, const fe f) {
+    memcpy(h, f, sizeof(fe));
+}
+
+static inline void fe_carry(fe h) {
+    uint64_t c;
+    c = h[0] >> 51; h[0] &= MASK51; h[1] += c;
+    c = h[1] >> 51; h[1] &= MASK51; h[2] += c;
+    c = h[2] >> 51; h[2] &= MASK51; h[3] += c;
+    c = h[3] >> 51; h[3] &= MASK51; h[4] += c;
+    c = h[4] >> 51; h[4] &= MASK51; h[0] += c * 19;
+}
+
+static inline void fe_add(fe h, const fe f, const fe g) {
+    for (int i = 0; i < 5; ++i) {
+        h[i] = f[i] + g[i];
+    }
+}
+
+// h = f + 4p - g
+static inline void fe_sub(fe h, const fe f, const fe g) {
+    h[0] = f[0] + 0x1FFFFFFFFFFFB4ULL - g[0];
+    h[1] = f[1] + 0x1FFFFFFFFFFFFCULL - g[1];
+    h[2] = f[2] + 0x1FFFFFFFFFFFFCULL - g[2];
+    h[3] = f[3] + 0x1FFFFFFFFFFFFCULL - g[3];
+    h[4] = f[4] + 0x1FFFFFFFFFFFFCULL - g[4];
+    fe_carry(h);
+}
+
+static inline void fe_neg(fe h, const fe f) {
+    fe zero;
+    fe_0(zero);
+    fe_sub(h, zero, f);
+}
+
+static inline void fe_reduce(fe h, uint128_t r0, uint128_t r1, uint128_t r2, uint128_t r3, uint128_t r4) {
+    r1 += (uint64_t)(r0 >> 51);
+    r2 += (uint64_t)(r1 >> 51);
+    r3 += (uint64_t)(r2 >> 51);
+    r4 += (uint64_t)(r3 >> 51);
+    uint128_t t = (uint128_t)(uint64_t)(r4 >> 51) * 19 + ((uint64_t)r0 & MASK51);
+    h[0] = (uint64_t)t & MASK51;
+    h[1] = ((uint64_t)r1 & MASK51) + (uint64_t)(t >> 51);
+    h[2] = (uint64_t)r2 & MASK51;
+    h[3] = (uint64_t)r3 & MASK51;
+    h[4] = (uint64_t)r4 & MASK51;
+}
+
+static inline void fe_mul(fe h, const fe f, const fe g) {
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+    uint128_t r0 = (uint128_t)f0 * g0 + (uint128_t)f1 * g4_19 + (uint128_t)f2 * g3_19 + (uint128_t)f3 * g2_19 + (uint128_t)f4 * g1_19;
+    uint128_t r1 = (uint128_t)f0 * g1 + (uint128_t)f1 * g0 + (uint128_t)f2 * g4_19 + (uint128_t)f3 * g3_19 + (uint128_t)f4 * g2_19;
+    uint128_t r2 = (uint128_t)f0 * g2 + (uint128_t)f1 * g1 + (uint128_t)f2 * g0 + (uint128_t)f3 * g4_19 + (uint128_t)f4 * g3_19;
+    uint128_t r3 = (uint128_t)f0 * g3 + (uint128_t)f1 * g2 + (uint128_t)f2 * g1 + (uint128_t)f3 * g0 + (uint128_t)f4 * g4_19;
+    uint128_t r4 = (uint128_t)f0 * g4 + (uint128_t)f1 * g3 + (uint128_t)f2 * g2 + (uint128_t)f3 * g1 + (uint128_t)f4 * g0;
+    fe_reduce(h, r0, r1, r2, r3, r4);
+}
+
+static inline void fe_sq(fe h, const fe f) {
+    uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint64_t d0 = 2 * f0, d1 = 2 * f1, d2 = 2 * f2, d3 = 2 * f3;
+    uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+    uint128_t r0 = (uint128_t)f0 * f0 + (uint128_t)d1 * f4_19 + (uint128_t)d2 * f3_19;
+    uint128_t r1 = (uint128_t)d0 * f1 + (uint128_t)d2 * f4_19 + (uint128_t)f3 * f3_19;
+    uint128_t r2 = (uint128_t)d0 * f2 + (uint128_t)f1 * f1 + (uint128_t)d3 * f4_19;
+    uint128_t r3 = (uint128_t)d0 * f3 + (uint128_t)d1 * f2 + (uint128_t)f4 * f4_19;
+    uint128_t r4 = (uint128_t)d0 * f4 + (uint128_t)d1 * f3 + (uint128_t)f2 * f2;
+    fe_reduce(h, r0, r1, r2, r3, r4);
+}
+
+static inline void fe_sqn(fe h, const fe f, int n) {
+    fe_sq(h, f);
+    while (--n > 0) {
+        fe_sq(h, h);
+    }
+}
+
+static inline void fe_mul_small(fe h, const fe f, uint32_t n) {
+    fe_reduce(h, (uint128_t)f[0] * n, (uint128_t)f[1] * n, (uint128_t)f[2] * n,
+              (uint128_t)f[3] * n, (uint128_t)f[4] * n);
+}
+
+// z^(2^250 - 1), and z^11 for the inversion
+static void fe_pow250(fe out, fe z11, const fe z) {
+    fe t, z9, a, b;
+    fe_sq(t, z);               // 2
+    fe_sqn(a, t, 2);           // 8
+    fe_mul(z9, a, z);          // 9
+    fe_mul(z11, z9, t);        // 11
+    fe_sq(a, z11);             // 22
+    fe_mul(a, a, z9);          // 2^5 - 1
+    fe_sqn(b, a, 5);
+    fe_mul(b, b, a);           // 2^10 - 1
+    fe_sqn(t, b, 10);
+    fe_mul(t, t, b);           // 2^20 - 1
+    fe_sqn(a, t, 20);
+    fe_mul(a, a, t);           // 2^40 - 1
+    fe_sqn(a, a, 10);
+    fe_mul(a, a, b);           // 2^50 - 1
+    fe_sqn(b, a, 50);
+    fe_mul(b, b, a);           // 2^100 - 1
+    fe_sqn(t, b, 100);
+    fe_mul(t, t, b);           // 2^200 - 1
+    fe_sqn(t, t, 50);
+    fe_mul(out, t, a);         // 2^250 - 1
+}
+
+// z^(p - 2)
+static void fe_invert(fe out, const fe z) {
+    fe t, z11;
+    fe_pow250(t, z11, z);
+    fe_sqn(t, t, 5);
+    fe_mul(out, t, z11);       // 2^255 - 21
+}
+
+// z^((p - 5) / 8)
+static void fe_pow22523(fe out, const fe z) {
+    fe t, z11;
+    fe_pow250(t, z11, z);
+    fe_sqn(t, t, 2);
+    fe_mul(out, t, z);         // 2^252 - 3
+}
+
+static void fe_tobytes(uint8_t s[32], const fe f) {
+    fe t;
+    fe_copy(t, f);
+    fe_carry(t);
+    fe_carry(t);
+    // t < 2p: subtract p when t + 19 overflows 2^255
+    uint64_t q = (t[0] + 19) >> 51;
+    q = (t[1] + q) >> 51;
+    q = (t[2] + q) >> 51;
+    q = (t[3] + q) >> 51;
+    q = (t[4] + q) >> 51;
+    t[0] += 19 * q;
+    t[1] += t[0] >> 51; t[0] &= MASK51;
+    t[2] += t[1] >> 51; t[1] &= MASK51;
+    t[3] += t[2] >> 51; t[2] &= MASK51;
+    t[4] += t[3] >> 51; t[3] &= MASK51;
+    t[4] &= MASK51;
+    store64_le(s, t[0] | (t[1] << 51));
+    store64_le(s + 8, (t[1] >> 13) | (t[2] << 38));
+    store64_le(s + 16, (t[2] >> 26) | (t[3] << 25));
+    store64_le(s + 24, (t[3] >> 39) | (t[4] << 12));
+}
+
+// the top bit is ignored
+static void fe_frombytes(fe h, const uint8_t s[32]) {
+    h[0] = load64_le(s) & MASK51;
+    h[1] = (load64_le(s + 6) >> 3) & MASK51;
+    h[2] = (load64_le(s + 12) >> 6) & MASK51;
+    h[3] = (load64_le(s + 19) >> 1) & MASK51;
+    h[4] = (load64_le(s + 24) >> 12) & MASK51;
+}
+
+static int fe_isnegative(const fe f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    return s[0] & 1;
+}
+
+static int fe_iszero(const fe f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    uint8_t d = 0;
+    for (int i = 0; i < 32; ++i) {
+        d |= s[i];
+    }
+    return d == 0;
+}
+
+// f = g when b == 1, b must be 0 or 1
+static inline void fe_cmov(fe f, const fe g, uint64_t b) {
+    uint64_t mask = 0 - b;
+    for (int i = 0; i < 5; ++i) {
+        f[i] ^= mask & (f[i] ^ g[i]);
+    }
+}
+
+static inline void fe_cswap(fe f, fe g, uint64_t b) {
+    uint64_t mask = 0 - b;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+#pragma mark Scalars (mod L)
+
+// L = 2^252 + 27742317777372353535851937790883648493
+static const int64_t SC_L[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10,
+};
+
+// r = x mod L, x in signed radix 2^8 (64 limbs)
+static void sc_reduce_limbs(uint8_t r[32], int64_t x[64]) {
+    int64_t carry;
+    int i, j;
+    for (i = 63; i >= 32; --i) {
+        carry = 0;
+        for (j = i - 32; j < i - 12; ++j) {
+            x[j] += carry - 16 * x[i] * SC_L[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for (j = 0; j < 32; ++j) {
+        x[j] += carry - (x[31] >> 4) * SC_L[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (j = 0; j < 32; ++j) {
+        x[j] -= carry * SC_L[j];
+    }
+    for (i = 0; i < 32; ++i) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = (uint8_t)(x[i] & 255);
+    }
+}
+
+static void sc_reduce(uint8_t r[32], const uint8_t s[64]) {
+    int64_t x[64];
+    for (int i = 0; i < 64; ++i) {
+        x[i] = s[i];
+    }
+    sc_reduce_limbs(r, x);
+    ed25519_wipe(x, sizeof(x));
+}
+
+// r = a * b + c (mod L)
+static void sc_muladd(uint8_t r[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]) {
+    int64_t x[64] = {0};
+    for (int i = 0; i < 32; ++i) {
+        x[i] = c[i];
+    }
+    for (int i = 0; i < 32; ++i) {
+        for (int j = 0; j < 32; ++j) {
+            x[i + j] += (int64_t)a[i] * b[j];
+        }
+    }
+    sc_reduce_limbs(r, x);
+    ed25519_wipe(x, sizeof(x));
+}
+
+// s < L (public data)
+static int sc_is_canonical(const uint8_t s[32]) {
+    for (int i = 31; i >= 0; --i) {
+        if (s[i] != SC_L[i]) {
+            return s[i] < SC_L[i];
+        }
+    }
+    return 0;
+}
+
+// width-w NAF: odd digits in (-2^(w-1), 2^(w-1)), variable-time
+static void sc_slide(int8_t r[256], const uint8_t a[32], int w) {
+    const int limit = (1 << (w - 1)) - 1;
+    for (int i = 0; i < 256; ++i) {
+        r[i] = 1 & (a[i >> 3] >> (i & 7));
+    }
+    for (int i = 0; i < 256; ++i) {
+        if (!r[i]) {
+            continue;
+        }
+        for (int b = 1; b <= w + 1 && i + b < 256; ++b) {
+            if (!r[i + b]) {
+                continue;
+            }
+            int v = r[i + b] * (1 << b);
+            if (r[i] + v <= limit) {
+                r[i] += v;
+                r[i + b] = 0;
+            } else if (r[i] - v >= -limit) {
+                r[i] -= v;
+                for (int k = i + b; k < 256; ++k) {
+                    if (!r[k]) {
+                        r[k] = 1;
+                        break;
+                    }
+                    r[k] = 0;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+#pragma mark Group (twisted Edwards, a = -1)
+
+struct ge_p2 {       // (X : Y : Z)
+    fe X, Y, Z;
+};
+
+struct ge_p3 {       // extended (X : Y : Z : T), XY = ZT
+    fe X, Y, Z, T;
+};
+
+struct ge_p1p1 {     // completed ((X : Z), (Y : T))
+    fe X, Y, Z, T;
+};
+
+struct ge_cached {
+    fe YplusX, YminusX, Z, T2d;
+};
+
+struct ge_precomp {  // affine, Z = 1
+    fe yplusx, yminusx, xy2d;
+};
+
+static const ge_p3 GE_BASE = {
+    {0x62d608f25d51aULL, 0x412a4b4f6592aULL, 0x75b7171a4b31dULL, 0x1ff60527118feULL, 0x216936d3cd6e5ULL},
+    {0x6666666666658ULL, 0x4ccccccccccccULL, 0x1999999999999ULL, 0x3333333333333ULL, 0x6666666666666ULL},
+    {1, 0, 0, 0, 0},
+    {0x68ab3a5b7dda3ULL, 0x00eea2a5eadbbULL, 0x2af8df483c27eULL, 0x332b375274732ULL, 0x67875f0fd78b7ULL},
+};
+
+static void ge_p3_0(ge_p3 *h) {
+    fe_0(h->X);
+    fe_1(h->Y);
+    fe_1(h->Z);
+    fe_0(h->T);
+}
+
+static void ge_precomp_0(ge_precomp *h) {
+    fe_1(h->yplusx);
+    fe_1(h->yminusx);
+    fe_0(h->xy2d);
+}
+
+static inline void ge_p1p1_to_p2(ge_p2 *r, const ge_p1p1 *p) {
+    fe_mul(r->X, p->X, p->T);
+    fe_mul(r->Y, p->Y, p->Z);
+    fe_mul(r->Z, p->Z, p->T);
+}
+
+static inline void ge_p1p1_to_p3(ge_p3 *r, const ge_p1p1 *p) {
+    fe_mul(r->X, p->X, p->T);
+    fe_mul(r->Y, p->Y, p->Z);
+    fe_mul(r->Z, p->Z, p->T);
+    fe_mul(r->T, p->X, p->Y);
+}
+
+static inline void ge_p3_to_p2(ge_p2 *r, const ge_p3 *p) {
+    fe_copy(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
+}
+
+static inline void ge_p3_to_cached(ge_cached *r, const ge_p3 *p) {
+    fe_add(r->YplusX, p->Y, p->X);
+    fe_sub(r->YminusX, p->Y, p->X);
+    fe_copy(r->Z, p->Z);
+    fe_mul(r->T2d, p->T, FE_D2);
+}
+
+static inline void ge_p2_dbl(ge_p1p1 *r, const ge_p2 *p) {
+    fe t0;
+    fe_sq(r->X, p->X);
+    fe_sq(r->Z, p->Y);
+    fe_sq(r->T, p->Z);
+    fe_add(r->T, r->T, r->T);
+    fe_add(r->Y, p->X, p->Y);
+    fe_sq(t0, r->Y);
+    fe_add(r->Y, r->Z, r->X);
+    fe_sub(r->Z, r->Z, r->X);
+    fe_sub(r->X, t0, r->Y);
+    fe_sub(r->T, r->T, r->Z);
+}
+
+static inline void ge_p3_dbl(ge_p1p1 *r, const ge_p3 *p) {
+    ge_p2 q;
+    ge_p3_to_p2(&q, p);
+    ge_p2_dbl(r, &q);
+}
+
+static inline void ge_add(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
+    fe t0;
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->YplusX);
+    fe_mul(r->Y, r->Y, q->YminusX);
+    fe_mul(r->T, q->T2d, p->T);
+    fe_mul(r->X, p->Z, q->Z);
+    fe_add(t0, r->X, r->X);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_add(r->Z, t0, r->T);
+    fe_sub(r->T, t0, r->T);
+}
+
+static inline void ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
+    fe t0;
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->YminusX);
+    fe_mul(r->Y, r->Y, q->YplusX);
+    fe_mul(r->T, q->T2d, p->T);
+    fe_mul(r->X, p->Z, q->Z);
+    fe_add(t0, r->X, r->X);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_sub(r->Z, t0, r->T);
+    fe_add(r->T, t0, r->T);
+}
+
+static inline void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
+    fe t0;
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->yplusx);
+    fe_mul(r->Y, r->Y, q->yminusx);
+    fe_mul(r->T, q->xy2d, p->T);
+    fe_add(t0, p->Z, p->Z);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_add(r->Z, t0, r->T);
+    fe_sub(r->T, t0, r->T);
+}
+
+static inline void ge_msub(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
+    fe t0;
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->yminusx);
+    fe_mul(r->Y, r->Y, q->yplusx);
+    fe_mul(r->T, q->xy2d, p->T);
+    fe_add(t0, p->Z, p->Z);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_sub(r->Z, t0, r->T);
+    fe_add(r->T, t0, r->T);
+}
+
+static void ge_p3_tobytes(uint8_t s[32], const ge_p3 *h) {
+    fe recip, x, y;
+    fe_invert(recip, h->Z);
+    fe_mul(x, h->X, recip);
+    fe_mul(y, h->Y, recip);
+    fe_tobytes(s, y);
+    s[31] ^= (uint8_t)(fe_isnegative(x) << 7);
+}
+
+// RFC 8032, 5.1.3; y must be canonical (public data)
+static int ge_frombytes(ge_p3 *h, const uint8_t s[32]) {
+    // y < p
+    uint8_t y[32];
+    memcpy(y, s, 32);
+    y[31] &= 0x7F;
+    if (y[31] == 0x7F && y[0] >= 0xED) {
+        int all = 1;
+        for (int i = 1; i < 31; ++i) {
+            all &= y[i] == 0xFF;
+        }
+        if (all) {
+            return 0;
+        }
+    }
+    fe u, v, v3, vxx, check;
+    fe_frombytes(h->Y, s);
+    fe_1(h->Z);
+    fe_sq(u, h->Y);
+    fe_mul(v, u, FE_D);
+    fe_sub(u, u, h->Z);          // u = y^2 - 1
+    fe_add(v, v, h->Z);          // v = dy^2 + 1
+    fe_sq(v3, v);
+    fe_mul(v3, v3, v);           // v^3
+    fe_sq(h->X, v3);
+    fe_mul(h->X, h->X, v);
+    fe_mul(h->X, h->X, u);       // u v^7
+    fe_pow22523(h->X, h->X);     // (u v^7)^((p - 5) / 8)
+    fe_mul(h->X, h->X, v3);
+    fe_mul(h->X, h->X, u);       // x = u v^3 (u v^7)^((p - 5) / 8)
+    fe_sq(vxx, h->X);
+    fe_mul(vxx, vxx, v);
+    fe_sub(check, vxx, u);
+    if (!fe_iszero(check)) {
+        fe_add(check, vxx, u);
+        if (!fe_iszero(check)) {
+            return 0;
+        }
+        fe_mul(h->X, h->X, FE_SQRTM1);
+    }
+    int sign = s[31] >> 7;
+    if (fe_iszero(h->X) && sign) {
+        return 0;
+    }
+    if (fe_isnegative(h->X) != sign) {
+        fe_neg(h->X, h->X);
+    }
+    fe_mul(h->T, h->X, h->Y);
+    return 1;
+}
+
+static void ge_p3_neg(ge_p3 *r, const ge_p3 *p) {
+    fe_neg(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
+    fe_neg(r->T, p->T);
+}
+
+// [8]P == O (public data)
+static int ge_mul8_is_identity(const ge_p3 *p) {
+    ge_p1p1 t;
+    ge_p2 q;
+    ge_p3_to_p2(&q, p);
+    for (int i = 0; i < 3; ++i) {
+        ge_p2_dbl(&t, &q);
+        ge_p1p1_to_p2(&q, &t);
+    }
+    fe d;
+    fe_sub(d, q.Y, q.Z);
+    return fe_iszero(q.X) && fe_iszero(d);
+}
+
+#pragma mark Tables
+
+// affine points from projective ones, with one inversion
+static void ge_batch_to_precomp(ge_precomp *out, const ge_p3 *in, size_t n) {
+    std::vector<uint64_t> buf(5 * n);
+    fe *acc = (fe *)buf.data();
+    fe inv, t;
+    fe_copy(acc[0], in[0].Z);
+    for (size_t i = 1; i < n; ++i) {
+        fe_mul(acc[i], acc[i - 1], in[i].Z);
+    }
+    fe_invert(inv, acc[n - 1]);
+    for (size_t i = n; i-- > 0;) {
+        fe zi, x, y;
+        if (i > 0) {
+            fe_mul(zi, inv, acc[i - 1]);
+            fe_mul(inv, inv, in[i].Z);
+        } else {
+            fe_copy(zi, inv);
+        }
+        fe_mul(x, in[i].X, zi);
+        fe_mul(y, in[i].Y, zi);
+        fe_add(out[i].yplusx, y, x);
+        fe_sub(out[i].yminusx, y, x);
+        fe_mul(t, x, y);
+        fe_mul(out[i].xy2d, t, FE_D2);
+    }
+}
+
+struct Ed25519Tables {
+    ge_precomp base[32][8];  // (j + 1) * 256^i * B, for signing
+    ge_precomp odd[64];      // B, 3B, 5B, ..., 127B, for verification
+
+    Ed25519Tables() {
+        std::vector<ge_p3> points(32 * 8);
+        ge_p3 p = GE_BASE, q;
+        ge_cached c;
+        ge_p1p1 t;
+        for (int i = 0; i < 32; ++i) {
+            ge_p3_to_cached(&c, &p);
+            points[8 * i] = p;
+            for (int j = 1; j < 8; ++j) {
+                ge_add(&t, &points[8 * i + j - 1], &c);
+                ge_p1p1_to_p3(&points[8 * i + j], &t);
+            }
+            // p = 256 * p
+            for (int k = 0; k < 8; ++k) {
+                ge_p3_dbl(&t, &p);
+                ge_p1p1_to_p3(&p, &t);
+            }
+        }
+        ge_batch_to_precomp(&base[0][0], points.data(), 32 * 8);
+        // odd multiples
+        ge_p3_dbl(&t, &GE_BASE);
+        ge_p1p1_to_p3(&q, &t);
+        ge_p3_to_cached(&c, &q);
+        points[0] = GE_BASE;
+        for (int i = 1; i < 64; ++i) {
+            ge_add(&t, &points[i - 1], &c);
+            ge_p1p1_to_p3(&points[i], &t);
+        }
+        ge_batch_to_precomp(odd, points.data(), 64);
+    }
+};
+
+static inline const Ed25519Tables &tables() {
+    static const Ed25519Tables t;
+    return t;
+}
+
+static inline void ge_precomp_cmov(ge_precomp *t, const ge_precomp *u, uint64_t b) {
+    fe_cmov(t->yplusx, u->yplusx, b);
+    fe_cmov(t->yminusx, u->yminusx, b);
+    fe_cmov(t->xy2d, u->xy2d, b);
+}
+
+static inline uint64_t ct_equal(int8_t b, int8_t c) {
+    uint32_t x = (uint8_t)(b ^ c);
+    return (x - 1) >> 31;
+}
+
+// t = b * 256^pos * B, b in [-8, 8], constant-time
+static void ge_select(ge_precomp *t, int pos, int8_t b) {
+    const ge_precomp *row = tables().base[pos];
+    uint64_t negative = (uint8_t)b >> 7;
+    int8_t babs = (int8_t)(b - (int8_t)(((-(int)negative) & b) * 2));
+    ge_precomp minus;
+    ge_precomp_0(t);
+    for (int j = 0; j < 8; ++j) {
+        ge_precomp_cmov(t, &row[j], ct_equal(babs, (int8_t)(j + 1)));
+    }
+    fe_copy(minus.yplusx, t->yminusx);
+    fe_copy(minus.yminusx, t->yplusx);
+    fe_neg(minus.xy2d, t->xy2d);
+    ge_precomp_cmov(t, &minus, negative);
+}
+
+// h = a * B, a[31] <= 127, constant-time
+static void ge_scalarmult_base(ge_p3 *h, const uint8_t a[32]) {
+    int8_t e[64];
+    for (int i = 0; i < 32; ++i) {
+        e[2 * i] = a[i] & 15;
+        e[2 * i + 1] = (a[i] >> 4) & 15;
+    }
+    // signed digits in [-8, 8]
+    int8_t carry = 0;
+    for (int i = 0; i < 63; ++i) {
+        e[i] += carry;
+        carry = (int8_t)((e[i] + 8) >> 4);
+        e[i] -= (int8_t)(carry * 16);
+    }
+    e[63] += carry;
+
+    ge_p1p1 r;
+    ge_p2 s;
+    ge_precomp t;
+    ge_p3_0(h);
+    for (int i = 1; i < 64; i += 2) {
+        ge_select(&t, i / 2, e[i]);
+        ge_madd(&r, h, &t);
+        ge_p1p1_to_p3(h, &r);
+    }
+    ge_p3_dbl(&r, h);
+    ge_p1p1_to_p2(&s, &r);
+    ge_p2_dbl(&r, &s);
+    ge_p1p1_to_p2(&s, &r);
+    ge_p2_dbl(&r, &s);
+    ge_p1p1_to_p2(&s, &r);
+    ge_p2_dbl(&r, &s);
+    ge_p1p1_to_p3(h, &r);
+    for (int i = 0; i < 64; i += 2) {
+        ge_select(&t, i / 2, e[i]);
+        ge_madd(&r, h, &t);
+        ge_p1p1_to_p3(h, &r);
+    }
+    ed25519_wipe(e, sizeof(e));
+    ed25519_wipe(&t, sizeof(t));
+}
+
+#pragma mark Multi-scalar multiplication (variable-time)
+
+// odd multiples P, 3P, ..., 15P (width-5 NAF)
+struct ge_term {
+    int8_t naf[256];
+    ge_cached odd[8];
+};
+
+static void ge_term_init(ge_term *term, const ge_p3 *p, const uint8_t scalar[32]) {
+    sc_slide(term->naf, scalar, 5);
+    ge_p1p1 t;
+    ge_p3 p2, u;
+    ge_p3_dbl(&t, p);
+    ge_p1p1_to_p3(&p2, &t);
+    ge_p3_to_cached(&term->odd[0], p);
+    for (int i = 1; i < 8; ++i) {
+        ge_add(&t, &p2, &term->odd[i - 1]);
+        ge_p1p1_to_p3(&u, &t);
+        ge_p3_to_cached(&term->odd[i], &u);
+    }
+}
+
+// Straus: r = b * B + sum(terms), sharing the doublings
+static void ge_multi_scalarmult(ge_p3 *r, const uint8_t b[32], const ge_term *terms, size_t n) {
+    const ge_precomp *odd = tables().odd;
+    int8_t bnaf[256];
+    sc_slide(bnaf, b, 8);
+    int top = 255;
+    for (; top >= 0; --top) {
+        int used = bnaf[top] != 0;
+        for (size_t k = 0; k < n && !used; ++k) {
+            used = terms[k].naf[top] != 0;
+        }
+        if (used) {
+            break;
+        }
+    }
+    ge_p1p1 t;
+    ge_p2 s;
+    ge_p3_0(r);
+    ge_p3_to_p2(&s, r);
+    for (int i = top; i >= 0; --i) {
+        ge_p2_dbl(&t, &s);
+        ge_p1p1_to_p3(r, &t);
+        for (size_t k = 0; k < n; ++k) {
+            int8_t d = terms[k].naf[i];
+            if (d > 0) {
+                ge_add(&t, r, &terms[k].odd[d / 2]);
+                ge_p1p1_to_p3(r, &t);
+            } else if (d < 0) {
+                ge_sub(&t, r, &terms[k].odd[(-d) / 2]);
+                ge_p1p1_to_p3(r, &t);
+            }
+        }
+        if (bnaf[i] > 0) {
+            ge_madd(&t, r, &odd[bnaf[i] / 2]);
+            ge_p1p1_to_p3(r, &t);
+        } else if (bnaf[i] < 0) {
+            ge_msub(&t, r, &odd[(-bnaf[i]) / 2]);
+            ge_p1p1_to_p3(r, &t);
+        }
+        ge_p3_to_p2(&s, r);
+    }
+}
+
+#pragma mark Ed25519
+
+static void ed25519_challenge(uint8_t k[32], const uint8_t *R, const uint8_t *pubkey,
+                              const uint8_t *msg, size_t len) {
+    sha512_ctx ctx;
+    uint8_t h[64];
+    sha512_init(&ctx);
+    sha512_update(&ctx, R, 32);
+    sha512_update(&ctx, pubkey, 32);
+    sha512_update(&ctx, msg, len);
+    sha512_final(&ctx, h);
+    sc_reduce(k, h);
+}
+
+void ed25519_key_init(ed25519_key *key, const uint8_t *seed) {
+    sha512_ctx ctx;
+    uint8_t h[64];
+    sha512_init(&ctx);
+    sha512_update(&ctx, seed, ED25519_SEED_SIZE);
+    sha512_final(&ctx, h);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+    memcpy(key->scalar, h, 32);
+    memcpy(key->prefix, h + 32, 32);
+    ge_p3 A;
+    ge_scalarmult_base(&A, key->scalar);
+    ge_p3_tobytes(key->pubkey, &A);
+    ed25519_wipe(h, sizeof(h));
+}
+
+void ed25519_key_wipe(ed25519_key *key) {
+    ed25519_wipe(key, sizeof(ed25519_key));
+}
+
+void ed25519_sign(const ed25519_key *key, const uint8_t *msg, size_t len, uint8_t *sig) {
+    sha512_ctx ctx;
+    uint8_t h[64], r[32], k[32];
+    // r = H(prefix || M)
+    sha512_init(&ctx);
+    sha512_update(&ctx, key->prefix, 32);
+    sha512_update(&ctx, msg, len);
+    sha512_final(&ctx, h);
+    sc_reduce(r, h);
+    // R = rB
+    ge_p3 R;
+    ge_scalarmult_base(&R, r);
+    ge_p3_tobytes(sig, &R);
+    // S = r + H(R || A || M) a
+    ed25519_challenge(k, sig, key->pubkey, msg, len);
+    sc_muladd(sig + 32, k, key->scalar, r);
+    ed25519_wipe(h, sizeof(h));
+    ed25519_wipe(r, sizeof(r));
+}
+
+int ed25519_verify(const uint8_t *pubkey, const uint8_t *msg, size_t len, const uint8_t *sig) {
+    if (!sc_is_canonical(sig + 32)) {
+        return 0;
+    }
+    ge_p3 A, R;
+    if (!ge_frombytes(&A, pubkey) || !ge_frombytes(&R, sig)) {
+        return 0;
+    }
+    uint8_t k[32];
+    ed25519_challenge(k, sig, pubkey, msg, len);
+    // [S]B - [k]A - R
+    ge_term term;
+    ge_p3 negA, P;
+    ge_p3_neg(&negA, &A);
+    ge_term_init(&term, &negA, k);
+    ge_multi_scalarmult(&P, sig + 32, &term, 1);
+    ge_cached c;
+    ge_p1p1 t;
+    ge_p3_to_cached(&c, &R);
+    ge_sub(&t, &P, &c);
+    ge_p1p1_to_p3(&P, &t);
+    return ge_mul8_is_identity(&P);
+}
+
+// [8]([-sum(z s)]B + sum([z]R) + sum([z k]A)) == O
+static int ed25519_verify_combined(size_t count,
+                                   const uint8_t *const *pubkeys,
+                                   const uint8_t *const *msgs, const size_t *lens,
+                                   const uint8_t *const *sigs) {
+    uint8_t random[16 * ED25519_BATCH_SIZE];
+    if (!drbg_random_bytes(random, 16 * count)) {
+        return 0;
+    }
+    static const uint8_t zero[32] = {0};
+    static const uint8_t minus_one[32] = {  // L - 1
+        0xec, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10,
+    };
+    std::vector<ge_term> terms(2 * count);
+    uint8_t sum[32] = {0}, z[32] = {0}, k[32], zk[32];
+    for (size_t i = 0; i < count; ++i) {
+        ge_p3 A, R;
+        if (!sc_is_canonical(sigs[i] + 32) ||
+            !ge_frombytes(&A, pubkeys[i]) || !ge_frombytes(&R, sigs[i])) {
+            return 0;
+        }
+        memcpy(z, random + 16 * i, 16);
+        ed25519_challenge(k, sigs[i], pubkeys[i], msgs[i], lens[i]);
+        sc_muladd(zk, z, k, zero);
+        sc_muladd(sum, z, sigs[i] + 32, sum);
+        ge_term_init(&terms[2 * i], &R, z);
+        ge_term_init(&terms[2 * i + 1], &A, zk);
+    }
+    uint8_t b[32];
+    sc_muladd(b, sum, minus_one, zero);
+    ge_p3 P;
+    ge_multi_scalarmult(&P, b, terms.data(), terms.size());
+    return ge_mul8_is_identity(&P);
+}
+
+int ed25519_verify_batch(size_t count,
+                         const uint8_t *const *pubkeys,
+                         const uint8_t *const *msgs, const size_t *lens,
+                         const uint8_t *const *sigs, int *results) {
+    int all = 1;
+    for (size_t start = 0; start < count; start += ED25519_BATCH_SIZE) {
+        size_t n = count - start;
+        if (n > ED25519_BATCH_SIZE) {
+            n = ED25519_BATCH_SIZE;
+        }
+        if (n > 1 && ed25519_verify_combined(n, pubkeys + start, msgs + start, lens + start, sigs + start)) {
+            for (size_t i = 0; i < n; ++i) {
+                results[start + i] = 1;
+            }
+            continue;
+        }
+        // find the bad ones
+        for (size_t i = start; i < start + n; ++i) {
+            results[i] = ed25519_verify(pubkeys[i], msgs[i], lens[i], sigs[i]);
+            all &= results[i];
+        }
+    }
+    return all;
+}
+
+#pragma mark X25519
+
+// RFC 7748, 5: Montgomery ladder, constant-time
+static void x25519_ladder(uint8_t out[32], const uint8_t scalar[32], const uint8_t point[32]) {
+    uint8_t e[32];
+    memcpy(e, scalar, 32);
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+    fe x1, x2, z2, x3, z3, a, aa, b, bb, c, d, da, cb, t;
+    fe_frombytes(x1, point);
+    fe_1(x2);
+    fe_0(z2);
+    fe_copy(x3, x1);
+    fe_1(z3);
+    uint64_t swap = 0;
+    for (int pos = 254; pos >= 0; --pos) {
+        uint64_t bit = (e[pos / 8] >> (pos & 7)) & 1;
+        swap ^= bit;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = bit;
+        fe_add(a, x2, z2);
+        fe_sq(aa, a);
+        fe_sub(b, x2, z2);
+        fe_sq(bb, b);
+        fe_sub(t, aa, bb);         // E
+        fe_add(c, x3, z3);
+        fe_sub(d, x3, z3);
+        fe_mul(da, d, a);
+        fe_mul(cb, c, b);
+        fe_add(x3, da, cb);
+        fe_sq(x3, x3);
+        fe_sub(z3, da, cb);
+        fe_sq(z3, z3);
+        fe_mul(z3, z3, x1);
+        fe_mul(x2, aa, bb);
+        fe_mul_small(z2, t, 121665);
+        fe_add(z2, z2, aa);
+        fe_mul(z2, z2, t);
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(out, x2);
+    ed25519_wipe(e, sizeof(e));
+    ed25519_wipe(x2, sizeof(x2));
+    ed25519_wipe(x3, sizeof(x3));
+}
+
+void x25519_public_key(uint8_t *pub, const uint8_t *secret) {
+    // fixed-base comb on the Edwards curve, then u = (Z + Y) / (Z - Y)
+    uint8_t e[32];
+    memcpy(e, secret, 32);
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+    ge_p3 A;
+    ge_scalarmult_base(&A, e);
+    fe n, d;
+    fe_add(n, A.Z, A.Y);
+    fe_sub(d, A.Z, A.Y);
+    fe_invert(d, d);
+    fe_mul(n, n, d);
+    fe_tobytes(pub, n);
+    ed25519_wipe(e, sizeof(e));
+    ed25519_wipe(&A, sizeof(A));
+}
+
+int x25519(uint8_t *shared, const uint8_t *secret, const uint8_t *peer) {
+    x25519_ladder(shared, secret, peer);
+    uint8_t d = 0;
+    for (int i = 0; i < 32; ++i) {
+        d |= shared[i];
+    }
+    return d != 0;
+}
+
+int ed25519_public_to_x25519(uint8_t *u, const uint8_t *pubkey) {
+    ge_p3 A;
+    if (!ge_frombytes(&A, pubkey)) {
+        return 0;
+    }
+    // u = (1 + y) / (1 - y), y = 1 is the identity
+    fe one, n, d;
+    fe_1(one);
+    fe_add(n, one, A.Y);
+    fe_sub(d, one, A.Y);
+    if (fe_iszero(d)) {
+        return 0;
+    }
+    fe_invert(d, d);
+    fe_mul(n, n, d);
+    fe_tobytes(u, n);
+    return 1;
+}
+
+static void x25519_seal_key(uint8_t key[CHACHA20_KEY_SIZE], const uint8_t *shared,
+                            const uint8_t *epk, const uint8_t *pub) {
+    sha512_ctx ctx;
+    uint8_t h[64];
+    sha512_init(&ctx);
+    sha512_update(&ctx, shared, 32);
+    sha512_update(&ctx, epk, 32);
+    sha512_update(&ctx, pub, 32);
+    sha512_final(&ctx, h);
+    memcpy(key, h, CHACHA20_KEY_SIZE);
+    ed25519_wipe(h, sizeof(h));
+}
+
+int x25519_seal(const uint8_t *peer, const uint8_t *ephemeral,
+                const uint8_t *in, size_t len, uint8_t *out) {
+    static const uint8_t nonce[CHACHA20_NONCE_SIZE] = {0};
+    uint8_t shared[32], key[CHACHA20_KEY_SIZE];
+    if (!x25519(shared, ephemeral, peer)) {
+        return 0;
+    }
+    x25519_public_key(out, ephemeral);
+    x25519_seal_key(key, shared, out, peer);
+    // the key is new for every message, a zero nonce is fine
+    chacha20poly1305_encrypt(key, nonce, NULL, 0, in, len, out + 32, out + 32 + len);
+    ed25519_wipe(shared, sizeof(shared));
+    ed25519_wipe(key, sizeof(key));
+    return 1;
+}
+
+int x25519_open(const uint8_t *secret, const uint8_t *pub,
+                const uint8_t *in, size_t len, uint8_t *out) {
+    static const uint8_t nonce[CHACHA20_NONCE_SIZE] = {0};
+    if (len < X25519_SEAL_OVERHEAD) {
+        return 0;
+    }
+    uint8_t shared[32], key[CHACHA20_KEY_SIZE];
+    if (!x25519(shared, secret, in)) {
+        return 0;
+    }
+    x25519_seal_key(key, shared, in, pub);
+    len -= X25519_SEAL_OVERHEAD;
+    int ok = chacha20poly1305_decrypt(key, nonce, NULL, 0, in + 32, len, in + 32 + len, out);
+    ed25519_wipe(shared, sizeof(shared));
+    ed25519_wipe(key, sizeof(key));
+    return ok;
+}
@@ -0,0 +1,136 @@
+//
+//  ed25519.h
+//  DIMPlugins
+//
+//  Ed25519 signatures (RFC 8032) and X25519 key agreement (RFC 7748)
+//  in radix 2^51 field arithmetic. Signing, key generation and X25519
+//  are constant-time; verification works on public data only and uses
+//  variable-time multi-scalar multiplication.
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_ED25519_H
+#define DIM_ED25519_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ED25519_SEED_SIZE       32
+#define ED25519_PUBLIC_KEY_SIZE 32
+#define ED25519_SIGNATURE_SIZE  64
+
+#define X25519_KEY_SIZE         32
+
+// sealed box: ephemeral public key (32 bytes) + ciphertext + tag (16 bytes)
+#define X25519_SEAL_OVERHEAD    48
+
+/**
+ *  Expanded secret key, build it once and reuse it for every signature
+ */
+typedef struct ed25519_key {
+    uint8_t scalar[32];  // clamped secret scalar (also the X25519 secret)
+    uint8_t prefix[32];  // nonce key
+    uint8_t pubkey[32];  // encoded public key
+} ed25519_key;
+
+/**
+ *  Expand secret key
+ *
+ * @param key  - expanded key to build
+ * @param seed - 32 bytes
+ */
+void ed25519_key_init(ed25519_key *key, const uint8_t *seed);
+
+/**
+ *  Erase expanded key
+ */
+void ed25519_key_wipe(ed25519_key *key);
+
+/**
+ *  Sign message (pure Ed25519)
+ *
+ * @param sig - 64 bytes
+ */
+void ed25519_sign(const ed25519_key *key, const uint8_t *msg, size_t len, uint8_t *sig);
+
+/**
+ *  Verify signature, with the cofactored equation [8][S]B = [8]R + [8][k]A,
+ *  so that single and batch verification always agree
+ *
+ * @param pubkey - 32 bytes
+ * @param sig    - 64 bytes
+ * @return 1 on valid signature
+ */
+int ed25519_verify(const uint8_t *pubkey, const uint8_t *msg, size_t len, const uint8_t *sig);
+
+/**
+ *  Verify many signatures with one random linear combination,
+ *  when the combination fails every signature is checked alone
+ *
+ * @param count   - number of signatures
+ * @param results - 1 for valid, 0 for invalid (count values)
+ * @return 1 when all signatures are valid
+ */
+int ed25519_verify_batch(size_t count,
+                         const uint8_t *const *pubkeys,
+                         const uint8_t *const *msgs, const size_t *lens,
+                         const uint8_t *const *sigs, int *results);
+
+/**
+ *  X25519 public key (u-coordinate) of a secret key
+ */
+void x25519_public_key(uint8_t *pub, const uint8_t *secret);
+
+/**
+ *  X25519 shared secret
+ *
+ * @return 0 when the peer key has small order (all-zero result)
+ */
+int x25519(uint8_t *shared, const uint8_t *secret, const uint8_t *peer);
+
+/**
+ *  Ed25519 public key to X25519 public key: u = (1 + y) / (1 - y);
+ *  the X25519 secret is ed25519_key.scalar
+ *
+ * @return 0 on invalid Ed25519 public key
+ */
+int ed25519_public_to_x25519(uint8_t *u, const uint8_t *pubkey);
+
+/**
+ *  Sealed box for the owner of 'peer':
+ *
+ *      epk   = X25519(ephemeral, 9)
+ *      key   = SHA-512(X25519(ephemeral, peer) || epk || peer)[0..31]
+ *      out   = epk || ChaCha20-Poly1305(key, nonce = 0, in)
+ *
+ * @param peer      - X25519 public key of the receiver
+ * @param ephemeral - 32 random bytes, never reuse them
+ * @param out       - len + X25519_SEAL_OVERHEAD bytes
+ * @return 0 on bad peer key
+ */
+int x25519_seal(const uint8_t *peer, const uint8_t *ephemeral,
+                const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ *  Open sealed box
+ *
+ * @param secret - X25519 secret key of the receiver
+ * @param pub    - X25519 public key of the receiver
+ * @param len    - sealed length (at least X25519_SEAL_OVERHEAD)
+ * @param out    - len - X25519_SEAL_OVERHEAD bytes
+ * @return 1 on success; 0 on wrong key or modified data
+ */
+int x25519_open(const uint8_t *secret, const uint8_t *pub,
+                const uint8_t *in, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_ED25519_H */
@@ -0,0 +1,330 @@
+//
+//  hex.cpp
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/3/25.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#include "hex.h"
+#include "cpu.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(DIM_CPU_X86)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+// byte => 2 chars
+struct HexTable {
+    uint16_t pairs[256];
+    // char => nibble; 0x10 for separator, 0xFF for invalid
+    uint8_t nibbles[256];
+    
+    HexTable() {
+        for (int i = 0; i < 256; ++i) {
+            char pair[2] = {kHexDigits[i >> 4], kHexDigits[i & 0x0F]};
+            __builtin_memcpy(&pairs[i], pair, 2);
+            nibbles[i] = 0xFF;
+        }
+        for (int i = 0; i < 10; ++i) {
+            nibbles['0' + i] = (uint8_t)i;
+        }
+        for (int i = 0; i < 6; ++i) {
+            nibbles['a' + i] = (uint8_t)(10 + i);
+            nibbles['A' + i] = (uint8_t)(10 + i);
+        }
+        const char *separators = " :-\t\r\n";
+        for (const char *p = separators; *p; ++p) {
+            nibbles[(uint8_t)*p] = 0x10;
+        }
+    }
+};
+
+static const HexTable kTable;
+
+#define NIBBLE_SEPARATOR 0x10
+
+#pragma mark Scalar
+
+static inline void encode_scalar(const uint8_t *src, size_t len, char *dst) {
+    for (size_t i = 0; i < len; ++i) {
+        __builtin_memcpy(dst + 2 * i, &kTable.pairs[src[i]], 2);
+    }
+}
+
+// decode with separators, 'hi' holds the pending high nibble (or -1)
+static inline size_t decode_scalar(const char *src, size_t len, uint8_t *dst, int *hi) {
+    size_t out = 0;
+    uint8_t n;
+    for (size_t i = 0; i < len; ++i) {
+        n = kTable.nibbles[(uint8_t)src[i]];
+        if (n < 0x10) {
+            if (*hi < 0) {
+                *hi = n;
+            } else {
+                dst[out++] = (uint8_t)((*hi << 4) | n);
+                *hi = -1;
+            }
+        } else if (n != NIBBLE_SEPARATOR) {
+            return HEX_DECODE_ERROR;
+        }
+    }
+    return out;
+}
+
+#pragma mark SSE2
+
+#if defined(__SSE2__)
+
+// 16 nibbles (0..15) => 16 hex chars
+static inline __m128i sse2_nibbles_to_chars(__m128i n) {
+    // n + '0' + (n > 9 ? 'a' - '0' - 10 : 0)
+    __m128i gt9 = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+    __m128i adj = _mm_and_si128(gt9, _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), adj);
+}
+
+static size_t encode_sse2(const uint8_t *src, size_t len, char *dst) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+        __m128i lo = _mm_and_si128(b, mask);
+        hi = sse2_nibbles_to_chars(hi);
+        lo = sse2_nibbles_to_chars(lo);
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    return i;
+}
+
+// 16 chars => 16 nibbles; 'ok' is false if any char is not a hex digit
+static inline __m128i sse2_chars_to_nibbles(__m128i c, bool *ok) {
+    // digits: '0'..'9'
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    // letters: 'a'..'f' / 'A'..'F'
+    __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(l, _mm_set1_epi8('f' + 1)));
+    __m128i a = _mm_sub_epi8(l, _mm_set1_epi8('a' - 10));
+    *ok = _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) == 0xFFFF;
+    return _mm_or_si128(_mm_and_si128(is_digit, d), _mm_and_si128(is_alpha, a));
+}
+
+// decode blocks of 32 chars without separators,
+// stop at the first block with other chars (let the scalar code handle it)
+static size_t decode_sse2(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    const __m128i low = _mm_set1_epi16(0x00FF);
+    size_t i = 0, out = 0;
+    bool ok0, ok1;
+    for (; i + 32 <= len; i += 32, out += 16) {
+        __m128i n0 = sse2_chars_to_nibbles(_mm_loadu_si128((const __m128i *)(src + i)), &ok0);
+        __m128i n1 = sse2_chars_to_nibbles(_mm_loadu_si128((const __m128i *)(src + i + 16)), &ok1);
+        if (!ok0 || !ok1) {
+            break;
+        }
+        // (even << 4) | odd
+        n0 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n0, low), 4), _mm_srli_epi16(n0, 8));
+        n1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n1, low), 4), _mm_srli_epi16(n1, 8));
+        _mm_storeu_si128((__m128i *)(dst + out), _mm_packus_epi16(n0, n1));
+    }
+    *consumed = i;
+    return out;
+}
+
+#endif /* __SSE2__ */
+
+#pragma mark AVX2
+
+#if defined(DIM_CPU_X86)
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_nibbles_to_chars(__m256i n) {
+    __m256i gt9 = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+    __m256i adj = _mm256_and_si256(gt9, _mm256_set1_epi8('a' - '0' - 10));
+    return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), adj);
+}
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(const uint8_t *src, size_t len, char *dst) {
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i hi = avx2_nibbles_to_chars(_mm256_and_si256(_mm256_srli_epi16(b, 4), mask));
+        __m256i lo = avx2_nibbles_to_chars(_mm256_and_si256(b, mask));
+        // unpack works in 128-bit lanes, fix the order
+        __m256i x0 = _mm256_unpacklo_epi8(hi, lo);
+        __m256i x1 = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(x0, x1, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i + 32), _mm256_permute2x128_si256(x0, x1, 0x31));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_chars_to_nibbles(__m256i c, bool *ok) {
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)),
+                                        _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), l));
+    __m256i a = _mm256_sub_epi8(l, _mm256_set1_epi8('a' - 10));
+    *ok = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) == 0xFFFFFFFFu;
+    return _mm256_or_si256(_mm256_and_si256(is_digit, d), _mm256_and_si256(is_alpha, a));
+}
+
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    const __m256i low = _mm256_set1_epi16(0x00FF);
+    size_t i = 0, out = 0;
+    bool ok0, ok1;
+    for (; i + 64 <= len; i += 64, out += 32) {
+        __m256i n0 = avx2_chars_to_nibbles(_mm256_loadu_si256((const __m256i *)(src + i)), &ok0);
+        __m256i n1 = avx2_chars_to_nibbles(_mm256_loadu_si256((const __m256i *)(src + i + 32)), &ok1);
+        if (!ok0 || !ok1) {
+            break;
+        }
+        n0 = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n0, low), 4), _mm256_srli_epi16(n0, 8));
+        n1 = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n1, low), 4), _mm256_srli_epi16(n1, 8));
+        // pack works in 128-bit lanes, fix the order
+        __m256i packed = _mm256_packus_epi16(n0, n1);
+        _mm256_storeu_si256((__m256i *)(dst + out), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    *consumed = i;
+    return out;
+}
+
+#endif /* DIM_CPU_X86 */
+
+#pragma mark NEON
+
+#if defined(__aarch64__)
+
+static size_t encode_neon(const uint8_t *src, size_t len, char *dst) {
+    const uint8x16_t digits = vld1q_u8((const uint8_t *)kHexDigits);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t b = vld1q_u8(src + i);
+        uint8x16x2_t chars;
+        chars.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(b, 4));
+        chars.val[1] = vqtbl1q_u8(digits, vandq_u8(b, mask));
+        // interleaved store: hi, lo, hi, lo, ...
+        vst2q_u8((uint8_t *)dst + 2 * i, chars);
+    }
+    return i;
+}
+
+static size_t decode_neon(const char *src, size_t len, uint8_t *dst, size_t *consumed) {
+    size_t i = 0, out = 0;
+    for (; i + 32 <= len; i += 32, out += 16) {
+        // de-interleave: val[0] = high nibble chars, val[1] = low nibble chars
+        uint8x16x2_t c = vld2q_u8((const uint8_t *)src + i);
+        uint8x16_t n[2];
+        uint8x16_t valid = vdupq_n_u8(0xFF);
+        for (int k = 0; k < 2; ++k) {
+            uint8x16_t d = vsubq_u8(c.val[k], vdupq_n_u8('0'));
+            uint8x16_t l = vsubq_u8(vorrq_u8(c.val[k], vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+            uint8x16_t is_digit = vcltq_u8(d, vdupq_n_u8(10));
+            uint8x16_t is_alpha = vcltq_u8(l, vdupq_n_u8(6));
+            valid = vandq_u8(valid, vorrq_u8(is_digit, is_alpha));
+            n[k] = vbslq_u8(is_digit, d, vaddq_u8(l, vdupq_n_u8(10)));
+        }
+        if (vminvq_u8(valid) == 0) {
+            break;
+        }
+        vst1q_u8(dst + out, vorrq_u8(vshlq_n_u8(n[0], 4), n[1]));
+    }
+    *consumed = i;
+    return out;
+}
+
+#endif /* __aarch64__ */
+
+#pragma mark Dispatch
+
+typedef size_t (*hex_encode_fn)(const uint8_t *src, size_t len, char *dst);
+typedef size_t (*hex_decode_fn)(const char *src, size_t len, uint8_t *dst, size_t *consumed);
+
+struct HexKernels {
+    hex_encode_fn encode;
+    hex_decode_fn decode;
+    
+    HexKernels() : encode(nullptr), decode(nullptr) {
+#if defined(DIM_CPU_X86)
+        if (dim_cpu_has_avx2()) {
+            encode = encode_avx2;
+            decode = decode_avx2;
+            return;
+        }
+#endif
+#if defined(__SSE2__)
+        encode = encode_sse2;
+        decode = decode_sse2;
+#elif defined(__aarch64__)
+        encode = encode_neon;
+        decode = decode_neon;
+#endif
+    }
+};
+
+static inline const HexKernels &kernels() {
+    static const HexKernels k;
+    return k;
+}
+
+size_t hex_encode(const uint8_t *src, size_t len, char *dst) {
+    size_t done = 0;
+    const HexKernels &k = kernels();
+    if (k.encode) {
+        done = k.encode(src, len, dst);
+    }
+    encode_scalar(src + done, len - done, dst + 2 * done);
+    return len * 2;
+}
+
+size_t hex_decode(const char *src, size_t len, uint8_t *dst) {
+    // skip '0x' prefix (after leading separators)
+    size_t pos = 0;
+    while (pos < len && kTable.nibbles[(uint8_t)src[pos]] == NIBBLE_SEPARATOR) {
+        ++pos;
+    }
+    if (pos + 1 < len && src[pos] == '0' && (src[pos + 1] == 'x' || src[pos + 1] == 'X')) {
+        pos += 2;
+    }
+    const HexKernels &k = kernels();
+    size_t out = 0, consumed, res;
+    int hi = -1;
+    while (pos < len) {
+        if (k.decode && hi < 0) {
+            // fast path: blocks without separators
+            out += k.decode(src + pos, len - pos, dst + out, &consumed);
+            pos += consumed;
+        }
+        // slow path: one block (or the tail) with separators
+        size_t step = len - pos < 64 ? len - pos : 64;
+        res = decode_scalar(src + pos, step, dst + out, &hi);
+        if (res == HEX_DECODE_ERROR) {
+            return HEX_DECODE_ERROR;
+        }
+        out += res;
+        pos += step;
+    }
+    if (hi >= 0) {
+        // odd digits
+        return HEX_DECODE_ERROR;
+    }
+    return out;
+}
@@ -0,0 +1,48 @@
+//
+//  hex.h
+//  DIMPlugins
+//
+//  Hex codec kernels: lookup tables + SSE2/AVX2/NEON.
+//
+//  Created by Albert Moky on 2024/3/25.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#ifndef DIM_HEX_H
+#define DIM_HEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEX_DECODE_ERROR ((size_t)-1)
+
+/**
+ *  Encode bytes to lower case hex string
+ *
+ * @param src - input bytes
+ * @param len - input length
+ * @param dst - output buffer, at least (len * 2) bytes
+ * @return output length (len * 2)
+ */
+size_t hex_encode(const uint8_t *src, size_t len, char *dst);
+
+/**
+ *  Decode hex string, separators (' ', ':', '-', '\t', '\r', '\n')
+ *  and the '0x' prefix are skipped in the same pass
+ *
+ * @param src - input chars
+ * @param len - input length
+ * @param dst - output buffer, at least (len / 2) bytes
+ * @return output length; HEX_DECODE_ERROR on invalid char or odd digits
+ */
+size_t hex_decode(const char *src, size_t len, uint8_t *dst);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif /* DIM_HEX_H */
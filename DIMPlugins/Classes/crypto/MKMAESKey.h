@@ -37,6 +37,8 @@
 
 #import <DIMCore/DIMCore.h>
 
+#import "MKMCipherStream.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 /*
@@ -47,9 +49,18 @@ NS_ASSUME_NONNULL_BEGIN
  *          keySize  : 32,                // optional
  *          data     : "{BASE64_ENCODE}", // password data
  *          iv       : "{BASE64_ENCODE}", // initialization vector
+ *          mode     : "CBC",             // optional, "CBC" (default) or "GCM"
  *      }
+ *
+ *      CBC: PKCS#7 padding, the 'iv' is sent in the extra params ("IV");
+ *      GCM: authenticated, each ciphertext carries its own random nonce:
+ *           nonce (12 bytes) + encrypted data + tag (16 bytes),
+ *           decrypting a modified message returns nil.
+ *
+ *      Streaming (large files) always uses the chunked AES-256-GCM
+ *      stream (MKMChunkedCipherContext), whatever the mode is.
  */
-@interface MKMAESKey : DIMSymmetricKey
+@interface MKMAESKey : DIMSymmetricKey <MKMChunkCipher, MKMStreamCipher>
 
 @end
 
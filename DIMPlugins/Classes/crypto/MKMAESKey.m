@@ -35,19 +35,46 @@
 //  Copyright © 2018 DIM Group. All rights reserved.
 //
 
-#import <CommonCrypto/CommonCryptor.h>
+#import <os/lock.h>
 
-#import "NSData+Crypto.h"
+#import "aes.h"
+#import "drbg.h"
 
 #import "MKMAESKey.h"
 
 static inline NSData *random_data(NSUInteger size) {
-    unsigned char *buf = malloc(size * sizeof(unsigned char));
-    arc4random_buf(buf, size);
-    return [[NSData alloc] initWithBytesNoCopy:buf length:size freeWhenDone:YES];
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:size];
+    if (!drbg_random_bytes(data.mutableBytes, size)) {
+        // system entropy source failed
+        arc4random_buf(data.mutableBytes, size);
+    }
+    return data;
+}
+
+// expanded key schedule (aes256_key), erased when the last owner releases it
+static inline NSData *aes_schedule(NSData *password) {
+    uint8_t pw[AES256_KEY_SIZE] = {0};
+    // 'password' should be 32 bytes for AES256, will be null-padded otherwise
+    [password getBytes:pw length:sizeof(pw)];
+    aes256_key *key = malloc(sizeof(aes256_key));
+    aes256_init(key, pw);
+    volatile uint8_t *p = pw;
+    for (NSUInteger i = 0; i < sizeof(pw); ++i) {
+        p[i] = 0;
+    }
+    return [[NSData alloc] initWithBytesNoCopy:key
+                                        length:sizeof(aes256_key)
+                                   deallocator:^(void *bytes, NSUInteger length) {
+        aes256_wipe(bytes);
+        free(bytes);
+    }];
 }
 
-@interface MKMAESKey ()
+@interface MKMAESKey () {
+    
+    os_unfair_lock _lock;
+    NSData *_schedule;  // aes256_key
+}
 
 @property (readonly, nonatomic) NSUInteger keySize;
 @property (readonly, nonatomic) NSUInteger blockSize;
@@ -55,6 +82,8 @@ static inline NSData *random_data(NSUInteger size) {
 @property (strong, nonatomic) id<MKMTransportableData> keyData;  // Key Data
 @property (strong, nonatomic) id<MKMTransportableData> ivData;   // Initialization Vector
 
+@property (strong, nonatomic, nullable) NSData *schedule;
+
 @end
 
 @implementation MKMAESKey
@@ -62,13 +91,15 @@ static inline NSData *random_data(NSUInteger size) {
 /* designated initializer */
 - (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
     if (self = [super initWithDictionary:keyInfo]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _schedule = nil;
         if ([self objectForKey:@"data"]) {
             // lazy
             _keyData = nil;
             _ivData = nil;
         } else {
             // TODO: check algorithm parameters
-            // 1. check mode = 'CBC'
+            // 1. check mode = 'CBC' or 'GCM'
             // 2. check padding = 'PKCS7Padding'
             [self _generate];
         }
@@ -91,6 +122,11 @@ static inline NSData *random_data(NSUInteger size) {
     [self setObject:ted.object forKey:@"data"];
     _keyData = ted;
     
+    if ([self isGCM]) {
+        // GCM takes a random nonce for each message
+        return;
+    }
+    
     // random initialization vector
     NSUInteger blockSize = [self blockSize];
     NSData *iv = random_data(blockSize);
@@ -109,10 +145,21 @@ static inline NSData *random_data(NSUInteger size) {
     if (key) {
         key.keyData = _keyData;
         key.ivData = _ivData;
+        // immutable once created, share it
+        os_unfair_lock_lock(&_lock);
+        NSData *schedule = _schedule;
+        os_unfair_lock_unlock(&_lock);
+        key.schedule = schedule;
     }
     return key;
 }
 
+- (BOOL)isGCM {
+    NSString *mode = [self stringForKey:@"mode" defaultValue:nil];
+    // no mode means CBC, as the keys made before GCM
+    return mode && [mode caseInsensitiveCompare:@"GCM"] == NSOrderedSame;
+}
+
 - (NSUInteger)keySize {
     // TODO: get from key data
     //...
@@ -120,7 +167,7 @@ static inline NSData *random_data(NSUInteger size) {
     // get from dictionary
     NSNumber *size = [self objectForKey:@"keySize"];
     if (size == nil) {
-        return kCCKeySizeAES256; // 32
+        return AES256_KEY_SIZE; // 32
     } else {
         return size.unsignedIntegerValue;
     }
@@ -133,7 +180,7 @@ static inline NSData *random_data(NSUInteger size) {
     // get from dictionary
     NSNumber *size = [self objectForKey:@"blockSize"];
     if (size == nil) {
-        return kCCBlockSizeAES128; // 16
+        return AES_BLOCK_SIZE; // 16
     } else {
         return size.unsignedIntegerValue;
     }
@@ -196,53 +243,163 @@ static inline NSData *random_data(NSUInteger size) {
     return [ted data];
 }
 
+- (const aes256_key *)expandedKey {
+    NSData *schedule;
+    os_unfair_lock_lock(&_lock);
+    schedule = _schedule;
+    os_unfair_lock_unlock(&_lock);
+    if (!schedule) {
+        // expand the password only once
+        schedule = aes_schedule([self data]);
+        os_unfair_lock_lock(&_lock);
+        if (!_schedule) {
+            _schedule = schedule;
+        }
+        schedule = _schedule;
+        os_unfair_lock_unlock(&_lock);
+    }
+    return schedule.bytes;
+}
+
+- (nullable NSData *)schedule {
+    NSData *schedule;
+    os_unfair_lock_lock(&_lock);
+    schedule = _schedule;
+    os_unfair_lock_unlock(&_lock);
+    return schedule;
+}
+- (void)setSchedule:(nullable NSData *)schedule {
+    os_unfair_lock_lock(&_lock);
+    _schedule = schedule;
+    os_unfair_lock_unlock(&_lock);
+}
+
 #pragma mark - Protocol
 
 - (NSData *)encrypt:(NSData *)plaintext params:(nullable NSMutableDictionary<NSString *,id> *)extra {
-    NSAssert(self.keySize == kCCKeySizeAES256, @"only support AES-256 now");
+    NSAssert(self.keySize == AES256_KEY_SIZE, @"only support AES-256 now");
+    if ([self isGCM]) {
+        return [self _encryptGCM:plaintext];
+    }
     // 0. TODO: random new 'IV'
     NSString *base64 = [self _ivString];
     [extra setObject:base64 forKey:@"IV"];
-    // 1. get key data & initial vector
-    NSData *key = [self data];
+    // 1. get key schedule & initial vector
+    const aes256_key *key = [self expandedKey];
     NSData *iv = [self iv];
-    // 2. try to encrypt
-    NSData *ciphertext = nil;
-    @try {
-        ciphertext = [plaintext AES256EncryptWithKey:key
-                                initializationVector:iv];
-    } @catch (NSException *exception) {
-        NSLog(@"[AES] failed to encrypt: %@", exception);
-    } @finally {
-        //
-    }
-    NSAssert(ciphertext, @"AES encrypt failed");
-    return ciphertext;
+    NSAssert(!iv || iv.length == AES_BLOCK_SIZE, @"AES iv error: %@", iv);
+    // 2. encrypt
+    size_t size = AES_CBC_ENCRYPT_SIZE(plaintext.length);
+    uint8_t *buffer = malloc(size);
+    size = aes256_cbc_encrypt(key, iv.bytes, plaintext.bytes, plaintext.length, buffer);
+    //the returned NSData takes ownership of the buffer and will free it on deallocation
+    return [[NSData alloc] initWithBytesNoCopy:buffer length:size];
 }
 
 - (nullable NSData *)decrypt:(NSData *)ciphertext params:(nullable NSDictionary<NSString *,id> *)extra {
-    NSAssert(self.keySize == kCCKeySizeAES256, @"only support AES-256 now");
+    NSAssert(self.keySize == AES256_KEY_SIZE, @"only support AES-256 now");
+    if ([self isGCM]) {
+        return [self _decryptGCM:ciphertext];
+    }
     // 0. get 'IV' from extra params
     id base64 = [extra objectForKey:@"IV"];
     if (base64) {
         [self _setInitVector:base64];
     }
-    // 1. get key data & initial vector
-    NSData *key = [self data];
+    // 1. get key schedule & initial vector
+    const aes256_key *key = [self expandedKey];
     NSData *iv = [self iv];
+    if (iv && iv.length != AES_BLOCK_SIZE) {
+        NSLog(@"[AES] iv error: %@", iv);
+        return nil;
+    }
     // 2. try to decrypt
-    NSData *plaintext = nil;
-    @try {
-        // AES decrypt algorithm
-        plaintext = [ciphertext AES256DecryptWithKey:key
-                                initializationVector:iv];
-    } @catch (NSException *exception) {
-        NSLog(@"[AES] failed to decrypt: %@", exception);
-    } @finally {
-        //
-    }
-    //NSAssert(plaintext, @"AES decrypt failed");
+    NSUInteger length = ciphertext.length;
+    if (length == 0) {
+        return nil;
+    }
+    uint8_t *buffer = malloc(length);
+    size_t size = aes256_cbc_decrypt(key, iv.bytes, ciphertext.bytes, length, buffer);
+    if (size == AES_DECRYPT_ERROR) {
+        //NSAssert(false, @"AES decrypt failed");
+        free(buffer);
+        return nil;
+    }
+    return [[NSData alloc] initWithBytesNoCopy:buffer length:size];
+}
+
+#pragma mark GCM
+
+// output: nonce (12 bytes) + ciphertext + tag (16 bytes)
+- (NSData *)_encryptGCM:(NSData *)plaintext {
+    const aes256_key *key = [self expandedKey];
+    NSUInteger length = plaintext.length;
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:(AES_GCM_IV_SIZE + length + AES_GCM_TAG_SIZE)];
+    uint8_t *nonce = output.mutableBytes;
+    if (!drbg_random_bytes(nonce, AES_GCM_IV_SIZE)) {
+        // system entropy source failed
+        arc4random_buf(nonce, AES_GCM_IV_SIZE);
+    }
+    aes256_gcm_encrypt(key, nonce, NULL, 0,
+                       plaintext.bytes, length,
+                       nonce + AES_GCM_IV_SIZE,
+                       nonce + AES_GCM_IV_SIZE + length);
+    return output;
+}
+
+- (nullable NSData *)_decryptGCM:(NSData *)ciphertext {
+    if (ciphertext.length < AES_GCM_IV_SIZE + AES_GCM_TAG_SIZE) {
+        return nil;
+    }
+    const aes256_key *key = [self expandedKey];
+    const uint8_t *nonce = ciphertext.bytes;
+    NSUInteger length = ciphertext.length - AES_GCM_IV_SIZE - AES_GCM_TAG_SIZE;
+    NSMutableData *plaintext = [[NSMutableData alloc] initWithLength:length];
+    if (!aes256_gcm_decrypt(key, nonce, NULL, 0,
+                            nonce + AES_GCM_IV_SIZE, length,
+                            nonce + AES_GCM_IV_SIZE + length,
+                            plaintext.mutableBytes)) {
+        // tag mismatched, the message was modified
+        return nil;
+    }
     return plaintext;
 }
 
+#pragma mark - Chunk Cipher
+
+- (void)sealChunk:(const uint8_t *)plaintext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+           output:(uint8_t *)ciphertext
+              tag:(uint8_t *)tag {
+    NSAssert(self.keySize == AES256_KEY_SIZE, @"only support AES-256 now");
+    aes256_gcm_encrypt([self expandedKey], nonce, aad, aadLength,
+                       plaintext, length, ciphertext, tag);
+}
+
+- (BOOL)openChunk:(const uint8_t *)ciphertext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+              tag:(const uint8_t *)tag
+           output:(uint8_t *)plaintext {
+    NSAssert(self.keySize == AES256_KEY_SIZE, @"only support AES-256 now");
+    return aes256_gcm_decrypt([self expandedKey], nonce, aad, aadLength,
+                              ciphertext, length, tag, plaintext) == 1;
+}
+
+#pragma mark Stream Cipher
+
+- (MKMCipherContext *)streamEncryptor {
+    return [MKMChunkedCipherContext encryptorWithCipher:self
+                                              chunkSize:MKMCipherStreamChunkSize];
+}
+
+- (MKMCipherContext *)streamDecryptor {
+    return [MKMChunkedCipherContext decryptorWithCipher:self];
+}
+
 @end
@@ -0,0 +1,62 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMChaCha20Key.h
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/8.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <DIMCore/DIMCore.h>
+
+#import "MKMCipherStream.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ *  ChaCha20-Poly1305 Key (RFC 8439)
+ *
+ *      keyInfo format: {
+ *          algorithm: "ChaCha20-Poly1305",
+ *          data     : "{BASE64_ENCODE}", // 32 bytes
+ *      }
+ *
+ *      Each ciphertext carries its own random nonce:
+ *          nonce (12 bytes) + encrypted data + tag (16 bytes),
+ *      decrypting a modified message returns nil.
+ *
+ *      Faster than AES on devices without AES instructions.
+ */
+@interface MKMChaCha20Key : DIMSymmetricKey <MKMChunkCipher, MKMStreamCipher>
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,202 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMChaCha20Key.m
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/8.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import "chacha.h"
+#import "drbg.h"
+
+#import "MKMChaCha20Key.h"
+
+static inline void random_bytes(uint8_t *buffer, size_t size) {
+    if (!drbg_random_bytes(buffer, size)) {
+        // system entropy source failed
+        arc4random_buf(buffer, size);
+    }
+}
+
+static inline void key_wipe(uint8_t *key) {
+    volatile uint8_t *p = key;
+    for (NSUInteger i = 0; i < CHACHA20_KEY_SIZE; ++i) {
+        p[i] = 0;
+    }
+}
+
+@interface MKMChaCha20Key ()
+
+@property (strong, nonatomic) id<MKMTransportableData> keyData;
+
+@end
+
+@implementation MKMChaCha20Key
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
+    if (self = [super initWithDictionary:keyInfo]) {
+        if ([self objectForKey:@"data"]) {
+            // lazy
+            _keyData = nil;
+        } else {
+            [self _generate];
+        }
+    }
+    return self;
+}
+
+- (void)_generate {
+    NSMutableData *pw = [[NSMutableData alloc] initWithLength:CHACHA20_KEY_SIZE];
+    random_bytes(pw.mutableBytes, CHACHA20_KEY_SIZE);
+    id<MKMTransportableData> ted = MKMTransportableDataCreate(pw, nil);
+    [self setObject:ted.object forKey:@"data"];
+    _keyData = ted;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    MKMChaCha20Key *key = [super copyWithZone:zone];
+    if (key) {
+        key.keyData = _keyData;
+    }
+    return key;
+}
+
+- (id<MKMTransportableData>)keyData {
+    id<MKMTransportableData> ted = _keyData;
+    if (!ted) {
+        id base64 = [self objectForKey:@"data"];
+        if (base64) {
+            _keyData = ted = MKMTransportableDataParse(base64);
+            NSAssert(ted, @"key data error: %@", base64);
+        } else {
+            NSAssert(false, @"key data not found: %@", self);
+        }
+    }
+    return ted;
+}
+
+- (NSData *)data {
+    id<MKMTransportableData> ted = [self keyData];
+    return [ted data];
+}
+
+- (void)_getKey:(uint8_t *)key {
+    NSData *data = [self data];
+    NSAssert(data.length == CHACHA20_KEY_SIZE, @"ChaCha20 key error: %@", self);
+    // 'data' should be 32 bytes, will be null-padded otherwise
+    memset(key, 0, CHACHA20_KEY_SIZE);
+    [data getBytes:key length:CHACHA20_KEY_SIZE];
+}
+
+#pragma mark - Protocol
+
+// output: nonce (12 bytes) + ciphertext + tag (16 bytes)
+- (NSData *)encrypt:(NSData *)plaintext params:(nullable NSMutableDictionary<NSString *,id> *)extra {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    [self _getKey:key];
+    NSUInteger length = plaintext.length;
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:(CHACHA20_NONCE_SIZE + length + POLY1305_TAG_SIZE)];
+    uint8_t *nonce = output.mutableBytes;
+    random_bytes(nonce, CHACHA20_NONCE_SIZE);
+    chacha20poly1305_encrypt(key, nonce, NULL, 0,
+                             plaintext.bytes, length,
+                             nonce + CHACHA20_NONCE_SIZE,
+                             nonce + CHACHA20_NONCE_SIZE + length);
+    key_wipe(key);
+    return output;
+}
+
+- (nullable NSData *)decrypt:(NSData *)ciphertext params:(nullable NSDictionary<NSString *,id> *)extra {
+    if (ciphertext.length < CHACHA20_NONCE_SIZE + POLY1305_TAG_SIZE) {
+        return nil;
+    }
+    uint8_t key[CHACHA20_KEY_SIZE];
+    [self _getKey:key];
+    const uint8_t *nonce = ciphertext.bytes;
+    NSUInteger length = ciphertext.length - CHACHA20_NONCE_SIZE - POLY1305_TAG_SIZE;
+    NSMutableData *plaintext = [[NSMutableData alloc] initWithLength:length];
+    int ok = chacha20poly1305_decrypt(key, nonce, NULL, 0,
+                                      nonce + CHACHA20_NONCE_SIZE, length,
+                                      nonce + CHACHA20_NONCE_SIZE + length,
+                                      plaintext.mutableBytes);
+    key_wipe(key);
+    if (!ok) {
+        // tag mismatched, the message was modified
+        return nil;
+    }
+    return plaintext;
+}
+
+#pragma mark - Chunk Cipher
+
+- (void)sealChunk:(const uint8_t *)plaintext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+           output:(uint8_t *)ciphertext
+              tag:(uint8_t *)tag {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    [self _getKey:key];
+    chacha20poly1305_encrypt(key, nonce, aad, aadLength,
+                             plaintext, length, ciphertext, tag);
+    key_wipe(key);
+}
+
+- (BOOL)openChunk:(const uint8_t *)ciphertext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+              tag:(const uint8_t *)tag
+           output:(uint8_t *)plaintext {
+    uint8_t key[CHACHA20_KEY_SIZE];
+    [self _getKey:key];
+    int ok = chacha20poly1305_decrypt(key, nonce, aad, aadLength,
+                                      ciphertext, length, tag, plaintext);
+    key_wipe(key);
+    return ok == 1;
+}
+
+#pragma mark Stream Cipher
+
+- (MKMCipherContext *)streamEncryptor {
+    return [MKMChunkedCipherContext encryptorWithCipher:self
+                                              chunkSize:MKMCipherStreamChunkSize];
+}
+
+- (MKMCipherContext *)streamDecryptor {
+    return [MKMChunkedCipherContext decryptorWithCipher:self];
+}
+
+@end
@@ -0,0 +1,158 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMCipherStream.h
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/5.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+#define MKMCipherStreamNonceSize     12
+#define MKMCipherStreamTagSize       16
+#define MKMCipherStreamHeaderSize    11  // chunk size (4 bytes) + nonce prefix (7 bytes)
+
+#define MKMCipherStreamChunkSize     (64 * 1024)
+#define MKMCipherStreamMinChunkSize  1024
+#define MKMCipherStreamMaxChunkSize  (16 * 1024 * 1024)
+
+/**
+ *  AEAD for one chunk: 12-byte nonce, 16-byte tag
+ */
+@protocol MKMChunkCipher <NSObject>
+
+- (void)sealChunk:(const uint8_t *)plaintext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+           output:(uint8_t *)ciphertext
+              tag:(uint8_t *)tag;
+
+// NO when the tag mismatched, the output is erased
+- (BOOL)openChunk:(const uint8_t *)ciphertext
+           length:(size_t)length
+            nonce:(const uint8_t *)nonce
+              aad:(const uint8_t *)aad
+        aadLength:(size_t)aadLength
+              tag:(const uint8_t *)tag
+           output:(uint8_t *)plaintext;
+
+@end
+
+/**
+ *  Cipher context: init / update / finish
+ *
+ *      The base class copies the data through unchanged (PLAIN),
+ *      subclasses transform it.
+ */
+@interface MKMCipherContext : NSObject
+
+// error occurred, the context cannot be used any more
+@property (readonly, nonatomic, getter=isFailed) BOOL failed;
+
+/**
+ *  Process next part of the input
+ *
+ * @param input - data
+ * @return output ready so far (may be empty); nil on error
+ */
+- (nullable NSData *)update:(NSData *)input;
+
+/**
+ *  Flush the rest output
+ *
+ * @return last output (may be empty); nil when the stream was truncated or modified
+ */
+- (nullable NSData *)finish;
+
+/**
+ *  Process the whole input with bounded memory (one chunk),
+ *  read until EOF, then finish
+ *
+ * @return NO on I/O error or authentication failure,
+ *         output written before the failure must be discarded
+ */
+- (BOOL)processFileDescriptor:(int)input toFileDescriptor:(int)output;
+- (BOOL)processInputStream:(NSInputStream *)input toOutputStream:(NSOutputStream *)output;
+
+@end
+
+/**
+ *  Chunked AEAD stream
+ *
+ *      header : chunk size (4 bytes, big-endian) + nonce prefix (7 random bytes)
+ *      chunks : ciphertext (chunk size) + tag (16 bytes),
+ *               the last one may be shorter (empty only when the input is empty)
+ *
+ *      nonce of chunk i = prefix (7 bytes) + i (4 bytes, big-endian) + last (1 byte),
+ *      and the header is the associated data of every chunk, so the receiver can decrypt and verify each chunk while downloading,
+ *      and chunks cannot be reordered, dropped or truncated.
+ */
+@interface MKMChunkedCipherContext : MKMCipherContext
+
+@property (readonly, strong, nonatomic) id<MKMChunkCipher> cipher;
+@property (readonly, nonatomic, getter=isEncrypting) BOOL encrypting;
+
+// plaintext bytes per chunk (for decryption, known after the header is read)
+@property (readonly, nonatomic) NSUInteger chunkSize;
+
+/**
+ *  Create cipher context
+ *
+ * @param cipher     - chunk AEAD
+ * @param encrypting - YES for encryptor, NO for decryptor
+ * @param size       - plaintext bytes per chunk (encryptor only, 1 KB ~ 16 MB)
+ */
+- (instancetype)initWithCipher:(id<MKMChunkCipher>)cipher
+                    encrypting:(BOOL)encrypting
+                     chunkSize:(NSUInteger)size
+NS_DESIGNATED_INITIALIZER;
+
++ (instancetype)encryptorWithCipher:(id<MKMChunkCipher>)cipher chunkSize:(NSUInteger)size;
++ (instancetype)decryptorWithCipher:(id<MKMChunkCipher>)cipher;
+
+@end
+
+/**
+ *  Symmetric key with streaming contexts
+ */
+@protocol MKMStreamCipher <NSObject>
+
+- (MKMCipherContext *)streamEncryptor;
+- (MKMCipherContext *)streamDecryptor;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,437 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMCipherStream.m
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/5.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <errno.h>
+#import <unistd.h>
+
+#import "drbg.h"
+
+#import "MKMCipherStream.h"
+
+#define MKMCipherStreamPrefixSize 7
+
+// receives the output, returns NO to stop
+typedef BOOL (^MKMCipherSink)(const uint8_t *bytes, size_t length);
+
+static inline void cipher_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+static BOOL write_all(int fd, const uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, bytes, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return NO;
+        }
+        bytes += n;
+        length -= (size_t)n;
+    }
+    return YES;
+}
+
+static BOOL stream_write_all(NSOutputStream *stream, const uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        NSInteger n = [stream write:bytes maxLength:length];
+        if (n <= 0) {
+            return NO;
+        }
+        bytes += n;
+        length -= (size_t)n;
+    }
+    return YES;
+}
+
+@interface MKMCipherContext () {
+
+    BOOL _failed;
+    BOOL _finished;
+}
+
+// subclasses override these two
+- (BOOL)process:(const uint8_t *)input length:(size_t)length sink:(MKMCipherSink)sink;
+- (BOOL)finishWithSink:(MKMCipherSink)sink;
+
+@end
+
+@implementation MKMCipherContext
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _failed = NO;
+        _finished = NO;
+    }
+    return self;
+}
+
+- (BOOL)process:(const uint8_t *)input length:(size_t)length sink:(MKMCipherSink)sink {
+    // PLAIN
+    return length == 0 || sink(input, length);
+}
+
+- (BOOL)finishWithSink:(MKMCipherSink)sink {
+    return YES;
+}
+
+- (BOOL)_update:(const uint8_t *)input length:(size_t)length sink:(MKMCipherSink)sink {
+    if (_failed || _finished) {
+        NSAssert(!_finished, @"cipher context finished");
+        return NO;
+    }
+    if (![self process:input length:length sink:sink]) {
+        _failed = YES;
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)_finishWithSink:(MKMCipherSink)sink {
+    if (_failed || _finished) {
+        NSAssert(!_finished, @"cipher context finished");
+        return NO;
+    }
+    _finished = YES;
+    if (![self finishWithSink:sink]) {
+        _failed = YES;
+        return NO;
+    }
+    return YES;
+}
+
+- (nullable NSData *)update:(NSData *)input {
+    NSMutableData *output = [[NSMutableData alloc] initWithCapacity:(input.length + MKMCipherStreamTagSize)];
+    BOOL ok = [self _update:input.bytes length:input.length sink:^BOOL(const uint8_t *bytes, size_t length) {
+        [output appendBytes:bytes length:length];
+        return YES;
+    }];
+    return ok ? output : nil;
+}
+
+- (nullable NSData *)finish {
+    NSMutableData *output = [[NSMutableData alloc] init];
+    BOOL ok = [self _finishWithSink:^BOOL(const uint8_t *bytes, size_t length) {
+        [output appendBytes:bytes length:length];
+        return YES;
+    }];
+    return ok ? output : nil;
+}
+
+- (BOOL)processFileDescriptor:(int)input toFileDescriptor:(int)output {
+    MKMCipherSink sink = ^BOOL(const uint8_t *bytes, size_t length) {
+        return write_all(output, bytes, length);
+    };
+    uint8_t *buffer = malloc(MKMCipherStreamChunkSize);
+    BOOL ok = YES;
+    while (ok) {
+        ssize_t n = read(input, buffer, MKMCipherStreamChunkSize);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            ok = NO;
+        } else if (n == 0) {
+            // EOF
+            break;
+        } else {
+            ok = [self _update:buffer length:(size_t)n sink:sink];
+        }
+    }
+    cipher_wipe(buffer, MKMCipherStreamChunkSize);
+    free(buffer);
+    return ok && [self _finishWithSink:sink];
+}
+
+- (BOOL)processInputStream:(NSInputStream *)input toOutputStream:(NSOutputStream *)output {
+    BOOL openInput = input.streamStatus == NSStreamStatusNotOpen;
+    BOOL openOutput = output.streamStatus == NSStreamStatusNotOpen;
+    if (openInput) {
+        [input open];
+    }
+    if (openOutput) {
+        [output open];
+    }
+    MKMCipherSink sink = ^BOOL(const uint8_t *bytes, size_t length) {
+        return stream_write_all(output, bytes, length);
+    };
+    uint8_t *buffer = malloc(MKMCipherStreamChunkSize);
+    BOOL ok = YES;
+    while (ok) {
+        NSInteger n = [input read:buffer maxLength:MKMCipherStreamChunkSize];
+        if (n < 0) {
+            ok = NO;
+        } else if (n == 0) {
+            // EOF
+            break;
+        } else {
+            ok = [self _update:buffer length:(size_t)n sink:sink];
+        }
+    }
+    cipher_wipe(buffer, MKMCipherStreamChunkSize);
+    free(buffer);
+    ok = ok && [self _finishWithSink:sink];
+    if (openInput) {
+        [input close];
+    }
+    if (openOutput) {
+        [output close];
+    }
+    return ok;
+}
+
+@end
+
+#pragma mark -
+
+@interface MKMChunkedCipherContext () {
+
+    uint8_t _header[MKMCipherStreamHeaderSize];
+    size_t _headerLength;   // header bytes sent / received
+
+    uint64_t _counter;      // index of the next chunk
+
+    uint8_t *_buffer;       // pending input, one chunk (sealed chunk for decryption)
+    size_t _buffered;
+    uint8_t *_output;       // one sealed chunk
+}
+
+@property (strong, nonatomic) id<MKMChunkCipher> cipher;
+@property (nonatomic, getter=isEncrypting) BOOL encrypting;
+@property (nonatomic) NSUInteger chunkSize;
+
+@end
+
+@implementation MKMChunkedCipherContext
+
+- (instancetype)init {
+    NSAssert(false, @"DON'T call me!");
+    id<MKMChunkCipher> cipher = nil;
+    return [self initWithCipher:cipher encrypting:NO chunkSize:0];
+}
+
+/* designated initializer */
+- (instancetype)initWithCipher:(id<MKMChunkCipher>)cipher
+                    encrypting:(BOOL)encrypting
+                     chunkSize:(NSUInteger)size {
+    if (self = [super init]) {
+        _cipher = cipher;
+        _encrypting = encrypting;
+        _headerLength = 0;
+        _counter = 0;
+        _buffer = NULL;
+        _buffered = 0;
+        _output = NULL;
+        if (encrypting) {
+            NSAssert(size >= MKMCipherStreamMinChunkSize && size <= MKMCipherStreamMaxChunkSize,
+                     @"chunk size error: %lu", (unsigned long)size);
+            size = MAX(size, MKMCipherStreamMinChunkSize);
+            size = MIN(size, MKMCipherStreamMaxChunkSize);
+            // header: chunk size + random nonce prefix
+            _header[0] = (uint8_t)(size >> 24);
+            _header[1] = (uint8_t)(size >> 16);
+            _header[2] = (uint8_t)(size >> 8);
+            _header[3] = (uint8_t)size;
+            uint8_t *prefix = _header + 4;
+            if (!drbg_random_bytes(prefix, MKMCipherStreamPrefixSize)) {
+                // system entropy source failed
+                arc4random_buf(prefix, MKMCipherStreamPrefixSize);
+            }
+            [self _allocateBuffers:size];
+        } else {
+            // known after the header is read
+            _chunkSize = 0;
+        }
+    }
+    return self;
+}
+
++ (instancetype)encryptorWithCipher:(id<MKMChunkCipher>)cipher chunkSize:(NSUInteger)size {
+    return [[self alloc] initWithCipher:cipher encrypting:YES chunkSize:size];
+}
+
++ (instancetype)decryptorWithCipher:(id<MKMChunkCipher>)cipher {
+    return [[self alloc] initWithCipher:cipher encrypting:NO chunkSize:0];
+}
+
+- (void)dealloc {
+    // plaintext may be left in the buffers
+    size_t size = _chunkSize + MKMCipherStreamTagSize;
+    if (_buffer) {
+        cipher_wipe(_buffer, size);
+        free(_buffer);
+    }
+    if (_output) {
+        cipher_wipe(_output, size);
+        free(_output);
+    }
+}
+
+- (void)_allocateBuffers:(NSUInteger)chunkSize {
+    _chunkSize = chunkSize;
+    _buffer = malloc(chunkSize + MKMCipherStreamTagSize);
+    _output = malloc(chunkSize + MKMCipherStreamTagSize);
+}
+
+- (BOOL)_nonce:(uint8_t *)nonce last:(BOOL)last {
+    if (_counter > UINT32_MAX) {
+        // too many chunks
+        return NO;
+    }
+    uint32_t index = (uint32_t)_counter++;
+    memcpy(nonce, _header + 4, MKMCipherStreamPrefixSize);
+    nonce[7] = (uint8_t)(index >> 24);
+    nonce[8] = (uint8_t)(index >> 16);
+    nonce[9] = (uint8_t)(index >> 8);
+    nonce[10] = (uint8_t)index;
+    nonce[11] = last ? 1 : 0;
+    return YES;
+}
+
+- (BOOL)_seal:(const uint8_t *)input length:(size_t)length last:(BOOL)last sink:(MKMCipherSink)sink {
+    uint8_t nonce[MKMCipherStreamNonceSize];
+    if (![self _nonce:nonce last:last]) {
+        return NO;
+    }
+    [_cipher sealChunk:input length:length nonce:nonce
+                   aad:_header aadLength:MKMCipherStreamHeaderSize
+                output:_output tag:(_output + length)];
+    return sink(_output, length + MKMCipherStreamTagSize);
+}
+
+- (BOOL)_open:(const uint8_t *)input length:(size_t)length last:(BOOL)last sink:(MKMCipherSink)sink {
+    uint8_t nonce[MKMCipherStreamNonceSize];
+    if (![self _nonce:nonce last:last]) {
+        return NO;
+    }
+    size_t size = length - MKMCipherStreamTagSize;
+    if (![_cipher openChunk:input length:size nonce:nonce
+                         aad:_header aadLength:MKMCipherStreamHeaderSize
+                         tag:(input + size) output:_output]) {
+        // modified, reordered or truncated
+        return NO;
+    }
+    return size == 0 || sink(_output, size);
+}
+
+- (BOOL)_readHeader:(const uint8_t **)input length:(size_t *)length {
+    size_t n = MIN(*length, MKMCipherStreamHeaderSize - _headerLength);
+    memcpy(_header + _headerLength, *input, n);
+    _headerLength += n;
+    *input += n;
+    *length -= n;
+    if (_headerLength < MKMCipherStreamHeaderSize) {
+        // waiting for more
+        return YES;
+    }
+    NSUInteger size = ((NSUInteger)_header[0] << 24) | ((NSUInteger)_header[1] << 16)
+                    | ((NSUInteger)_header[2] << 8) | _header[3];
+    if (size < MKMCipherStreamMinChunkSize || size > MKMCipherStreamMaxChunkSize) {
+        NSLog(@"[Stream] chunk size error: %lu", (unsigned long)size);
+        return NO;
+    }
+    [self _allocateBuffers:size];
+    return YES;
+}
+
+- (BOOL)process:(const uint8_t *)input length:(size_t)length sink:(MKMCipherSink)sink {
+    if (_encrypting) {
+        if (_headerLength == 0) {
+            _headerLength = MKMCipherStreamHeaderSize;
+            if (!sink(_header, MKMCipherStreamHeaderSize)) {
+                return NO;
+            }
+        }
+    } else if (_headerLength < MKMCipherStreamHeaderSize) {
+        if (![self _readHeader:&input length:&length]) {
+            return NO;
+        }
+    }
+    // a full chunk is kept until more input arrives, the last one is for 'finish'
+    size_t size = _encrypting ? _chunkSize : _chunkSize + MKMCipherStreamTagSize;
+    while (length > 0) {
+        if (_buffered == size) {
+            if (![self _chunk:_buffer length:size last:NO sink:sink]) {
+                return NO;
+            }
+            _buffered = 0;
+        }
+        if (_buffered == 0) {
+            // whole chunks straight from the input
+            while (length > size) {
+                if (![self _chunk:input length:size last:NO sink:sink]) {
+                    return NO;
+                }
+                input += size;
+                length -= size;
+            }
+        }
+        size_t n = MIN(length, size - _buffered);
+        memcpy(_buffer + _buffered, input, n);
+        _buffered += n;
+        input += n;
+        length -= n;
+    }
+    return YES;
+}
+
+- (BOOL)finishWithSink:(MKMCipherSink)sink {
+    if (_encrypting) {
+        if (_headerLength == 0) {
+            // empty input
+            _headerLength = MKMCipherStreamHeaderSize;
+            if (!sink(_header, MKMCipherStreamHeaderSize)) {
+                return NO;
+            }
+        }
+    } else if (_headerLength < MKMCipherStreamHeaderSize || _buffered < MKMCipherStreamTagSize) {
+        // truncated
+        return NO;
+    }
+    return [self _chunk:_buffer length:_buffered last:YES sink:sink];
+}
+
+- (BOOL)_chunk:(const uint8_t *)input length:(size_t)length last:(BOOL)last sink:(MKMCipherSink)sink {
+    if (_encrypting) {
+        return [self _seal:input length:length last:last sink:sink];
+    } else {
+        return [self _open:input length:length last:last sink:sink];
+    }
+}
+
+@end
@@ -47,8 +47,22 @@ NS_ASSUME_NONNULL_BEGIN
 *          keySizeInBits: 256,  // optional
 *          data         : "..." // base64_encode()
 *      }
+*
+*      decrypt: opens ECIES messages made by MKMECCPublicKey
 */
-@interface MKMECCPrivateKey : DIMPrivateKey
+@interface MKMECCPrivateKey : DIMPrivateKey <MKMDecryptKey>
+
+/**
+ *  Deterministic signing (RFC 6979 nonce), the same data always gets
+ *  the same signature; default is the class value
+ */
+@property (nonatomic, getter=isDeterministic) BOOL deterministic;
+
+/**
+ *  Default signing mode for new keys, NO for randomized signatures;
+ *  set it to YES before loading keys to make the signatures reproducible
+ */
+@property (class, nonatomic) BOOL deterministicSigning;
 
 @end
 
@@ -0,0 +1,548 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2020 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2020 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMECCPrivateKey.mm
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2020/12/14.
+//  Copyright © 2020 Albert Moky. All rights reserved.
+//
+
+#import <os/lock.h>
+#import <string.h>
+
+#include "sha256.h"
+
+#import "uECC.h"
+#import "ecies.h"
+
+/**
+ *  Refs:
+ *      https://github.com/kmackay/micro-ecc
+ *      https://github.com/digitalbitbox/mcu/blob/master/src/ecc.c
+ */
+
+static inline int ecc_sig_to_der(const uint8_t *sig, uint8_t *der)
+{
+    int i;
+    uint8_t *p = der, *len, *len1, *len2;
+    *p = 0x30;
+    p++; // sequence
+    *p = 0x00;
+    len = p;
+    p++; // len(sequence)
+
+    *p = 0x02;
+    p++; // integer
+    *p = 0x00;
+    len1 = p;
+    p++; // len(integer)
+
+    // process R
+    i = 0;
+    while (sig[i] == 0 && i < 32) {
+        i++; // skip leading zeroes
+    }
+    if (sig[i] >= 0x80) { // put zero in output if MSB set
+        *p = 0x00;
+        p++;
+        *len1 = *len1 + 1;
+    }
+    while (i < 32) { // copy bytes to output
+        *p = sig[i];
+        p++;
+        *len1 = *len1 + 1;
+        i++;
+    }
+
+    *p = 0x02;
+    p++; // integer
+    *p = 0x00;
+    len2 = p;
+    p++; // len(integer)
+
+    // process S
+    i = 32;
+    while (sig[i] == 0 && i < 64) {
+        i++; // skip leading zeroes
+    }
+    if (sig[i] >= 0x80) { // put zero in output if MSB set
+        *p = 0x00;
+        p++;
+        *len2 = *len2 + 1;
+    }
+    while (i < 64) { // copy bytes to output
+        *p = sig[i];
+        p++;
+        *len2 = *len2 + 1;
+        i++;
+    }
+
+    *len = *len1 + *len2 + 4;
+    return *len + 2;
+}
+
+#pragma mark - HMAC-SHA256 for RFC 6979
+
+/*
+ *  uECC_sign_deterministic() starts every HMAC with init_hash() and one
+ *  key pad block (K ^ ipad or K ^ opad), so the context can look the block
+ *  up and restore the hash state after it instead of hashing it again:
+ *
+ *      1. K = 0 is the first key of every signature, its ipad/opad states
+ *         and the first message 'V || 0x00 || x' depend on the private key
+ *         only, they are computed once per key (ecc_hmac_key);
+ *      2. every later K is used twice (for V and then the next K or T),
+ *         the context keeps its states for the second use.
+ *
+ *  A restored state is the state after hashing that very block, so the
+ *  results are always plain HMAC-SHA256.
+ */
+
+// precomputed for the private key, immutable
+struct ecc_hmac_key {
+    uint8_t pads[2][64];  // ipad, opad (K = 0)
+    CSHA256 keyed[2];     // after pads
+    CSHA256 prefix;       // after ipad and message
+    uint8_t message[65];  // V (0x01 * 32) || 0x00 || x
+};
+
+struct ecc_hmac_context {
+    uECC_HashContext uECC;
+    const ecc_hmac_key *key;
+    CSHA256 sha;
+    bool fresh;            // nothing hashed since init_hash()
+    int pending;           // bytes of key->message matched but not hashed, -1 for none
+    bool cached[2];
+    uint8_t pads[2][64];   // ipad, opad (current K)
+    CSHA256 keyed[2];
+    uint8_t tmp[2 * 32 + 64];
+};
+
+static void ecc_hmac_key_init(ecc_hmac_key *hk, const uint8_t *prikey) {
+    memset(hk->pads[0], 0x36, 64);
+    memset(hk->pads[1], 0x5c, 64);
+    hk->keyed[0].Reset().Write(hk->pads[0], 64);
+    hk->keyed[1].Reset().Write(hk->pads[1], 64);
+    memset(hk->message, 0x01, 32);
+    hk->message[32] = 0x00;
+    memcpy(hk->message + 33, prikey, 32);
+    hk->prefix = hk->keyed[0];
+    hk->prefix.Write(hk->message, sizeof(hk->message));
+}
+
+static void ecc_hmac_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    while (len-- > 0) {
+        *p++ = 0;
+    }
+}
+
+static void ecc_hmac_init(const uECC_HashContext *base) {
+    ecc_hmac_context *ctx = (ecc_hmac_context *)base;
+    ctx->sha.Reset();
+    ctx->fresh = true;
+    ctx->pending = -1;
+}
+
+// restore the state after the first block
+static void ecc_hmac_restore(ecc_hmac_context *ctx, const uint8_t *block) {
+    int which = block[63] == 0x5c ? 1 : 0;
+    if (memcmp(block, ctx->key->pads[which], 64) == 0) {
+        // K = 0, the inner hash goes on with the key's message
+        ctx->sha = ctx->key->keyed[which];
+        ctx->pending = which == 0 ? 0 : -1;
+    } else if (ctx->cached[which] && memcmp(block, ctx->pads[which], 64) == 0) {
+        ctx->sha = ctx->keyed[which];
+    } else {
+        ctx->sha.Write(block, 64);
+        ctx->keyed[which] = ctx->sha;
+        memcpy(ctx->pads[which], block, 64);
+        ctx->cached[which] = true;
+    }
+}
+
+static void ecc_hmac_update(const uECC_HashContext *base, const uint8_t *message, unsigned message_size) {
+    ecc_hmac_context *ctx = (ecc_hmac_context *)base;
+    if (ctx->fresh) {
+        ctx->fresh = false;
+        if (message_size == 64) {
+            ecc_hmac_restore(ctx, message);
+            return;
+        }
+    }
+    if (ctx->pending >= 0) {
+        const uint8_t *expected = ctx->key->message + ctx->pending;
+        if (ctx->pending + message_size <= sizeof(ctx->key->message) &&
+            memcmp(expected, message, message_size) == 0) {
+            ctx->pending += message_size;
+            if (ctx->pending == sizeof(ctx->key->message)) {
+                ctx->sha = ctx->key->prefix;
+                ctx->pending = -1;
+            }
+            return;
+        }
+        ctx->sha.Write(ctx->key->message, ctx->pending);
+        ctx->pending = -1;
+    }
+    ctx->sha.Write(message, message_size);
+}
+
+static void ecc_hmac_finish(const uECC_HashContext *base, uint8_t *hash_result) {
+    ecc_hmac_context *ctx = (ecc_hmac_context *)base;
+    if (ctx->pending > 0) {
+        ctx->sha.Write(ctx->key->message, ctx->pending);
+    }
+    ctx->pending = -1;
+    ctx->sha.Finalize(hash_result);
+}
+
+static int ecc_sign_deterministic(const uint8_t *prikey, const ecc_hmac_key *hk,
+                                  const uint8_t *hash, unsigned hash_size,
+                                  uint8_t *sig, uECC_Curve curve) {
+    ecc_hmac_context ctx;
+    ctx.uECC.init_hash = ecc_hmac_init;
+    ctx.uECC.update_hash = ecc_hmac_update;
+    ctx.uECC.finish_hash = ecc_hmac_finish;
+    ctx.uECC.block_size = 64;
+    ctx.uECC.result_size = 32;
+    ctx.uECC.tmp = ctx.tmp;
+    ctx.key = hk;
+    ctx.fresh = false;
+    ctx.pending = -1;
+    ctx.cached[0] = ctx.cached[1] = false;
+    int res = uECC_sign_deterministic(prikey, hash, hash_size, &ctx.uECC, sig, curve);
+    ecc_hmac_wipe(&ctx, sizeof(ctx));
+    return res;
+}
+
+#pragma mark -
+
+#import "MKMSecKeyHelper.h"
+#import "DIMInternTable.h"
+#import "MKMECCPublicKey.h"
+
+#import "MKMECCPrivateKey.h"
+
+@interface MKMECCPrivateKey () {
+    
+    NSData *_data;
+    
+    NSUInteger _keySize;
+    
+    const uint8_t *_prikey;
+    
+    MKMECCPublicKey *_publicKey;
+    
+    BOOL _deterministic;
+    
+    os_unfair_lock _lock;
+    NSData *_hmacKey;  // ecc_hmac_key
+    DIMInternTable<NSData *> *_receivers;  // epk => ecies_key
+}
+
+@property (strong, nonatomic) NSData *data;
+
+@property (nonatomic) NSUInteger keySize;
+
+@property (nonatomic) const uint8_t *prikey;
+
+@property (strong, nonatomic, nullable) MKMECCPublicKey *publicKey;
+
+// keyed HMAC states for deterministic signing (ecc_hmac_key)
+@property (strong, nonatomic, nullable) NSData *hmacKey;
+
+@end
+
+static BOOL s_deterministicSigning = NO;
+
+// senders keep their ephemeral keys for a while (see MKMECCPublicKey),
+// remember the keys derived for the latest ones
+#define ECIES_RECEIVER_CAPACITY 256
+
+static inline NSData *ecies_receiver_create(const uint8_t *prikey, const uint8_t *pubkey,
+                                            const uint8_t *epk, uECC_Curve curve) {
+    ecies_key *key = (ecies_key *)malloc(sizeof(ecies_key));
+    if (!ecies_receiver_init(key, prikey, pubkey, epk, curve)) {
+        ecies_key_wipe(key);
+        free(key);
+        return nil;
+    }
+    return [[NSData alloc] initWithBytesNoCopy:key
+                                        length:sizeof(ecies_key)
+                                   deallocator:^(void *bytes, NSUInteger length) {
+        ecies_key_wipe((ecies_key *)bytes);
+        free(bytes);
+    }];
+}
+
+@implementation MKMECCPrivateKey
+
++ (BOOL)deterministicSigning {
+    return s_deterministicSigning;
+}
+
++ (void)setDeterministicSigning:(BOOL)deterministicSigning {
+    s_deterministicSigning = deterministicSigning;
+}
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
+    if (self = [super initWithDictionary:keyInfo]) {
+        // lazy
+        _data = nil;
+        
+        _keySize = 0;
+        
+        _prikey = NULL;
+        
+        _publicKey = nil;
+        
+        _deterministic = s_deterministicSigning;
+        
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _hmacKey = nil;
+        _receivers = nil;
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    
+    // clear prikey
+    self.prikey = NULL;
+
+    //[super dealloc];
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    MKMECCPrivateKey *key = [super copyWithZone:zone];
+    if (key) {
+        key.data = _data;
+        key.keySize = _keySize;
+        key.prikey = _prikey;
+        key.publicKey = _publicKey;
+        key.deterministic = _deterministic;
+        // immutable once created, share it
+        key.hmacKey = self.hmacKey;
+    }
+    return key;
+}
+
+- (uECC_Curve)curve {
+    // TODO: other curve?
+    return uECC_secp256k1();
+}
+
+- (NSData *)data {
+    if (!_data) {
+        NSString *pem = [self objectForKey:@"data"];
+        // check for raw data (32 bytes)
+        NSUInteger len = pem.length;
+        if (len == 64) {
+            // Hex encode
+            _data = MKMHexDecode(pem);
+        } else if (len > 0) {
+            // PEM
+            _data = [MKMSecKeyHelper privateKeyDataFromContent:pem algorithm:MKMAlgorithm_ECC];
+        } else {
+            // generate it
+            // TODO: check key size?
+            uint8_t pubkey[64] = {0};
+            uint8_t prikey[32] = {0};
+            int res = uECC_make_key(pubkey, prikey, self.curve);
+            if (res != 1) {
+                NSAssert(false, @"failed to generate ECC private key");
+                return nil;
+            }
+            _data = [[NSData alloc] initWithBytes:prikey length:32];
+            [self setObject:MKMHexEncode(_data) forKey:@"data"];
+        }
+    }
+    return _data;
+}
+- (void)setData:(NSData *)data {
+    _data = data;
+}
+
+- (NSUInteger)keySize {
+    if (_keySize == 0) {
+        NSNumber *size = [self objectForKey:@"keySize"];
+        if (size == nil) {
+            _keySize = 256 / 8; // 32
+        } else {
+            _keySize = size.unsignedIntegerValue;
+        }
+    }
+    return _keySize;
+}
+
+- (const uint8_t *)prikey {
+    if (_prikey == NULL) {
+        NSData *data = self.data;
+        _prikey = (const uint8_t *)data.bytes;
+    }
+    return _prikey;
+}
+
+- (MKMECCPublicKey *)publicKey {
+    if (!_publicKey) {
+        // get public key content from private key
+        uint8_t pubkey[65] = {0};
+        pubkey[0] = 0x04;
+        int res = uECC_compute_public_key(self.prikey, pubkey+1, self.curve);
+        if (res != 1) {
+            NSAssert(false, @"failed to create ECC public key");
+            return nil;
+        }
+        size_t len = sizeof(pubkey);
+        
+        NSData *data = [[NSData alloc] initWithBytes:pubkey length:len];
+        NSString *hex = MKMHexEncode(data);
+        NSDictionary *dict = @{@"algorithm":MKMAlgorithm_ECC,
+                               @"data"     :hex,
+                               @"curve"    :@"secp256k1",
+                               @"digest"   :@"SHA256",
+                               };
+        _publicKey = [[MKMECCPublicKey alloc] initWithDictionary:dict];
+    }
+    return _publicKey;
+}
+
+- (void)setPublicKey:(nullable MKMECCPublicKey *)publicKey {
+    _publicKey = publicKey;
+}
+
+- (nullable NSData *)hmacKey {
+    NSData *hmacKey;
+    os_unfair_lock_lock(&_lock);
+    hmacKey = _hmacKey;
+    os_unfair_lock_unlock(&_lock);
+    if (hmacKey) {
+        return hmacKey;
+    }
+    const uint8_t *prikey = self.prikey;
+    if (prikey == NULL) {
+        return nil;
+    }
+    ecc_hmac_key hk;
+    ecc_hmac_key_init(&hk, prikey);
+    hmacKey = [[NSData alloc] initWithBytes:&hk length:sizeof(hk)];
+    ecc_hmac_wipe(&hk, sizeof(hk));
+    os_unfair_lock_lock(&_lock);
+    if (!_hmacKey) {
+        _hmacKey = hmacKey;
+    }
+    hmacKey = _hmacKey;
+    os_unfair_lock_unlock(&_lock);
+    return hmacKey;
+}
+- (void)setHmacKey:(nullable NSData *)hmacKey {
+    os_unfair_lock_lock(&_lock);
+    _hmacKey = hmacKey;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (NSData *)sign:(NSData *)data {
+    NSData *hash = MKMSHA256Digest(data);
+    uint8_t sig[64];
+    int res;
+    if (_deterministic) {
+        NSData *hmacKey = self.hmacKey;
+        res = !hmacKey ? 0 : ecc_sign_deterministic(self.prikey, (const ecc_hmac_key *)hmacKey.bytes,
+                                                    (const uint8_t *)hash.bytes, (unsigned)hash.length,
+                                                    sig, self.curve);
+    } else {
+        res = uECC_sign(self.prikey, (const uint8_t *)hash.bytes, (unsigned)hash.length, sig, self.curve);
+    }
+    if (res != 1) {
+        NSAssert(false, @"failed to sign with ECC private key");
+        return nil;
+    }
+    uint8_t vchSig[72];
+    size_t nSigLen = ecc_sig_to_der(sig, vchSig);
+    return [[NSData alloc] initWithBytes:vchSig length:nSigLen];
+}
+
+// derived key for the ephemeral public key (33 bytes), nil for invalid key
+- (nullable NSData *)receivingKey:(NSData *)epk {
+    NSData *key;
+    DIMInternTable<NSData *> *receivers;
+    os_unfair_lock_lock(&_lock);
+    if (!_receivers) {
+        // keys not used recently are evicted when full
+        _receivers = [[DIMInternTable alloc] initWithCapacity:ECIES_RECEIVER_CAPACITY];
+    }
+    receivers = _receivers;
+    os_unfair_lock_unlock(&_lock);
+    key = [receivers objectForKey:epk];
+    if (key) {
+        return key;
+    }
+    NSData *pubkey = self.publicKey.data;  // 0x04 + 64 bytes
+    if (pubkey.length != 65 || !self.prikey) {
+        NSAssert(false, @"ECC private key error: %@", self);
+        return nil;
+    }
+    key = ecies_receiver_create(self.prikey, (const uint8_t *)pubkey.bytes + 1,
+                                (const uint8_t *)epk.bytes, self.curve);
+    if (!key) {
+        return nil;
+    }
+    return [receivers internObject:key forKey:epk];
+}
+
+- (nullable NSData *)decrypt:(NSData *)ciphertext params:(nullable NSDictionary *)extra {
+    NSUInteger length = ciphertext.length;
+    if (length < ECIES_OVERHEAD) {
+        NSLog(@"[ECC] ciphertext too short: %lu", length);
+        return nil;
+    }
+    NSData *epk = [ciphertext subdataWithRange:NSMakeRange(0, ECIES_POINT_SIZE)];
+    NSData *key = [self receivingKey:epk];
+    if (!key) {
+        // not an ECIES message
+        return nil;
+    }
+    NSMutableData *plaintext = [[NSMutableData alloc] initWithLength:(length - ECIES_OVERHEAD)];
+    if (!ecies_open((const ecies_key *)key.bytes, (const uint8_t *)ciphertext.bytes, length,
+                    (uint8_t *)plaintext.mutableBytes)) {
+        // wrong key or modified data
+        return nil;
+    }
+    return plaintext;
+}
+
+- (BOOL)matchEncryptKey:(id<MKMEncryptKey>)pKey {
+    return DIMCryptoMatchEncryptKey(pKey, self);
+}
+
+@end
@@ -46,8 +46,36 @@ NS_ASSUME_NONNULL_BEGIN
 *          algorithm: "ECC",
 *          data: "..."       // base64
 *      }
+*
+*      encrypt: ECIES, ECDH + X9.63 KDF (SHA-256) + ChaCha20-Poly1305,
+*               ephemeral public key (33 bytes) + nonce (12 bytes) + data + tag (16 bytes)
+*               (disabled by default, see 'encryptionEnabled')
 */
-@interface MKMECCPublicKey : DIMPublicKey
+@interface MKMECCPublicKey : DIMPublicKey <MKMEncryptKey>
+
+/**
+ *  Use ECC keys (in meta/visa) for encrypting message keys, default is NO;
+ *  when disabled, the keys don't conform to MKMEncryptKey at runtime, so
+ *  the facebook will not pick them as visa keys. Set it to YES only when
+ *  all peers can open ECIES messages (made by MKMECCPrivateKey).
+ */
+@property (class, nonatomic) BOOL encryptionEnabled;
+
+@end
+
+@interface MKMECCPublicKey (Batch)
+
+/**
+ *  Verify a batch of signatures, signatures by the same key share the work
+ *
+ * @param data       - signed data
+ * @param signatures - signatures (DER)
+ * @param keys       - signer's public key for each signature
+ * @return bitmap, bit (i % 8) of byte (i / 8) is set when signature i matches
+ */
++ (NSData *)verifyBatch:(NSArray<NSData *> *)data
+             signatures:(NSArray<NSData *> *)signatures
+                   keys:(NSArray<id<MKMVerifyKey>> *)keys;
 
 @end
 
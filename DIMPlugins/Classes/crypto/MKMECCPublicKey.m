@@ -35,9 +35,16 @@
 //  Copyright © 2020 Albert Moky. All rights reserved.
 //
 
+#import <os/lock.h>
+#import <stdatomic.h>
+#import <objc/runtime.h>
+
 #import "uECC.h"
+#import "ecies.h"
+#import "drbg.h"
 
 #import "MKMSecKeyHelper.h"
+#import "DIMInternTable.h"
 
 #import "MKMECCPublicKey.h"
 
@@ -135,25 +142,128 @@ static inline int ecc_der_to_sig(const uint8_t *der, int der_len, uint8_t *sig_6
     return 0;
 }
 
+#pragma mark - ECIES sending contexts
+
+/*
+ *  One ephemeral key pair per peer, shared by the messages sealed to it
+ *  for a while: wrapping message keys for the same members again and again
+ *  costs one AEAD instead of two scalar multiplications each time.
+ *  Every message still gets a random nonce, and the ephemeral key is
+ *  replaced after ECIES_SENDER_LIFETIME or ECIES_SENDER_MAX_USES.
+ */
+#define ECIES_SENDER_LIFETIME  3600   // seconds
+#define ECIES_SENDER_MAX_USES  65536
+#define ECIES_SENDER_CAPACITY  1024   // peers
+
+typedef struct ecies_sender {
+    ecies_key key;
+    time_t expires;
+    _Atomic NSUInteger uses;
+} ecies_sender;
+
+// peer (64 bytes point) => ecies_sender, peers not used recently are evicted when full
+static inline DIMInternTable<NSMutableData *> *ecies_senders(void) {
+    static DIMInternTable *s_senders = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        s_senders = [[DIMInternTable alloc] initWithCapacity:ECIES_SENDER_CAPACITY];
+    });
+    return s_senders;
+}
+
+static inline NSMutableData *ecies_sender_create(const uint8_t *peer, uECC_Curve curve) {
+    ecies_sender *sender = malloc(sizeof(ecies_sender));
+    if (!ecies_sender_init(&sender->key, peer, curve)) {
+        ecies_key_wipe(&sender->key);
+        free(sender);
+        return nil;
+    }
+    sender->expires = time(NULL) + ECIES_SENDER_LIFETIME;
+    atomic_init(&sender->uses, 0);
+    return [[NSMutableData alloc] initWithBytesNoCopy:sender
+                                               length:sizeof(ecies_sender)
+                                          deallocator:^(void *bytes, NSUInteger length) {
+        ecies_key_wipe(&((ecies_sender *)bytes)->key);
+        free(bytes);
+    }];
+}
+
+// seal with the current context for this peer (64 bytes point), renew it when used up
+static BOOL ecies_sender_seal(NSData *peer, uECC_Curve curve, const uint8_t *nonce,
+                              const uint8_t *in, size_t len, uint8_t *out) {
+    DIMInternTable<NSMutableData *> *senders = ecies_senders();
+    NSMutableData *context = [senders objectForKey:peer];
+    ecies_sender *sender;
+    if (context) {
+        sender = context.mutableBytes;
+        if (atomic_fetch_add(&sender->uses, 1) >= ECIES_SENDER_MAX_USES ||
+            sender->expires < time(NULL)) {
+            [senders removeObject:context forKey:peer];
+            context = nil;
+        }
+    }
+    if (!context) {
+        // new ephemeral key pair
+        context = ecies_sender_create(peer.bytes, curve);
+        if (!context) {
+            return NO;
+        }
+        // another thread may create one for this peer at the same time
+        context = [senders internObject:context forKey:peer];
+    }
+    // the context is immutable except 'uses', safe to read without lock
+    sender = context.mutableBytes;
+    ecies_seal(&sender->key, nonce, in, len, out);
+    return YES;
+}
+
+#pragma mark -
+
+// build the table of multiples after this many verifications by the same key
+#define ECC_PRECOMPUTE_THRESHOLD 8
+
 @interface MKMECCPublicKey () {
     
     NSData *_data;
     
     NSUInteger _keySize;
     
-    const uint8_t *_pubkey;
+    os_unfair_lock _lock;
+    NSData *_parsedKey;     // uECC_PrecomputedKey
+    NSData *_table;         // multiples of the point, built after enough verifications
+    BOOL _invalid;
+    NSUInteger _verifications;
 }
 
 @property (strong, nonatomic) NSData *data;
 
 @property (nonatomic) NSUInteger keySize;
 
-@property (nonatomic) const uint8_t *pubkey;
+// decoded and validated point (uECC_PrecomputedKey), nil for invalid key
+@property (strong, nonatomic, nullable) NSData *parsedKey;
 
 @end
 
+static BOOL s_encryptionEnabled = NO;
+
 @implementation MKMECCPublicKey
 
++ (BOOL)encryptionEnabled {
+    return s_encryptionEnabled;
+}
+
++ (void)setEncryptionEnabled:(BOOL)encryptionEnabled {
+    s_encryptionEnabled = encryptionEnabled;
+}
+
+- (BOOL)conformsToProtocol:(Protocol *)protocol {
+    if (!s_encryptionEnabled && protocol_isEqual(protocol, @protocol(MKMEncryptKey))) {
+        // peers without ECIES cannot decrypt
+        return NO;
+    }
+    return [super conformsToProtocol:protocol];
+}
+
 /* designated initializer */
 - (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
     if (self = [super initWithDictionary:keyInfo]) {
@@ -162,26 +272,28 @@ static inline int ecc_der_to_sig(const uint8_t *der, int der_len, uint8_t *sig_6
         
         _keySize = 0;
         
-        _pubkey = NULL;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _parsedKey = nil;
+        _table = nil;
+        _invalid = NO;
+        _verifications = 0;
     }
     
     return self;
 }
 
-- (void)dealloc {
-    
-    // clear pubkey
-    self.pubkey = NULL;
-    
-    //[super dealloc];
-}
-
 - (id)copyWithZone:(nullable NSZone *)zone {
     MKMECCPublicKey *key = [super copyWithZone:zone];
     if (key) {
         key.data = _data;
         key.keySize = _keySize;
-        key.pubkey = _pubkey;
+        // immutable once created, share it
+        os_unfair_lock_lock(&_lock);
+        NSData *parsed = _parsedKey;
+        NSData *table = _table;
+        os_unfair_lock_unlock(&_lock);
+        key.parsedKey = parsed;
+        key->_table = table;
     }
     return key;
 }
@@ -191,27 +303,77 @@ static inline int ecc_der_to_sig(const uint8_t *der, int der_len, uint8_t *sig_6
     return uECC_secp256k1();
 }
 
-- (const uint8_t *)pubkey {
-    if (_pubkey == NULL) {
-        NSData *data = self.data;
-        _pubkey = data.bytes;
-        // TODO: check for compressed key
-        if (data.length == 65) {
-            _pubkey = _pubkey+1;
-        }
+- (nullable NSData *)parsedKey {
+    NSData *parsed;
+    BOOL invalid;
+    os_unfair_lock_lock(&_lock);
+    parsed = _parsedKey;
+    invalid = _invalid;
+    os_unfair_lock_unlock(&_lock);
+    if (parsed || invalid) {
+        return parsed;
+    }
+    // decode & check the point only once
+    NSData *data = self.data;
+    const uint8_t *point = data.bytes;
+    uint8_t buffer[64];
+    if (data.length == 65 && point[0] == 0x04) {
+        point = point + 1;
+    } else if (data.length == 33) {
+        // compressed key
+        uECC_decompress(point, buffer, self.curve);
+        point = buffer;
+    } else if (data.length != 64) {
+        point = NULL;
+    }
+    NSMutableData *key = [[NSMutableData alloc] initWithLength:sizeof(uECC_PrecomputedKey)];
+    if (!point || !uECC_import_public_key(point, key.mutableBytes, self.curve)) {
+        NSAssert(false, @"ECC public key error: %@", self);
+        os_unfair_lock_lock(&_lock);
+        _invalid = YES;
+        os_unfair_lock_unlock(&_lock);
+        return nil;
     }
-    return _pubkey;
+    os_unfair_lock_lock(&_lock);
+    if (!_parsedKey) {
+        _parsedKey = key;
+    }
+    parsed = _parsedKey;
+    os_unfair_lock_unlock(&_lock);
+    return parsed;
 }
-- (void)setPubkey:(const uint8_t *)pubkey {
-    if (_pubkey != pubkey) {
-        if (_pubkey != NULL) {
-            //free(_pubkey);
-            _pubkey = NULL;
-        }
-        if (pubkey != NULL) {
-            _pubkey = pubkey;
+- (void)setParsedKey:(nullable NSData *)parsedKey {
+    os_unfair_lock_lock(&_lock);
+    _parsedKey = parsedKey;
+    os_unfair_lock_unlock(&_lock);
+}
+
+// current table of the parsed key, not counted as a verification
+- (nullable NSData *)table {
+    NSData *table;
+    os_unfair_lock_lock(&_lock);
+    table = _table;
+    os_unfair_lock_unlock(&_lock);
+    return table;
+}
+
+// table of the parsed key, built after enough verifications (nil before that)
+- (nullable NSData *)verifyingTable:(NSData *)parsed {
+    NSData *table;
+    BOOL precompute;
+    os_unfair_lock_lock(&_lock);
+    table = _table;
+    precompute = !table && (++_verifications == ECC_PRECOMPUTE_THRESHOLD);
+    os_unfair_lock_unlock(&_lock);
+    if (precompute) {
+        NSMutableData *multiples = [[NSMutableData alloc] initWithLength:uECC_PRECOMPUTED_TABLE_SIZE];
+        if (uECC_precompute_table(parsed.bytes, multiples.mutableBytes)) {
+            os_unfair_lock_lock(&_lock);
+            _table = table = multiples;
+            os_unfair_lock_unlock(&_lock);
         }
     }
+    return table;
 }
 
 - (NSData *)data {
@@ -265,7 +427,12 @@ static inline int ecc_der_to_sig(const uint8_t *der, int der_len, uint8_t *sig_6
             NSAssert(false, @"failed to verify with ECC private key");
             return NO;
         }
-        return uECC_verify(self.pubkey, hash.bytes, (unsigned)hash.length, sig, self.curve);
+        NSData *key = self.parsedKey;
+        if (!key) {
+            return NO;
+        }
+        NSData *table = [self verifyingTable:key];
+        return uECC_verify_precomputed(key.bytes, table.bytes, hash.bytes, (unsigned)hash.length, sig);
     } @catch (NSException *exception) {
         NSLog(@"[ECC] failed to verify: %@", exception);
     } @finally {
@@ -273,4 +440,134 @@ static inline int ecc_der_to_sig(const uint8_t *der, int der_len, uint8_t *sig_6
     }
 }
 
+- (NSData *)encrypt:(NSData *)plaintext params:(nullable NSMutableDictionary *)extra {
+    NSData *parsed = self.parsedKey;
+    if (!parsed) {
+        return nil;
+    }
+    const uECC_PrecomputedKey *key = parsed.bytes;
+    NSData *peer = [[NSData alloc] initWithBytes:key->public_key length:64];
+    uint8_t nonce[ECIES_NONCE_SIZE];
+    if (!drbg_random_bytes(nonce, sizeof(nonce))) {
+        // system entropy source failed
+        arc4random_buf(nonce, sizeof(nonce));
+    }
+    NSUInteger length = plaintext.length;
+    NSMutableData *ciphertext = [[NSMutableData alloc] initWithLength:(length + ECIES_OVERHEAD)];
+    if (!ecies_sender_seal(peer, self.curve, nonce, plaintext.bytes, length, ciphertext.mutableBytes)) {
+        NSAssert(false, @"failed to encrypt with ECC public key: %@", self);
+        return nil;
+    }
+    return ciphertext;
+}
+
+@end
+
+@implementation MKMECCPublicKey (Batch)
+
++ (NSData *)verifyBatch:(NSArray<NSData *> *)data
+             signatures:(NSArray<NSData *> *)signatures
+                   keys:(NSArray<id<MKMVerifyKey>> *)keys {
+    NSUInteger count = [data count];
+    NSAssert([signatures count] == count && [keys count] == count,
+             @"batch not match: %lu, %lu, %lu", count, [signatures count], [keys count]);
+    NSMutableData *results = [[NSMutableData alloc] initWithLength:(count + 7) / 8];
+    uint8_t *bitmap = [results mutableBytes];
+    
+    // 1. group by public key, so that signatures by the same key are
+    //    consecutive and share the decoded point
+    NSMutableDictionary<NSData *, NSMutableArray<NSNumber *> *> *groups;
+    groups = [[NSMutableDictionary alloc] init];
+    NSMutableArray<NSData *> *order = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *indexes;
+    id<MKMVerifyKey> pKey;
+    MKMECCPublicKey *key;
+    NSUInteger index;
+    for (index = 0; index < count; ++index) {
+        pKey = [keys objectAtIndex:index];
+        if (![pKey isKindOfClass:[MKMECCPublicKey class]]) {
+            // other key, check it alone
+            if ([pKey verify:[data objectAtIndex:index] withSignature:[signatures objectAtIndex:index]]) {
+                bitmap[index / 8] |= 1 << (index % 8);
+            }
+            continue;
+        }
+        key = (MKMECCPublicKey *)pKey;
+        if (!key.parsedKey) {
+            continue;
+        }
+        indexes = [groups objectForKey:key.data];
+        if (!indexes) {
+            indexes = [[NSMutableArray alloc] init];
+            [groups setObject:indexes forKey:key.data];
+            [order addObject:key.data];
+        }
+        [indexes addObject:@(index)];
+    }
+    
+    // 2. decode signatures and digest data
+    uECC_Curve curve = uECC_secp256k1();
+    const uECC_PrecomputedKey **pubkeys = malloc(count * sizeof(const uECC_PrecomputedKey *));
+    const uint64_t **tables = malloc(count * sizeof(const uint64_t *));
+    const uint8_t **hashes = malloc(count * sizeof(const uint8_t *));
+    const uint8_t **sigs = malloc(count * sizeof(const uint8_t *));
+    NSUInteger *positions = malloc(count * sizeof(NSUInteger));
+    NSMutableData *buffer = [[NSMutableData alloc] initWithLength:count * (32 + 64)];
+    uint8_t *hash = [buffer mutableBytes];
+    uint8_t *sig = hash + count * 32;
+    unsigned total = 0;
+    // keep the parsed keys & tables till verified
+    NSMutableArray<NSData *> *parsedKeys = [[NSMutableArray alloc] initWithCapacity:order.count * 2];
+    for (NSData *pk in order) {
+        const uECC_PrecomputedKey *point = NULL;
+        const uint64_t *table = NULL;
+        for (NSNumber *pos in [groups objectForKey:pk]) {
+            index = [pos unsignedIntegerValue];
+            NSData *signature = [signatures objectAtIndex:index];
+            if (ecc_der_to_sig(signature.bytes, (int)signature.length, sig + total * 64) != 0) {
+                continue;
+            }
+            key = (MKMECCPublicKey *)[keys objectAtIndex:index];
+            if (point == NULL) {
+                // same pointer for the whole group, decoded already
+                NSData *parsed = key.parsedKey;
+                [parsedKeys addObject:parsed];
+                point = parsed.bytes;
+                NSData *multiples = [key table];
+                if (multiples) {
+                    [parsedKeys addObject:multiples];
+                    table = multiples.bytes;
+                }
+            }
+            NSData *digest = MKMSHA256Digest([data objectAtIndex:index]);
+            memcpy(hash + total * 32, digest.bytes, 32);
+            pubkeys[total] = point;
+            tables[total] = table;
+            hashes[total] = hash + total * 32;
+            sigs[total] = sig + total * 64;
+            positions[total] = index;
+            ++total;
+        }
+    }
+    
+    // 3. verify together
+    if (total > 0) {
+        uint8_t *verified = malloc((total + 7) / 8);
+        uECC_verify_batch(pubkeys, tables, NULL, hashes, 32, sigs, total, verified, curve);
+        for (unsigned i = 0; i < total; ++i) {
+            if (verified[i / 8] & (1 << (i % 8))) {
+                index = positions[i];
+                bitmap[index / 8] |= 1 << (index % 8);
+            }
+        }
+        free(verified);
+    }
+    free(pubkeys);
+    free(tables);
+    free(hashes);
+    free(sigs);
+    free(positions);
+    return results;
+}
+
 @end
@@ -0,0 +1,57 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMEd25519PrivateKey.h
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <DIMCore/DIMCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ *  Ed25519 Private Key
+ *
+ *      keyInfo format: {
+ *          algorithm: "Ed25519",
+ *          data     : "..."       // hex, 32 bytes seed
+ *      }
+ *
+ *      decrypt: opens sealed boxes made by MKMEd25519PublicKey,
+ *               with the X25519 form of this key
+ */
+@interface MKMEd25519PrivateKey : DIMPrivateKey <MKMDecryptKey>
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,219 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMEd25519PrivateKey.m
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "ed25519.h"
+#import "drbg.h"
+
+#import "MKMPlugins.h"
+#import "MKMEd25519PublicKey.h"
+
+#import "MKMEd25519PrivateKey.h"
+
+static inline NSData *ed25519_expand(NSData *seed) {
+    ed25519_key *key = malloc(sizeof(ed25519_key));
+    ed25519_key_init(key, seed.bytes);
+    return [[NSData alloc] initWithBytesNoCopy:key
+                                        length:sizeof(ed25519_key)
+                                   deallocator:^(void *bytes, NSUInteger length) {
+        ed25519_key_wipe(bytes);
+        free(bytes);
+    }];
+}
+
+@interface MKMEd25519PrivateKey () {
+    
+    NSData *_data;
+    
+    MKMEd25519PublicKey *_publicKey;
+    
+    os_unfair_lock _lock;
+    NSData *_expandedKey;  // ed25519_key
+}
+
+@property (strong, nonatomic) NSData *data;
+
+@property (strong, nonatomic, nullable) MKMEd25519PublicKey *publicKey;
+
+@property (strong, nonatomic, nullable) NSData *expandedKey;
+
+@end
+
+@implementation MKMEd25519PrivateKey
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
+    if (self = [super initWithDictionary:keyInfo]) {
+        // lazy
+        _data = nil;
+        
+        _publicKey = nil;
+        
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _expandedKey = nil;
+    }
+    
+    return self;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    MKMEd25519PrivateKey *key = [super copyWithZone:zone];
+    if (key) {
+        key.data = _data;
+        key.publicKey = _publicKey;
+        // immutable once created, share it
+        os_unfair_lock_lock(&_lock);
+        NSData *expandedKey = _expandedKey;
+        os_unfair_lock_unlock(&_lock);
+        key.expandedKey = expandedKey;
+    }
+    return key;
+}
+
+- (NSData *)data {
+    if (!_data) {
+        NSString *hex = [self objectForKey:@"data"];
+        if (hex.length > 0) {
+            NSAssert(hex.length == ED25519_SEED_SIZE * 2, @"Ed25519 private key error: %@", self);
+            _data = MKMHexDecode(hex);
+        } else {
+            // generate it
+            NSMutableData *seed = [[NSMutableData alloc] initWithLength:ED25519_SEED_SIZE];
+            if (!drbg_random_bytes(seed.mutableBytes, ED25519_SEED_SIZE)) {
+                // system entropy source failed
+                arc4random_buf(seed.mutableBytes, ED25519_SEED_SIZE);
+            }
+            _data = seed;
+            [self setObject:MKMHexEncode(_data) forKey:@"data"];
+        }
+    }
+    return _data;
+}
+- (void)setData:(NSData *)data {
+    _data = data;
+}
+
+- (nullable NSData *)expandedKey {
+    NSData *expandedKey;
+    os_unfair_lock_lock(&_lock);
+    expandedKey = _expandedKey;
+    os_unfair_lock_unlock(&_lock);
+    if (expandedKey) {
+        return expandedKey;
+    }
+    NSData *seed = self.data;
+    if (seed.length != ED25519_SEED_SIZE) {
+        return nil;
+    }
+    // SHA-512 and one fixed-base multiplication, do it only once
+    expandedKey = ed25519_expand(seed);
+    os_unfair_lock_lock(&_lock);
+    if (!_expandedKey) {
+        _expandedKey = expandedKey;
+    }
+    expandedKey = _expandedKey;
+    os_unfair_lock_unlock(&_lock);
+    return expandedKey;
+}
+- (void)setExpandedKey:(nullable NSData *)expandedKey {
+    os_unfair_lock_lock(&_lock);
+    _expandedKey = expandedKey;
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (MKMEd25519PublicKey *)publicKey {
+    if (!_publicKey) {
+        NSData *expandedKey = self.expandedKey;
+        if (!expandedKey) {
+            NSAssert(false, @"failed to create Ed25519 public key");
+            return nil;
+        }
+        const ed25519_key *key = (const ed25519_key *)expandedKey.bytes;
+        NSData *data = [[NSData alloc] initWithBytes:key->pubkey length:ED25519_PUBLIC_KEY_SIZE];
+        NSString *hex = MKMHexEncode(data);
+        NSDictionary *dict = @{@"algorithm":MKMAlgorithm_Ed25519,
+                               @"data"     :hex,
+                               };
+        _publicKey = [[MKMEd25519PublicKey alloc] initWithDictionary:dict];
+    }
+    return _publicKey;
+}
+
+- (void)setPublicKey:(nullable MKMEd25519PublicKey *)publicKey {
+    _publicKey = publicKey;
+}
+
+#pragma mark - Protocol
+
+- (NSData *)sign:(NSData *)data {
+    NSData *expandedKey = self.expandedKey;
+    if (!expandedKey) {
+        NSAssert(false, @"Ed25519 private key error: %@", self);
+        return nil;
+    }
+    NSMutableData *signature = [[NSMutableData alloc] initWithLength:ED25519_SIGNATURE_SIZE];
+    ed25519_sign((const ed25519_key *)expandedKey.bytes, data.bytes, data.length, signature.mutableBytes);
+    return signature;
+}
+
+- (nullable NSData *)decrypt:(NSData *)ciphertext params:(nullable NSDictionary *)extra {
+    NSUInteger length = ciphertext.length;
+    if (length < X25519_SEAL_OVERHEAD) {
+        NSLog(@"[Ed25519] ciphertext too short: %lu", length);
+        return nil;
+    }
+    NSData *expandedKey = self.expandedKey;
+    NSData *u = self.publicKey.montgomeryKey;
+    if (!expandedKey || !u) {
+        NSAssert(false, @"Ed25519 private key error: %@", self);
+        return nil;
+    }
+    const ed25519_key *key = (const ed25519_key *)expandedKey.bytes;
+    NSMutableData *plaintext = [[NSMutableData alloc] initWithLength:(length - X25519_SEAL_OVERHEAD)];
+    if (!x25519_open(key->scalar, u.bytes, ciphertext.bytes, length, plaintext.mutableBytes)) {
+        // wrong key or modified data
+        return nil;
+    }
+    return plaintext;
+}
+
+- (BOOL)matchEncryptKey:(id<MKMEncryptKey>)pKey {
+    return DIMCryptoMatchEncryptKey(pKey, self);
+}
+
+@end
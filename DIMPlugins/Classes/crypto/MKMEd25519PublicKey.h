@@ -0,0 +1,77 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMEd25519PublicKey.h
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <DIMCore/DIMCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ *  Ed25519 Public Key
+ *
+ *      keyInfo format: {
+ *          algorithm: "Ed25519",
+ *          data     : "..."       // hex, 32 bytes
+ *      }
+ *
+ *      verify : Ed25519 (RFC 8032), 64-byte signatures
+ *      encrypt: sealed box to the X25519 form of this key,
+ *               ephemeral public key (32 bytes) + ChaCha20-Poly1305 (data + 16 bytes tag)
+ */
+@interface MKMEd25519PublicKey : DIMPublicKey <MKMEncryptKey>
+
+// X25519 public key (u-coordinate), nil for invalid key
+@property (readonly, strong, nonatomic, nullable) NSData *montgomeryKey;
+
+@end
+
+@interface MKMEd25519PublicKey (Batch)
+
+/**
+ *  Verify a batch of signatures with one random linear combination
+ *
+ * @param data       - signed data
+ * @param signatures - signatures (64 bytes)
+ * @param keys       - signer's public key for each signature
+ * @return bitmap, bit (i % 8) of byte (i / 8) is set when signature i matches
+ */
++ (NSData *)verifyBatch:(NSArray<NSData *> *)data
+             signatures:(NSArray<NSData *> *)signatures
+                   keys:(NSArray<id<MKMVerifyKey>> *)keys;
+
+@end
+
+NS_ASSUME_NONNULL_END
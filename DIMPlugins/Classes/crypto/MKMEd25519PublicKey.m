@@ -0,0 +1,241 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMEd25519PublicKey.m
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/4/10.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "ed25519.h"
+#import "drbg.h"
+
+#import "MKMEd25519PublicKey.h"
+
+@interface MKMEd25519PublicKey () {
+    
+    NSData *_data;
+    
+    os_unfair_lock _lock;
+    NSData *_montgomeryKey;
+    BOOL _invalid;
+}
+
+@property (strong, nonatomic) NSData *data;
+
+@property (strong, nonatomic, nullable) NSData *montgomeryKey;
+
+@end
+
+@implementation MKMEd25519PublicKey
+
+/* designated initializer */
+- (instancetype)initWithDictionary:(NSDictionary *)keyInfo {
+    if (self = [super initWithDictionary:keyInfo]) {
+        // lazy
+        _data = nil;
+        
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _montgomeryKey = nil;
+        _invalid = NO;
+    }
+    
+    return self;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    MKMEd25519PublicKey *key = [super copyWithZone:zone];
+    if (key) {
+        key.data = _data;
+        // immutable once created, share it
+        os_unfair_lock_lock(&_lock);
+        NSData *u = _montgomeryKey;
+        os_unfair_lock_unlock(&_lock);
+        key.montgomeryKey = u;
+    }
+    return key;
+}
+
+- (NSData *)data {
+    if (!_data) {
+        NSString *hex = [self objectForKey:@"data"];
+        NSAssert(hex.length == ED25519_PUBLIC_KEY_SIZE * 2, @"Ed25519 public key error: %@", self);
+        _data = MKMHexDecode(hex);
+    }
+    return _data;
+}
+- (void)setData:(NSData *)data {
+    _data = data;
+}
+
+- (nullable NSData *)montgomeryKey {
+    NSData *u;
+    BOOL invalid;
+    os_unfair_lock_lock(&_lock);
+    u = _montgomeryKey;
+    invalid = _invalid;
+    os_unfair_lock_unlock(&_lock);
+    if (u || invalid) {
+        return u;
+    }
+    // decode & convert the point only once
+    NSData *data = self.data;
+    NSMutableData *key = [[NSMutableData alloc] initWithLength:X25519_KEY_SIZE];
+    if (data.length != ED25519_PUBLIC_KEY_SIZE ||
+        !ed25519_public_to_x25519(key.mutableBytes, data.bytes)) {
+        NSAssert(false, @"Ed25519 public key error: %@", self);
+        os_unfair_lock_lock(&_lock);
+        _invalid = YES;
+        os_unfair_lock_unlock(&_lock);
+        return nil;
+    }
+    os_unfair_lock_lock(&_lock);
+    if (!_montgomeryKey) {
+        _montgomeryKey = key;
+    }
+    u = _montgomeryKey;
+    os_unfair_lock_unlock(&_lock);
+    return u;
+}
+- (void)setMontgomeryKey:(nullable NSData *)montgomeryKey {
+    os_unfair_lock_lock(&_lock);
+    _montgomeryKey = montgomeryKey;
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Protocol
+
+- (BOOL)verify:(NSData *)data withSignature:(NSData *)signature {
+    NSData *pubkey = self.data;
+    if (signature.length != ED25519_SIGNATURE_SIZE || pubkey.length != ED25519_PUBLIC_KEY_SIZE) {
+        NSLog(@"[Ed25519] signature length not match: %lu", signature.length);
+        return NO;
+    }
+    return ed25519_verify(pubkey.bytes, data.bytes, data.length, signature.bytes) == 1;
+}
+
+- (NSData *)encrypt:(NSData *)plaintext params:(nullable NSMutableDictionary *)extra {
+    NSData *u = self.montgomeryKey;
+    if (!u) {
+        NSAssert(false, @"Ed25519 public key error: %@", self);
+        return nil;
+    }
+    // one-time key pair for this message
+    uint8_t ephemeral[X25519_KEY_SIZE];
+    if (!drbg_random_bytes(ephemeral, sizeof(ephemeral))) {
+        // system entropy source failed
+        arc4random_buf(ephemeral, sizeof(ephemeral));
+    }
+    NSUInteger length = plaintext.length;
+    NSMutableData *ciphertext = [[NSMutableData alloc] initWithLength:(length + X25519_SEAL_OVERHEAD)];
+    int res = x25519_seal(u.bytes, ephemeral, plaintext.bytes, length, ciphertext.mutableBytes);
+    volatile uint8_t *p = ephemeral;
+    for (NSUInteger i = 0; i < sizeof(ephemeral); ++i) {
+        p[i] = 0;
+    }
+    if (res != 1) {
+        NSAssert(false, @"Ed25519 encrypt failed: %@", self);
+        return nil;
+    }
+    return ciphertext;
+}
+
+@end
+
+@implementation MKMEd25519PublicKey (Batch)
+
++ (NSData *)verifyBatch:(NSArray<NSData *> *)data
+             signatures:(NSArray<NSData *> *)signatures
+                   keys:(NSArray<id<MKMVerifyKey>> *)keys {
+    NSUInteger count = [data count];
+    NSAssert([signatures count] == count && [keys count] == count,
+             @"batch not match: %lu, %lu, %lu", count, [signatures count], [keys count]);
+    NSMutableData *results = [[NSMutableData alloc] initWithLength:(count + 7) / 8];
+    uint8_t *bitmap = [results mutableBytes];
+    
+    // 1. collect Ed25519 signatures, check other keys alone
+    const uint8_t **pubkeys = malloc(count * sizeof(const uint8_t *));
+    const uint8_t **msgs = malloc(count * sizeof(const uint8_t *));
+    const uint8_t **sigs = malloc(count * sizeof(const uint8_t *));
+    size_t *lens = malloc(count * sizeof(size_t));
+    NSUInteger *positions = malloc(count * sizeof(NSUInteger));
+    size_t total = 0;
+    id<MKMVerifyKey> pKey;
+    NSData *pubkey, *message, *signature;
+    NSUInteger index;
+    for (index = 0; index < count; ++index) {
+        pKey = [keys objectAtIndex:index];
+        message = [data objectAtIndex:index];
+        signature = [signatures objectAtIndex:index];
+        if (![pKey isKindOfClass:[MKMEd25519PublicKey class]]) {
+            // other key, check it alone
+            if ([pKey verify:message withSignature:signature]) {
+                bitmap[index / 8] |= 1 << (index % 8);
+            }
+            continue;
+        }
+        pubkey = [(MKMEd25519PublicKey *)pKey data];
+        if (pubkey.length != ED25519_PUBLIC_KEY_SIZE || signature.length != ED25519_SIGNATURE_SIZE) {
+            continue;
+        }
+        // the arrays keep the objects alive
+        pubkeys[total] = pubkey.bytes;
+        msgs[total] = message.bytes;
+        lens[total] = message.length;
+        sigs[total] = signature.bytes;
+        positions[total] = index;
+        ++total;
+    }
+    
+    // 2. verify together
+    if (total > 0) {
+        int *verified = malloc(total * sizeof(int));
+        ed25519_verify_batch(total, pubkeys, msgs, lens, sigs, verified);
+        for (size_t i = 0; i < total; ++i) {
+            if (verified[i]) {
+                index = positions[i];
+                bitmap[index / 8] |= 1 << (index % 8);
+            }
+        }
+        free(verified);
+    }
+    
+    free(pubkeys);
+    free(msgs);
+    free(sigs);
+    free(lens);
+    free(positions);
+    return results;
+}
+
+@end
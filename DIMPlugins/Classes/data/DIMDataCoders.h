@@ -39,6 +39,22 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ *  Base64 coder (SIMD)
+ *  ~~~~~~~~~~~~~~~~~~~
+ *  Encodes with padding and without line breaks;
+ *  decodes in lenient mode by default (unknown chars skipped, padding optional),
+ *  or in strict mode (only whitespaces skipped, padding required).
+ */
+@interface DIMBase64Coder : NSObject <MKMDataCoder>
+
+@property (readonly, nonatomic, getter=isStrict) BOOL strict;
+
+- (instancetype)initWithStrict:(BOOL)strict
+NS_DESIGNATED_INITIALIZER;
+
+@end
+
 void DIMRegisterDataCoders(void);
 
 NS_ASSUME_NONNULL_END
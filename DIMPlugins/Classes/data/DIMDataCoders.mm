@@ -36,6 +36,8 @@
 //
 
 #import "base58.h"
+#import "base64.h"
+#import "hex.h"
 
 #import "DIMDataCoders.h"
 
@@ -43,66 +45,69 @@
 
 @end
 
-static inline char hex_char(char ch) {
-    if (ch >= '0' && ch <= '9') {
-        return ch - '0';
+// get ASCII chars of the string without copying if possible,
+// or copy into the stack buffer for short string;
+// 'holder' keeps the copied chars for long string
+static inline const char *ascii_chars(NSString *string, char *stack, size_t size,
+                                      NSData * __strong *holder, NSUInteger *len) {
+    const char *chars = CFStringGetCStringPtr((__bridge CFStringRef)string,
+                                              kCFStringEncodingASCII);
+    if (chars) {
+        *len = [string length];
+        return chars;
     }
-    if (ch >= 'a' && ch <= 'f') {
-        return ch - 'a' + 10;
+    if ([string length] < size &&
+        [string getCString:stack maxLength:size encoding:NSASCIIStringEncoding]) {
+        *len = strlen(stack);
+        return stack;
     }
-    if (ch >= 'A' && ch <= 'F') {
-        return ch - 'A' + 10;
+    NSData *ascii = [string dataUsingEncoding:NSASCIIStringEncoding];
+    if (!ascii) {
+        // non-ASCII chars
+        return NULL;
     }
-    return 0;
+    *holder = ascii;
+    *len = [ascii length];
+    return (const char *)[ascii bytes];
 }
 
 @implementation Hex
 
 - (NSString *)encode:(NSData *)data {
-    NSMutableString *output = nil;
-    
-    const unsigned char *bytes = (const unsigned char *)[data bytes];
     NSUInteger len = [data length];
-    output = [[NSMutableString alloc] initWithCapacity:(len*2)];
-    for (int i = 0; i < len; ++i) {
-        [output appendFormat:@"%02x", bytes[i]];
+    if (len == 0) {
+        return @"";
     }
-    
-    return output;
+    // encode into a pre-sized buffer, the string takes its ownership
+    char *buffer = (char *)malloc(len * 2);
+    if (!buffer) {
+        return nil;
+    }
+    size_t size = hex_encode((const uint8_t *)[data bytes], len, buffer);
+    return [[NSString alloc] initWithBytesNoCopy:buffer
+                                          length:size
+                                        encoding:NSASCIIStringEncoding
+                                    freeWhenDone:YES];
 }
 
 - (nullable NSData *)decode:(NSString *)string {
-    NSMutableData *output = nil;
-    
-    NSString *str = string;
-    // 1. remove ' ', ':', '-', '\n'
-    str = [str stringByReplacingOccurrencesOfString:@" " withString:@""];
-    str = [str stringByReplacingOccurrencesOfString:@":" withString:@""];
-    str = [str stringByReplacingOccurrencesOfString:@"-" withString:@""];
-    str = [str stringByReplacingOccurrencesOfString:@"\n" withString:@""];
-    
-    // 2. skip '0x' prefix
-    char ch0, ch1;
-    NSUInteger pos = 0;
-    NSUInteger len = [string length];
-    if (len > 2) {
-        ch0 = [str characterAtIndex:0];
-        ch1 = [str characterAtIndex:1];
-        if (ch0 == '0' && (ch1 == 'x' || ch1 == 'X')) {
-            pos = 2;
-        }
+    char stack[256];
+    NSData *holder = nil;
+    NSUInteger len = 0;
+    const char *chars = ascii_chars(string, stack, sizeof(stack), &holder, &len);
+    if (!chars) {
+        // not a hex string
+        return nil;
     }
-    
-    // 3. decode bytes
-    output = [[NSMutableData alloc] initWithCapacity:(len/2)];
-    unsigned char byte;
-    for (; (pos + 1) < len; pos += 2) {
-        ch0 = [str characterAtIndex:pos];
-        ch1 = [str characterAtIndex:(pos + 1)];
-        byte = hex_char(ch0) * 16 + hex_char(ch1);
-        [output appendBytes:&byte length:1];
-    }
-    
+    // decode into a pre-sized buffer,
+    // separators (' ', ':', '-', '\n') and '0x' prefix are skipped in the same pass
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:(len / 2)];
+    size_t size = hex_decode(chars, len, (uint8_t *)[output mutableBytes]);
+    if (size == HEX_DECODE_ERROR) {
+        // invalid char, or odd number of digits
+        return nil;
+    }
+    [output setLength:size];
     return output;
 }
 
@@ -115,43 +120,96 @@ static inline char hex_char(char ch) {
 @implementation Base58
 
 - (NSString *)encode:(NSData *)data {
-    NSString *output = nil;
     const unsigned char *pbegin = (const unsigned char *)[data bytes];
     const unsigned char *pend = pbegin + [data length];
-    std::string str = EncodeBase58(pbegin, pend);
-    output = [[NSString alloc] initWithCString:str.c_str()
-                                      encoding:NSUTF8StringEncoding];
-    return output;
+    size_t size = BASE58_ENCODE_SIZE([data length]);
+    // addresses (25 bytes) are encoded in the stack buffer
+    char stack[128];
+    char *buffer = size <= sizeof(stack) ? stack : (char *)malloc(size);
+    if (!buffer) {
+        return nil;
+    }
+    size_t len = EncodeBase58(pbegin, pend, buffer, size);
+    if (buffer == stack) {
+        return [[NSString alloc] initWithBytes:buffer
+                                        length:len
+                                      encoding:NSASCIIStringEncoding];
+    }
+    return [[NSString alloc] initWithBytesNoCopy:buffer
+                                          length:len
+                                        encoding:NSASCIIStringEncoding
+                                    freeWhenDone:YES];
 }
 
 - (nullable NSData *)decode:(NSString *)string {
-    NSData *output = nil;
-    const char *cstr = [string cStringUsingEncoding:NSUTF8StringEncoding];
-    std::vector<unsigned char> vch;
-    DecodeBase58(cstr, vch);
-    std::string str(vch.begin(), vch.end());
-    output = [[NSData alloc] initWithBytes:str.c_str() length:str.size()];
+    char stack[256];
+    NSData *holder = nil;
+    NSUInteger len = 0;
+    const char *chars = ascii_chars(string, stack, sizeof(stack), &holder, &len);
+    if (!chars) {
+        // not a base58 string
+        return nil;
+    }
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:BASE58_DECODE_SIZE(len)];
+    size_t size = 0;
+    if (!DecodeBase58(chars, len, (unsigned char *)[output mutableBytes], [output length], &size)) {
+        return nil;
+    }
+    [output setLength:size];
     return output;
 }
 
 @end
 
-@interface Base64 : NSObject <MKMDataCoder>
+@implementation DIMBase64Coder
 
-@end
+- (instancetype)init {
+    return [self initWithStrict:NO];
+}
 
-@implementation Base64
+/* designated initializer */
+- (instancetype)initWithStrict:(BOOL)strict {
+    if (self = [super init]) {
+        _strict = strict;
+    }
+    return self;
+}
 
 - (NSString *)encode:(NSData *)data {
-    NSDataBase64EncodingOptions opt;
-    opt = NSDataBase64EncodingEndLineWithCarriageReturn;
-    return [data base64EncodedStringWithOptions:opt];
+    NSUInteger len = [data length];
+    if (len == 0) {
+        return @"";
+    }
+    // encode into a pre-sized buffer, the string takes its ownership
+    char *buffer = (char *)malloc(BASE64_ENCODE_SIZE(len));
+    if (!buffer) {
+        return nil;
+    }
+    size_t size = base64_encode((const uint8_t *)[data bytes], len, buffer);
+    return [[NSString alloc] initWithBytesNoCopy:buffer
+                                          length:size
+                                        encoding:NSASCIIStringEncoding
+                                    freeWhenDone:YES];
 }
 
 - (nullable NSData *)decode:(NSString *)string {
-    NSDataBase64DecodingOptions opt;
-    opt = NSDataBase64DecodingIgnoreUnknownCharacters;
-    return [[NSData alloc] initWithBase64EncodedString:string options:opt];
+    char stack[256];
+    NSData *holder = nil;
+    NSUInteger len = 0;
+    const char *chars = ascii_chars(string, stack, sizeof(stack), &holder, &len);
+    if (!chars) {
+        // not a base64 string
+        return nil;
+    }
+    // decode into a pre-sized buffer, whitespaces are skipped in the same pass
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:BASE64_DECODE_BOUND(len)];
+    int flags = _strict ? BASE64_STRICT : BASE64_LENIENT;
+    size_t size = base64_decode(chars, len, (uint8_t *)[output mutableBytes], flags);
+    if (size == BASE64_DECODE_ERROR) {
+        return nil;
+    }
+    [output setLength:size];
+    return output;
 }
 
 @end
@@ -166,7 +224,7 @@ void DIMRegisterDataCoders(void) {
             [MKMBase58 setCoder:[[Base58 alloc] init]];
         }
         if ([MKMBase64 getCoder] == nil) {
-            [MKMBase64 setCoder:[[Base64 alloc] init]];
+            [MKMBase64 setCoder:[[DIMBase64Coder alloc] init]];
         }
     });
 }
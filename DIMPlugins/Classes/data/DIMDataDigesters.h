@@ -39,6 +39,55 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ *  Streaming Digest
+ *  ~~~~~~~~~~~~~~~~
+ *  init -> update ... -> final
+ *
+ *  For hashing large data (e.g. file attachments) chunk by chunk,
+ *  without loading all of it into memory.
+ */
+@protocol DIMDigestContext <NSObject>
+
+- (void)update:(NSData *)data;
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length;
+
+/**
+ *  Finish digesting, the context cannot be updated after this
+ *
+ * @return digest
+ */
+- (NSData *)finalDigest;
+
+@end
+
+@protocol DIMStreamDigester <MKMDataDigester>
+
+/**
+ *  Create a new context for streaming digest
+ */
+- (id<DIMDigestContext>)createContext;
+
+@end
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Digest all data from input stream chunk by chunk
+ *
+ * @param digester - MD5, SHA1, SHA256, RIPEMD160 or KECCAK256
+ * @param input    - file/network stream (will be opened & closed here)
+ * @return digest, nil on stream error
+ */
+NSData * _Nullable DIMDigestStream(id<DIMStreamDigester> digester, NSInputStream *input);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
 void DIMRegisterDataDigesters(void);
 
 NS_ASSUME_NONNULL_END
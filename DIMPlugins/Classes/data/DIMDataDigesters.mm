@@ -38,53 +38,244 @@
 #import <CommonCrypto/CommonDigest.h>
 
 #import "ripemd160.h"
+#import "sha256.h"
 #import "sha3.h"
 
 #import "DIMDataDigesters.h"
 
-@interface MD5 : NSObject <MKMDataDigester>
+// CC_LONG is 32-bit, longer input must be fed in pieces
+#define CC_LONG_MAX ((NSUInteger)UINT32_MAX)
+
+#pragma mark Contexts
+
+@interface MD5Context : NSObject <DIMDigestContext> {
+    
+    CC_MD5_CTX _ctx;
+}
+
+@end
+
+@implementation MD5Context
+
+- (instancetype)init {
+    if (self = [super init]) {
+        CC_MD5_Init(&_ctx);
+    }
+    return self;
+}
+
+- (void)update:(NSData *)data {
+    [self updateBytes:[data bytes] length:[data length]];
+}
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length {
+    const uint8_t *ptr = (const uint8_t *)bytes;
+    NSUInteger size;
+    while (length > 0) {
+        size = MIN(length, CC_LONG_MAX);
+        CC_MD5_Update(&_ctx, ptr, (CC_LONG)size);
+        ptr += size;
+        length -= size;
+    }
+}
+
+- (NSData *)finalDigest {
+    unsigned char digest[CC_MD5_DIGEST_LENGTH];
+    CC_MD5_Final(digest, &_ctx);
+    return [[NSData alloc] initWithBytes:digest length:CC_MD5_DIGEST_LENGTH];
+}
+
+@end
+
+@interface SHA1Context : NSObject <DIMDigestContext> {
+    
+    CC_SHA1_CTX _ctx;
+}
+
+@end
+
+@implementation SHA1Context
+
+- (instancetype)init {
+    if (self = [super init]) {
+        CC_SHA1_Init(&_ctx);
+    }
+    return self;
+}
+
+- (void)update:(NSData *)data {
+    [self updateBytes:[data bytes] length:[data length]];
+}
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length {
+    const uint8_t *ptr = (const uint8_t *)bytes;
+    NSUInteger size;
+    while (length > 0) {
+        size = MIN(length, CC_LONG_MAX);
+        CC_SHA1_Update(&_ctx, ptr, (CC_LONG)size);
+        ptr += size;
+        length -= size;
+    }
+}
+
+- (NSData *)finalDigest {
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1_Final(digest, &_ctx);
+    return [[NSData alloc] initWithBytes:digest length:CC_SHA1_DIGEST_LENGTH];
+}
+
+@end
+
+@interface SHA256Context : NSObject <DIMDigestContext> {
+    
+    CSHA256 _ctx;
+}
+
+@end
+
+@implementation SHA256Context
+
+- (void)update:(NSData *)data {
+    [self updateBytes:[data bytes] length:[data length]];
+}
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length {
+    _ctx.Write((const unsigned char *)bytes, (size_t)length);
+}
+
+- (NSData *)finalDigest {
+    unsigned char digest[CSHA256::OUTPUT_SIZE];
+    _ctx.Finalize(digest);
+    return [[NSData alloc] initWithBytes:digest length:CSHA256::OUTPUT_SIZE];
+}
+
+@end
+
+@interface RIPEMD160Context : NSObject <DIMDigestContext> {
+    
+    CRIPEMD160 _ctx;
+}
+
+@end
+
+@implementation RIPEMD160Context
+
+- (void)update:(NSData *)data {
+    [self updateBytes:[data bytes] length:[data length]];
+}
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length {
+    _ctx.Write((const unsigned char *)bytes, (size_t)length);
+}
+
+- (NSData *)finalDigest {
+    unsigned char digest[CRIPEMD160::OUTPUT_SIZE];
+    _ctx.Finalize(digest);
+    return [[NSData alloc] initWithBytes:digest length:CRIPEMD160::OUTPUT_SIZE];
+}
+
+@end
+
+@interface KECCAK256Context : NSObject <DIMDigestContext> {
+    
+    struct sha3_ctx _ctx;
+}
+
+@end
+
+@implementation KECCAK256Context
+
+- (instancetype)init {
+    if (self = [super init]) {
+        sha3_256_init(&_ctx);
+    }
+    return self;
+}
+
+- (void)update:(NSData *)data {
+    [self updateBytes:[data bytes] length:[data length]];
+}
+
+- (void)updateBytes:(const void *)bytes length:(NSUInteger)length {
+    sha3_update(&_ctx, (const uint8_t *)bytes, (size_t)length);
+}
+
+- (NSData *)finalDigest {
+    unsigned char digest[32];
+    sha3_final(&_ctx, digest, 32);
+    return [[NSData alloc] initWithBytes:digest length:32];
+}
+
+@end
+
+#pragma mark Digesters
+
+@interface MD5 : NSObject <DIMStreamDigester>
 
 @end
 
 @implementation MD5
 
 - (NSData *)digest:(NSData *)data {
+    if ([data length] > CC_LONG_MAX) {
+        MD5Context *ctx = [[MD5Context alloc] init];
+        [ctx update:data];
+        return [ctx finalDigest];
+    }
     unsigned char digest[CC_MD5_DIGEST_LENGTH];
     CC_MD5([data bytes], (CC_LONG)[data length], digest);
     return [[NSData alloc] initWithBytes:digest length:CC_MD5_DIGEST_LENGTH];
 }
 
+- (id<DIMDigestContext>)createContext {
+    return [[MD5Context alloc] init];
+}
+
 @end
 
-@interface SHA1 : NSObject <MKMDataDigester>
+@interface SHA1 : NSObject <DIMStreamDigester>
 
 @end
 
 @implementation SHA1
 
 - (NSData *)digest:(NSData *)data {
+    if ([data length] > CC_LONG_MAX) {
+        SHA1Context *ctx = [[SHA1Context alloc] init];
+        [ctx update:data];
+        return [ctx finalDigest];
+    }
     unsigned char digest[CC_SHA1_DIGEST_LENGTH];
     CC_SHA1([data bytes], (CC_LONG)[data length], digest);
     return [[NSData alloc] initWithBytes:digest length:CC_SHA1_DIGEST_LENGTH];
 }
 
+- (id<DIMDigestContext>)createContext {
+    return [[SHA1Context alloc] init];
+}
+
 @end
 
-@interface SHA256 : NSObject <MKMDataDigester>
+@interface SHA256 : NSObject <DIMStreamDigester>
 
 @end
 
 @implementation SHA256
 
 - (NSData *)digest:(NSData *)data {
-    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
-    CC_SHA256([data bytes], (CC_LONG)[data length], digest);
-    return [[NSData alloc] initWithBytes:digest length:CC_SHA256_DIGEST_LENGTH];
+    const unsigned char *bytes = (const unsigned char *)[data bytes];
+    unsigned char digest[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(bytes, (size_t)[data length]).Finalize(digest);
+    return [[NSData alloc] initWithBytes:digest length:CSHA256::OUTPUT_SIZE];
+}
+
+- (id<DIMDigestContext>)createContext {
+    return [[SHA256Context alloc] init];
 }
 
 @end
 
-@interface RIPEMD160 : NSObject <MKMDataDigester>
+@interface RIPEMD160 : NSObject <DIMStreamDigester>
 
 @end
 
@@ -97,9 +288,13 @@
     return [[NSData alloc] initWithBytes:digest length:CRIPEMD160::OUTPUT_SIZE];
 }
 
+- (id<DIMDigestContext>)createContext {
+    return [[RIPEMD160Context alloc] init];
+}
+
 @end
 
-@interface KECCAK256 : NSObject <MKMDataDigester>
+@interface KECCAK256 : NSObject <DIMStreamDigester>
 
 @end
 
@@ -113,11 +308,48 @@
     return [[NSData alloc] initWithBytes:digest length:32];
 }
 
+- (id<DIMDigestContext>)createContext {
+    return [[KECCAK256Context alloc] init];
+}
+
 @end
 
+#define DIM_DIGEST_CHUNK_SIZE (64 * 1024)
+
+NSData *DIMDigestStream(id<DIMStreamDigester> digester, NSInputStream *input) {
+    id<DIMDigestContext> ctx = [digester createContext];
+    uint8_t *buffer = (uint8_t *)malloc(DIM_DIGEST_CHUNK_SIZE);
+    if (!buffer) {
+        return nil;
+    }
+    BOOL ok = YES;
+    NSInteger len;
+    [input open];
+    while (YES) {
+        len = [input read:buffer maxLength:DIM_DIGEST_CHUNK_SIZE];
+        if (len > 0) {
+            [ctx updateBytes:buffer length:len];
+        } else {
+            // 0: end of stream; -1: error
+            ok = len == 0;
+            break;
+        }
+    }
+    [input close];
+    free(buffer);
+    if (!ok) {
+        NSCAssert(false, @"failed to read stream: %@", [input streamError]);
+        return nil;
+    }
+    return [ctx finalDigest];
+}
+
 void DIMRegisterDataDigesters(void) {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
+        // pick SHA-NI / ARMv8 SHA2 instructions if the CPU has them
+        SHA256AutoDetect();
+        
         if ([MKMMD5 getDigester] == nil) {
             [MKMMD5 setDigester:[[MD5 alloc] init]];
         }
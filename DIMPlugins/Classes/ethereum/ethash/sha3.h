@@ -16,6 +16,24 @@ struct ethash_h256;
 decsha3(256)
 decsha3(512)
 
+/*** Streaming sponge: init -> update ... -> final ***/
+struct sha3_ctx {
+	uint64_t a[25];  // state, 64-bit lanes
+	size_t rate;     // block size in bytes
+	size_t pos;      // bytes absorbed into current block
+	uint8_t delim;   // domain separation
+};
+
+void sha3_256_init(struct sha3_ctx* ctx);
+void sha3_512_init(struct sha3_ctx* ctx);
+void sha3_update(struct sha3_ctx* ctx, uint8_t const* in, size_t inlen);
+int sha3_final(struct sha3_ctx* ctx, uint8_t* out, size_t outlen);
+
+/*** Batch: Keccak-256 of 'count' messages, 4/8 at once with AVX2/AVX-512 ***/
+// out: count * 32 bytes; messages with the same number of blocks
+// (e.g. public keys, or addresses) go through the multi-buffer path.
+void keccak256_many(uint8_t* out, uint8_t const* const* in, size_t const* inlen, size_t count);
+
 static inline void SHA3_256(struct ethash_h256 const* ret, uint8_t const* data, size_t const size)
 {
 	sha3_256((uint8_t*)ret, 32, data, size);
@@ -35,41 +35,40 @@
 //  Copyright © 2018 DIM Group. All rights reserved.
 //
 
-#import <CommonCrypto/CommonCryptor.h>
+#import "aes.h"
 
 #import "NSData+Crypto.h"
 
+static inline void aes_expand(aes256_key *schedule, NSData *key) {
+    // 'key' should be 32 bytes for AES256, will be null-padded otherwise
+    uint8_t keyPtr[AES256_KEY_SIZE] = {0};
+    [key getBytes:keyPtr length:sizeof(keyPtr)];
+    aes256_init(schedule, keyPtr);
+    volatile uint8_t *p = keyPtr;
+    for (NSUInteger i = 0; i < sizeof(keyPtr); ++i) {
+        p[i] = 0;
+    }
+}
+
 @implementation NSData (AES)
 
 - (nullable NSData *)AES256EncryptWithKey:(NSData *)key
                      initializationVector:(nullable NSData *)iv {
-    // 'key' should be 32 bytes for AES256, will be null-padded otherwise
-    char keyPtr[kCCKeySizeAES256+1]; // room for terminator (unused)
-    bzero(keyPtr, sizeof(keyPtr)); // fill with zeroes (for padding)
-    
-    // fetch key data
-    [key getBytes:keyPtr length:sizeof(keyPtr)];
-//    [key getCString:keyPtr maxLength:sizeof(keyPtr) encoding:NSUTF8StringEncoding];
+    if (iv && iv.length != AES_BLOCK_SIZE) {
+        return nil;
+    }
+    aes256_key schedule;
+    aes_expand(&schedule, key);
     
+    // PKCS#7 adds 1 to 16 bytes, the output size is known before encrypting
     NSUInteger dataLength = [self length];
-    
-    //See the doc: For block ciphers, the output size will always be less than or
-    //equal to the input size plus the size of one block.
-    //That's why we need to add the size of one block here
-    size_t bufferSize = dataLength + kCCBlockSizeAES128;
+    size_t bufferSize = AES_CBC_ENCRYPT_SIZE(dataLength);
     void *buffer = malloc(bufferSize);
     
-    size_t numBytesEncrypted = 0;
-    CCCryptorStatus cryptStatus = CCCrypt(kCCEncrypt, kCCAlgorithmAES, kCCOptionPKCS7Padding,
-                                          keyPtr, kCCKeySizeAES256,
-                                          [iv bytes], /* initialization vector (optional) */
-                                          [self bytes], dataLength, /* input */
-                                          buffer, bufferSize, /* output */
-                                          &numBytesEncrypted);
-    if (cryptStatus != kCCSuccess) {
-        free(buffer); //free the buffer;
-        return nil;
-    }
+    size_t numBytesEncrypted = aes256_cbc_encrypt(&schedule, [iv bytes],
+                                                  [self bytes], dataLength,
+                                                  buffer);
+    aes256_wipe(&schedule);
     
     //the returned NSData takes ownership of the buffer and will free it on deallocation
     return [[NSData alloc] initWithBytesNoCopy:buffer length:numBytesEncrypted];
@@ -77,31 +76,25 @@
 
 - (nullable NSData *)AES256DecryptWithKey:(NSData *)key
                      initializationVector:(nullable NSData *)iv {
-    // 'key' should be 32 bytes for AES256, will be null-padded otherwise
-    char keyPtr[kCCKeySizeAES256+1]; // room for terminator (unused)
-    bzero(keyPtr, sizeof(keyPtr)); // fill with zeroes (for padding)
-    
-    // fetch key data
-    [key getBytes:keyPtr length:sizeof(keyPtr)];
-//    [key getCString:keyPtr maxLength:sizeof(keyPtr) encoding:NSUTF8StringEncoding];
-    
+    if (iv && iv.length != AES_BLOCK_SIZE) {
+        return nil;
+    }
     NSUInteger dataLength = [self length];
+    if (dataLength == 0 || dataLength % AES_BLOCK_SIZE != 0) {
+        return nil;
+    }
+    aes256_key schedule;
+    aes_expand(&schedule, key);
     
-    //See the doc: For block ciphers, the output size will always be less than or
-    //equal to the input size plus the size of one block.
-    //That's why we need to add the size of one block here
-    size_t bufferSize = dataLength + kCCBlockSizeAES128;
-    void *buffer = malloc(bufferSize);
+    // the plaintext is shorter than the ciphertext
+    void *buffer = malloc(dataLength);
     
-    size_t numBytesDecrypted = 0;
-    CCCryptorStatus cryptStatus = CCCrypt(kCCDecrypt, kCCAlgorithmAES, kCCOptionPKCS7Padding,
-                                          keyPtr, kCCKeySizeAES256,
-                                          [iv bytes], /* initialization vector (optional) */
-                                          [self bytes], dataLength, /* input */
-                                          buffer, bufferSize, /* output */
-                                          &numBytesDecrypted);
+    size_t numBytesDecrypted = aes256_cbc_decrypt(&schedule, [iv bytes],
+                                                  [self bytes], dataLength,
+                                                  buffer);
+    aes256_wipe(&schedule);
     
-    if (cryptStatus != kCCSuccess) {
+    if (numBytesDecrypted == AES_DECRYPT_ERROR) {
         free(buffer); //free the buffer;
         return nil;
     }
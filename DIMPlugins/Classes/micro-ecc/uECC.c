@@ -13,6 +13,13 @@
     #define uECC_VLI_API static
 #endif
 
+#if (uECC_FAST_secp256k1 && uECC_SUPPORTS_secp256k1 && (uECC_OPTIMIZATION_LEVEL > 0) && \
+        (uECC_WORD_SIZE == 8) && SUPPORTS_INT128)
+    #define uECC_FIELD_FUNCS 1
+#else
+    #define uECC_FIELD_FUNCS 0
+#endif
+
 #if (uECC_PLATFORM == uECC_avr) || \
     (uECC_PLATFORM == uECC_arm) || \
     (uECC_PLATFORM == uECC_arm_thumb) || \
@@ -160,6 +167,11 @@ struct uECC_Curve_t {
 #if (uECC_OPTIMIZATION_LEVEL > 0)
     void (*mmod_fast)(uECC_word_t *result, uECC_word_t *product);
 #endif
+#if uECC_FIELD_FUNCS
+    /* Optional whole field multiply/square (replacing mult + mmod_fast), NULL if not provided */
+    void (*mod_mult_fast)(uECC_word_t *result, const uECC_word_t *left, const uECC_word_t *right);
+    void (*mod_square_fast)(uECC_word_t *result, const uECC_word_t *left);
+#endif
 };
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
@@ -624,6 +636,12 @@ uECC_VLI_API void uECC_vli_modMult_fast(uECC_word_t *result,
                                         const uECC_word_t *right,
                                         uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
+#if uECC_FIELD_FUNCS
+    if (curve->mod_mult_fast) {
+        curve->mod_mult_fast(result, left, right);
+        return;
+    }
+#endif
     uECC_vli_mult(product, left, right, curve->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
     curve->mmod_fast(result, product);
@@ -650,6 +668,12 @@ uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
                                           const uECC_word_t *left,
                                           uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
+#if uECC_FIELD_FUNCS
+    if (curve->mod_square_fast) {
+        curve->mod_square_fast(result, left);
+        return;
+    }
+#endif
     uECC_vli_square(product, left, curve->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
     curve->mmod_fast(result, product);
@@ -672,6 +696,12 @@ uECC_VLI_API void uECC_vli_modSquare(uECC_word_t *result,
 uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
                                           const uECC_word_t *left,
                                           uECC_Curve curve) {
+#if uECC_FIELD_FUNCS
+    if (curve->mod_square_fast) {
+        curve->mod_square_fast(result, left);
+        return;
+    }
+#endif
     uECC_vli_modMult_fast(result, left, left, curve);
 }
 
@@ -952,6 +982,20 @@ static uECC_word_t EccPoint_compute_public_key(uECC_word_t *result,
     uECC_word_t *initial_Z = 0;
     uECC_word_t carry;
 
+#if uECC_FIELD_FUNCS
+    if (curve == &curve_secp256k1) {
+        /* Fixed-base comb, constant time; the random value blinds the initial Z. */
+        if (g_rng_function) {
+            if (!uECC_generate_random_int(tmp1, curve->p, curve->num_words)) {
+                return 0;
+            }
+            initial_Z = tmp1;
+        }
+        secp256k1_mult_G(result, private_key, initial_Z);
+        return !EccPoint_isZero(result, curve);
+    }
+#endif
+
     /* Regularize the bitcount for the private key so that attackers cannot use a side channel
        attack to learn the number of leading zeros. */
     carry = regularize_k(private_key, tmp1, tmp2, curve);
@@ -1205,10 +1249,11 @@ int uECC_compute_public_key(const uint8_t *private_key, uint8_t *public_key, uEC
 
 /* -------- ECDSA code -------- */
 
-static void bits2int(uECC_word_t *native,
-                     const uint8_t *bits,
-                     unsigned bits_size,
-                     uECC_Curve curve) {
+/* The leftmost num_n_bits of bits, not reduced (RFC 6979 bits2int). */
+static void bits2int_unreduced(uECC_word_t *native,
+                               const uint8_t *bits,
+                               unsigned bits_size,
+                               uECC_Curve curve) {
     unsigned num_n_bytes = BITS_TO_BYTES(curve->num_n_bits);
     unsigned num_n_words = BITS_TO_WORDS(curve->num_n_bits);
     int shift;
@@ -1236,6 +1281,15 @@ static void bits2int(uECC_word_t *native,
         *ptr = (temp >> shift) | carry;
         carry = temp << (uECC_WORD_BITS - shift);
     }
+}
+
+static void bits2int(uECC_word_t *native,
+                     const uint8_t *bits,
+                     unsigned bits_size,
+                     uECC_Curve curve) {
+    unsigned num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+
+    bits2int_unreduced(native, bits, bits_size, curve);
 
     /* Reduce mod curve_n */
     if (uECC_vli_cmp_unsafe(curve->n, native, num_n_words) != 1) {
@@ -1243,6 +1297,20 @@ static void bits2int(uECC_word_t *native,
     }
 }
 
+/* result = left * right (mod n) */
+static void modMult_n(uECC_word_t *result,
+                      const uECC_word_t *left,
+                      const uECC_word_t *right,
+                      uECC_Curve curve) {
+#if uECC_FIELD_FUNCS
+    if (curve == &curve_secp256k1) {
+        secp256k1_scalar_mul(result, left, right);
+        return;
+    }
+#endif
+    uECC_vli_modMult(result, left, right, curve->n, BITS_TO_WORDS(curve->num_n_bits));
+}
+
 static int uECC_sign_with_k_internal(const uint8_t *private_key,
                             const uint8_t *message_hash,
                             unsigned hash_size,
@@ -1269,16 +1337,30 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
         return 0;
     }
 
-    carry = regularize_k(k, tmp, s, curve);
-    /* If an RNG function was specified, try to get a random initial Z value to improve
-       protection against side-channel attacks. */
-    if (g_rng_function) {
-        if (!uECC_generate_random_int(k2[carry], curve->p, num_words)) {
-            return 0;
+#if uECC_FIELD_FUNCS
+    if (curve == &curve_secp256k1) {
+        /* Fixed-base comb, constant time; the random value blinds the initial Z. */
+        if (g_rng_function) {
+            if (!uECC_generate_random_int(tmp, curve->p, num_words)) {
+                return 0;
+            }
+            initial_Z = tmp;
+        }
+        secp256k1_mult_G(p, k, initial_Z);
+    } else
+#endif
+    {
+        carry = regularize_k(k, tmp, s, curve);
+        /* If an RNG function was specified, try to get a random initial Z value to improve
+           protection against side-channel attacks. */
+        if (g_rng_function) {
+            if (!uECC_generate_random_int(k2[carry], curve->p, num_words)) {
+                return 0;
+            }
+            initial_Z = k2[carry];
         }
-        initial_Z = k2[carry];
+        EccPoint_mult(p, curve->G, k2[!carry], initial_Z, num_n_bits + 1, curve);
     }
-    EccPoint_mult(p, curve->G, k2[!carry], initial_Z, num_n_bits + 1, curve);
     if (uECC_vli_isZero(p, num_words)) {
         return 0;
     }
@@ -1294,9 +1376,9 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
 
     /* Prevent side channel analysis of uECC_vli_modInv() to determine
        bits of k / the private key by premultiplying by a random number */
-    uECC_vli_modMult(k, k, tmp, curve->n, num_n_words); /* k' = rand * k */
-    uECC_vli_modInv(k, k, curve->n, num_n_words);       /* k = 1 / k' */
-    uECC_vli_modMult(k, k, tmp, curve->n, num_n_words); /* k = 1 / k */
+    modMult_n(k, k, tmp, curve); /* k' = rand * k */
+    uECC_vli_modInv(k, k, curve->n, num_n_words); /* k = 1 / k' */
+    modMult_n(k, k, tmp, curve); /* k = 1 / k */
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
     uECC_vli_nativeToBytes(signature, curve->num_bytes, p); /* store r */
@@ -1310,11 +1392,11 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
 
     s[num_n_words - 1] = 0;
     uECC_vli_set(s, p, num_words);
-    uECC_vli_modMult(s, tmp, s, curve->n, num_n_words); /* s = r*d */
+    modMult_n(s, tmp, s, curve); /* s = r*d */
 
     bits2int(tmp, message_hash, hash_size, curve);
     uECC_vli_modAdd(s, tmp, s, curve->n, num_n_words); /* s = e + r*d */
-    uECC_vli_modMult(s, s, k, curve->n, num_n_words);  /* s = (e + r*d) / k */
+    modMult_n(s, s, k, curve); /* s = (e + r*d) / k */
     if (uECC_vli_numBits(s, num_n_words) > (bitcount_t)curve->num_bytes * 8) {
         return 0;
     }
@@ -1403,10 +1485,11 @@ static void update_V(const uECC_HashContext *hash_context, uint8_t *K, uint8_t *
     HMAC_finish(hash_context, K, V);
 }
 
-/* Deterministic signing, similar to RFC 6979. Differences are:
-    * We just use H(m) directly rather than bits2octets(H(m))
-      (it is not reduced modulo curve_n).
-    * We generate a value for k (aka T) directly rather than converting endianness.
+/* Deterministic signing (RFC 6979, section 3.2):
+    * h1 is taken as bits2octets(H(m)) and x as int2octets(x), both num_n_bytes long;
+    * k = bits2int(T), rejected (with K, V updated) unless 0 < k < n and the signature
+      is valid, as in step h.3.
+   With uECC_VLI_NATIVE_LITTLE_ENDIAN the octet strings are little-endian, like the keys.
 
    Layout of hash_context->tmp: <K> | <V> | (1 byte overlapped 0x00 or 0x01) / <HMAC pad> */
 int uECC_sign_deterministic(const uint8_t *private_key,
@@ -1417,9 +1500,13 @@ int uECC_sign_deterministic(const uint8_t *private_key,
                             uECC_Curve curve) {
     uint8_t *K = hash_context->tmp;
     uint8_t *V = K + hash_context->result_size;
-    wordcount_t num_bytes = curve->num_bytes;
-    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
-    bitcount_t num_n_bits = curve->num_n_bits;
+    wordcount_t num_n_bytes = BITS_TO_BYTES(curve->num_n_bits);
+    uECC_word_t h1[uECC_MAX_WORDS];
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    uint8_t *h1_octets = (uint8_t *)h1;
+#else
+    uint8_t h1_octets[uECC_MAX_WORDS * uECC_WORD_SIZE];
+#endif
     uECC_word_t tries;
     unsigned i;
     for (i = 0; i < hash_context->result_size; ++i) {
@@ -1427,47 +1514,49 @@ int uECC_sign_deterministic(const uint8_t *private_key,
         K[i] = 0;
     }
 
-    /* K = HMAC_K(V || 0x00 || int2octets(x) || h(m)) */
+    /* h1 = bits2octets(H(m)) */
+    bits2int(h1, message_hash, hash_size, curve);
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
+    uECC_vli_nativeToBytes(h1_octets, num_n_bytes, h1);
+#endif
+
+    /* K = HMAC_K(V || 0x00 || int2octets(x) || h1) */
     HMAC_init(hash_context, K);
     V[hash_context->result_size] = 0x00;
     HMAC_update(hash_context, V, hash_context->result_size + 1);
-    HMAC_update(hash_context, private_key, num_bytes);
-    HMAC_update(hash_context, message_hash, hash_size);
+    HMAC_update(hash_context, private_key, num_n_bytes);
+    HMAC_update(hash_context, h1_octets, num_n_bytes);
     HMAC_finish(hash_context, K, K);
 
     update_V(hash_context, K, V);
 
-    /* K = HMAC_K(V || 0x01 || int2octets(x) || h(m)) */
+    /* K = HMAC_K(V || 0x01 || int2octets(x) || h1) */
     HMAC_init(hash_context, K);
     V[hash_context->result_size] = 0x01;
     HMAC_update(hash_context, V, hash_context->result_size + 1);
-    HMAC_update(hash_context, private_key, num_bytes);
-    HMAC_update(hash_context, message_hash, hash_size);
+    HMAC_update(hash_context, private_key, num_n_bytes);
+    HMAC_update(hash_context, h1_octets, num_n_bytes);
     HMAC_finish(hash_context, K, K);
 
     update_V(hash_context, K, V);
 
     for (tries = 0; tries < uECC_RNG_MAX_TRIES; ++tries) {
-        uECC_word_t T[uECC_MAX_WORDS];
-        uint8_t *T_ptr = (uint8_t *)T;
+        uint8_t T[uECC_MAX_WORDS * uECC_WORD_SIZE];
+        uECC_word_t k[uECC_MAX_WORDS];
         wordcount_t T_bytes = 0;
         for (;;) {
             update_V(hash_context, K, V);
             for (i = 0; i < hash_context->result_size; ++i) {
-                T_ptr[T_bytes++] = V[i];
-                if (T_bytes >= num_n_words * uECC_WORD_SIZE) {
+                T[T_bytes++] = V[i];
+                if (T_bytes >= num_n_bytes) {
                     goto filled;
                 }
             }
         }
     filled:
-        if ((bitcount_t)num_n_words * uECC_WORD_SIZE * 8 > num_n_bits) {
-            uECC_word_t mask = (uECC_word_t)-1;
-            T[num_n_words - 1] &=
-                mask >> ((bitcount_t)(num_n_words * uECC_WORD_SIZE * 8 - num_n_bits));
-        }
-
-        if (uECC_sign_with_k_internal(private_key, message_hash, hash_size, T, signature, curve)) {
+        /* k = bits2int(T) */
+        bits2int_unreduced(k, T, num_n_bytes, curve);
+        if (uECC_sign_with_k_internal(private_key, message_hash, hash_size, k, signature, curve)) {
             return 1;
         }
 
@@ -1486,33 +1575,14 @@ static bitcount_t smax(bitcount_t a, bitcount_t b) {
     return (a > b ? a : b);
 }
 
-int uECC_verify(const uint8_t *public_key,
-                const uint8_t *message_hash,
-                unsigned hash_size,
-                const uint8_t *signature,
-                uECC_Curve curve) {
-    uECC_word_t u1[uECC_MAX_WORDS], u2[uECC_MAX_WORDS];
-    uECC_word_t z[uECC_MAX_WORDS];
-    uECC_word_t sum[uECC_MAX_WORDS * 2];
-    uECC_word_t rx[uECC_MAX_WORDS];
-    uECC_word_t ry[uECC_MAX_WORDS];
-    uECC_word_t tx[uECC_MAX_WORDS];
-    uECC_word_t ty[uECC_MAX_WORDS];
-    uECC_word_t tz[uECC_MAX_WORDS];
-    const uECC_word_t *points[4];
-    const uECC_word_t *point;
-    bitcount_t num_bits;
-    bitcount_t i;
-#if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    uECC_word_t *_public = (uECC_word_t *)public_key;
-#else
-    uECC_word_t _public[uECC_MAX_WORDS * 2];
-#endif
-    uECC_word_t r[uECC_MAX_WORDS], s[uECC_MAX_WORDS];
+/* Reads r and s from signature; 0 < r, s < n. */
+static int read_signature(uECC_word_t *r,
+                          uECC_word_t *s,
+                          const uint8_t *signature,
+                          uECC_Curve curve) {
     wordcount_t num_words = curve->num_words;
     wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
 
-    rx[num_n_words - 1] = 0;
     r[num_n_words - 1] = 0;
     s[num_n_words - 1] = 0;
 
@@ -1520,9 +1590,6 @@ int uECC_verify(const uint8_t *public_key,
     bcopy((uint8_t *) r, signature, curve->num_bytes);
     bcopy((uint8_t *) s, signature + curve->num_bytes, curve->num_bytes);
 #else
-    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
-    uECC_vli_bytesToNative(
-        _public + num_words, public_key + curve->num_bytes, curve->num_bytes);
     uECC_vli_bytesToNative(r, signature, curve->num_bytes);
     uECC_vli_bytesToNative(s, signature + curve->num_bytes, curve->num_bytes);
 #endif
@@ -1537,11 +1604,61 @@ int uECC_verify(const uint8_t *public_key,
             uECC_vli_cmp_unsafe(curve->n, s, num_n_words) != 1) {
         return 0;
     }
+    return 1;
+}
+
+/* Returns the public key in native words, converted into buffer if needed. */
+static const uECC_word_t *native_public_key(uECC_word_t *buffer,
+                                            const uint8_t *public_key,
+                                            uECC_Curve curve) {
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    return (const uECC_word_t *)public_key;
+#else
+    uECC_vli_bytesToNative(buffer, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(
+        buffer + curve->num_words, public_key + curve->num_bytes, curve->num_bytes);
+    return buffer;
+#endif
+}
+
+/* Checks the signature (r, s) with z = 1/s already computed.
+   _public: public key in native words.
+   table: verification table for the public key (secp256k1 only), or NULL. */
+static int verify_with_inverse(const uECC_word_t *_public,
+                               const uint64_t *table,
+                               const uint8_t *message_hash,
+                               unsigned hash_size,
+                               const uECC_word_t *r,
+                               uECC_word_t *z,
+                               uECC_Curve curve) {
+    uECC_word_t u1[uECC_MAX_WORDS], u2[uECC_MAX_WORDS];
+    uECC_word_t sum[uECC_MAX_WORDS * 2];
+    uECC_word_t rx[uECC_MAX_WORDS];
+    uECC_word_t ry[uECC_MAX_WORDS];
+    uECC_word_t tx[uECC_MAX_WORDS];
+    uECC_word_t ty[uECC_MAX_WORDS];
+    uECC_word_t tz[uECC_MAX_WORDS];
+    const uECC_word_t *points[4];
+    const uECC_word_t *point;
+    bitcount_t num_bits;
+    bitcount_t i;
+    wordcount_t num_words = curve->num_words;
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+
+    rx[num_n_words - 1] = 0;
 
     /* Calculate u1 and u2. */
-    uECC_vli_modInv(z, s, curve->n, num_n_words); /* z = 1/s */
     u1[num_n_words - 1] = 0;
     bits2int(u1, message_hash, hash_size, curve);
+#if uECC_FIELD_FUNCS
+    if (curve == &curve_secp256k1) {
+        secp256k1_scalar_mul(u1, u1, z); /* u1 = e/s */
+        secp256k1_scalar_mul(u2, r, z); /* u2 = r/s */
+        return secp256k1_verify(u1, u2, r, _public, table);
+    }
+#else
+    (void)table;
+#endif
     uECC_vli_modMult(u1, u1, z, curve->n, num_n_words); /* u1 = e/s */
     uECC_vli_modMult(u2, r, z, curve->n, num_n_words); /* u2 = r/s */
 
@@ -1598,6 +1715,197 @@ int uECC_verify(const uint8_t *public_key,
     return (int)(uECC_vli_equal(rx, r, num_words));
 }
 
+static int uECC_verify_internal(const uint8_t *public_key,
+                                const uECC_PrecomputedKey *key,
+                                const uint64_t *table,
+                                const uint8_t *message_hash,
+                                unsigned hash_size,
+                                const uint8_t *signature,
+                                uECC_Curve curve) {
+    uECC_word_t r[uECC_MAX_WORDS], s[uECC_MAX_WORDS];
+    uECC_word_t z[uECC_MAX_WORDS];
+    uECC_word_t buffer[uECC_MAX_WORDS * 2];
+    const uECC_word_t *_public;
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+
+    if (!read_signature(r, s, signature, curve)) {
+        return 0;
+    }
+    uECC_vli_modInv(z, s, curve->n, num_n_words); /* z = 1/s */
+    if (key) {
+        /* decoded and checked once by uECC_import_public_key() */
+        _public = (const uECC_word_t *)key->point;
+    } else {
+        _public = native_public_key(buffer, public_key, curve);
+    }
+    return verify_with_inverse(_public, table, message_hash, hash_size, r, z, curve);
+}
+
+int uECC_verify(const uint8_t *public_key,
+                const uint8_t *message_hash,
+                unsigned hash_size,
+                const uint8_t *signature,
+                uECC_Curve curve) {
+    return uECC_verify_internal(public_key, 0, 0, message_hash, hash_size, signature, curve);
+}
+
+int uECC_import_public_key(const uint8_t *public_key,
+                           uECC_PrecomputedKey *key,
+                           uECC_Curve curve) {
+    uECC_word_t *point = (uECC_word_t *)key->point;
+    int i;
+    if (!uECC_valid_public_key(public_key, curve)) {
+        return 0;
+    }
+    key->curve = curve;
+    for (i = 0; i < curve->num_bytes * 2; ++i) {
+        key->public_key[i] = public_key[i];
+    }
+    uECC_vli_bytesToNative(point, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(
+        point + curve->num_words, public_key + curve->num_bytes, curve->num_bytes);
+    return 1;
+}
+
+int uECC_precompute_table(const uECC_PrecomputedKey *key, uint64_t *table) {
+#if uECC_FIELD_FUNCS
+    if (key->curve == &curve_secp256k1) {
+        secp256k1_precompute_key(table, key->point);
+        return 1;
+    }
+#endif
+    (void)table;
+    return 0;
+}
+
+int uECC_verify_precomputed(const uECC_PrecomputedKey *key,
+                            const uint64_t *table,
+                            const uint8_t *message_hash,
+                            unsigned hash_size,
+                            const uint8_t *signature) {
+    return uECC_verify_internal(key->public_key, key, table, message_hash, hash_size, signature,
+                                key->curve);
+}
+
+/* Signatures per shared inversion in uECC_verify_batch() */
+#define uECC_BATCH_SIZE 64
+
+/* Consecutive signatures by one key worth building its verification table */
+#define uECC_BATCH_TABLE_MIN 8
+
+/* The key (or raw public key) of signature i, for finding runs of the same key */
+static const void *batch_key_id(const uECC_PrecomputedKey * const *keys,
+                                const uint8_t * const *public_keys,
+                                unsigned i) {
+    if (keys && keys[i]) {
+        return keys[i];
+    }
+    return public_keys[i];
+}
+
+int uECC_verify_batch(const uECC_PrecomputedKey * const *keys,
+                      const uint64_t * const *tables,
+                      const uint8_t * const *public_keys,
+                      const uint8_t * const *message_hashes,
+                      unsigned hash_size,
+                      const uint8_t * const *signatures,
+                      unsigned count,
+                      uint8_t *results,
+                      uECC_Curve curve) {
+    uECC_word_t r[uECC_BATCH_SIZE][uECC_MAX_WORDS];
+    uECC_word_t s[uECC_BATCH_SIZE][uECC_MAX_WORDS];
+    uECC_word_t z[uECC_BATCH_SIZE][uECC_MAX_WORDS];
+    uECC_word_t acc[uECC_MAX_WORDS];
+    uint8_t valid[uECC_BATCH_SIZE];
+    const uint64_t *table = 0;
+    const void *table_key = 0;
+#if uECC_FIELD_FUNCS
+    uint64_t key_table[64 * 8];
+    unsigned run;
+#endif
+    uECC_word_t buffer[uECC_MAX_WORDS * 2];
+    const uECC_word_t *_public = 0;
+    int checked = 0;
+    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+    unsigned base, size, i;
+    int all = 1;
+
+    for (i = 0; i < (count + 7) / 8; ++i) {
+        results[i] = 0;
+    }
+    for (base = 0; base < count; base += size) {
+        size = count - base;
+        if (size > uECC_BATCH_SIZE) {
+            size = uECC_BATCH_SIZE;
+        }
+
+        /* z[i] = product of s[j] for the valid j < i */
+        uECC_vli_clear(acc, num_n_words);
+        acc[0] = 1;
+        for (i = 0; i < size; ++i) {
+            valid[i] = (uint8_t)read_signature(r[i], s[i], signatures[base + i], curve);
+            if (valid[i]) {
+                uECC_vli_set(z[i], acc, num_n_words);
+                modMult_n(acc, acc, s[i], curve);
+            }
+        }
+
+        /* One inversion for the whole chunk (Montgomery's trick), walking back with
+           acc = 1 / (product of s[j] for the valid j <= i) */
+        uECC_vli_modInv(acc, acc, curve->n, num_n_words);
+        for (i = size; i-- > 0; ) {
+            if (valid[i]) {
+                modMult_n(z[i], z[i], acc, curve); /* z = 1/s */
+                modMult_n(acc, acc, s[i], curve);
+            }
+        }
+
+        for (i = 0; i < size; ++i) {
+            unsigned index = base + i;
+            const void *key_id = batch_key_id(keys, public_keys, index);
+            if (!valid[i]) {
+                all = 0;
+                continue;
+            }
+            if (key_id != table_key) {
+                /* Decode the key once for a run of signatures by it */
+                table_key = key_id;
+                table = tables ? tables[index] : 0;
+                if (keys && keys[index]) {
+                    /* checked and decoded by uECC_import_public_key() */
+                    _public = (const uECC_word_t *)keys[index]->point;
+                    checked = 1;
+                } else {
+                    _public = native_public_key(buffer, public_keys[index], curve);
+                    checked = 0;
+                }
+            #if uECC_FIELD_FUNCS
+                /* Build the table for a long enough run of signatures by this key */
+                if (!table && curve == &curve_secp256k1) {
+                    for (run = index + 1;
+                         run < count && batch_key_id(keys, public_keys, run) == key_id;
+                         ++run) {
+                    }
+                    if (run - index >= uECC_BATCH_TABLE_MIN &&
+                            (checked || uECC_valid_public_key(public_keys[index], curve))) {
+                        secp256k1_precompute_key(key_table, _public);
+                        table = key_table;
+                    }
+                }
+            #endif
+            }
+            if (verify_with_inverse(_public, table, message_hashes[index], hash_size,
+                                    r[i], z[i], curve)) {
+                results[index / 8] |= (uint8_t)(1 << (index % 8));
+            } else {
+                all = 0;
+            }
+        }
+    }
+    (void)checked;
+    return all;
+}
+
 #if uECC_ENABLE_VLI_API
 
 unsigned uECC_curve_num_words(uECC_Curve curve) {
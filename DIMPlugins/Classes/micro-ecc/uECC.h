@@ -69,6 +69,14 @@ the same endianness. */
     #define uECC_SUPPORTS_secp256k1 1
 #endif
 
+/* uECC_FAST_secp256k1 - If enabled (defined as nonzero), secp256k1 uses a dedicated 4x64-bit
+field multiply/square with the special reduction for p = 2^256 - 2^32 - 977 (MULX/ADX on x86-64
+when the CPU supports them). Only effective with 64-bit words and 128-bit integer support;
+results are identical to the generic code. */
+#ifndef uECC_FAST_secp256k1
+    #define uECC_FAST_secp256k1 1
+#endif
+
 /* Specifies whether compressed point format is supported.
    Set to 0 to disable point compression/decompression functions. */
 #ifndef uECC_SUPPORT_COMPRESSED_POINT
@@ -360,6 +368,93 @@ int uECC_verify(const uint8_t *public_key,
                 const uint8_t *signature,
                 uECC_Curve curve);
 
+/* uECC_PrecomputedKey - a validated public key, kept in native words (about 140 bytes), for
+verifying many signatures by the same key; safe to share between threads. The table of its
+multiples is optional and kept apart (see uECC_precompute_table()). */
+typedef struct uECC_PrecomputedKey {
+    uECC_Curve curve;
+    uint8_t public_key[64];
+    uint64_t point[8];
+} uECC_PrecomputedKey;
+
+/* Size in bytes of the table from uECC_precompute_table() */
+#define uECC_PRECOMPUTED_TABLE_SIZE (64 * 8 * 8)
+
+/* uECC_import_public_key() function.
+Check a public key and keep it decoded; cheap enough to do for every key, verifying with it
+skips decoding the key again.
+
+Inputs:
+    public_key - The signer's public key.
+
+Outputs:
+    key - Will be filled in with the key.
+
+Returns 1 if the public key is valid, 0 if it is invalid.
+*/
+int uECC_import_public_key(const uint8_t *public_key,
+                           uECC_PrecomputedKey *key,
+                           uECC_Curve curve);
+
+/* uECC_precompute_table() function.
+Compute the table of multiples of a key (about 4 KB), worth it only for a key verifying many
+signatures; the table is used for secp256k1 on 64-bit platforms.
+
+Inputs:
+    key - A key from uECC_import_public_key().
+
+Outputs:
+    table - Will be filled in with uECC_PRECOMPUTED_TABLE_SIZE bytes.
+
+Returns 1 if the table is computed, 0 if the curve does not use it.
+*/
+int uECC_precompute_table(const uECC_PrecomputedKey *key, uint64_t *table);
+
+/* uECC_verify_precomputed() function.
+Verify an ECDSA signature with a key from uECC_import_public_key(), and its table from
+uECC_precompute_table() (or NULL); same result as uECC_verify() with that public key.
+
+Returns 1 if the signature is valid, 0 if it is invalid.
+*/
+int uECC_verify_precomputed(const uECC_PrecomputedKey *key,
+                            const uint64_t *table,
+                            const uint8_t *message_hash,
+                            unsigned hash_size,
+                            const uint8_t *signature);
+
+/* uECC_verify_batch() function.
+Verify a batch of ECDSA signatures; all the signatures share one modular inversion,
+and consecutive signatures by the same key (same pointer) share the verification
+table for it. Each result is the same as uECC_verify() would give.
+
+Inputs:
+    keys           - The signer's key from uECC_import_public_key() for each signature,
+                     NULL (or a NULL entry) to take the raw key from public_keys.
+    tables         - The table from uECC_precompute_table() for each key, NULL (or a NULL
+                     entry) to build one for a long run of signatures by the same key.
+    public_keys    - The signer's public key (64 bytes) for each signature without a key;
+                     checked and decoded here, may be NULL when all keys are given.
+    message_hashes - The hash of each signed data, hash_size bytes each.
+    hash_size      - The size of each message_hash in bytes.
+    signatures     - The signatures to verify.
+    count          - The number of signatures.
+
+Outputs:
+    results - Bitmap of (count + 7) / 8 bytes; bit (i % 8) of byte (i / 8) is set
+              if signature i is valid.
+
+Returns 1 if all the signatures are valid, 0 otherwise.
+*/
+int uECC_verify_batch(const uECC_PrecomputedKey * const *keys,
+                      const uint64_t * const *tables,
+                      const uint8_t * const *public_keys,
+                      const uint8_t * const *message_hashes,
+                      unsigned hash_size,
+                      const uint8_t * const *signatures,
+                      unsigned count,
+                      uint8_t *results,
+                      uECC_Curve curve);
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
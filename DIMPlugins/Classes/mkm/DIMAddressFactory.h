@@ -37,6 +37,8 @@
 
 #import <MingKeMing/MingKeMing.h>
 
+#import "DIMInternTable.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 /**
@@ -57,6 +59,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (NSUInteger)reduceMemory;
 
+/**
+ *  Cache statistics (count, capacity, hits, misses, evictions)
+ */
+@property (readonly, nonatomic) DIMInternStats statistics;
+
 @end
 
 #ifdef __cplusplus
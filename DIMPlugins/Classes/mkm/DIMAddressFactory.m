@@ -42,9 +42,12 @@
 
 #import "DIMAddressFactory.h"
 
+// max count of cached objects
+#define DIM_CACHE_CAPACITY (1 << 16)
+
 @interface DIMAddressFactory () {
     
-    NSMutableDictionary<NSString *, id<MKMAddress>> *_addresses;
+    DIMInternTable<id<MKMAddress>> *_addresses;
 }
 
 @end
@@ -53,7 +56,7 @@
 
 - (instancetype)init {
     if (self = [super init]) {
-        _addresses = [[NSMutableDictionary alloc] init];
+        _addresses = [[DIMInternTable alloc] initWithCapacity:DIM_CACHE_CAPACITY];
     }
     return self;
 }
@@ -62,8 +65,7 @@
                                      type:(MKMEntityType)network {
     id<MKMAddress> address = [meta generateAddress:network];
     NSAssert(address, @"failed to generate address: %@", meta);
-    [_addresses setObject:address forKey:address.string];
-    return address;
+    return [_addresses internObject:address forKey:address.string];
 }
 
 - (nullable id<MKMAddress>)parseAddress:(NSString *)address {
@@ -71,7 +73,7 @@
     if (!addr) {
         addr = MKMAddressCreate(address);
         if (addr) {
-            [_addresses setObject:addr forKey:address];
+            addr = [_addresses internObject:addr forKey:address];
         }
     }
     return addr;
@@ -87,9 +89,11 @@
 @implementation DIMAddressFactory (Thanos)
 
 - (NSUInteger)reduceMemory {
-    NSUInteger snap = 0;
-    snap = DIMThanos(_addresses, snap);
-    return snap;
+    return [_addresses reduceMemory];
+}
+
+- (DIMInternStats)statistics {
+    return [_addresses statistics];
 }
 
 @end
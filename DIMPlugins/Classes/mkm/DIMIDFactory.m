@@ -59,9 +59,12 @@ static inline NSString *concat(NSString *name,
     }
 }
 
+// max count of cached objects
+#define DIM_CACHE_CAPACITY (1 << 16)
+
 @interface DIMIDFactory () {
     
-    NSMutableDictionary<NSString *, id<MKMID>> *_identifiers;
+    DIMInternTable<id<MKMID>> *_identifiers;
 }
 
 @end
@@ -70,7 +73,7 @@ static inline NSString *concat(NSString *name,
 
 - (instancetype)init {
     if (self = [super init]) {
-        _identifiers = [[NSMutableDictionary alloc] init];
+        _identifiers = [[DIMInternTable alloc] initWithCapacity:DIM_CACHE_CAPACITY];
     }
     return self;
 }
@@ -90,7 +93,7 @@ static inline NSString *concat(NSString *name,
     id<MKMID> ID = [_identifiers objectForKey:string];
     if (!ID) {
         ID = [self newID:string name:name address:address terminal:location];
-        [_identifiers setObject:ID forKey:string];
+        ID = [_identifiers internObject:ID forKey:string];
     }
     return ID;
 }
@@ -100,7 +103,7 @@ static inline NSString *concat(NSString *name,
     if (!ID) {
         ID = [self parse:identifier];
         if (ID) {
-            [_identifiers setObject:ID forKey:identifier];
+            ID = [_identifiers internObject:ID forKey:identifier];
         }
     }
     return ID;
@@ -119,35 +122,55 @@ static inline NSString *concat(NSString *name,
 
 // protected
 - (nullable id<MKMID>)parse:(NSString *)identifier {
-    NSString *name;
-    id<MKMAddress> address;
-    NSString *terminal;
-    // split ID string
-    NSArray<NSString *> *pair = [identifier componentsSeparatedByString:@"/"];
-    NSAssert(pair.firstObject.length > 0, @"ID error: %@", identifier);
-    // terminal
-    if (pair.count == 1) {
-        // no terminal
-        terminal = nil;
-    } else {
-        // got terminal
-        NSAssert(pair.count == 2, @"ID error: %@", identifier);
-        NSAssert(pair.lastObject.length > 0, @"ID.terminal error: %@", identifier);
-        terminal = pair.lastObject;
+    //
+    //  scan the string once: "name@address/terminal"
+    //
+    CFStringRef string = (__bridge CFStringRef)identifier;
+    CFIndex len = CFStringGetLength(string);
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer(string, &buffer, CFRangeMake(0, len));
+    CFIndex at = kCFNotFound;     // position of '@'
+    CFIndex slash = kCFNotFound;  // position of '/'
+    UniChar ch;
+    for (CFIndex pos = 0; pos < len; ++pos) {
+        ch = CFStringGetCharacterFromInlineBuffer(&buffer, pos);
+        if (ch == '/') {
+            if (slash != kCFNotFound) {
+                NSAssert(false, @"ID error: %@", identifier);
+                return nil;
+            }
+            slash = pos;
+        } else if (ch == '@' && slash == kCFNotFound) {
+            // '@' in terminal is allowed
+            if (at != kCFNotFound) {
+                NSAssert(false, @"ID error: %@", identifier);
+                return nil;
+            }
+            at = pos;
+        }
     }
     // name @ address
-    pair = [pair.firstObject componentsSeparatedByString:@"@"];
-    NSAssert(pair.lastObject.length > 0, @"ID.address error: %@", identifier);
-    if (pair.count == 1) {
-        // got address without name
+    CFIndex head = (at == kCFNotFound) ? 0 : at + 1;
+    CFIndex tail = (slash == kCFNotFound) ? len : slash;
+    if (at == 0 || head >= tail || slash == len - 1) {
+        // empty name, address or terminal
+        NSAssert(false, @"ID error: %@", identifier);
+        return nil;
+    }
+    NSString *name;
+    NSString *terminal;
+    NSString *addr;
+    if (head == 0 && tail == len) {
+        // got address only, no need to create substring
         name = nil;
+        terminal = nil;
+        addr = identifier;
     } else {
-        // got name & address
-        NSAssert(pair.count == 2, @"ID error: %@", identifier);
-        NSAssert(pair.firstObject.length > 0, @"ID error: %@", identifier);
-        name = pair.firstObject;
+        name = at == kCFNotFound ? nil : [identifier substringToIndex:at];
+        terminal = slash == kCFNotFound ? nil : [identifier substringFromIndex:(slash + 1)];
+        addr = [identifier substringWithRange:NSMakeRange(head, tail - head)];
     }
-    address = MKMAddressParse(pair.lastObject);
+    id<MKMAddress> address = MKMAddressParse(addr);
     if (address == nil) {
         NSAssert(false, @"cannot get address from ID: %@", identifier);
         return nil;
@@ -160,9 +183,11 @@ static inline NSString *concat(NSString *name,
 @implementation DIMIDFactory (Thanos)
 
 - (NSUInteger)reduceMemory {
-    NSUInteger snap = 0;
-    snap = DIMThanos(_identifiers, snap);
-    return snap;
+    return [_identifiers reduceMemory];
+}
+
+- (DIMInternStats)statistics {
+    return [_identifiers statistics];
 }
 
 @end
@@ -0,0 +1,97 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMInternTable.h
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/3/22.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct {
+    NSUInteger count;      // cached objects
+    NSUInteger capacity;   // max objects
+    NSUInteger hits;       // found in cache
+    NSUInteger misses;     // not found
+    NSUInteger evictions;  // removed for space
+} DIMInternStats;
+
+/**
+ *  Interning Table
+ *  ~~~~~~~~~~~~~~~
+ *  Thread-safe cache for parsed objects (ID, Address, ECIES keys, ...)
+ *
+ *  The keys are spread into shards by hash, each shard has its own lock,
+ *  so threads parsing different strings seldom wait for each other;
+ *  when a shard is full, an object not used recently is evicted (CLOCK).
+ *
+ *  Looking up a cached object needs no allocation.
+ */
+@interface DIMInternTable<__covariant ObjectType> : NSObject
+
+@property (readonly, nonatomic) NSUInteger capacity;
+
+@property (readonly, nonatomic) DIMInternStats statistics;
+
+/**
+ *  Create table with max count of objects
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+NS_DESIGNATED_INITIALIZER;
+
+- (nullable ObjectType)objectForKey:(id<NSObject, NSCopying>)key;
+
+/**
+ *  Cache the object, if another object with the same key has been cached
+ *  (by another thread), return the cached one
+ *
+ * @return interned object
+ */
+- (ObjectType)internObject:(ObjectType)object forKey:(id<NSObject, NSCopying>)key;
+
+/**
+ *  Remove the cached object, if it's not replaced by another thread
+ */
+- (void)removeObject:(ObjectType)object forKey:(id<NSObject, NSCopying>)key;
+
+/**
+ *  Remove 50% of cached objects (the recently used ones survive first)
+ *
+ * @return number of survivors
+ */
+- (NSUInteger)reduceMemory;
+
+@end
+
+NS_ASSUME_NONNULL_END
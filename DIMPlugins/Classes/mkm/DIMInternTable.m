@@ -0,0 +1,304 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2024 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2024 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  DIMInternTable.m
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2024/3/22.
+//  Copyright © 2024 Albert Moky. All rights reserved.
+//
+
+#import <os/lock.h>
+
+#import "DIMInternTable.h"
+
+#define DIM_INTERN_SHARDS 16  // must be power of 2
+
+@interface DIMInternShard : NSObject {
+    
+@public
+    os_unfair_lock _lock;
+    
+    NSUInteger _hits;
+    NSUInteger _misses;
+    NSUInteger _evictions;
+}
+
+@property (readonly, nonatomic) NSUInteger capacity;
+@property (readonly, nonatomic) NSUInteger count;
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+// call with lock held
+- (nullable id)objectForKey:(id<NSObject, NSCopying>)key;
+- (nullable id)peekObjectForKey:(id<NSObject, NSCopying>)key;  // not counted
+- (void)setObject:(id)object forKey:(id<NSObject, NSCopying>)key;
+- (void)removeObjectForKey:(id<NSObject, NSCopying>)key;
+- (void)evict:(NSUInteger)count;
+
+@end
+
+@interface DIMInternShard () {
+    
+    NSMutableDictionary<id<NSCopying>, NSNumber *> *_index;  // key => slot
+    
+    __strong id *_keys;
+    __strong id *_objects;
+    uint8_t *_refs;   // recently used flags
+    NSUInteger _hand; // clock hand
+    NSUInteger _used; // slots used
+}
+
+@end
+
+@implementation DIMInternShard
+
+- (instancetype)init {
+    NSAssert(false, @"DON'T call me!");
+    return [self initWithCapacity:1];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    NSAssert(capacity > 0, @"capacity error: %lu", capacity);
+    if (self = [super init]) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _capacity = capacity;
+        _index = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+        _keys = (__strong id *)calloc(capacity, sizeof(id));
+        _objects = (__strong id *)calloc(capacity, sizeof(id));
+        _refs = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+        _hand = 0;
+        _used = 0;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _capacity; ++i) {
+        _keys[i] = nil;
+        _objects[i] = nil;
+    }
+    free(_keys);
+    free(_objects);
+    free(_refs);
+}
+
+- (NSUInteger)count {
+    return [_index count];
+}
+
+- (nullable id)objectForKey:(id<NSObject, NSCopying>)key {
+    NSNumber *slot = [_index objectForKey:key];
+    if (!slot) {
+        ++_misses;
+        return nil;
+    }
+    NSUInteger pos = [slot unsignedIntegerValue];
+    _refs[pos] = 1;
+    ++_hits;
+    return _objects[pos];
+}
+
+- (nullable id)peekObjectForKey:(id<NSObject, NSCopying>)key {
+    NSNumber *slot = [_index objectForKey:key];
+    return slot ? _objects[[slot unsignedIntegerValue]] : nil;
+}
+
+- (void)setObject:(id)object forKey:(id<NSObject, NSCopying>)key {
+    NSUInteger pos;
+    if (_used < _capacity) {
+        // take a free slot
+        pos = _used++;
+    } else {
+        // find a slot not used recently
+        pos = [self sweep];
+        if (_keys[pos]) {
+            [_index removeObjectForKey:_keys[pos]];
+            ++_evictions;
+        }
+    }
+    _keys[pos] = key;
+    _objects[pos] = object;
+    _refs[pos] = 1;
+    [_index setObject:@(pos) forKey:key];
+}
+
+- (void)removeObjectForKey:(id<NSObject, NSCopying>)key {
+    NSNumber *slot = [_index objectForKey:key];
+    if (!slot) {
+        return;
+    }
+    NSUInteger pos = [slot unsignedIntegerValue];
+    [_index removeObjectForKey:key];
+    _keys[pos] = nil;
+    _objects[pos] = nil;
+    _refs[pos] = 0;
+}
+
+// move the clock hand till a slot without 'recently used' flag
+- (NSUInteger)sweep {
+    NSUInteger pos;
+    while (YES) {
+        pos = _hand;
+        _hand = (_hand + 1) % _used;
+        if (!_keys[pos]) {
+            // empty slot
+            return pos;
+        } else if (_refs[pos]) {
+            // give it a second chance
+            _refs[pos] = 0;
+        } else {
+            return pos;
+        }
+    }
+}
+
+- (void)evict:(NSUInteger)count {
+    NSUInteger pos;
+    while (count > 0 && [_index count] > 0) {
+        pos = [self sweep];
+        if (!_keys[pos]) {
+            // empty slot
+            continue;
+        }
+        [_index removeObjectForKey:_keys[pos]];
+        _keys[pos] = nil;
+        _objects[pos] = nil;
+        _refs[pos] = 0;
+        ++_evictions;
+        --count;
+    }
+    if ([_index count] == 0) {
+        _used = 0;
+        _hand = 0;
+    }
+}
+
+@end
+
+#pragma mark -
+
+@interface DIMInternTable () {
+    
+    NSArray<DIMInternShard *> *_shards;
+}
+
+@end
+
+@implementation DIMInternTable
+
+- (instancetype)init {
+    return [self initWithCapacity:(1 << 16)];
+}
+
+/* designated initializer */
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        NSUInteger each = (capacity + DIM_INTERN_SHARDS - 1) / DIM_INTERN_SHARDS;
+        if (each == 0) {
+            each = 1;
+        }
+        NSMutableArray *shards = [[NSMutableArray alloc] initWithCapacity:DIM_INTERN_SHARDS];
+        for (NSUInteger i = 0; i < DIM_INTERN_SHARDS; ++i) {
+            [shards addObject:[[DIMInternShard alloc] initWithCapacity:each]];
+        }
+        _shards = shards;
+        _capacity = each * DIM_INTERN_SHARDS;
+    }
+    return self;
+}
+
+static inline DIMInternShard *shard_for(NSArray<DIMInternShard *> *shards, id<NSObject, NSCopying> key) {
+    NSUInteger hash = [key hash];
+    // mix high bits, NSString hash is weak in low bits for similar strings
+    hash ^= hash >> 16;
+    return [shards objectAtIndex:(hash & (DIM_INTERN_SHARDS - 1))];
+}
+
+- (nullable id)objectForKey:(id<NSObject, NSCopying>)key {
+    DIMInternShard *shard = shard_for(_shards, key);
+    id object;
+    os_unfair_lock_lock(&shard->_lock);
+    object = [shard objectForKey:key];
+    os_unfair_lock_unlock(&shard->_lock);
+    return object;
+}
+
+- (id)internObject:(id)object forKey:(id<NSObject, NSCopying>)key {
+    NSAssert(object, @"object should not be empty: %@", key);
+    DIMInternShard *shard = shard_for(_shards, key);
+    id cached;
+    os_unfair_lock_lock(&shard->_lock);
+    cached = [shard peekObjectForKey:key];
+    if (cached) {
+        // another thread parsed it first
+        object = cached;
+    } else {
+        // immutable key, so it cannot be changed outside
+        [shard setObject:object forKey:[key copyWithZone:nil]];
+    }
+    os_unfair_lock_unlock(&shard->_lock);
+    return object;
+}
+
+- (void)removeObject:(id)object forKey:(id<NSObject, NSCopying>)key {
+    DIMInternShard *shard = shard_for(_shards, key);
+    os_unfair_lock_lock(&shard->_lock);
+    if ([shard peekObjectForKey:key] == object) {
+        [shard removeObjectForKey:key];
+    }
+    os_unfair_lock_unlock(&shard->_lock);
+}
+
+- (NSUInteger)reduceMemory {
+    NSUInteger survivors = 0;
+    for (DIMInternShard *shard in _shards) {
+        os_unfair_lock_lock(&shard->_lock);
+        [shard evict:(shard.count + 1) / 2];
+        survivors += shard.count;
+        os_unfair_lock_unlock(&shard->_lock);
+    }
+    return survivors;
+}
+
+- (DIMInternStats)statistics {
+    DIMInternStats stats = {0, _capacity, 0, 0, 0};
+    for (DIMInternShard *shard in _shards) {
+        os_unfair_lock_lock(&shard->_lock);
+        stats.count += shard.count;
+        stats.hits += shard->_hits;
+        stats.misses += shard->_misses;
+        stats.evictions += shard->_evictions;
+        os_unfair_lock_unlock(&shard->_lock);
+    }
+    return stats;
+}
+
+@end
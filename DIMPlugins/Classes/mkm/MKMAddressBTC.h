@@ -67,6 +67,16 @@ NS_DESIGNATED_INITIALIZER;
  */
 + (instancetype)generate:(NSData *)fingerprint type:(MKMEntityType)network;
 
+/**
+ *  Generate addresses with fingerprints in batch
+ *
+ * @param fingerprints - meta.fingerprint or key.data list
+ * @param network      - address type
+ * @return Address objects, nil on out of memory
+ */
++ (nullable NSArray<MKMAddressBTC *> *)generateAddresses:(NSArray<NSData *> *)fingerprints
+                                           type:(MKMEntityType)network;
+
 /**
  *  Parse a string for BTC address
  *
@@ -75,6 +85,14 @@ NS_DESIGNATED_INITIALIZER;
  */
 + (instancetype)parse:(NSString *)string;
 
+/**
+ *  Parse strings for BTC addresses in batch
+ *
+ * @param strings - address strings
+ * @return Address objects, NSNull for the invalid ones; nil on out of memory
+ */
++ (nullable NSArray *)parseAddresses:(NSArray<NSString *> *)strings;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,305 @@
+// license: https://mit-license.org
+//
+//  Ming-Ke-Ming : Decentralized User Identity Authentication
+//
+//                               Written in 2020 by Moky <albert.moky@gmail.com>
+//
+// =============================================================================
+// The MIT License (MIT)
+//
+// Copyright (c) 2020 Albert Moky
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+//
+//  MKMAddressBTC.mm
+//  DIMPlugins
+//
+//  Created by Albert Moky on 2020/12/12.
+//  Copyright © 2020 Albert Moky. All rights reserved.
+//
+
+#include "sha256.h"
+#include "ripemd160.h"
+#include "base58.h"
+
+#import "MKMAddressBTC.h"
+
+// address data: network (1 byte) + digest (20 bytes) + code (4 bytes)
+#define BTC_HEAD_SIZE 21
+#define BTC_DATA_SIZE 25
+
+@interface MKMAddressBTC () {
+    
+    MKMEntityType _network;
+}
+
+@end
+
+/**
+ *  BTC address algorithm:
+ *      digest     = ripemd160(sha256(fingerprint));
+ *      check_code = sha256(sha256(network + digest)).prefix(4);
+ *      addr       = base58_encode(network + digest + check_code);
+ */
+@implementation MKMAddressBTC
+
+- (instancetype)init {
+    NSAssert(false, @"DON'T call me!");
+    NSString *string = nil;
+    return [self initWithString:string];
+}
+
+- (nullable instancetype)initWithCoder:(NSCoder *)aDecoder {
+    NSAssert(false, @"DON'T call me!");
+    NSString *string = nil;
+    return [self initWithString:string type:0];
+}
+
+- (instancetype)initWithString:(NSString *)address {
+    //NSAssert(false, @"DON'T call me!");
+    return [self initWithString:address type:0];
+}
+
+/* designated initializer */
+- (instancetype)initWithString:(NSString *)address type:(MKMEntityType)network {
+    if (self = [super initWithString:address]) {
+        _network = network;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(nullable NSZone *)zone {
+    MKMAddressBTC *address = [super copyWithZone:zone];
+    if (address) {
+        address.type = _network;
+    }
+    return address;
+}
+
+- (MKMEntityType)type {
+    return _network;
+}
+
+- (void)setType:(MKMEntityType)network {
+    _network = network;
+}
+
+- (BOOL)isBroadcast {
+    return NO;
+}
+
+- (BOOL)isUser {
+    return MKMEntityTypeIsUser(_network);
+}
+
+- (BOOL)isGroup {
+    return MKMEntityTypeIsGroup(_network);
+}
+
+#pragma mark Coding
+
+// check_code = sha256(sha256(network + digest)).prefix(4)
+static inline void check_code(const UInt8 *head, UInt8 *cc) {
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(head, BTC_HEAD_SIZE).Finalize(hash);
+    CSHA256().Write(hash, sizeof(hash)).Finalize(hash);
+    memcpy(cc, hash, 4);
+}
+
+// addr = base58_encode(network + digest + check_code)
+static inline NSString *btc_encode(const UInt8 *data) {
+    char buffer[BASE58_ENCODE_SIZE(BTC_DATA_SIZE)];
+    size_t len = EncodeBase58(data, data + BTC_DATA_SIZE, buffer, sizeof(buffer));
+    return [[NSString alloc] initWithBytes:buffer length:len encoding:NSASCIIStringEncoding];
+}
+
+// decode address data (25 bytes) from base58 string
+static inline BOOL btc_decode(NSString *string, UInt8 *data) {
+    if (string.length < 26 || string.length > 35) {
+        return NO;
+    }
+    // copy the characters to stack, no intermediate C string
+    char chars[35];
+    CFIndex len = (CFIndex)string.length;
+    CFIndex used = 0;
+    CFIndex count = CFStringGetBytes((__bridge CFStringRef)string, CFRangeMake(0, len),
+                                     kCFStringEncodingASCII, 0, false, (UInt8 *)chars, sizeof(chars), &used);
+    if (count != len) {
+        // non-ASCII character
+        return NO;
+    }
+    unsigned char buffer[BASE58_DECODE_SIZE(35)];
+    size_t size = 0;
+    if (!DecodeBase58(chars, (size_t)used, buffer, sizeof(buffer), &size)) {
+        return NO;
+    }
+    if (size != BTC_DATA_SIZE) {
+        return NO;
+    }
+    memcpy(data, buffer, BTC_DATA_SIZE);
+    return YES;
+}
+
++ (instancetype)generate:(NSData *)fingerprint type:(MKMEntityType)network {
+    UInt8 data[BTC_DATA_SIZE];
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    // 1. digest = ripemd160(sha256(fingerprint))
+    CSHA256().Write((const unsigned char *)fingerprint.bytes, fingerprint.length).Finalize(hash);
+    CRIPEMD160().Write(hash, sizeof(hash)).Finalize(data + 1);
+    // 2. head = network + digest
+    data[0] = network;
+    // 3. cc = sha256(sha256(head)).prefix(4)
+    check_code(data, data + BTC_HEAD_SIZE);
+    // 4. addr = base58_encode(_h + cc)
+    NSString *string = btc_encode(data);
+    return [[self alloc] initWithString:string type:network];
+}
+
++ (NSArray<MKMAddressBTC *> *)generateAddresses:(NSArray<NSData *> *)fingerprints
+                                           type:(MKMEntityType)network {
+    NSUInteger count = fingerprints.count;
+    if (count == 0) {
+        return @[];
+    }
+    // input pointers & lengths; sha256 digests (2 rounds), ripemd160 digests, address data
+    NSMutableData *args = [[NSMutableData alloc] initWithLength:count * (sizeof(unsigned char *) + sizeof(size_t))];
+    NSMutableData *buffer = [[NSMutableData alloc] initWithLength:count * (32 + 32 + 20 + BTC_DATA_SIZE)];
+    if (!args || !buffer) {
+        NSAssert(false, @"out of memory: %lu", count);
+        return nil;
+    }
+    const unsigned char **input = (const unsigned char **)args.mutableBytes;
+    size_t *length = (size_t *)(input + count);
+    UInt8 *hash1 = (UInt8 *)buffer.mutableBytes;
+    UInt8 *hash2 = hash1 + count * 32;
+    UInt8 *digest = hash2 + count * 32;
+    UInt8 *data = digest + count * 20;
+    NSUInteger i;
+    NSData *fingerprint;
+    for (i = 0; i < count; ++i) {
+        fingerprint = fingerprints[i];
+        input[i] = (const unsigned char *)fingerprint.bytes;
+        length[i] = fingerprint.length;
+    }
+    // 1. digest = ripemd160(sha256(fingerprint))
+    SHA256Many(hash1, input, length, count);
+    for (i = 0; i < count; ++i) {
+        input[i] = hash1 + i * 32;
+        length[i] = 32;
+    }
+    RIPEMD160Many(digest, input, length, count);
+    // 2. head = network + digest
+    for (i = 0; i < count; ++i) {
+        data[i * BTC_DATA_SIZE] = network;
+        memcpy(data + i * BTC_DATA_SIZE + 1, digest + i * 20, 20);
+        input[i] = data + i * BTC_DATA_SIZE;
+        length[i] = BTC_HEAD_SIZE;
+    }
+    // 3. cc = sha256(sha256(head)).prefix(4)
+    SHA256Many(hash1, input, length, count);
+    for (i = 0; i < count; ++i) {
+        input[i] = hash1 + i * 32;
+        length[i] = 32;
+    }
+    SHA256Many(hash2, input, length, count);
+    // 4. addr = base58_encode(_h + cc)
+    NSMutableArray<MKMAddressBTC *> *addresses = [[NSMutableArray alloc] initWithCapacity:count];
+    UInt8 *item;
+    for (i = 0; i < count; ++i) {
+        item = data + i * BTC_DATA_SIZE;
+        memcpy(item + BTC_HEAD_SIZE, hash2 + i * 32, 4);
+        [addresses addObject:[[self alloc] initWithString:btc_encode(item) type:network]];
+    }
+    return addresses;
+}
+
++ (instancetype)parse:(NSString *)string {
+    // decode
+    UInt8 data[BTC_DATA_SIZE];
+    if (!btc_decode(string, data)) {
+        return nil;
+    }
+    // Check Code
+    UInt8 cc[4];
+    check_code(data, cc);
+    if (memcmp(cc, data + BTC_HEAD_SIZE, 4) == 0) {
+        return [[self alloc] initWithString:string type:data[0]];
+    } else {
+        return nil;
+    }
+}
+
++ (NSArray *)parseAddresses:(NSArray<NSString *> *)strings {
+    NSUInteger count = strings.count;
+    if (count == 0) {
+        return @[];
+    }
+    // input pointers, lengths & indexes; address data, sha256 digests (2 rounds)
+    NSMutableData *args = [[NSMutableData alloc] initWithLength:count * (sizeof(unsigned char *) + sizeof(size_t) + sizeof(NSUInteger))];
+    NSMutableData *buffer = [[NSMutableData alloc] initWithLength:count * (BTC_DATA_SIZE + 32 + 32)];
+    if (!args || !buffer) {
+        NSAssert(false, @"out of memory: %lu", count);
+        return nil;
+    }
+    const unsigned char **input = (const unsigned char **)args.mutableBytes;
+    size_t *length = (size_t *)(input + count);
+    NSUInteger *index = (NSUInteger *)(length + count);
+    UInt8 *data = (UInt8 *)buffer.mutableBytes;
+    UInt8 *hash1 = data + count * BTC_DATA_SIZE;
+    UInt8 *hash2 = hash1 + count * 32;
+    // 1. decode
+    NSUInteger valid = 0;
+    NSUInteger i;
+    for (i = 0; i < count; ++i) {
+        if (btc_decode(strings[i], data + valid * BTC_DATA_SIZE)) {
+            input[valid] = data + valid * BTC_DATA_SIZE;
+            length[valid] = BTC_HEAD_SIZE;
+            index[valid] = i;
+            ++valid;
+        }
+    }
+    // 2. cc = sha256(sha256(head)).prefix(4)
+    SHA256Many(hash1, input, length, valid);
+    for (i = 0; i < valid; ++i) {
+        input[i] = hash1 + i * 32;
+        length[i] = 32;
+    }
+    SHA256Many(hash2, input, length, valid);
+    // 3. check
+    NSMutableArray *addresses = [[NSMutableArray alloc] initWithCapacity:count];
+    NSUInteger j = 0;
+    UInt8 *item;
+    for (i = 0; i < count; ++i) {
+        if (j < valid && index[j] == i) {
+            item = data + j * BTC_DATA_SIZE;
+            if (memcmp(hash2 + j * 32, item + BTC_HEAD_SIZE, 4) == 0) {
+                [addresses addObject:[[self alloc] initWithString:strings[i] type:item[0]]];
+            } else {
+                [addresses addObject:[NSNull null]];
+            }
+            ++j;
+        } else {
+            [addresses addObject:[NSNull null]];
+        }
+    }
+    return addresses;
+}
+
+@end
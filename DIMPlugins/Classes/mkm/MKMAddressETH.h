@@ -54,6 +54,14 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSString *)validateAddress:(NSString *)address;
 + (BOOL)isValidate:(NSString *)address;
 
+/**
+ *  Validate ETH addresses in batch
+ *
+ * @param addresses - address strings
+ * @return EIP-55 addresses, NSNull for the invalid ones; nil on out of memory
+ */
++ (nullable NSArray *)validateAddresses:(NSArray<NSString *> *)addresses;
+
 /**
  *  Generate ETH address with key.data
  *
@@ -62,6 +70,14 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (instancetype)generate:(NSData *)fingerprint;
 
+/**
+ *  Generate ETH addresses with keys in batch
+ *
+ * @param fingerprints - key.data list
+ * @return Address objects, nil on out of memory
+ */
++ (nullable NSArray<MKMAddressETH *> *)generateAddresses:(NSArray<NSData *> *)fingerprints;
+
 /**
  *  Parse a string for ETH address
  *
@@ -35,35 +35,42 @@
 //  Copyright © 2020 Albert Moky. All rights reserved.
 //
 
+#import "sha3.h"
+
 #import "MKMAddressETH.h"
 
 // https://eips.ethereum.org/EIPS/eip-55
-static inline NSString *eip55(NSString *hex) {
-    NSData *utf8 = MKMUTF8Encode(hex);
-    NSData *digest = MKMKECCAK256Digest(utf8);
-    UInt8 *origin = (UInt8 *)utf8.bytes;
-    UInt8 *hash = (UInt8 *)digest.bytes;
-    UInt8 buffer[40];
+static inline NSString *eip55(const UInt8 *hex, const UInt8 *hash) {
+    UInt8 buffer[42];
     UInt8 ch;
+    buffer[0] = '0';
+    buffer[1] = 'x';
     for (int i = 0; i < 40; ++i) {
-        ch = origin[i];
+        ch = hex[i];
         if (ch > '9') {
             // check for each 4 bits in the hash table
             // if the first bit is '1',
             //     change the character to uppercase
             ch -= (hash[i >> 1] << (i << 2 & 4) & 0x80) >> 2;
         }
-        buffer[i] = ch;
+        buffer[i + 2] = ch;
     }
-    return [[NSString alloc] initWithBytes:buffer length:40 encoding:NSUTF8StringEncoding];
+    return [[NSString alloc] initWithBytes:buffer length:42 encoding:NSUTF8StringEncoding];
 }
 
-static inline BOOL is_eth(NSString *address) {
+// copy the ASCII characters (42 bytes) into buffer and check them,
+// without creating any intermediate data
+static inline BOOL eth_chars(NSString *address, UInt8 *buffer) {
     if (address.length != 42) {
         return NO;
     }
-    NSData *data = MKMUTF8Encode(address);
-    UInt8 *buffer = (UInt8 *)data.bytes;
+    CFIndex used = 0;
+    CFIndex count = CFStringGetBytes((__bridge CFStringRef)address, CFRangeMake(0, 42),
+                                     kCFStringEncodingASCII, 0, false, buffer, 42, &used);
+    if (count != 42 || used != 42) {
+        // non-ASCII character
+        return NO;
+    }
     if (buffer[0] != '0' || buffer[1]!= 'x') {
         return NO;
     }
@@ -85,6 +92,46 @@ static inline BOOL is_eth(NSString *address) {
     return YES;
 }
 
+static inline BOOL is_eth(NSString *address) {
+    UInt8 buffer[42];
+    return eth_chars(address, buffer);
+}
+
+// copy the address body (40 chars after '0x') in lowercase
+static inline BOOL eth_body(NSString *address, UInt8 *hex) {
+    UInt8 buffer[42];
+    if (!eth_chars(address, buffer)) {
+        return NO;
+    }
+    UInt8 ch;
+    for (int i = 0; i < 40; ++i) {
+        ch = buffer[i + 2];
+        if (ch >= 'A' && ch <= 'Z') {
+            ch += 'a' - 'A';
+        }
+        hex[i] = ch;
+    }
+    return YES;
+}
+
+// address body = hex_encode(digest.suffix(20))
+static inline void eth_hex(const UInt8 *digest, UInt8 *hex) {
+    static const char alphabet[] = "0123456789abcdef";
+    const UInt8 *tail = digest + 12;
+    for (int i = 0; i < 20; ++i) {
+        hex[i << 1] = alphabet[tail[i] >> 4];
+        hex[i << 1 | 1] = alphabet[tail[i] & 0x0F];
+    }
+}
+
+static inline NSData *eth_fingerprint(NSData *fingerprint) {
+    if (fingerprint.length == 65) {
+        fingerprint = [fingerprint subdataWithRange:NSMakeRange(1, 64)];
+    }
+    NSCAssert(fingerprint.length == 64, @"key data length error: %lu", fingerprint.length);
+    return fingerprint;
+}
+
 @implementation MKMAddressETH
 
 - (MKMEntityType)type {
@@ -106,12 +153,13 @@ static inline BOOL is_eth(NSString *address) {
 #pragma mark Coding
 
 + (NSString *)validateAddress:(NSString *)address {
-    if (is_eth(address)) {
-        address = [address substringFromIndex:2];
-        address = [address lowercaseString];
-        return [NSString stringWithFormat:@"0x%@", eip55(address)];
+    UInt8 hex[40];
+    if (!eth_body(address, hex)) {
+        return nil;
     }
-    return nil;
+    UInt8 hash[32];
+    sha3_256(hash, 32, hex, 40);
+    return eip55(hex, hash);
 }
 
 + (BOOL)isValidate:(NSString *)address {
@@ -119,20 +167,103 @@ static inline BOOL is_eth(NSString *address) {
     return [validate isEqualToString:address];
 }
 
-+ (instancetype)generate:(NSData *)fingerprint {
-    if (fingerprint.length == 65) {
-        fingerprint = [fingerprint subdataWithRange:NSMakeRange(1, 64)];
++ (NSArray *)validateAddresses:(NSArray<NSString *> *)addresses {
+    NSUInteger count = addresses.count;
+    if (count == 0) {
+        return @[];
     }
-    NSAssert(fingerprint.length == 64, @"key data length error: %lu", fingerprint.length);
+    // input pointers, lengths & indexes; hex bodies, keccak256 digests
+    NSMutableData *args = [[NSMutableData alloc] initWithLength:count * (sizeof(uint8_t *) + sizeof(size_t) + sizeof(NSUInteger))];
+    NSMutableData *buffer = [[NSMutableData alloc] initWithLength:count * (40 + 32)];
+    if (!args || !buffer) {
+        NSAssert(false, @"out of memory: %lu", count);
+        return nil;
+    }
+    const uint8_t **input = (const uint8_t **)args.mutableBytes;
+    size_t *length = (size_t *)(input + count);
+    NSUInteger *index = (NSUInteger *)(length + count);
+    UInt8 *hex = (UInt8 *)buffer.mutableBytes;
+    UInt8 *hash = hex + count * 40;
+    // 1. collect valid ones
+    NSUInteger valid = 0;
+    for (NSUInteger i = 0; i < count; ++i) {
+        if (eth_body(addresses[i], hex + valid * 40)) {
+            input[valid] = hex + valid * 40;
+            length[valid] = 40;
+            index[valid] = i;
+            ++valid;
+        }
+    }
+    // 2. hash them in batch
+    keccak256_many(hash, input, length, valid);
+    // 3. build results
+    NSMutableArray *results = [[NSMutableArray alloc] initWithCapacity:count];
+    NSUInteger j = 0;
+    for (NSUInteger i = 0; i < count; ++i) {
+        if (j < valid && index[j] == i) {
+            [results addObject:eip55(hex + j * 40, hash + j * 32)];
+            ++j;
+        } else {
+            [results addObject:[NSNull null]];
+        }
+    }
+    return results;
+}
+
++ (instancetype)generate:(NSData *)fingerprint {
+    fingerprint = eth_fingerprint(fingerprint);
     // 1. digest = keccak256(fingerprint);
-    NSData *digest = MKMKECCAK256Digest(fingerprint);
+    UInt8 digest[32];
+    sha3_256(digest, 32, (const uint8_t *)fingerprint.bytes, fingerprint.length);
     // 2. address = hex_encode(digest.suffix(20));
-    NSData *tail = [digest subdataWithRange:NSMakeRange(digest.length - 20, 20)];
-    NSString *hex = MKMHexEncode(tail);
-    NSString *address = [NSString stringWithFormat:@"0x%@", eip55(hex)];
+    UInt8 hex[40];
+    eth_hex(digest, hex);
+    sha3_256(digest, 32, hex, 40);
+    NSString *address = eip55(hex, digest);
     return [[self alloc] initWithString:address];
 }
 
++ (NSArray<MKMAddressETH *> *)generateAddresses:(NSArray<NSData *> *)fingerprints {
+    NSUInteger count = fingerprints.count;
+    if (count == 0) {
+        return @[];
+    }
+    NSMutableArray<NSData *> *keys = [[NSMutableArray alloc] initWithCapacity:count];
+    // input pointers & lengths; keccak256 digests, hex bodies
+    NSMutableData *args = [[NSMutableData alloc] initWithLength:count * (sizeof(uint8_t *) + sizeof(size_t))];
+    NSMutableData *buffer = [[NSMutableData alloc] initWithLength:count * (32 + 40)];
+    if (!args || !buffer) {
+        NSAssert(false, @"out of memory: %lu", count);
+        return nil;
+    }
+    const uint8_t **input = (const uint8_t **)args.mutableBytes;
+    size_t *length = (size_t *)(input + count);
+    UInt8 *digest = (UInt8 *)buffer.mutableBytes;
+    UInt8 *hex = digest + count * 32;
+    NSData *data;
+    for (NSUInteger i = 0; i < count; ++i) {
+        data = eth_fingerprint(fingerprints[i]);
+        [keys addObject:data];  // keep it alive
+        input[i] = (const uint8_t *)data.bytes;
+        length[i] = data.length;
+    }
+    // 1. digest = keccak256(fingerprint);
+    keccak256_many(digest, input, length, count);
+    // 2. address = hex_encode(digest.suffix(20));
+    for (NSUInteger i = 0; i < count; ++i) {
+        eth_hex(digest + i * 32, hex + i * 40);
+        input[i] = hex + i * 40;
+        length[i] = 40;
+    }
+    // 3. checksum
+    keccak256_many(digest, input, length, count);
+    NSMutableArray<MKMAddressETH *> *results = [[NSMutableArray alloc] initWithCapacity:count];
+    for (NSUInteger i = 0; i < count; ++i) {
+        [results addObject:[[self alloc] initWithString:eip55(hex + i * 40, digest + i * 32)]];
+    }
+    return results;
+}
+
 + (instancetype)parse:(NSString *)string {
     if (is_eth(string)) {
         return [[self alloc] initWithString:string];
@@ -57,10 +57,14 @@ FOUNDATION_EXPORT const unsigned char DIMPluginsVersionString[];
 #define __DIM_SDK__ 1
 
 // Crypto
+#import <DIMPlugins/MKMCipherStream.h>
 #import <DIMPlugins/MKMAESKey.h>
+#import <DIMPlugins/MKMChaCha20Key.h>
 #import <DIMPlugins/MKMSecKeyHelper.h>
 #import <DIMPlugins/MKMECCPublicKey.h>
 #import <DIMPlugins/MKMECCPrivateKey.h>
+#import <DIMPlugins/MKMEd25519PublicKey.h>
+#import <DIMPlugins/MKMEd25519PrivateKey.h>
 #import <DIMPlugins/MKMRSAPublicKey.h>
 #import <DIMPlugins/MKMRSAPrivateKey.h>
 #import <DIMPlugins/MKMPrivateKey+Store.h>
@@ -73,6 +77,7 @@ FOUNDATION_EXPORT const unsigned char DIMPluginsVersionString[];
 #import <DIMPlugins/DIMBaseFileFactory.h>
 
 // MingKeMing
+#import <DIMPlugins/DIMInternTable.h>
 #import <DIMPlugins/DIMAddressFactory.h>
 #import <DIMPlugins/DIMIDFactory.h>
 #import <DIMPlugins/DIMMetaFactory.h>
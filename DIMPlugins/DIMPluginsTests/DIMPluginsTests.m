@@ -7,6 +7,8 @@
 
 #import <XCTest/XCTest.h>
 
+#import <DIMPlugins/DIMPlugins.h>
+
 @interface DIMPluginsTests : XCTestCase
 
 @end
@@ -14,23 +16,459 @@
 @implementation DIMPluginsTests
 
 - (void)setUp {
-    // Put setup code here. This method is called before the invocation of each test method in the class.
+    [MKMPlugins loadPlugins];
 }
 
 - (void)tearDown {
     // Put teardown code here. This method is called after the invocation of each test method in the class.
 }
 
-- (void)testExample {
-    // This is an example of a functional test case.
-    // Use XCTAssert and related functions to verify your tests produce the correct results.
+#pragma mark AES
+
+// bytes 0x00..0x1f, 0x00..0x0f
+static NSString *kAESKeyData = @"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=";
+static NSString *kAESKeyIV = @"AAECAwQFBgcICQoLDA0ODw==";
+
+- (void)testAESDefaultModeIsCBC {
+    // generated key without 'mode'
+    MKMAESKey *key = [[MKMAESKey alloc] initWithDictionary:@{@"algorithm": @"AES"}];
+    XCTAssertNil([key objectForKey:@"mode"]);
+    XCTAssertNotNil([key objectForKey:@"iv"], @"CBC key needs an iv");
+    
+    NSData *plaintext = [@"Hello, DIM!" dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableDictionary *params = [[NSMutableDictionary alloc] init];
+    NSData *ciphertext = [key encrypt:plaintext params:params];
+    XCTAssertEqual(ciphertext.length, 16);
+    XCTAssertEqualObjects([key decrypt:ciphertext params:params], plaintext);
+}
+
+- (void)testAESDecryptLegacyCBC {
+    // AES-256-CBC/PKCS7 ciphertext made by the CCCrypt implementation
+    NSDictionary *info = @{@"algorithm": @"AES",
+                           @"data"     : kAESKeyData,
+                           @"iv"       : kAESKeyIV,
+                           };
+    MKMAESKey *key = [[MKMAESKey alloc] initWithDictionary:info];
+    NSData *ciphertext = [[NSData alloc] initWithBase64EncodedString:@"kRzxjb+OqmXgZfO851vbGtADN7y2UYH1iywwSLowAXsAxVaqzMsT7i5GmTO2jAmW"
+                                                             options:0];
+    NSData *plaintext = [key decrypt:ciphertext params:nil];
+    NSString *text = [[NSString alloc] initWithData:plaintext encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(text, @"Hello, DIM! This is a CBC message.");
+    // and back
+    XCTAssertEqualObjects([key encrypt:plaintext params:nil], ciphertext);
+}
+
+#pragma mark ChaCha20-Poly1305
+
+static MKMChaCha20Key *chacha_key(void) {
+    // bytes 0x80..0x9f (RFC 8439, 2.8.2)
+    NSDictionary *info = @{@"algorithm": MKMAlgorithm_ChaCha20Poly1305,
+                           @"data"     : @"gIGCg4SFhoeIiYqLjI2Oj5CRkpOUlZaXmJmam5ydnp8=",
+                           };
+    return [[MKMChaCha20Key alloc] initWithDictionary:info];
+}
+
+- (void)testChaCha20Poly1305RFC8439 {
+    MKMChaCha20Key *key = chacha_key();
+    NSData *nonce = MKMHexDecode(@"070000004041424344454647");
+    NSData *aad = MKMHexDecode(@"50515253c0c1c2c3c4c5c6c7");
+    NSData *plaintext = [@"Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it."
+                         dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *expected = MKMHexDecode(@"d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+                                    @"3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+                                    @"92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+                                    @"3ff4def08e4b7a9de576d26586cec64b6116");
+    NSData *tag = MKMHexDecode(@"1ae10b594f09e26a7e902ecbd0600691");
+    
+    NSMutableData *ciphertext = [[NSMutableData alloc] initWithLength:plaintext.length];
+    NSMutableData *mac = [[NSMutableData alloc] initWithLength:16];
+    [key sealChunk:plaintext.bytes length:plaintext.length
+             nonce:nonce.bytes aad:aad.bytes aadLength:aad.length
+            output:ciphertext.mutableBytes tag:mac.mutableBytes];
+    XCTAssertEqualObjects(ciphertext, expected);
+    XCTAssertEqualObjects(mac, tag);
+    
+    NSMutableData *output = [[NSMutableData alloc] initWithLength:expected.length];
+    BOOL ok = [key openChunk:expected.bytes length:expected.length
+                       nonce:nonce.bytes aad:aad.bytes aadLength:aad.length
+                         tag:tag.bytes output:output.mutableBytes];
+    XCTAssertTrue(ok);
+    XCTAssertEqualObjects(output, plaintext);
+}
+
+- (void)testChaCha20Poly1305RejectsWrongTag {
+    MKMChaCha20Key *key = chacha_key();
+    NSData *plaintext = [@"Hello, DIM!" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *ciphertext = [key encrypt:plaintext params:nil];
+    XCTAssertEqual(ciphertext.length, 12 + plaintext.length + 16);
+    XCTAssertEqualObjects([key decrypt:ciphertext params:nil], plaintext);
+    
+    // flip one bit of the tag, then of the ciphertext
+    NSMutableData *modified = [ciphertext mutableCopy];
+    ((uint8_t *)modified.mutableBytes)[modified.length - 1] ^= 0x01;
+    XCTAssertNil([key decrypt:modified params:nil]);
+    modified = [ciphertext mutableCopy];
+    ((uint8_t *)modified.mutableBytes)[12] ^= 0x80;
+    XCTAssertNil([key decrypt:modified params:nil]);
+    // another key
+    MKMChaCha20Key *other = [[MKMChaCha20Key alloc] initWithDictionary:@{@"algorithm": MKMAlgorithm_ChaCha20Poly1305}];
+    XCTAssertNil([other decrypt:ciphertext params:nil]);
+}
+
+- (void)testChaCha20Poly1305Performance {
+    MKMChaCha20Key *key = chacha_key();
+    NSMutableData *plaintext = [[NSMutableData alloc] initWithLength:(1 << 20)];
+    [self measureBlock:^{
+        for (int i = 0; i < 64; ++i) {
+            NSData *ciphertext = [key encrypt:plaintext params:nil];
+            XCTAssertNotNil([key decrypt:ciphertext params:nil]);
+        }
+    }];
+}
+
+#pragma mark ID
+
+static NSArray<NSString *> *id_samples(void) {
+    return @[@"moky@4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgQ",
+             @"moky@4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgQ/DIM",
+             @"4WDfe3zZ4T7opFSi3iDAKiuTnUHjxmXekk",
+             @"moky@0x9527cFd9b6a0736d8417354088A4fC6e345E31F8",
+             @"anyone@anywhere",
+             @"everyone@everywhere",
+             ];
+}
+
+// the parser before single-pass scanning, for comparison
+static id<MKMID> split_parse(NSString *string) {
+    NSString *name = nil;
+    NSString *terminal = nil;
+    NSArray<NSString *> *pair = [string componentsSeparatedByString:@"/"];
+    if (pair.count > 1) {
+        terminal = pair.lastObject;
+    }
+    pair = [pair.firstObject componentsSeparatedByString:@"@"];
+    if (pair.count > 1) {
+        name = pair.firstObject;
+    }
+    id<MKMAddress> address = MKMAddressParse(pair.lastObject);
+    return [[MKMID alloc] initWithString:string name:name address:address terminal:terminal];
+}
+
+- (void)testIDParse {
+    DIMIDFactory *factory = [[DIMIDFactory alloc] init];
+    id<MKMID> ID = [factory parse:@"moky@4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgQ/DIM"];
+    XCTAssertEqualObjects(ID.name, @"moky");
+    XCTAssertEqualObjects(ID.address.string, @"4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgQ");
+    XCTAssertEqualObjects(ID.terminal, @"DIM");
+    XCTAssertTrue(ID.isUser);
+    
+    ID = [factory parse:@"4WDfe3zZ4T7opFSi3iDAKiuTnUHjxmXekk"];
+    XCTAssertNil(ID.name);
+    XCTAssertNil(ID.terminal);
+    XCTAssertEqualObjects(ID.address.string, @"4WDfe3zZ4T7opFSi3iDAKiuTnUHjxmXekk");
+    
+    ID = [factory parse:@"everyone@everywhere"];
+    XCTAssertTrue(ID.isBroadcast);
+    XCTAssertTrue(ID.isGroup);
+    
+    // same results as splitting
+    for (NSString *string in id_samples()) {
+        id<MKMID> expected = split_parse(string);
+        ID = [factory parse:string];
+        XCTAssertEqualObjects(ID.string, string);
+        XCTAssertEqualObjects(ID.name, expected.name);
+        XCTAssertEqualObjects(ID.address.string, expected.address.string);
+        XCTAssertEqualObjects(ID.terminal, expected.terminal);
+    }
+}
+
+- (void)testIDParsePerformance {
+    DIMIDFactory *factory = [[DIMIDFactory alloc] init];
+    NSArray<NSString *> *samples = id_samples();
+    [self measureBlock:^{
+        for (int i = 0; i < 20000; ++i) {
+            @autoreleasepool {
+                for (NSString *string in samples) {
+                    [factory parse:string];
+                }
+            }
+        }
+    }];
+}
+
+- (void)testIDSplitParsePerformance {
+    NSArray<NSString *> *samples = id_samples();
+    [self measureBlock:^{
+        for (int i = 0; i < 20000; ++i) {
+            @autoreleasepool {
+                for (NSString *string in samples) {
+                    split_parse(string);
+                }
+            }
+        }
+    }];
+}
+
+#pragma mark Base58
+
+// Bitcoin Core 'base58_encode_decode.json'
+static NSDictionary<NSString *, NSString *> *base58_vectors(void) {
+    return @{@"61"                                                : @"2g",
+             @"626262"                                            : @"a3gV",
+             @"636363"                                            : @"aPEr",
+             @"73696d706c792061206c6f6e6720737472696e67"          : @"2cFupjhnEsSn59qHXstmK2ffpLv2",
+             @"00eb15231dfceb60925886b67d065299925915aeb172c06647": @"1NS17iag9jJgTHD1VXjvLCEnZuQ3rJDE9L",
+             @"516b6fcd0f"                                        : @"ABnLTmg",
+             @"bf4f89001e670274dd"                                : @"3SEo3LWLoPntC",
+             @"572e4794"                                          : @"3EFU7m",
+             @"ecac89cad93923c02321"                              : @"EJDM8drfXA6uyA",
+             @"10c8511e"                                          : @"Rt5zm",
+             @"00000000000000000000"                              : @"1111111111",
+             };
+}
+
+// the byte-at-a-time conversion before limbs, for comparison
+static NSString *base58_bytewise(NSData *data) {
+    static const char alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    const uint8_t *pbegin = (const uint8_t *)data.bytes;
+    const uint8_t *pend = pbegin + data.length;
+    NSUInteger zeroes = 0;
+    while (pbegin != pend && *pbegin == 0) {
+        ++pbegin;
+        ++zeroes;
+    }
+    NSUInteger size = (pend - pbegin) * 138 / 100 + 1;
+    NSMutableData *b58 = [[NSMutableData alloc] initWithLength:size];
+    uint8_t *digits = (uint8_t *)b58.mutableBytes;
+    NSUInteger length = 0;
+    int carry;
+    NSUInteger i;
+    for (; pbegin != pend; ++pbegin) {
+        carry = *pbegin;
+        for (i = 0; (carry != 0 || i < length) && i < size; ++i) {
+            carry += 256 * digits[size - 1 - i];
+            digits[size - 1 - i] = carry % 58;
+            carry /= 58;
+        }
+        length = i;
+    }
+    NSMutableString *string = [[NSMutableString alloc] initWithCapacity:zeroes + length];
+    for (i = 0; i < zeroes; ++i) {
+        [string appendString:@"1"];
+    }
+    for (i = size - length; i < size; ++i) {
+        [string appendFormat:@"%c", alphabet[digits[i]]];
+    }
+    return string;
+}
+
+- (void)testBase58Vectors {
+    NSDictionary<NSString *, NSString *> *vectors = base58_vectors();
+    NSData *data;
+    for (NSString *hex in vectors) {
+        data = MKMHexDecode(hex);
+        XCTAssertEqualObjects(MKMBase58Encode(data), vectors[hex]);
+        XCTAssertEqualObjects(MKMBase58Decode(vectors[hex]), data);
+        XCTAssertEqualObjects(base58_bytewise(data), vectors[hex]);
+    }
+    // invalid characters
+    XCTAssertNil(MKMBase58Decode(@"3SEo3LWLoPn0C"));
+    XCTAssertNil(MKMBase58Decode(@"3SEo3LWLoPnIC"));
+}
+
+- (void)testBTCAddress {
+    // compressed public key of secret 1
+    NSData *fingerprint = MKMHexDecode(@"0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+    MKMAddressBTC *address = [MKMAddressBTC generate:fingerprint type:0x08];
+    XCTAssertEqualObjects(address.string, @"4QP6S2Gv3WZmgnJgR8mshrbHA9W6hQiTxR");
+    XCTAssertEqual(address.type, 0x08);
+    address = [MKMAddressBTC generate:fingerprint type:0x00];
+    XCTAssertEqualObjects(address.string, @"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH");
+    
+    address = [MKMAddressBTC parse:@"4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgQ"];
+    XCTAssertEqual(address.type, 0x08);
+    // check code error
+    XCTAssertNil([MKMAddressBTC parse:@"4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgR"]);
+    
+    NSArray *results = [MKMAddressBTC parseAddresses:@[@"4QP6S2Gv3WZmgnJgR8mshrbHA9W6hQiTxR",
+                                                        @"4DnqXWdTV8wuZgfqSCX9GjE2kNq7HJrUgR",
+                                                        @"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH",
+                                                        ]];
+    XCTAssertEqual(results.count, 3);
+    XCTAssertEqualObjects([results[0] string], @"4QP6S2Gv3WZmgnJgR8mshrbHA9W6hQiTxR");
+    XCTAssertEqualObjects(results[1], [NSNull null]);
+    XCTAssertEqualObjects([results[2] string], @"1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH");
 }
 
-- (void)testPerformanceExample {
-    // This is an example of a performance test case.
+- (void)testBase58Performance {
+    NSData *data = MKMHexDecode(@"0800f29f1f22d23166e47dc0ab82dca90eaddb6569c78261f1");
     [self measureBlock:^{
-        // Put the code you want to measure the time of here.
+        for (int i = 0; i < 100000; ++i) {
+            @autoreleasepool {
+                NSString *string = MKMBase58Encode(data);
+                MKMBase58Decode(string);
+            }
+        }
     }];
 }
 
+- (void)testBase58BytewisePerformance {
+    NSData *data = MKMHexDecode(@"0800f29f1f22d23166e47dc0ab82dca90eaddb6569c78261f1");
+    [self measureBlock:^{
+        for (int i = 0; i < 100000; ++i) {
+            @autoreleasepool {
+                base58_bytewise(data);
+            }
+        }
+    }];
+}
+
+#pragma mark ETH
+
+// https://eips.ethereum.org/EIPS/eip-55
+static NSArray<NSString *> *eip55_vectors(void) {
+    return @[@"0x5aAeb6053F3E94C9b9A09f33669435E7Ef1BeAed",
+             @"0xfB6916095ca1df60bB79Ce92cE3Ea74c37c5d359",
+             @"0xdbF03B407c01E7cD3CBea99509d93f8DDDC8C6FB",
+             @"0xD1220A0cf47c7B9Be7A2E6BA89F429762e7b9aDb",
+             ];
+}
+
+static NSArray<NSData *> *random_fingerprints(NSUInteger count) {
+    NSMutableArray<NSData *> *array = [[NSMutableArray alloc] initWithCapacity:count];
+    NSMutableData *data;
+    for (NSUInteger i = 0; i < count; ++i) {
+        data = [[NSMutableData alloc] initWithLength:64];
+        arc4random_buf(data.mutableBytes, 64);
+        [array addObject:data];
+    }
+    return array;
+}
+
+- (void)testETHValidateAddresses {
+    NSArray<NSString *> *vectors = eip55_vectors();
+    NSMutableArray<NSString *> *inputs = [[NSMutableArray alloc] init];
+    for (NSString *address in vectors) {
+        XCTAssertEqualObjects([MKMAddressETH validateAddress:address.lowercaseString], address);
+        XCTAssertTrue([MKMAddressETH isValidate:address]);
+        XCTAssertFalse([MKMAddressETH isValidate:address.lowercaseString]);
+        [inputs addObject:address.lowercaseString];
+    }
+    [inputs insertObject:@"0x5aAeb6053F3E94C9b9A09f33669435E7Ef1BeAe" atIndex:2];  // too short
+    [inputs addObject:@"5aAeb6053F3E94C9b9A09f33669435E7Ef1BeAed00"];            // no '0x'
+    
+    NSArray *results = [MKMAddressETH validateAddresses:inputs];
+    XCTAssertEqual(results.count, 6);
+    XCTAssertEqualObjects(results[0], vectors[0]);
+    XCTAssertEqualObjects(results[1], vectors[1]);
+    XCTAssertEqualObjects(results[2], [NSNull null]);
+    XCTAssertEqualObjects(results[3], vectors[2]);
+    XCTAssertEqualObjects(results[4], vectors[3]);
+    XCTAssertEqualObjects(results[5], [NSNull null]);
+}
+
+- (void)testETHGenerateAddresses {
+    // uncompressed public key of secret 1
+    NSData *fingerprint = MKMHexDecode(@"0479be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+                                       @"483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8");
+    NSString *expected = @"0x7E5F4552091A69125d5DfCb7b8C2659029395Bdf";
+    XCTAssertEqualObjects([MKMAddressETH generate:fingerprint].string, expected);
+    
+    NSMutableArray<NSData *> *fingerprints = [random_fingerprints(9) mutableCopy];
+    [fingerprints insertObject:fingerprint atIndex:5];
+    NSArray<MKMAddressETH *> *results = [MKMAddressETH generateAddresses:fingerprints];
+    XCTAssertEqual(results.count, 10);
+    XCTAssertEqualObjects(results[5].string, expected);
+    for (NSUInteger i = 0; i < 10; ++i) {
+        XCTAssertEqualObjects(results[i].string, [MKMAddressETH generate:fingerprints[i]].string);
+        XCTAssertTrue([MKMAddressETH isValidate:results[i].string]);
+    }
+}
+
+- (void)testETHGeneratePerformance {
+    NSArray<NSData *> *fingerprints = random_fingerprints(10000);
+    [self measureBlock:^{
+        @autoreleasepool {
+            for (NSData *fingerprint in fingerprints) {
+                [MKMAddressETH generate:fingerprint];
+            }
+        }
+    }];
+}
+
+- (void)testETHGenerateAddressesPerformance {
+    NSArray<NSData *> *fingerprints = random_fingerprints(10000);
+    [self measureBlock:^{
+        @autoreleasepool {
+            [MKMAddressETH generateAddresses:fingerprints];
+        }
+    }];
+}
+
+- (void)testKECCAK256Performance {
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:(1 << 20)];
+    [self measureBlock:^{
+        for (int i = 0; i < 64; ++i) {
+            [[MKMKECCAK256 getDigester] digest:data];
+        }
+    }];
+}
+
+#pragma mark BTC batch
+
+- (void)testBTCGenerateAddresses {
+    NSData *fingerprint = MKMHexDecode(@"0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+    NSMutableArray<NSData *> *fingerprints = [random_fingerprints(10) mutableCopy];
+    [fingerprints insertObject:fingerprint atIndex:3];
+    NSArray<MKMAddressBTC *> *results = [MKMAddressBTC generateAddresses:fingerprints type:0x08];
+    XCTAssertEqual(results.count, 11);
+    XCTAssertEqualObjects(results[3].string, @"4QP6S2Gv3WZmgnJgR8mshrbHA9W6hQiTxR");
+    for (NSUInteger i = 0; i < 11; ++i) {
+        XCTAssertEqualObjects(results[i].string, [MKMAddressBTC generate:fingerprints[i] type:0x08].string);
+        XCTAssertEqual(results[i].type, 0x08);
+    }
+}
+
+- (void)testBTCGeneratePerformance {
+    NSArray<NSData *> *fingerprints = random_fingerprints(10000);
+    [self measureBlock:^{
+        @autoreleasepool {
+            for (NSData *fingerprint in fingerprints) {
+                [MKMAddressBTC generate:fingerprint type:0x08];
+            }
+        }
+    }];
+}
+
+- (void)testBTCGenerateAddressesPerformance {
+    NSArray<NSData *> *fingerprints = random_fingerprints(10000);
+    [self measureBlock:^{
+        @autoreleasepool {
+            [MKMAddressBTC generateAddresses:fingerprints type:0x08];
+        }
+    }];
+}
+
+#pragma mark Intern table
+
+- (void)testInternTableEviction {
+    DIMInternTable<NSString *> *table = [[DIMInternTable alloc] initWithCapacity:64];
+    NSArray<NSData *> *keys = random_fingerprints(1000);
+    for (NSData *key in keys) {
+        [table internObject:[key description] forKey:key];
+    }
+    // full, but not flushed
+    DIMInternStats stats = table.statistics;
+    XCTAssertEqual(stats.count, table.capacity);
+    XCTAssertEqual(stats.evictions, 1000 - table.capacity);
+    NSData *last = keys.lastObject;
+    XCTAssertEqualObjects([table objectForKey:last], [last description]);
+    
+    // removed only when not replaced
+    [table removeObject:@"other" forKey:last];
+    XCTAssertNotNil([table objectForKey:last]);
+    [table removeObject:[table objectForKey:last] forKey:last];
+    XCTAssertNil([table objectForKey:last]);
+}
+
 @end